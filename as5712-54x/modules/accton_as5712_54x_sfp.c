@@ -45,6 +45,18 @@
 
 #define BIT_INDEX(i) (1ULL << (i))
 
+#define EEPROM_SIZE             256
+#define EEPROM_CHUNK_SIZE       I2C_SMBUS_BLOCK_MAX
+#define EEPROM_NUM_CHUNKS       (EEPROM_SIZE / EEPROM_CHUNK_SIZE)
+#define EEPROM_CHUNK_INTERVAL   (HZ + HZ / 2)
+
+/* Chunks that do not change while the module stays inserted:
+ * SFF-8472 A0h base and extended ID (0~95),
+ * SFF-8636 upper page 00h (128~255).
+ */
+#define SFP_STATIC_CHUNKS       0x07
+#define QSFP_STATIC_CHUNKS      0xF0
+
 #if 0
 static ssize_t show_status(struct device *dev, struct device_attribute *da,char *buf);
 static ssize_t set_tx_disable(struct device *dev, struct device_attribute *da,
@@ -68,7 +80,10 @@ struct as5712_54x_sfp_data {
     char                valid;           /* !=0 if registers are valid */
     unsigned long       last_updated;    /* In jiffies */
     int                 port;            /* Front port index */
-    char                eeprom[256];     /* eeprom data */
+    char                eeprom[EEPROM_SIZE]; /* eeprom data */
+    unsigned long       chunk_updated[EEPROM_NUM_CHUNKS]; /* In jiffies */
+    u8                  chunk_valid;     /* bit0:byte 0~31, bit1:32~63 and so on */
+    char                present;         /* presence the chunks were read with */
     u64                 status[4];       /* bit0:port0, bit1:port1 and so on */
                                          /* index 0 => is_present
                                                   1 => tx_fail
@@ -89,10 +104,10 @@ static const u8 cpld_to_front_port_table[] =
 
 #define CPLD_PORT_TO_FRONT_PORT(port)  (cpld_to_front_port_table[port])
 
-static struct as5712_54x_sfp_data *as5712_54x_sfp_update_device(struct device *dev, int update_eeprom);
+static struct as5712_54x_sfp_data *as5712_54x_sfp_update_device(struct device *dev);
+static int as5712_54x_sfp_update_eeprom(struct i2c_client *client, loff_t off, size_t count);
 static ssize_t show_port_number(struct device *dev, struct device_attribute *da, char *buf);
 static ssize_t show_status(struct device *dev, struct device_attribute *da, char *buf);
-static ssize_t show_eeprom(struct device *dev, struct device_attribute *da, char *buf);
 static ssize_t set_tx_disable(struct device *dev, struct device_attribute *da,
 			const char *buf, size_t count);
 static ssize_t get_lp_mode(struct device *dev, struct device_attribute *da,
@@ -126,7 +141,6 @@ static SENSOR_DEVICE_ATTR(sfp_tx_fault,    S_IRUGO, show_status, NULL, SFP_TX_FA
 static SENSOR_DEVICE_ATTR(sfp_tx_disable,  S_IWUSR | S_IRUGO, show_status, set_tx_disable, SFP_TX_DISABLE);
 static SENSOR_DEVICE_ATTR(sfp_rx_loss,     S_IRUGO, show_status,NULL, SFP_RX_LOSS);
 static SENSOR_DEVICE_ATTR(sfp_port_number,  S_IRUGO, show_port_number, NULL, SFP_PORT_NUMBER);
-static SENSOR_DEVICE_ATTR(sfp_eeprom,      S_IRUGO, show_eeprom, NULL, SFP_EEPROM);
 static SENSOR_DEVICE_ATTR(sfp_rx_los_all, S_IRUGO, show_status,NULL, SFP_RX_LOS_ALL);
 static SENSOR_DEVICE_ATTR(sfp_is_present_all, S_IRUGO, show_status,NULL, SFP_IS_PRESENT_ALL);
 static SENSOR_DEVICE_ATTR(sfp_lp_mode,     S_IWUSR | S_IRUGO, get_lp_mode, set_lp_mode, SFP_LP_MODE);
@@ -137,7 +151,6 @@ static struct attribute *as5712_54x_sfp_attributes[] = {
     &sensor_dev_attr_sfp_tx_fault.dev_attr.attr,
     &sensor_dev_attr_sfp_rx_loss.dev_attr.attr,
     &sensor_dev_attr_sfp_tx_disable.dev_attr.attr,
-    &sensor_dev_attr_sfp_eeprom.dev_attr.attr,
     &sensor_dev_attr_sfp_port_number.dev_attr.attr,
     &sensor_dev_attr_sfp_rx_los_all.dev_attr.attr,
     &sensor_dev_attr_sfp_is_present_all.dev_attr.attr,
@@ -231,7 +244,7 @@ static ssize_t show_status(struct device *dev, struct device_attribute *da,
     /*
      * The remaining attributes are gathered on a per-selected-sfp basis.
      */
-    data = as5712_54x_sfp_update_device(dev, 0);
+    data = as5712_54x_sfp_update_device(dev);
     if (attr->index == SFP_IS_PRESENT) {
         val = (data->status[attr->index] & BIT_INDEX(data->port)) ? 0 : 1;
     }
@@ -422,10 +435,22 @@ static ssize_t set_tx_disable(struct device *dev, struct device_attribute *da,
     return count;
 }
 
-static ssize_t show_eeprom(struct device *dev, struct device_attribute *da,
-             char *buf)
+static ssize_t show_eeprom(struct file *filp, struct kobject *kobj,
+             struct bin_attribute *attr, char *buf, loff_t off, size_t count)
 {
-    struct as5712_54x_sfp_data *data = as5712_54x_sfp_update_device(dev, 1);
+    struct i2c_client *client = to_i2c_client(container_of(kobj, struct device, kobj));
+    struct as5712_54x_sfp_data *data;
+    int status;
+
+    if (off >= EEPROM_SIZE) {
+        return 0;
+    }
+
+    if (off + count > EEPROM_SIZE) {
+        count = EEPROM_SIZE - off;
+    }
+
+    data = as5712_54x_sfp_update_device(&client->dev);
 
     if (!data->valid) {
         return 0;
@@ -435,13 +460,35 @@ static ssize_t show_eeprom(struct device *dev, struct device_attribute *da,
         return 0;
     }
 
-    memcpy(buf, data->eeprom, sizeof(data->eeprom));
+    mutex_lock(&data->update_lock);
 
-    return sizeof(data->eeprom);
+    status = as5712_54x_sfp_update_eeprom(client, off, count);
+    if (status == 0) {
+        memcpy(buf, data->eeprom + off, count);
+    }
+
+    mutex_unlock(&data->update_lock);
+
+    return (status < 0) ? status : count;
 }
 
+static struct bin_attribute sfp_eeprom_attr = {
+    .attr = {
+        .name = "sfp_eeprom",
+        .mode = S_IRUGO,
+    },
+    .size = EEPROM_SIZE,
+    .read = show_eeprom,
+};
+
+static struct bin_attribute *as5712_54x_sfp_bin_attributes[] = {
+    &sfp_eeprom_attr,
+    NULL
+};
+
 static const struct attribute_group as5712_54x_sfp_group = {
     .attrs = as5712_54x_sfp_attributes,
+    .bin_attrs = as5712_54x_sfp_bin_attributes,
 };
 
 static int as5712_54x_sfp_probe(struct i2c_client *client,
@@ -586,9 +633,70 @@ abort:
     return result;
 }
 
+static int as5712_54x_sfp_read_chunk(struct i2c_client *client, u8 command, u8 *data)
+{
+    int status, i;
+
+    if (i2c_check_functionality(client->adapter, I2C_FUNC_SMBUS_READ_I2C_BLOCK)) {
+        status = i2c_smbus_read_i2c_block_data(client, command, EEPROM_CHUNK_SIZE, data);
+
+        if (unlikely(status < 0)) {
+            dev_dbg(&client->dev, "sfp read block data failed, command(0x%2x), data(0x%2x)\r\n", command, status);
+            return status;
+        }
+
+        return (status == EEPROM_CHUNK_SIZE) ? 0 : -EIO;
+    }
+
+    for (i = 0; i < EEPROM_CHUNK_SIZE; i++) {
+        status = as5712_54x_sfp_read_byte(client, command + i, data + i);
+
+        if (status < 0) {
+            return status;
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * Refresh the eeprom chunks overlapping off~off+count, the caller holds
+ * update_lock and has checked the port is present.  The static chunks
+ * are read once per insertion, the others once each EEPROM_CHUNK_INTERVAL.
+ */
+static int as5712_54x_sfp_update_eeprom(struct i2c_client *client, loff_t off, size_t count)
+{
+    struct as5712_54x_sfp_data *data = i2c_get_clientdata(client);
+    u8 pinned = (data->port < SFP_PORT_MAX) ? SFP_STATIC_CHUNKS : QSFP_STATIC_CHUNKS;
+    int first = off / EEPROM_CHUNK_SIZE;
+    int last = (off + count - 1) / EEPROM_CHUNK_SIZE;
+    int i, status;
+
+    for (i = first; i <= last; i++) {
+        if ((data->chunk_valid & BIT(i)) &&
+            ((pinned & BIT(i)) || time_before(jiffies, data->chunk_updated[i] + EEPROM_CHUNK_INTERVAL))) {
+            continue;
+        }
+
+        data->chunk_valid &= ~BIT(i);
+        status = as5712_54x_sfp_read_chunk(client, i * EEPROM_CHUNK_SIZE,
+                                           (u8 *)data->eeprom + i * EEPROM_CHUNK_SIZE);
+        if (status < 0) {
+            dev_dbg(&client->dev, "unable to read eeprom from port(%d)\n",
+                                  CPLD_PORT_TO_FRONT_PORT(data->port));
+            return status;
+        }
+
+        data->chunk_valid |= BIT(i);
+        data->chunk_updated[i] = jiffies;
+    }
+
+    return 0;
+}
+
 #define ALWAYS_UPDATE_DEVICE 1
 
-static struct as5712_54x_sfp_data *as5712_54x_sfp_update_device(struct device *dev, int update_eeprom)
+static struct as5712_54x_sfp_data *as5712_54x_sfp_update_device(struct device *dev)
 {
     struct i2c_client *client = to_i2c_client(dev);
     struct as5712_54x_sfp_data *data = i2c_get_clientdata(client);
@@ -635,23 +743,10 @@ static struct as5712_54x_sfp_data *as5712_54x_sfp_update_device(struct device *d
             data->status[SFP_IS_PRESENT] |= (u64)status << 48;
         }
 
-        if (update_eeprom) {
-            /* Read eeprom data based on port number */
-            memset(data->eeprom, 0, sizeof(data->eeprom));
-
-            /* Check if the port is present */
-            if ((data->status[SFP_IS_PRESENT] & BIT_INDEX(data->port)) == 0) {
-                /* read eeprom */
-                for (i = 0; i < sizeof(data->eeprom); i++) {
-                    status = as5712_54x_sfp_read_byte(client, i, data->eeprom + i);
-
-                    if (status < 0) {
-                        dev_dbg(&client->dev, "unable to read eeprom from port(%d)\n",
-                                              CPLD_PORT_TO_FRONT_PORT(data->port));
-                        goto exit;
-                    }
-                }
-            }
+        /* A module inserted or removed invalidates all the eeprom chunks */
+        if (data->present != !(data->status[SFP_IS_PRESENT] & BIT_INDEX(data->port))) {
+            data->present = !data->present;
+            data->chunk_valid = 0;
         }
 
         data->valid = 1;
@@ -25,14 +25,9 @@
 #endif
 
 #include <linux/module.h>
-#include <linux/jiffies.h>
 #include <linux/i2c.h>
-#include <linux/hwmon.h>
 #include <linux/hwmon-sysfs.h>
-#include <linux/err.h>
-#include <linux/mutex.h>
-#include <linux/sysfs.h>
-#include <linux/slab.h>
+#include "accton_pmbus_psu.h"
 
 #define MAX_FAN_DUTY_CYCLE 100
 
@@ -40,32 +35,35 @@
  */
 static const unsigned short normal_i2c[] = { 0x3c, 0x3d, 0x3e, 0x3f, I2C_CLIENT_END };
 
-/* Each client has this additional data 
- */
-struct cpr_4011_4mxx_data {
-    struct device      *hwmon_dev;
-    struct mutex        update_lock;
-    char                valid;           /* !=0 if registers are valid */
-    unsigned long       last_updated;    /* In jiffies */
-    u8   vout_mode;     /* Register value */
-    u16  v_in;          /* Register value */
-    u16  v_out;         /* Register value */
-    u16  i_in;          /* Register value */
-    u16  i_out;         /* Register value */
-    u16  p_in;          /* Register value */
-    u16  p_out;         /* Register value */
-    u16  temp_input[2]; /* Register value */
-    u8   fan_fault;     /* Register value */
-    u16  fan_duty_cycle[2];  /* Register value */
-    u16  fan_speed[2];  /* Register value */
+/* PMBus commands behind the sysfs attributes */
+enum cpr_4011_4mxx_regs {
+    REG_P_OUT,
+    REG_VOUT_MODE,
+    REG_FAN_FAULT,
+    REG_V_IN,
+    REG_P_IN,
+    REG_V_OUT,
+    REG_I_IN,
+    REG_I_OUT,
+    REG_TEMP1,
+    REG_FAN1_DUTY_CYCLE,
+    REG_FAN1_SPEED,
+    NUM_REGS
 };
 
-static ssize_t show_linear(struct device *dev, struct device_attribute *da, char *buf);
-static ssize_t show_fan_fault(struct device *dev, struct device_attribute *da, char *buf);
-static ssize_t show_vout(struct device *dev, struct device_attribute *da, char *buf);
-static ssize_t set_fan_duty_cycle(struct device *dev, struct device_attribute *da, const char *buf, size_t count);
-static int cpr_4011_4mxx_write_word(struct i2c_client *client, u8 reg, u16 value);
-static struct cpr_4011_4mxx_data *cpr_4011_4mxx_update_device(struct device *dev);
+static const struct pmbus_psu_reg cpr_4011_4mxx_regs[NUM_REGS] = {
+    [REG_P_OUT]           = PMBUS_PSU_WORD_REG(0x96, false),
+    [REG_VOUT_MODE]       = PMBUS_PSU_BYTE_REG(0x20, true),
+    [REG_FAN_FAULT]       = PMBUS_PSU_BYTE_REG(0x81, false),
+    [REG_V_IN]            = PMBUS_PSU_WORD_REG(0x88, false),
+    [REG_P_IN]            = PMBUS_PSU_WORD_REG(0x97, false),
+    [REG_V_OUT]           = PMBUS_PSU_WORD_REG(0x8b, false),
+    [REG_I_IN]            = PMBUS_PSU_WORD_REG(0x89, false),
+    [REG_I_OUT]           = PMBUS_PSU_WORD_REG(0x8c, false),
+    [REG_TEMP1]           = PMBUS_PSU_WORD_REG(0x8d, false),
+    [REG_FAN1_DUTY_CYCLE] = PMBUS_PSU_WORD_REG(0x3b, false),
+    [REG_FAN1_SPEED]      = PMBUS_PSU_WORD_REG(0x90, false),
+};
 
 enum cpr_4011_4mxx_sysfs_attributes {
     PSU_V_IN,
@@ -78,20 +76,35 @@ enum cpr_4011_4mxx_sysfs_attributes {
     PSU_FAN1_FAULT,
     PSU_FAN1_DUTY_CYCLE,
     PSU_FAN1_SPEED,
+    NUM_VALUES
+};
+
+static const struct pmbus_psu_value cpr_4011_4mxx_values[NUM_VALUES] = {
+    [PSU_V_IN]            = PMBUS_PSU_LINEAR(REG_V_IN, 1000),
+    [PSU_V_OUT]           = PMBUS_PSU_VOUT(REG_V_OUT, REG_VOUT_MODE),
+    [PSU_I_IN]            = PMBUS_PSU_LINEAR(REG_I_IN, 1000),
+    [PSU_I_OUT]           = PMBUS_PSU_LINEAR(REG_I_OUT, 1000),
+    [PSU_P_IN]            = PMBUS_PSU_LINEAR(REG_P_IN, 1000),
+    [PSU_P_OUT]           = PMBUS_PSU_LINEAR(REG_P_OUT, 1000),
+    [PSU_TEMP1_INPUT]     = PMBUS_PSU_LINEAR(REG_TEMP1, 1000),
+    [PSU_FAN1_FAULT]      = PMBUS_PSU_FLAG(REG_FAN_FAULT, 7),
+    [PSU_FAN1_DUTY_CYCLE] = PMBUS_PSU_DUTY(REG_FAN1_DUTY_CYCLE, MAX_FAN_DUTY_CYCLE),
+    [PSU_FAN1_SPEED]      = PMBUS_PSU_LINEAR(REG_FAN1_SPEED, 1),
 };
 
 /* sysfs attributes for hwmon 
  */
-static SENSOR_DEVICE_ATTR(psu_v_in,        S_IRUGO, show_linear,      NULL, PSU_V_IN);
-static SENSOR_DEVICE_ATTR(psu_v_out,       S_IRUGO, show_vout,        NULL, PSU_V_OUT);
-static SENSOR_DEVICE_ATTR(psu_i_in,        S_IRUGO, show_linear,      NULL, PSU_I_IN);
-static SENSOR_DEVICE_ATTR(psu_i_out,       S_IRUGO, show_linear,      NULL, PSU_I_OUT);
-static SENSOR_DEVICE_ATTR(psu_p_in,        S_IRUGO, show_linear,      NULL, PSU_P_IN);
-static SENSOR_DEVICE_ATTR(psu_p_out,       S_IRUGO, show_linear,      NULL, PSU_P_OUT);
-static SENSOR_DEVICE_ATTR(psu_temp1_input, S_IRUGO, show_linear,      NULL, PSU_TEMP1_INPUT);
-static SENSOR_DEVICE_ATTR(psu_fan1_fault,  S_IRUGO, show_fan_fault,   NULL, PSU_FAN1_FAULT);
-static SENSOR_DEVICE_ATTR(psu_fan1_duty_cycle_percentage, S_IWUSR | S_IRUGO, show_linear, set_fan_duty_cycle, PSU_FAN1_DUTY_CYCLE);
-static SENSOR_DEVICE_ATTR(psu_fan1_speed_rpm, S_IRUGO, show_linear,   NULL, PSU_FAN1_SPEED);
+static SENSOR_DEVICE_ATTR(psu_v_in,        S_IRUGO, pmbus_psu_show, NULL, PSU_V_IN);
+static SENSOR_DEVICE_ATTR(psu_v_out,       S_IRUGO, pmbus_psu_show, NULL, PSU_V_OUT);
+static SENSOR_DEVICE_ATTR(psu_i_in,        S_IRUGO, pmbus_psu_show, NULL, PSU_I_IN);
+static SENSOR_DEVICE_ATTR(psu_i_out,       S_IRUGO, pmbus_psu_show, NULL, PSU_I_OUT);
+static SENSOR_DEVICE_ATTR(psu_p_in,        S_IRUGO, pmbus_psu_show, NULL, PSU_P_IN);
+static SENSOR_DEVICE_ATTR(psu_p_out,       S_IRUGO, pmbus_psu_show, NULL, PSU_P_OUT);
+static SENSOR_DEVICE_ATTR(psu_temp1_input, S_IRUGO, pmbus_psu_show, NULL, PSU_TEMP1_INPUT);
+static SENSOR_DEVICE_ATTR(psu_fan1_fault,  S_IRUGO, pmbus_psu_show, NULL, PSU_FAN1_FAULT);
+static SENSOR_DEVICE_ATTR(psu_fan1_duty_cycle_percentage, S_IWUSR | S_IRUGO, pmbus_psu_show, pmbus_psu_store, PSU_FAN1_DUTY_CYCLE);
+static SENSOR_DEVICE_ATTR(psu_fan1_speed_rpm, S_IRUGO, pmbus_psu_show, NULL, PSU_FAN1_SPEED);
+static SENSOR_DEVICE_ATTR(snapshot,        S_IRUGO, pmbus_psu_show_snapshot, NULL, 0);
 
 static struct attribute *cpr_4011_4mxx_attributes[] = {
     &sensor_dev_attr_psu_v_in.dev_attr.attr,
@@ -104,178 +117,35 @@ static struct attribute *cpr_4011_4mxx_attributes[] = {
     &sensor_dev_attr_psu_fan1_fault.dev_attr.attr,
     &sensor_dev_attr_psu_fan1_duty_cycle_percentage.dev_attr.attr,
     &sensor_dev_attr_psu_fan1_speed_rpm.dev_attr.attr,
+    &sensor_dev_attr_snapshot.dev_attr.attr,
     NULL
 };
 
-static int two_complement_to_int(u16 data, u8 valid_bit, int mask)
-{
-    u16  valid_data  = data & mask;
-    bool is_negative = valid_data >> (valid_bit - 1);
-
-    return is_negative ? (-(((~valid_data) & mask) + 1)) : valid_data;
-}
-
-static ssize_t set_fan_duty_cycle(struct device *dev, struct device_attribute *da,
-			const char *buf, size_t count)
-{
-    struct sensor_device_attribute *attr = to_sensor_dev_attr(da);
-    struct i2c_client *client = to_i2c_client(dev);
-    struct cpr_4011_4mxx_data *data = i2c_get_clientdata(client);
-    int nr = (attr->index == PSU_FAN1_DUTY_CYCLE) ? 0 : 1;
-	long speed;
-	int error;
-
-	error = kstrtol(buf, 10, &speed);
-	if (error)
-		return error;
-
-    if (speed < 0 || speed > MAX_FAN_DUTY_CYCLE)
-        return -EINVAL;
-
-    mutex_lock(&data->update_lock);
-    data->fan_duty_cycle[nr] = speed;
-    cpr_4011_4mxx_write_word(client, 0x3B + nr, data->fan_duty_cycle[nr]);
-    mutex_unlock(&data->update_lock);
-
-    return count;
-}
-
-static ssize_t show_linear(struct device *dev, struct device_attribute *da,
-             char *buf)
-{
-    struct sensor_device_attribute *attr = to_sensor_dev_attr(da);
-    struct cpr_4011_4mxx_data *data = cpr_4011_4mxx_update_device(dev);
-
-    u16 value = 0;
-    int exponent, mantissa;
-    int multiplier = 1000;
-    
-    switch (attr->index) {
-    case PSU_V_IN:
-        value = data->v_in;
-        break;
-    case PSU_I_IN:
-        value = data->i_in;
-        break;
-    case PSU_I_OUT:
-        value = data->i_out;
-        break;
-    case PSU_P_IN:
-        value = data->p_in;
-        break;
-    case PSU_P_OUT:
-        value = data->p_out;
-        break;
-    case PSU_TEMP1_INPUT:
-        value = data->temp_input[0];
-        break;
-    case PSU_FAN1_DUTY_CYCLE:
-        multiplier = 1;
-        value = data->fan_duty_cycle[0];
-        break;
-    case PSU_FAN1_SPEED:
-        multiplier = 1;
-        value = data->fan_speed[0];
-        break;
-    default:
-        break;
-    }
-    
-    exponent = two_complement_to_int(value >> 11, 5, 0x1f);
-    mantissa = two_complement_to_int(value & 0x7ff, 11, 0x7ff);
-
-    return (exponent >= 0) ? sprintf(buf, "%d\n", (mantissa << exponent) * multiplier) :
-                             sprintf(buf, "%d\n", (mantissa * multiplier) / (1 << -exponent));                      
-}
-
-static ssize_t show_fan_fault(struct device *dev, struct device_attribute *da,
-             char *buf)
-{
-    struct sensor_device_attribute *attr = to_sensor_dev_attr(da);
-    struct cpr_4011_4mxx_data *data = cpr_4011_4mxx_update_device(dev);
-
-    u8 shift = (attr->index == PSU_FAN1_FAULT) ? 7 : 6;
-
-    return sprintf(buf, "%d\n", data->fan_fault >> shift);
-}
-
-static ssize_t show_vout(struct device *dev, struct device_attribute *da,
-             char *buf)
-{
-    struct cpr_4011_4mxx_data *data = cpr_4011_4mxx_update_device(dev);
-    int exponent, mantissa;
-    int multiplier = 1000;
-
-    exponent = two_complement_to_int(data->vout_mode, 5, 0x1f);
-    mantissa = data->v_out;
-
-    return (exponent > 0) ? sprintf(buf, "%d\n", (mantissa << exponent) * multiplier) :
-                            sprintf(buf, "%d\n", (mantissa * multiplier) / (1 << -exponent));
-}
-
 static const struct attribute_group cpr_4011_4mxx_group = {
     .attrs = cpr_4011_4mxx_attributes,
 };
 
+static const struct pmbus_psu_model cpr_4011_4mxx_model = {
+    .name        = "cpr_4011_4mxx",
+    .regs        = cpr_4011_4mxx_regs,
+    .num_regs    = NUM_REGS,
+    .values      = cpr_4011_4mxx_values,
+    .num_values  = NUM_VALUES,
+    .group       = &cpr_4011_4mxx_group,
+    .status_reg  = -1,
+    .gate_reg    = -1,
+    .on_error    = PMBUS_PSU_ERR_KEEP,
+};
+
 static int cpr_4011_4mxx_probe(struct i2c_client *client,
             const struct i2c_device_id *dev_id)
 {
-    struct cpr_4011_4mxx_data *data;
-    int status;
-
-    if (!i2c_check_functionality(client->adapter, 
-        I2C_FUNC_SMBUS_BYTE_DATA | I2C_FUNC_SMBUS_WORD_DATA)) {
-        status = -EIO;
-        goto exit;
-    }
-
-    data = kzalloc(sizeof(struct cpr_4011_4mxx_data), GFP_KERNEL);
-    if (!data) {
-        status = -ENOMEM;
-        goto exit;
-    }
-
-    i2c_set_clientdata(client, data);
-    data->valid = 0;
-    mutex_init(&data->update_lock);
-
-    dev_info(&client->dev, "chip found\n");
-
-    /* Register sysfs hooks */
-    status = sysfs_create_group(&client->dev.kobj, &cpr_4011_4mxx_group);
-    if (status) {
-        goto exit_free;
-    }
-
-    data->hwmon_dev = hwmon_device_register(&client->dev);
-    if (IS_ERR(data->hwmon_dev)) {
-        status = PTR_ERR(data->hwmon_dev);
-        goto exit_remove;
-    }
-
-    dev_info(&client->dev, "%s: psu '%s'\n",
-         dev_name(data->hwmon_dev), client->name);
-    
-    return 0;
-
-exit_remove:
-    sysfs_remove_group(&client->dev.kobj, &cpr_4011_4mxx_group);
-exit_free:
-    kfree(data);
-exit:
-    
-    return status;
+    return pmbus_psu_probe(client, &cpr_4011_4mxx_model);
 }
 
 static int cpr_4011_4mxx_remove(struct i2c_client *client)
 {
-    struct cpr_4011_4mxx_data *data = i2c_get_clientdata(client);
-
-    hwmon_device_unregister(data->hwmon_dev);
-    sysfs_remove_group(&client->dev.kobj, &cpr_4011_4mxx_group);
-    kfree(data);
-    
-    return 0;
+    return pmbus_psu_remove(client);
 }
 
 static const struct i2c_device_id cpr_4011_4mxx_id[] = {
@@ -295,93 +165,6 @@ static struct i2c_driver cpr_4011_4mxx_driver = {
     .address_list = normal_i2c,
 };
 
-static int cpr_4011_4mxx_read_byte(struct i2c_client *client, u8 reg)
-{
-    return i2c_smbus_read_byte_data(client, reg);
-}
-
-static int cpr_4011_4mxx_read_word(struct i2c_client *client, u8 reg)
-{
-    return i2c_smbus_read_word_data(client, reg);
-}
-
-static int cpr_4011_4mxx_write_word(struct i2c_client *client, u8 reg, u16 value)
-{
-    return i2c_smbus_write_word_data(client, reg, value);
-}
-
-struct reg_data_byte {
-    u8   reg;
-    u8  *value;
-};
-
-struct reg_data_word {
-    u8   reg;
-    u16 *value;
-};
-
-static struct cpr_4011_4mxx_data *cpr_4011_4mxx_update_device(struct device *dev)
-{
-    struct i2c_client *client = to_i2c_client(dev);
-    struct cpr_4011_4mxx_data *data = i2c_get_clientdata(client);
-    
-    mutex_lock(&data->update_lock);
-
-    if (time_after(jiffies, data->last_updated + HZ + HZ / 2)
-        || !data->valid) {
-        int i, status;
-        struct reg_data_byte regs_byte[] = { {0x20, &data->vout_mode},
-                                             {0x81, &data->fan_fault}};
-        struct reg_data_word regs_word[] = { {0x88, &data->v_in},
-                                             {0x8b, &data->v_out},
-                                             {0x89, &data->i_in},
-                                             {0x8c, &data->i_out},
-                                             {0x96, &data->p_out},
-                                             {0x97, &data->p_in},
-                                             {0x8d, &(data->temp_input[0])},
-                                             {0x8e, &(data->temp_input[1])},
-                                             {0x3b, &(data->fan_duty_cycle[0])},
-                                             {0x3c, &(data->fan_duty_cycle[1])},
-                                             {0x90, &(data->fan_speed[0])},
-                                             {0x91, &(data->fan_speed[1])}};
-
-        dev_dbg(&client->dev, "Starting cpr_4011_4mxx update\n");
-
-        /* Read byte data */        
-        for (i = 0; i < ARRAY_SIZE(regs_byte); i++) {
-            status = cpr_4011_4mxx_read_byte(client, regs_byte[i].reg);
-            
-            if (status < 0) {
-                dev_dbg(&client->dev, "reg %d, err %d\n",
-                        regs_byte[i].reg, status);
-            }
-            else {
-                *(regs_byte[i].value) = status;
-            }
-        }
-                    
-        /* Read word data */                    
-        for (i = 0; i < ARRAY_SIZE(regs_word); i++) {
-            status = cpr_4011_4mxx_read_word(client, regs_word[i].reg);
-            
-            if (status < 0) {
-                dev_dbg(&client->dev, "reg %d, err %d\n",
-                        regs_word[i].reg, status);
-            }
-            else {
-                *(regs_word[i].value) = status;
-            }
-        }
-        
-        data->last_updated = jiffies;
-        data->valid = 1;
-    }
-
-    mutex_unlock(&data->update_lock);
-
-    return data;
-}
-
 static int __init cpr_4011_4mxx_init(void)
 {
     return i2c_add_driver(&cpr_4011_4mxx_driver);
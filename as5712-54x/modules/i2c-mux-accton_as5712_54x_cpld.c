@@ -34,11 +34,14 @@
 #include <linux/slab.h>
 #include <linux/device.h>
 #include <linux/i2c.h>
+#include <linux/srcu.h>
 #include <linux/i2c-mux.h>
 #include <linux/version.h>
 #include <linux/stat.h>
 #include <linux/hwmon-sysfs.h>
 #include <linux/delay.h>
+#include <linux/workqueue.h>
+#include <linux/kobject.h>
 
 #define I2C_RW_RETRY_COUNT				10
 #define I2C_RW_RETRY_INTERVAL			60 /* ms */
@@ -48,6 +51,7 @@
 #define NUM_OF_CPLD3_CHANS 0x1E
 #define CPLD_CHANNEL_SELECT_REG 0x2
 #define CPLD_DESELECT_CHANNEL   0xFF
+#define CPLD_CHANNEL_UNKNOWN    0xFE    /* last select write failed */
 
 #if 0
 #define NUM_OF_ALL_CPLD_CHANS (NUM_OF_CPLD2_CHANS + NUM_OF_CPLD3_CHANS)
@@ -55,14 +59,49 @@
 
 #define ACCTON_I2C_CPLD_MUX_MAX_NCHANS  NUM_OF_CPLD3_CHANS
 
-static LIST_HEAD(cpld_client_list);
-static struct mutex     list_lock;
+/*
+ * Transceiver presence is polled in the background and changes are
+ * pushed to userspace: sysfs_notify() on module_present_all and on each
+ * module_present_<n> that changed, plus a KOBJ_CHANGE uevent with
+ * PRESENT_CHANGED/PRESENT port masks (bit0 = port 1, set = present).
+ * Userspace can then sleep in poll() instead of re-reading
+ * module_present_all.
+ */
+static unsigned int present_poll_ms = 200;
+module_param(present_poll_ms, uint, S_IRUGO);
+MODULE_PARM_DESC(present_poll_ms, "transceiver presence poll interval in ms, 0 disables");
+
+/*
+ * With lazy_deselect the channel is left selected after a transfer and
+ * only switched off when the other CPLD mux on the same parent bus
+ * selects one of its channels, so back-to-back A0/A2 reads of one port
+ * cost a single select write.  Nothing else may use address 0x50/0x51
+ * on the parent bus in this mode.
+ */
+static bool lazy_deselect;
+module_param(lazy_deselect, bool, S_IRUGO);
+MODULE_PARM_DESC(lazy_deselect, "keep the mux channel selected until another one is needed");
+
+static DEFINE_SPINLOCK(lazy_lock);
+static struct as5712_54x_cpld_data *lazy_active; /* mux left selected */
+
+#define CPLD_CLIENT_MAX_ADDR    0x80    /* 7-bit addresses */
 
 struct cpld_client_node {
     struct i2c_client *client;
-    struct list_head   list;
+    struct mutex       lock;    /* held across one transaction */
 };
 
+/*
+ * CPLD clients indexed by I2C address.  The exported accessors look the
+ * client up under SRCU and hold only that CPLD's mutex across the bus
+ * transaction, so list_lock is never held across I2C.  list_lock only
+ * orders add/remove.
+ */
+static struct cpld_client_node __rcu *cpld_clients[CPLD_CLIENT_MAX_ADDR];
+static struct mutex     list_lock;
+DEFINE_STATIC_SRCU(cpld_client_srcu);
+
 enum cpld_mux_type {
     as5712_54x_cpld2,
     as5712_54x_cpld3,
@@ -73,12 +112,17 @@ struct as5712_54x_cpld_data {
     enum cpld_mux_type type;
     struct i2c_adapter *virt_adaps[ACCTON_I2C_CPLD_MUX_MAX_NCHANS];
     u8 last_chan;  /* last register value */
-#if LINUX_VERSION_CODE >= KERNEL_VERSION(4,7,0)
     struct i2c_client *client;
+    struct i2c_adapter *parent;
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4,7,0)
     struct i2c_mux_core *muxc;
 #endif
     struct device      *hwmon_dev;
     struct mutex        update_lock;
+
+    struct delayed_work present_work;
+    u64  present;       /* bit0:port1, last polled value */
+    char present_valid;
 };
 
 #if 0
@@ -130,6 +174,9 @@ enum as5712_54x_cpld1_sysfs_attributes {
 	ACCESS,
 	MODULE_PRESENT_ALL,
 	MODULE_RXLOS_ALL,
+	MODULE_TXDISABLE_ALL,
+	MODULE_LPMODE_ALL,
+	MODULE_RESET_ALL,
 	/* transceiver attributes */
 	TRANSCEIVER_PRESENT_ATTR_ID(1),
 	TRANSCEIVER_PRESENT_ATTR_ID(2),
@@ -356,12 +403,16 @@ static ssize_t set_tx_disable(struct device *dev, struct device_attribute *da,
 static ssize_t set_lp_mode(struct device *dev, struct device_attribute *da,
 			const char *buf, size_t count);
 static ssize_t set_mode_reset(struct device *dev, struct device_attribute *da,
+			const char *buf, size_t count);
+static ssize_t set_bits_all(struct device *dev, struct device_attribute *da,
 			const char *buf, size_t count);	
 static ssize_t access(struct device *dev, struct device_attribute *da,
 			const char *buf, size_t count);
 static ssize_t show_version(struct device *dev, struct device_attribute *da,
              char *buf);
 static int as5712_54x_cpld_read_internal(struct i2c_client *client, u8 reg);
+static int as5712_54x_cpld_read_block_internal(struct i2c_client *client, u8 reg,
+                                               u8 len, u8 *values);
 static int as5712_54x_cpld_write_internal(struct i2c_client *client, u8 reg, u8 value);
 
 /* transceiver attributes */
@@ -393,6 +444,9 @@ static SENSOR_DEVICE_ATTR(access, S_IWUSR, NULL, access, ACCESS);
 /* transceiver attributes */
 static SENSOR_DEVICE_ATTR(module_present_all, S_IRUGO, show_present_all, NULL, MODULE_PRESENT_ALL);
 static SENSOR_DEVICE_ATTR(module_rx_los_all, S_IRUGO, show_rxlos_all, NULL, MODULE_RXLOS_ALL);
+static SENSOR_DEVICE_ATTR(module_tx_disable_all, S_IWUSR, NULL, set_bits_all, MODULE_TXDISABLE_ALL);
+static SENSOR_DEVICE_ATTR(module_lp_mode_all, S_IWUSR, NULL, set_bits_all, MODULE_LPMODE_ALL);
+static SENSOR_DEVICE_ATTR(module_reset_all, S_IWUSR, NULL, set_bits_all, MODULE_RESET_ALL);
 DECLARE_TRANSCEIVER_PRESENT_SENSOR_DEVICE_ATTR(1);
 DECLARE_TRANSCEIVER_PRESENT_SENSOR_DEVICE_ATTR(2);
 DECLARE_TRANSCEIVER_PRESENT_SENSOR_DEVICE_ATTR(3);
@@ -519,6 +573,7 @@ static struct attribute *as5712_54x_cpld2_attributes[] = {
 	/* transceiver attributes */
 	&sensor_dev_attr_module_present_all.dev_attr.attr,
 	&sensor_dev_attr_module_rx_los_all.dev_attr.attr,
+	&sensor_dev_attr_module_tx_disable_all.dev_attr.attr,
 	DECLARE_TRANSCEIVER_PRESENT_ATTR(1),
 	DECLARE_TRANSCEIVER_PRESENT_ATTR(2),
 	DECLARE_TRANSCEIVER_PRESENT_ATTR(3),
@@ -580,6 +635,9 @@ static struct attribute *as5712_54x_cpld3_attributes[] = {
 	/* transceiver attributes */
 	&sensor_dev_attr_module_present_all.dev_attr.attr,
 	&sensor_dev_attr_module_rx_los_all.dev_attr.attr,
+	&sensor_dev_attr_module_tx_disable_all.dev_attr.attr,
+	&sensor_dev_attr_module_lp_mode_all.dev_attr.attr,
+	&sensor_dev_attr_module_reset_all.dev_attr.attr,
 	DECLARE_TRANSCEIVER_PRESENT_ATTR(25),
 	DECLARE_TRANSCEIVER_PRESENT_ATTR(26),
 	DECLARE_TRANSCEIVER_PRESENT_ATTR(27),
@@ -650,28 +708,34 @@ static const struct attribute_group as5712_54x_cpld3_group = {
 static ssize_t show_present_all(struct device *dev, struct device_attribute *da,
              char *buf)
 {
-	int i, status, num_regs = 0;
+	int i, status;
 	u8 values[4]  = {0};
-	u8 regs[] = {0x6, 0x7, 0x8, 0x14};
 	struct i2c_client *client = to_i2c_client(dev);
 	struct as5712_54x_cpld_data *data = i2c_get_clientdata(client);
 
 	mutex_lock(&data->update_lock);
 
-    num_regs = (data->type == as5712_54x_cpld2) ? 3 : 4;
+    /* 0x6-0x8 in one go, CPLD3 also has the QSFP bits in 0x14 */
+    status = as5712_54x_cpld_read_block_internal(client, 0x6, 3, values);
+    if (status < 0) {
+        goto exit;
+    }
 
-    for (i = 0; i < num_regs; i++) {
-        status = as5712_54x_cpld_read_internal(client, regs[i]);
-        
+    if (data->type == as5712_54x_cpld3) {
+        status = as5712_54x_cpld_read_internal(client, 0x14);
         if (status < 0) {
             goto exit;
         }
 
-        values[i] = ~(u8)status;
+        values[3] = status;
     }
 
 	mutex_unlock(&data->update_lock);
 
+    for (i = 0; i < ARRAY_SIZE(values); i++) {
+        values[i] = ~values[i];
+    }
+
     /* Return values 1 -> 54 in order */
     if (data->type == as5712_54x_cpld2) {
         status = sprintf(buf, "%.2x %.2x %.2x\n",
@@ -693,22 +757,16 @@ exit:
 static ssize_t show_rxlos_all(struct device *dev, struct device_attribute *da,
              char *buf)
 {
-	int i, status;
+	int status;
 	u8 values[3]  = {0};
-	u8 regs[] = {0xF, 0x10, 0x11};
 	struct i2c_client *client = to_i2c_client(dev);
 	struct as5712_54x_cpld_data *data = i2c_get_clientdata(client);
 
 	mutex_lock(&data->update_lock);
 
-    for (i = 0; i < ARRAY_SIZE(regs); i++) {
-        status = as5712_54x_cpld_read_internal(client, regs[i]);
-        
-        if (status < 0) {
-            goto exit;
-        }
-
-        values[i] = (u8)status;
+    status = as5712_54x_cpld_read_block_internal(client, 0xF, ARRAY_SIZE(values), values);
+    if (status < 0) {
+        goto exit;
     }
 
 	mutex_unlock(&data->update_lock);
@@ -953,6 +1011,79 @@ exit:
 	return status;
 }
 
+/*
+ * module_{tx_disable,lp_mode,reset}_all: "<value> [<change mask>]" in hex,
+ * bit0 = the first port of that signal on this CPLD (port 1/25 for
+ * tx_disable, 49 for lp_mode/reset), 1 = disabled/low power/in reset.
+ * Only ports in the change mask (default all) are touched, with one
+ * write per CPLD register and no read when the whole register changes.
+ */
+static ssize_t set_bits_all(struct device *dev, struct device_attribute *da,
+			const char *buf, size_t count)
+{
+    struct sensor_device_attribute *attr = to_sensor_dev_attr(da);
+	struct i2c_client *client = to_i2c_client(dev);
+	struct as5712_54x_cpld_data *data = i2c_get_clientdata(client);
+	unsigned long long value, change = ~0ULL, ports;
+	int i, status = 0, nports;
+    u8 reg, v, cm;
+
+	switch (attr->index) {
+	case MODULE_TXDISABLE_ALL:
+		reg    = 0xC;
+		nports = 24;
+		break;
+	case MODULE_LPMODE_ALL:
+		reg    = 0x16;
+		nports = 6;
+		break;
+	case MODULE_RESET_ALL:
+		reg    = 0x15;
+		nports = 6;
+		break;
+	default:
+		return -ENOENT;
+	}
+
+	if (sscanf(buf, "%llx %llx", &value, &change) < 1) {
+		return -EINVAL;
+	}
+
+    ports = (1ULL << nports) - 1;
+    if (value & ~ports) {
+        return -EINVAL;
+    }
+    change &= ports;
+
+    mutex_lock(&data->update_lock);
+    for (i = 0; i < (nports+7)/8; i++) {
+        cm = change >> (i*8);
+        v  = value >> (i*8);
+        if (!cm) {
+            continue;
+        }
+
+        if (cm != 0xff) {
+            status = as5712_54x_cpld_read_internal(client, reg + i);
+            if (unlikely(status < 0)) {
+                goto exit;
+            }
+            v = (status & ~cm) | (v & cm);
+        }
+
+        status = as5712_54x_cpld_write_internal(client, reg + i, v);
+        if (unlikely(status < 0)) {
+            goto exit;
+        }
+    }
+    mutex_unlock(&data->update_lock);
+    return count;
+
+exit:
+    mutex_unlock(&data->update_lock);
+    return status;
+}
+
 static ssize_t set_lp_mode(struct device *dev, struct device_attribute *da,
 			const char *buf, size_t count)
 {
@@ -1114,108 +1245,226 @@ static int as5712_54x_cpld_mux_reg_write(struct i2c_adapter *adap,
 
 }
 
-#if LINUX_VERSION_CODE >= KERNEL_VERSION(4,7,0)
-static int as5712_54x_cpld_mux_select_chan(struct i2c_mux_core *muxc,
-        u32 chan)
+static int as5712_54x_cpld_mux_select(struct i2c_adapter *parent,
+        struct as5712_54x_cpld_data *data, u8 regval)
 {
-    struct as5712_54x_cpld_data *data = i2c_mux_priv(muxc);
-    struct i2c_client *client = data->client;
-    u8 regval;
+    struct as5712_54x_cpld_data *prev = NULL;
+    unsigned long flags;
     int ret = 0;
-    regval = chan;
+
+    if (lazy_deselect) {
+        /* The other mux may still have a port on our parent bus */
+        spin_lock_irqsave(&lazy_lock, flags);
+        if (lazy_active && lazy_active != data && lazy_active->parent == parent) {
+            prev = lazy_active;
+            lazy_active = NULL;
+        }
+        spin_unlock_irqrestore(&lazy_lock, flags);
+
+        /* Same parent, so its lock (held by the caller) covers prev too */
+        if (prev && prev->last_chan != chips[prev->type].deselectChan) {
+            ret = as5712_54x_cpld_mux_reg_write(parent, prev->client,
+                                                chips[prev->type].deselectChan);
+            prev->last_chan = (ret < 0) ? CPLD_CHANNEL_UNKNOWN :
+                              chips[prev->type].deselectChan;
+            if (ret < 0)
+                return ret;
+        }
+    }
 
     /* Only select the channel if its different from the last channel */
     if (data->last_chan != regval) {
-        ret = as5712_54x_cpld_mux_reg_write(muxc->parent, client, regval);
-        data->last_chan = regval;
+        ret = as5712_54x_cpld_mux_reg_write(parent, data->client, regval);
+        data->last_chan = (ret < 0) ? CPLD_CHANNEL_UNKNOWN : regval;
+    }
+
+    if (lazy_deselect && ret >= 0) {
+        spin_lock_irqsave(&lazy_lock, flags);
+        lazy_active = data;
+        spin_unlock_irqrestore(&lazy_lock, flags);
     }
 
     return ret;
 }
 
-static int as5712_54x_cpld_mux_deselect_mux(struct i2c_mux_core *muxc,
-        u32 chan)
+static int as5712_54x_cpld_mux_deselect(struct i2c_adapter *parent,
+        struct as5712_54x_cpld_data *data)
 {
-    struct as5712_54x_cpld_data *data = i2c_mux_priv(muxc);
-    struct i2c_client *client = data->client;
+    u8 deselect = chips[data->type].deselectChan;
+    int ret;
+
+    /* Keep the channel, the next select on this parent switches it off */
+    if (lazy_deselect)
+        return 0;
+
+    if (data->last_chan == deselect)
+        return 0;
 
     /* Deselect active channel */
-    data->last_chan = chips[data->type].deselectChan;
+    ret = as5712_54x_cpld_mux_reg_write(parent, data->client, deselect);
+    data->last_chan = (ret < 0) ? CPLD_CHANNEL_UNKNOWN : deselect;
+
+    return ret;
+}
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4,7,0)
+static int as5712_54x_cpld_mux_select_chan(struct i2c_mux_core *muxc,
+        u32 chan)
+{
+    return as5712_54x_cpld_mux_select(muxc->parent, i2c_mux_priv(muxc), chan);
+}
 
-    return as5712_54x_cpld_mux_reg_write(muxc->parent, client, data->last_chan);
+static int as5712_54x_cpld_mux_deselect_mux(struct i2c_mux_core *muxc,
+        u32 chan)
+{
+    return as5712_54x_cpld_mux_deselect(muxc->parent, i2c_mux_priv(muxc));
 }
 #else
 
 static int as5712_54x_cpld_mux_select_chan(struct i2c_adapter *adap,
 			       void *client, u32 chan)
 {
-	struct as5712_54x_cpld_data *data = i2c_get_clientdata(client);
-	u8 regval;
-	int ret = 0;
-    regval = chan;
-
-	/* Only select the channel if its different from the last channel */
-	if (data->last_chan != regval) {
-		ret = as5712_54x_cpld_mux_reg_write(adap, client, regval);
-		data->last_chan = regval;
-	}
-
-	return ret;
+	return as5712_54x_cpld_mux_select(adap, i2c_get_clientdata(client), chan);
 }
 
 static int as5712_54x_cpld_mux_deselect_mux(struct i2c_adapter *adap,
 				void *client, u32 chan)
 {
-	struct as5712_54x_cpld_data *data = i2c_get_clientdata(client);
-
-	/* Deselect active channel */
-	data->last_chan = chips[data->type].deselectChan;
-
-	return as5712_54x_cpld_mux_reg_write(adap, client, data->last_chan);
+	return as5712_54x_cpld_mux_deselect(adap, i2c_get_clientdata(client));
 }
 
 #endif /*#if LINUX_VERSION_CODE >= KERNEL_VERSION(4,7,0)*/
 
 static void as5712_54x_cpld_add_client(struct i2c_client *client)
 {
-    struct cpld_client_node *node = kzalloc(sizeof(struct cpld_client_node), GFP_KERNEL);
+    struct cpld_client_node *node;
+
+    if (client->addr >= CPLD_CLIENT_MAX_ADDR) {
+        return;
+    }
 
+    node = kzalloc(sizeof(struct cpld_client_node), GFP_KERNEL);
     if (!node) {
         dev_dbg(&client->dev, "Can't allocate cpld_client_node (0x%x)\n", client->addr);
         return;
     }
 
     node->client = client;
+    mutex_init(&node->lock);
 
     mutex_lock(&list_lock);
-    list_add(&node->list, &cpld_client_list);
+    if (rcu_access_pointer(cpld_clients[client->addr])) {
+        /* Same address on another bus, the first one keeps the slot */
+        mutex_unlock(&list_lock);
+        dev_warn(&client->dev, "cpld 0x%x already registered\n", client->addr);
+        kfree(node);
+        return;
+    }
+    rcu_assign_pointer(cpld_clients[client->addr], node);
     mutex_unlock(&list_lock);
 }
 
 static void as5712_54x_cpld_remove_client(struct i2c_client *client)
 {
-    struct list_head    *list_node = NULL;
-    struct cpld_client_node *cpld_node = NULL;
-    int found = 0;
+    struct cpld_client_node *node = NULL;
+
+    if (client->addr >= CPLD_CLIENT_MAX_ADDR) {
+        return;
+    }
 
     mutex_lock(&list_lock);
+    node = rcu_dereference_protected(cpld_clients[client->addr],
+                                     lockdep_is_held(&list_lock));
+    if (node && node->client == client) {
+        RCU_INIT_POINTER(cpld_clients[client->addr], NULL);
+    }
+    else {
+        node = NULL;
+    }
+    mutex_unlock(&list_lock);
 
-    list_for_each(list_node, &cpld_client_list)
-    {
-        cpld_node = list_entry(list_node, struct cpld_client_node, list);
+    if (node) {
+        /* Wait for accessors still using this client */
+        synchronize_srcu(&cpld_client_srcu);
+        kfree(node);
+    }
+}
 
-        if (cpld_node->client == client) {
-            found = 1;
-            break;
-        }
+/* QSFP ports 49-54 present bits in CPLD3 register 0x14 */
+static const u8 as5712_54x_qsfp_present_bit[] = { 0, 2, 4, 1, 3, 5 };
+
+static void as5712_54x_cpld_present_notify(struct i2c_client *client,
+                                           u64 present, u64 changed)
+{
+    char name[24], env_changed[40], env_present[40];
+    char *envp[] = { env_changed, env_present, NULL };
+    int i;
+
+    for (i = 0; i < 64; i++) {
+        if (!(changed & (1ULL << i)))
+            continue;
+
+        snprintf(name, sizeof(name), "module_present_%d", i + 1);
+        sysfs_notify(&client->dev.kobj, NULL, name);
     }
+    sysfs_notify(&client->dev.kobj, NULL, "module_present_all");
 
-    if (found) {
-        list_del(list_node);
-        kfree(cpld_node);
+    snprintf(env_changed, sizeof(env_changed), "PRESENT_CHANGED=%llx", changed);
+    snprintf(env_present, sizeof(env_present), "PRESENT=%llx", present);
+    kobject_uevent_env(&client->dev.kobj, KOBJ_CHANGE, envp);
+}
+
+/* CPLD2 holds ports 1-24, CPLD3 ports 25-48 and the QSFP ports 49-54 */
+static int as5712_54x_cpld_read_present(struct as5712_54x_cpld_data *data, u64 *present)
+{
+    u8 values[3];
+    int base = (data->type == as5712_54x_cpld2) ? 0 : 24;
+    int i, status;
+
+    *present = 0;
+
+    status = as5712_54x_cpld_read_block_internal(data->client, 0x6, ARRAY_SIZE(values), values);
+    if (unlikely(status < 0))
+        return status;
+
+    for (i = 0; i < ARRAY_SIZE(values); i++)
+        *present |= (u64)(u8)~values[i] << (base + i * 8);  /* active low */
+
+    if (data->type != as5712_54x_cpld3)
+        return 0;
+
+    status = as5712_54x_cpld_read_internal(data->client, 0x14);
+    if (unlikely(status < 0))
+        return status;
+
+    for (i = 0; i < ARRAY_SIZE(as5712_54x_qsfp_present_bit); i++) {
+        if (!(status & (1 << as5712_54x_qsfp_present_bit[i])))
+            *present |= 1ULL << (48 + i);
     }
 
-    mutex_unlock(&list_lock);
+    return 0;
+}
+
+static void as5712_54x_cpld_present_work(struct work_struct *work)
+{
+    struct as5712_54x_cpld_data *data = container_of(to_delayed_work(work),
+                                        struct as5712_54x_cpld_data, present_work);
+    u64 present;
+    int status;
+
+    mutex_lock(&data->update_lock);
+    status = as5712_54x_cpld_read_present(data, &present);
+    mutex_unlock(&data->update_lock);
+
+    if (status >= 0) {
+        if (data->present_valid && present != data->present)
+            as5712_54x_cpld_present_notify(data->client, present, present ^ data->present);
+
+        data->present = present;
+        data->present_valid = 1;
+    }
+
+    schedule_delayed_work(&data->present_work, msecs_to_jiffies(present_poll_ms));
 }
 
 static ssize_t show_version(struct device *dev, struct device_attribute *attr, char *buf)
@@ -1263,7 +1512,6 @@ static int as5712_54x_cpld_mux_probe(struct i2c_client *client,
     data = i2c_mux_priv(muxc);
     i2c_set_clientdata(client, data);
     data->muxc = muxc;
-    data->client = client;
 #else
 
     data = kzalloc(sizeof(struct as5712_54x_cpld_data), GFP_KERNEL);
@@ -1272,8 +1520,11 @@ static int as5712_54x_cpld_mux_probe(struct i2c_client *client,
         goto exit;
     }
     i2c_set_clientdata(client, data);
-    mutex_init(&data->update_lock);
 #endif
+    mutex_init(&data->update_lock);
+    data->client = client;
+    data->parent = adap;
+    INIT_DELAYED_WORK(&data->present_work, as5712_54x_cpld_present_work);
     data->type = id->driver_data;
     if (data->type == as5712_54x_cpld2 || data->type == as5712_54x_cpld3) {
         data->last_chan = chips[data->type].deselectChan; /* force the first selection */
@@ -1327,6 +1578,10 @@ static int as5712_54x_cpld_mux_probe(struct i2c_client *client,
     }
 
     as5712_54x_cpld_add_client(client);
+
+    if (present_poll_ms && data->type != as5712_54x_cpld1)
+        schedule_delayed_work(&data->present_work, 0);
+
     return 0;
 
 exit_mux_register:
@@ -1342,18 +1597,37 @@ exit:
     return ret;
 }
 
+/* Switch off a channel lazy_deselect left selected and forget the mux */
+static void as5712_54x_cpld_lazy_release(struct as5712_54x_cpld_data *data)
+{
+    unsigned long flags;
+    bool active;
+
+    spin_lock_irqsave(&lazy_lock, flags);
+    active = (lazy_active == data);
+    if (active)
+        lazy_active = NULL;
+    spin_unlock_irqrestore(&lazy_lock, flags);
+
+    if (active && data->last_chan != chips[data->type].deselectChan)
+        i2c_smbus_write_byte_data(data->client, CPLD_CHANNEL_SELECT_REG,
+                                  chips[data->type].deselectChan);
+}
+
 static int as5712_54x_cpld_mux_remove(struct i2c_client *client)
 {
     struct as5712_54x_cpld_data *data = i2c_get_clientdata(client);
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(4,7,0)
     struct i2c_mux_core *muxc = data->muxc;
 
+    cancel_delayed_work_sync(&data->present_work);
     i2c_mux_del_adapters(muxc);
 #else
     const struct chip_desc *chip = &chips[data->type];
     int chan;
     const struct attribute_group *group = NULL;
 
+    cancel_delayed_work_sync(&data->present_work);
     as5712_54x_cpld_remove_client(client);
 
     /* Remove sysfs hooks */
@@ -1382,6 +1656,7 @@ static int as5712_54x_cpld_mux_remove(struct i2c_client *client)
         }
     }
 #endif
+    as5712_54x_cpld_lazy_release(data);
     kfree(data);
 
     return 0;
@@ -1405,6 +1680,45 @@ static int as5712_54x_cpld_read_internal(struct i2c_client *client, u8 reg)
     return status;
 }
 
+/*
+ * Read len consecutive registers, in a single I2C block read when the
+ * adapter supports it, register by register otherwise.
+ */
+static int as5712_54x_cpld_read_block_internal(struct i2c_client *client, u8 reg,
+                                               u8 len, u8 *values)
+{
+    int status = 0, retry = I2C_RW_RETRY_COUNT, i;
+
+    if (!i2c_check_functionality(client->adapter, I2C_FUNC_SMBUS_READ_I2C_BLOCK)) {
+        for (i = 0; i < len; i++) {
+            status = as5712_54x_cpld_read_internal(client, reg + i);
+            if (unlikely(status < 0)) {
+                return status;
+            }
+
+            values[i] = status;
+        }
+        return len;
+    }
+
+    while (retry) {
+        status = i2c_smbus_read_i2c_block_data(client, reg, len, values);
+        if (unlikely(status < 0)) {
+            msleep(I2C_RW_RETRY_INTERVAL);
+            retry--;
+            continue;
+        }
+
+        break;
+    }
+
+    if (unlikely(status >= 0 && status != len)) {
+        return -EIO;
+    }
+
+    return status;
+}
+
 static int as5712_54x_cpld_write_internal(struct i2c_client *client, u8 reg, u8 value)
 {
     int status = 0, retry = I2C_RW_RETRY_COUNT;
@@ -1425,23 +1739,21 @@ static int as5712_54x_cpld_write_internal(struct i2c_client *client, u8 reg, u8
 
 int as5712_54x_cpld_read(unsigned short cpld_addr, u8 reg)
 {
-    struct list_head   *list_node = NULL;
-    struct cpld_client_node *cpld_node = NULL;
-    int ret = -EPERM;
-
-    mutex_lock(&list_lock);
-
-    list_for_each(list_node, &cpld_client_list)
-    {
-        cpld_node = list_entry(list_node, struct cpld_client_node, list);
+    struct cpld_client_node *node;
+    int ret = -EPERM, idx;
 
-        if (cpld_node->client->addr == cpld_addr) {
-            ret = as5712_54x_cpld_read_internal(cpld_node->client, reg);
-            break;
-        }
+    if (cpld_addr >= CPLD_CLIENT_MAX_ADDR) {
+        return ret;
     }
 
-    mutex_unlock(&list_lock);
+    idx = srcu_read_lock(&cpld_client_srcu);
+    node = srcu_dereference(cpld_clients[cpld_addr], &cpld_client_srcu);
+    if (node) {
+        mutex_lock(&node->lock);
+        ret = as5712_54x_cpld_read_internal(node->client, reg);
+        mutex_unlock(&node->lock);
+    }
+    srcu_read_unlock(&cpld_client_srcu, idx);
 
     return ret;
 }
@@ -1449,23 +1761,21 @@ EXPORT_SYMBOL(as5712_54x_cpld_read);
 
 int as5712_54x_cpld_write(unsigned short cpld_addr, u8 reg, u8 value)
 {
-    struct list_head   *list_node = NULL;
-    struct cpld_client_node *cpld_node = NULL;
-    int ret = -EIO;
-
-    mutex_lock(&list_lock);
+    struct cpld_client_node *node;
+    int ret = -EIO, idx;
 
-    list_for_each(list_node, &cpld_client_list)
-    {
-        cpld_node = list_entry(list_node, struct cpld_client_node, list);
-
-        if (cpld_node->client->addr == cpld_addr) {
-            ret = as5712_54x_cpld_write_internal(cpld_node->client, reg, value);
-            break;
-        }
+    if (cpld_addr >= CPLD_CLIENT_MAX_ADDR) {
+        return ret;
     }
 
-    mutex_unlock(&list_lock);
+    idx = srcu_read_lock(&cpld_client_srcu);
+    node = srcu_dereference(cpld_clients[cpld_addr], &cpld_client_srcu);
+    if (node) {
+        mutex_lock(&node->lock);
+        ret = as5712_54x_cpld_write_internal(node->client, reg, value);
+        mutex_unlock(&node->lock);
+    }
+    srcu_read_unlock(&cpld_client_srcu, idx);
 
     return ret;
 }
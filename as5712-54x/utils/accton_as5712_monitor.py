@@ -30,12 +30,14 @@ try:
     import imp
     import logging
     import logging.config
+    import logging.handlers
     import types
     import time  # this is only being used as part of the example
     import traceback
     from tabulate import tabulate
     from as5712_54x.fanutil import FanUtil
     from as5712_54x.thermalutil import ThermalUtil
+    from as5712_54x.monitorutil import SysfsCache, MonitorScheduler
 except ImportError as e:
     raise ImportError('%s - required module not found' % str(e))
 
@@ -72,8 +74,92 @@ class accton_as5712_monitor(object):
             console.setFormatter(formatter)
             logging.getLogger('').addHandler(console)
 
+        # the alarms of the FAN and PSU tasks go to syslog as well
+        sys_handler = logging.handlers.SysLogHandler(address = '/dev/log')
+        sys_handler.setLevel(logging.INFO)
+        logging.getLogger('').addHandler(sys_handler)
+
         logging.debug('SET. logfile:%s / loglevel:%d', log_file, log_level)
 
+        # one cache for every task: a node is read once per tick
+        self.cache = SysfsCache()
+        self.thermal = ThermalUtil(self.cache)
+        self.fan = FanUtil(self.cache)
+
+        self.fan_num = 5
+        self.fan_path = "/sys/devices/platform/as5712_54x_fan/"
+        self.fan_status_state = [2] * self.fan_num  #init state=2, fault=1, normal=0
+
+        self.psu_num = 2
+        self.psu_path = "/sys/bus/i2c/devices/"
+        self.psu_mapping = {
+            0: "57-0050",
+            1: "58-0053",
+        }
+        self.psu_state = [2, 2]
+        self.psu_power_status = [2, 2]
+
+    def manage_fan_status(self):
+        """FAN fault alarms"""
+        FAN_STATUS_FAULT = 1
+        FAN_STATUS_NORMAL = 0
+
+        for idx in range (0, self.fan_num):
+            content = self.cache.read(self.fan_path + 'fan%d_fault' % (idx+1))
+            if content is None:
+                return False
+            # content is a string, either "0" or "1"
+            if content == "1":
+                if self.fan_status_state[idx]!=FAN_STATUS_FAULT:
+                    logging.warning("Alarm for FAN-%d fault is detected", idx+1)
+                    self.fan_status_state[idx]=FAN_STATUS_FAULT
+            else:
+                if self.fan_status_state[idx]!=FAN_STATUS_NORMAL:
+                    self.fan_status_state[idx]=FAN_STATUS_NORMAL
+                    logging.info("FAN-%d normal is detected", idx+1)
+
+        return True
+
+    def manage_psu(self):
+        """PSU present and power good alarms"""
+        PSU_STATE_REMOVE = 0
+        PSU_STATE_INSERT = 1
+
+        PSU_STATUS_NO_POWER = 0
+        PSU_STATUS_POWER_GOOD = 1
+
+        for idx in range (0, self.psu_num):
+            content = self.cache.read(self.psu_path + self.psu_mapping[idx] + '/psu_present')
+            if content is None:
+                return False
+            # content is a string, either "0" or "1"
+            if content == "1":
+                if self.psu_state[idx]!=PSU_STATE_INSERT:
+                    self.psu_state[idx]=PSU_STATE_INSERT
+                    logging.info("PSU-%d present is detected", idx+1)
+            else:
+                if self.psu_state[idx]!=PSU_STATE_REMOVE:
+                    self.psu_state[idx]=PSU_STATE_REMOVE
+                    logging.warning("Alarm for PSU-%d absent is detected", idx+1)
+                    self.psu_power_status[idx]=PSU_STATUS_NO_POWER
+
+        for idx in range (0, self.psu_num):
+            content = self.cache.read(self.psu_path + self.psu_mapping[idx] + '/psu_power_good')
+            if content is None:
+                return False
+            # content is a string, either "0" or "1"
+            if content == "0":
+                if self.psu_power_status[idx]!=PSU_STATUS_NO_POWER:
+                    if self.psu_state[idx]==PSU_STATE_INSERT:
+                        logging.warning("Alarm for PSU-%d fault is detected", idx+1)
+                        self.psu_power_status[idx]=PSU_STATUS_NO_POWER
+            else:
+                if self.psu_power_status[idx] !=PSU_STATUS_POWER_GOOD:
+                    logging.info("PSU-%d power_good is detected", idx+1)
+                    self.psu_power_status[idx]=PSU_STATUS_POWER_GOOD
+
+        return True
+
     def manage_fans(self):
         FAN_LEV1_UP_TEMP = 57500  # temperature
         FAN_LEV1_DOWN_TEMP = 0    # unused
@@ -92,8 +178,8 @@ class accton_as5712_monitor(object):
         FAN_LEV4_SPEED_PERC = 40
 
 
-        thermal = ThermalUtil()
-        fan = FanUtil()
+        thermal = self.thermal
+        fan = self.fan
 
         temp1 = thermal.get_thermal_1_val()
         if temp1 is None:
@@ -185,11 +271,13 @@ def main(argv):
                 log_file = arg
 
     monitor = accton_as5712_monitor(log_file, log_level)
+    scheduler = MonitorScheduler(monitor.cache)
+    scheduler.register('fan policy', 1, monitor.manage_fans)
+    scheduler.register('fan status', 3, monitor.manage_fan_status)
+    scheduler.register('psu status', 3, monitor.manage_psu)
 
     # Loop forever, doing something useful hopefully:
-    while True:
-        monitor.manage_fans()
-        time.sleep(1)
+    scheduler.run()
 
 if __name__ == '__main__':
     main(sys.argv[1:])
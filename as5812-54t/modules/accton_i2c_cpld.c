@@ -25,17 +25,26 @@
 #include <linux/module.h>
 #include <linux/i2c.h>
 #include <linux/slab.h>
-#include <linux/list.h>
+#include <linux/srcu.h>
 #include <linux/dmi.h>
 
-static LIST_HEAD(cpld_client_list);
-static struct mutex	 list_lock;
+#define CPLD_CLIENT_MAX_ADDR	0x80	/* 7-bit addresses */
 
 struct cpld_client_node {
 	struct i2c_client *client;
-	struct list_head   list;
+	struct mutex       lock;	/* held across one transaction */
 };
 
+/*
+ * CPLD clients indexed by I2C address.  The exported accessors look the
+ * client up under SRCU and hold only that CPLD's mutex across the bus
+ * transaction, so CPLDs on different buses are accessed concurrently.
+ * list_lock only orders add/remove.
+ */
+static struct cpld_client_node __rcu *cpld_clients[CPLD_CLIENT_MAX_ADDR];
+static struct mutex	 list_lock;
+DEFINE_STATIC_SRCU(cpld_client_srcu);
+
 /* Addresses scanned for accton_i2c_cpld
  */
 static const unsigned short normal_i2c[] = { 0x31, 0x35, 0x60, 0x61, 0x62, 0x64, I2C_CLIENT_END };
@@ -58,44 +67,57 @@ static struct device_attribute ver = __ATTR(version, 0600, show_cpld_version, NU
 
 static void accton_i2c_cpld_add_client(struct i2c_client *client)
 {
-	struct cpld_client_node *node = kzalloc(sizeof(struct cpld_client_node), GFP_KERNEL);
-	
+	struct cpld_client_node *node;
+
+	if (client->addr >= CPLD_CLIENT_MAX_ADDR) {
+		return;
+	}
+
+	node = kzalloc(sizeof(struct cpld_client_node), GFP_KERNEL);
 	if (!node) {
 		dev_dbg(&client->dev, "Can't allocate cpld_client_node (0x%x)\n", client->addr);
 		return;
 	}
-	
+
 	node->client = client;
-	
+	mutex_init(&node->lock);
+
 	mutex_lock(&list_lock);
-	list_add(&node->list, &cpld_client_list);
+	if (rcu_access_pointer(cpld_clients[client->addr])) {
+		/* Same address on another bus, the first one keeps the slot */
+		mutex_unlock(&list_lock);
+		dev_warn(&client->dev, "cpld 0x%x already registered\n", client->addr);
+		kfree(node);
+		return;
+	}
+	rcu_assign_pointer(cpld_clients[client->addr], node);
 	mutex_unlock(&list_lock);
 }
 
 static void accton_i2c_cpld_remove_client(struct i2c_client *client)
 {
-	struct list_head		*list_node = NULL;
-	struct cpld_client_node *cpld_node = NULL;
-	int found = 0;
-	
-	mutex_lock(&list_lock);
+	struct cpld_client_node *node = NULL;
 
-	list_for_each(list_node, &cpld_client_list)
-	{
-		cpld_node = list_entry(list_node, struct cpld_client_node, list);
-		
-		if (cpld_node->client == client) {
-			found = 1;
-			break;
-		}
+	if (client->addr >= CPLD_CLIENT_MAX_ADDR) {
+		return;
 	}
-	
-	if (found) {
-		list_del(list_node);
-		kfree(cpld_node);
+
+	mutex_lock(&list_lock);
+	node = rcu_dereference_protected(cpld_clients[client->addr],
+	                                 lockdep_is_held(&list_lock));
+	if (node && node->client == client) {
+		RCU_INIT_POINTER(cpld_clients[client->addr], NULL);
+	}
+	else {
+		node = NULL;
 	}
-	
 	mutex_unlock(&list_lock);
+
+	if (node) {
+		/* Wait for accessors still using this client */
+		synchronize_srcu(&cpld_client_srcu);
+		kfree(node);
+	}
 }
 
 static int accton_i2c_cpld_probe(struct i2c_client *client,
@@ -150,23 +172,21 @@ static struct i2c_driver accton_i2c_cpld_driver = {
 
 int accton_i2c_cpld_read(unsigned short cpld_addr, u8 reg)
 {
-	struct list_head   *list_node = NULL;
-	struct cpld_client_node *cpld_node = NULL;
-	int ret = -EPERM;
-	
-	mutex_lock(&list_lock);
+	struct cpld_client_node *node;
+	int ret = -EPERM, idx;
 
-	list_for_each(list_node, &cpld_client_list)
-	{
-		cpld_node = list_entry(list_node, struct cpld_client_node, list);
-		
-		if (cpld_node->client->addr == cpld_addr) {
-			ret = i2c_smbus_read_byte_data(cpld_node->client, reg);
-			break;
-		}
+	if (cpld_addr >= CPLD_CLIENT_MAX_ADDR) {
+		return ret;
 	}
-	
-	mutex_unlock(&list_lock);
+
+	idx = srcu_read_lock(&cpld_client_srcu);
+	node = srcu_dereference(cpld_clients[cpld_addr], &cpld_client_srcu);
+	if (node) {
+		mutex_lock(&node->lock);
+		ret = i2c_smbus_read_byte_data(node->client, reg);
+		mutex_unlock(&node->lock);
+	}
+	srcu_read_unlock(&cpld_client_srcu, idx);
 
 	return ret;
 }
@@ -174,23 +194,21 @@ EXPORT_SYMBOL(accton_i2c_cpld_read);
 
 int accton_i2c_cpld_write(unsigned short cpld_addr, u8 reg, u8 value)
 {
-	struct list_head   *list_node = NULL;
-	struct cpld_client_node *cpld_node = NULL;
-	int ret = -EIO;
-	
-	mutex_lock(&list_lock);
+	struct cpld_client_node *node;
+	int ret = -EIO, idx;
 
-	list_for_each(list_node, &cpld_client_list)
-	{
-		cpld_node = list_entry(list_node, struct cpld_client_node, list);
-		
-		if (cpld_node->client->addr == cpld_addr) {
-			ret = i2c_smbus_write_byte_data(cpld_node->client, reg, value);
-			break;
-		}
+	if (cpld_addr >= CPLD_CLIENT_MAX_ADDR) {
+		return ret;
 	}
-	
-	mutex_unlock(&list_lock);
+
+	idx = srcu_read_lock(&cpld_client_srcu);
+	node = srcu_dereference(cpld_clients[cpld_addr], &cpld_client_srcu);
+	if (node) {
+		mutex_lock(&node->lock);
+		ret = i2c_smbus_write_byte_data(node->client, reg, value);
+		mutex_unlock(&node->lock);
+	}
+	srcu_read_unlock(&cpld_client_srcu, idx);
 
 	return ret;
 }
@@ -0,0 +1 @@
+../../common/modules/accton_i2c_stats.c
\ No newline at end of file
@@ -0,0 +1 @@
+../../common/modules/accton_pmbus_psu.c
\ No newline at end of file
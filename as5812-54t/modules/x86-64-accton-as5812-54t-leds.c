@@ -231,60 +231,112 @@ static int accton_as5812_54t_led_write_value(u8 reg, u8 value)
     return accton_i2c_cpld_write(0x60, reg, value);
 }
 
+/*
+ * reg_val[] shadows led_reg[].  It is refreshed from the CPLD when older
+ * than 1.5s, and kept in step by every write in between.
+ * Called with update_lock held.
+ */
+static int __accton_as5812_54t_led_update(void)
+{
+    int i;
+
+    if (!time_after(jiffies, ledctl->last_updated + HZ + HZ / 2)
+        && ledctl->valid) {
+        return 0;
+    }
+
+    dev_dbg(&ledctl->pdev->dev, "Starting accton_as5812_54t_led update\n");
+
+    /* Update LED data
+     */
+    for (i = 0; i < ARRAY_SIZE(ledctl->reg_val); i++) {
+        int status = accton_as5812_54t_led_read_value(led_reg[i]);
+
+        if (status < 0) {
+            ledctl->valid = 0;
+            dev_dbg(&ledctl->pdev->dev, "reg %d, err %d\n", led_reg[i], status);
+            return status;
+        }
+        ledctl->reg_val[i] = status;
+    }
+
+    ledctl->last_updated = jiffies;
+    ledctl->valid = 1;
+    return 0;
+}
+
 static void accton_as5812_54t_led_update(void)
 {
     mutex_lock(&ledctl->update_lock);
+    __accton_as5812_54t_led_update();
+    mutex_unlock(&ledctl->update_lock);
+}
+
+/* Write led_reg[idx] only if the value changes.  Called with update_lock held. */
+static int __accton_as5812_54t_led_write_reg(int idx, u8 value)
+{
+    int status;
 
-    if (time_after(jiffies, ledctl->last_updated + HZ + HZ / 2)
-        || !ledctl->valid) {
-        int i;
+    if (value == ledctl->reg_val[idx]) {
+        return 0;
+    }
 
-        dev_dbg(&ledctl->pdev->dev, "Starting accton_as5812_54t_led update\n");
-        
-        /* Update LED data
-         */
-        for (i = 0; i < ARRAY_SIZE(ledctl->reg_val); i++) {
-            int status = accton_as5812_54t_led_read_value(led_reg[i]);
-            
-            if (status < 0) {
-                ledctl->valid = 0;
-                dev_dbg(&ledctl->pdev->dev, "reg %d, err %d\n", led_reg[i], status);
-				goto exit;
-            }
-            else
-            {
-                ledctl->reg_val[i] = status;                                  
-            }
+    status = accton_as5812_54t_led_write_value(led_reg[idx], value);
+    if (status < 0) {
+        ledctl->valid = 0;
+        dev_dbg(&ledctl->pdev->dev, "reg %d, err %d\n", led_reg[idx], status);
+        return status;
+    }
+
+    ledctl->reg_val[idx] = value;
+    return 0;
+}
+
+/* Index into led_reg[] / reg_val[] of the register holding the LED */
+static int led_type_reg_id(enum led_type type)
+{
+    int i;
+
+    switch (type) {
+    case LED_TYPE_PSU1:
+    case LED_TYPE_PSU2:
+        return 1;
+    case LED_TYPE_DIAG:
+    case LED_TYPE_FAN:
+    case LED_TYPE_LOC:
+        return 0;
+    default:
+        break;
+    }
+
+    for (i = 0; i < ARRAY_SIZE(fanx_info); i++) {
+        if (fanx_info[i].type == type) {
+            return fanx_info[i].reg_id;
         }
-        
-        ledctl->last_updated = jiffies;
-        ledctl->valid = 1;
     }
-    
-exit:    
-    mutex_unlock(&ledctl->update_lock);
+
+    return -1;
 }
 
 static void accton_as5812_54t_led_set(struct led_classdev *led_cdev,
-                                      enum led_brightness led_light_mode, 
+                                      enum led_brightness led_light_mode,
                                       u8 reg, enum led_type type)
 {
-    int reg_val;
-    
+    int idx;
+
     mutex_lock(&ledctl->update_lock);
-    
-    reg_val = accton_as5812_54t_led_read_value(reg);
-    
-    if (reg_val < 0) {
-        dev_dbg(&ledctl->pdev->dev, "reg %d, err %d\n", reg, reg_val);
+
+    for (idx = 0; idx < ARRAY_SIZE(led_reg); idx++) {
+        if (led_reg[idx] == reg) {
+            break;
+        }
+    }
+    if (idx == ARRAY_SIZE(led_reg) || __accton_as5812_54t_led_update() < 0) {
         goto exit;
     }
 
-    reg_val = led_light_mode_to_reg_val(type, led_light_mode, reg_val);
-    accton_as5812_54t_led_write_value(reg, reg_val);
-    
-    /* to prevent the slow-update issue */
-    ledctl->valid = 0;
+    __accton_as5812_54t_led_write_reg(idx, led_light_mode_to_reg_val(type, led_light_mode,
+                                                          ledctl->reg_val[idx]));
 
 exit:
     mutex_unlock(&ledctl->update_lock);
@@ -482,6 +534,106 @@ static struct led_classdev accton_as5812_54t_leds[] = {
     },
 };
 
+/*
+ * "leds" sets any number of the LEDs above in one go: "diag=1 loc=0",
+ * with the LED names and the values of their brightness files.  Each
+ * register is written at most once.  Reading it gives the same form.
+ */
+static const char *accton_as5812_54t_led_name(enum led_type type)
+{
+    return strrchr(accton_as5812_54t_leds[type].name, ':') + 1;
+}
+
+static ssize_t accton_as5812_54t_led_batch_show(struct device *dev,
+                                      struct device_attribute *da, char *buf)
+{
+    int type, idx, len = 0;
+
+    mutex_lock(&ledctl->update_lock);
+    if (__accton_as5812_54t_led_update() < 0) {
+        mutex_unlock(&ledctl->update_lock);
+        return -EIO;
+    }
+
+    for (type = 0; type < ARRAY_SIZE(accton_as5812_54t_leds); type++) {
+        idx = led_type_reg_id(type);
+        if (idx < 0) {
+            continue;
+        }
+        len += sprintf(buf + len, "%s%s=%d", len ? " " : "", accton_as5812_54t_led_name(type),
+                       led_reg_val_to_light_mode(type, ledctl->reg_val[idx]));
+    }
+    mutex_unlock(&ledctl->update_lock);
+
+    len += sprintf(buf + len, "\n");
+    return len;
+}
+
+static ssize_t accton_as5812_54t_led_batch_store(struct device *dev,
+                                       struct device_attribute *da,
+                                       const char *buf, size_t count)
+{
+    u8 reg_val[ARRAY_SIZE(ledctl->reg_val)];
+    char *str, *p, *tok;
+    int i, status;
+
+    str = kstrndup(buf, count, GFP_KERNEL);
+    if (!str) {
+        return -ENOMEM;
+    }
+
+    mutex_lock(&ledctl->update_lock);
+    status = __accton_as5812_54t_led_update();
+    if (status < 0) {
+        goto exit;
+    }
+    memcpy(reg_val, ledctl->reg_val, sizeof(reg_val));
+
+    p = str;
+    while ((tok = strsep(&p, " \t\n")) != NULL) {
+        char *val = strchr(tok, '=');
+        int type, idx = -1;
+        long mode;
+
+        if (!*tok) {
+            continue;
+        }
+        if (!val) {
+            status = -EINVAL;
+            goto exit;
+        }
+        *val++ = '\0';
+
+        for (type = 0; type < ARRAY_SIZE(accton_as5812_54t_leds); type++) {
+            if (!strcmp(accton_as5812_54t_led_name(type), tok)) {
+                idx = led_type_reg_id(type);
+                break;
+            }
+        }
+        if (idx < 0 || kstrtol(val, 10, &mode) ||
+            mode < 0 || mode > accton_as5812_54t_leds[type].max_brightness) {
+            status = -EINVAL;
+            goto exit;
+        }
+        reg_val[idx] = led_light_mode_to_reg_val(type, mode, reg_val[idx]);
+    }
+
+    for (i = 0; i < ARRAY_SIZE(reg_val); i++) {
+        status = __accton_as5812_54t_led_write_reg(i, reg_val[i]);
+        if (status < 0) {
+            goto exit;
+        }
+    }
+    status = count;
+
+exit:
+    mutex_unlock(&ledctl->update_lock);
+    kfree(str);
+    return status;
+}
+
+static DEVICE_ATTR(leds, S_IRUGO | S_IWUSR, accton_as5812_54t_led_batch_show, accton_as5812_54t_led_batch_store);
+
 static int accton_as5812_54t_led_suspend(struct platform_device *dev,
         pm_message_t state)
 {
@@ -526,6 +678,11 @@ static int accton_as5812_54t_led_probe(struct platform_device *pdev)
         }
     }
 
+    /* the batched interface is optional, the LEDs work without it */
+    if (i == ARRAY_SIZE(accton_as5812_54t_leds) && device_create_file(&pdev->dev, &dev_attr_leds)) {
+        dev_warn(&pdev->dev, "unable to create the leds attribute\n");
+    }
+
     return ret;
 }
 
@@ -533,6 +690,8 @@ static int accton_as5812_54t_led_remove(struct platform_device *pdev)
 {
     int i;
 
+    device_remove_file(&pdev->dev, &dev_attr_leds);
+
     for (i = 0; i < ARRAY_SIZE(accton_as5812_54t_leds); i++) {
         led_classdev_unregister(&accton_as5812_54t_leds[i]);
     }
@@ -31,6 +31,7 @@
 #include <linux/slab.h>
 #include <linux/device.h>
 #include <linux/i2c.h>
+#include <linux/srcu.h>
 #include <linux/i2c-mux.h>
 #include <linux/version.h>
 #include <linux/stat.h>
@@ -48,14 +49,23 @@
 
 #define ACCTON_I2C_CPLD_MUX_MAX_NCHANS  NUM_OF_CPLD3_CHANS
 
-static LIST_HEAD(cpld_client_list);
-static struct mutex     list_lock;
+#define CPLD_CLIENT_MAX_ADDR    0x80    /* 7-bit addresses */
 
 struct cpld_client_node {
     struct i2c_client *client;
-    struct list_head   list;
+    struct mutex       lock;    /* held across one transaction */
 };
 
+/*
+ * CPLD clients indexed by I2C address.  The exported accessors look the
+ * client up under SRCU and hold only that CPLD's mutex across the bus
+ * transaction, so list_lock is never held across I2C.  list_lock only
+ * orders add/remove.
+ */
+static struct cpld_client_node __rcu *cpld_clients[CPLD_CLIENT_MAX_ADDR];
+static struct mutex     list_lock;
+DEFINE_STATIC_SRCU(cpld_client_srcu);
+
 enum cpld_mux_type {
     as6712_32x_cpld2,
     as6712_32x_cpld3,
@@ -624,44 +634,57 @@ static int as6712_32x_cpld_mux_deselect_mux(struct i2c_adapter *adap,
 
 static void as6712_32x_cpld_add_client(struct i2c_client *client)
 {
-    struct cpld_client_node *node = kzalloc(sizeof(struct cpld_client_node), GFP_KERNEL);
+    struct cpld_client_node *node;
+
+    if (client->addr >= CPLD_CLIENT_MAX_ADDR) {
+        return;
+    }
 
+    node = kzalloc(sizeof(struct cpld_client_node), GFP_KERNEL);
     if (!node) {
         dev_dbg(&client->dev, "Can't allocate cpld_client_node (0x%x)\n", client->addr);
         return;
     }
 
     node->client = client;
+    mutex_init(&node->lock);
 
-	mutex_lock(&list_lock);
-    list_add(&node->list, &cpld_client_list);
-	mutex_unlock(&list_lock);
+    mutex_lock(&list_lock);
+    if (rcu_access_pointer(cpld_clients[client->addr])) {
+        /* Same address on another bus, the first one keeps the slot */
+        mutex_unlock(&list_lock);
+        dev_warn(&client->dev, "cpld 0x%x already registered\n", client->addr);
+        kfree(node);
+        return;
+    }
+    rcu_assign_pointer(cpld_clients[client->addr], node);
+    mutex_unlock(&list_lock);
 }
 
 static void as6712_32x_cpld_remove_client(struct i2c_client *client)
 {
-    struct list_head    *list_node = NULL;
-    struct cpld_client_node *cpld_node = NULL;
-    int found = 0;
+    struct cpld_client_node *node = NULL;
 
-	mutex_lock(&list_lock);
-
-    list_for_each(list_node, &cpld_client_list)
-    {
-        cpld_node = list_entry(list_node, struct cpld_client_node, list);
-
-        if (cpld_node->client == client) {
-            found = 1;
-            break;
-        }
+    if (client->addr >= CPLD_CLIENT_MAX_ADDR) {
+        return;
     }
 
-    if (found) {
-        list_del(list_node);
-        kfree(cpld_node);
+    mutex_lock(&list_lock);
+    node = rcu_dereference_protected(cpld_clients[client->addr],
+                                     lockdep_is_held(&list_lock));
+    if (node && node->client == client) {
+        RCU_INIT_POINTER(cpld_clients[client->addr], NULL);
     }
+    else {
+        node = NULL;
+    }
+    mutex_unlock(&list_lock);
 
-	mutex_unlock(&list_lock);
+    if (node) {
+        /* Wait for accessors still using this client */
+        synchronize_srcu(&cpld_client_srcu);
+        kfree(node);
+    }
 }
 
 static ssize_t show_version(struct device *dev, struct device_attribute *attr, char *buf)
@@ -870,23 +893,21 @@ static int as6712_32x_cpld_write_internal(struct i2c_client *client, u8 reg, u8
 
 int as6712_32x_cpld_read(unsigned short cpld_addr, u8 reg)
 {
-    struct list_head   *list_node = NULL;
-    struct cpld_client_node *cpld_node = NULL;
-    int ret = -EPERM;
-
-    mutex_lock(&list_lock);
-
-    list_for_each(list_node, &cpld_client_list)
-    {
-        cpld_node = list_entry(list_node, struct cpld_client_node, list);
+    struct cpld_client_node *node;
+    int ret = -EPERM, idx;
 
-        if (cpld_node->client->addr == cpld_addr) {
-            ret = as6712_32x_cpld_read_internal(cpld_node->client, reg);
-    		break;
-        }
+    if (cpld_addr >= CPLD_CLIENT_MAX_ADDR) {
+        return ret;
     }
 
-	mutex_unlock(&list_lock);
+    idx = srcu_read_lock(&cpld_client_srcu);
+    node = srcu_dereference(cpld_clients[cpld_addr], &cpld_client_srcu);
+    if (node) {
+        mutex_lock(&node->lock);
+        ret = as6712_32x_cpld_read_internal(node->client, reg);
+        mutex_unlock(&node->lock);
+    }
+    srcu_read_unlock(&cpld_client_srcu, idx);
 
     return ret;
 }
@@ -894,23 +915,21 @@ EXPORT_SYMBOL(as6712_32x_cpld_read);
 
 int as6712_32x_cpld_write(unsigned short cpld_addr, u8 reg, u8 value)
 {
-    struct list_head   *list_node = NULL;
-    struct cpld_client_node *cpld_node = NULL;
-    int ret = -EIO;
-
-	mutex_lock(&list_lock);
+    struct cpld_client_node *node;
+    int ret = -EIO, idx;
 
-    list_for_each(list_node, &cpld_client_list)
-    {
-        cpld_node = list_entry(list_node, struct cpld_client_node, list);
-
-        if (cpld_node->client->addr == cpld_addr) {
-            ret = as6712_32x_cpld_write_internal(cpld_node->client, reg, value);
-            break;
-        }
+    if (cpld_addr >= CPLD_CLIENT_MAX_ADDR) {
+        return ret;
     }
 
-	mutex_unlock(&list_lock);
+    idx = srcu_read_lock(&cpld_client_srcu);
+    node = srcu_dereference(cpld_clients[cpld_addr], &cpld_client_srcu);
+    if (node) {
+        mutex_lock(&node->lock);
+        ret = as6712_32x_cpld_write_internal(node->client, reg, value);
+        mutex_unlock(&node->lock);
+    }
+    srcu_read_unlock(&cpld_client_srcu, idx);
 
     return ret;
 }
@@ -37,6 +37,7 @@
 
 #define IS_POWER_GOOD(id, value)	(!!(value & BIT(id*4 + 1)))
 #define IS_PRESENT(id, value)		(!(value & BIT(id*4)))
+#define PSU_STATUS_BITS(id)			(BIT(id*4) | BIT(id*4 + 1))
 
 static ssize_t show_index(struct device *dev, struct device_attribute *da, char *buf);
 static ssize_t show_status(struct device *dev, struct device_attribute *da, char *buf);
@@ -58,6 +59,8 @@ struct as6712_32x_psu_data {
     unsigned long       last_updated;    /* In jiffies */
     u8  index;           /* PSU index */
     u8  status;          /* Status(present/power_good) register read from CPLD */
+    char model_valid;    /* !=0 if model_name was read at psu_bits */
+    u8  psu_bits;        /* This PSU's bits of status when the eeprom was read */
     char model_name[14]; /* Model name, read from eeprom */
 };
 
@@ -128,8 +131,18 @@ static ssize_t show_model_name(struct device *dev, struct device_attribute *da,
         return 0;
     }
 
-    if (as6712_32x_psu_model_name_get(dev) < 0) {
-        return -ENXIO;
+    /* The eeprom only has to be read again when the PSU comes, goes,
+     * or its power good changes
+     */
+    if (!data->model_valid ||
+        data->psu_bits != (data->status & PSU_STATUS_BITS(data->index))) {
+        if (as6712_32x_psu_model_name_get(dev) < 0) {
+            data->model_valid = 0;
+            return -ENXIO;
+        }
+
+        data->psu_bits = data->status & PSU_STATUS_BITS(data->index);
+        data->model_valid = 1;
     }
     return sprintf(buf, "%s\n", data->model_name);
 }
@@ -0,0 +1 @@
+../../common/modules/accton_pmbus_conv.h
\ No newline at end of file
@@ -0,0 +1 @@
+../../common/utils/accton_sysfs_bench.py
\ No newline at end of file
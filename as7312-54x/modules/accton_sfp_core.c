@@ -0,0 +1 @@
+../../common/modules/accton_sfp_core.c
\ No newline at end of file
@@ -97,6 +97,10 @@ class accton_as7312_monitor(object):
 
         logging.debug('SET. logfile:%s / loglevel:%d', log_file, log_level)
 
+        # kept across cycles, their sysfs nodes stay open
+        self.thermal = ThermalUtil()
+        self.fan = FanUtil()
+
     def manage_fans(self):
         max_duty = 100
         fan_policy_f2b = {
@@ -117,8 +121,8 @@ class accton_as7312_monitor(object):
            2: 50000,
         }
   
-        thermal = ThermalUtil()
-        fan = FanUtil()
+        thermal = self.thermal
+        fan = self.fan
         for x in range(fan.get_idx_fan_start(), fan.get_num_fans()+1):
             fan_status = fan.get_fan_status(x)
             if fan_status is None:
@@ -0,0 +1 @@
+../../common/utils/accton_sff.py
\ No newline at end of file
@@ -25,6 +25,7 @@
 
 try:
     import time
+    import os
     import logging
     from collections import namedtuple
 except ImportError as e:
@@ -99,26 +100,53 @@ class FanUtil(object):
             return None
 
         device_path = self.get_fan_to_device_path(fan_num, node_num)
-       
-        try:
-            val_file = open(device_path, 'r')
-        except IOError as e:
-            logging.error('GET. unable to open file: %s', str(e))
+        content = self._read_node((fan_num, node_num), device_path)
+        if content is None:
             return None
 
-        content = val_file.readline().rstrip()
-        
         if content == '':
             logging.debug('GET. content is NULL. device_path:%s', device_path)
             return None
 
+        return int(content)
+
+    def _read_node(self, key, device_path):
+        """Read a sysfs node through a descriptor kept open across calls.
+        A read error drops the descriptor, the next call opens it again."""
+        if self._cache is not None:
+            return self._cache.read(device_path)
+
+        fd = self._fan_to_device_fd_mapping.get(key)
+        if fd is None:
+            try:
+                fd = os.open(device_path, os.O_RDONLY)
+            except OSError as e:
+                logging.error('GET. unable to open file: %s', str(e))
+                return None
+            self._fan_to_device_fd_mapping[key] = fd
+
         try:
-		    val_file.close()
-        except:
-            logging.debug('GET. unable to close file. device_path:%s', device_path)
+            os.lseek(fd, 0, os.SEEK_SET)
+            return os.read(fd, 64).rstrip()
+        except OSError as e:
+            logging.debug('GET. unable to read file. device_path:%s, %s', device_path, str(e))
+            self._close_node(key)
             return None
 
-        return int(content)
+    def _close_node(self, key):
+        fd = self._fan_to_device_fd_mapping.pop(key, None)
+        if fd is not None:
+            try:
+                os.close(fd)
+            except OSError:
+                pass
+
+    def close(self):
+        for key in self._fan_to_device_fd_mapping.keys():
+            self._close_node(key)
+
+    def __del__(self):
+        self.close()
 
     def _set_fan_node_val(self, fan_num, node_num, val):
         if fan_num < self.FAN_NUM_1_IDX or fan_num > self.FAN_NUM_ON_MAIN_BROAD:
@@ -142,6 +170,8 @@ class FanUtil(object):
             return None
 
         val_file.write(content)
+        if self._cache is not None:
+            self._cache.invalidate(device_path)
 
         try:
 		    val_file.close()
@@ -151,7 +181,10 @@ class FanUtil(object):
 
         return True
 
-    def __init__(self):
+    def __init__(self, cache=None):
+        """'cache' is a monitorutil.SysfsCache to read the nodes through"""
+        self._fan_to_device_fd_mapping = {}
+        self._cache = cache
         fan_path = self.BASE_VAL_PATH 
 
         for fan_num in range(self.FAN_NUM_1_IDX, self.FAN_NUM_ON_MAIN_BROAD+1):
@@ -180,6 +213,13 @@ class FanUtil(object):
     def get_fan_to_device_path(self, fan_num, node_num):
         return self._fan_to_device_path_mapping[(fan_num, node_num)]
 
+    def get_all(self):
+        """Read every fan node in one pass.
+        Returns a dict keyed like _fan_to_device_node_mapping, None for
+        a node that could not be read."""
+        return dict((key, self._get_fan_node_val(key[0], key[1]))
+                    for key in self._fan_to_device_node_mapping)
+
     def get_fan_fault(self, fan_num):
         return self._get_fan_node_val(fan_num, self.FAN_NODE_FAULT_IDX_OF_MAP)
 
@@ -191,15 +231,10 @@ class FanUtil(object):
 
     def get_fan_duty_cycle(self):
         #duty_path = self.FAN_DUTY_PATH
-        try:
-            val_file = open(self.FAN_DUTY_PATH)
-        except IOError as e:
-            print "Error: unable to open file: %s" % str(e)          
+        content = self._read_node('duty', self.FAN_DUTY_PATH)
+        if content is None or content == '':
             return False
 
-        content = val_file.readline().rstrip()
-        val_file.close()
-        
         return int(content)
         #self._get_fan_node_val(fan_num, self.FAN_NODE_DUTY_IDX_OF_MAP)
 #static u32 reg_val_to_duty_cycle(u8 reg_val) 
@@ -217,6 +252,8 @@ class FanUtil(object):
             return False       
         fan_file.write(str(val))
         fan_file.close()
+        if self._cache is not None:
+            self._cache.invalidate(self.FAN_DUTY_PATH)
         return True
 
     #def get_fanr_fault(self, fan_num):
@@ -24,6 +24,7 @@
 
 try:
     import time
+    import os
     import logging
     import glob
     import commands
@@ -61,9 +62,11 @@ class ThermalUtil(object):
 
     BASE_VAL_PATH = '/sys/bus/i2c/devices/{0}-00{1}/hwmon/hwmon*/temp1_input'
     CPU_thermal_PATH = "/sys/class/hwmon/hwmon0/temp1_input"
-    BCM_thermal_cmd = 'bcmcmd "show temp" > /tmp/bcm_thermal'
-    BCM_thermal_path = '/tmp/bcm_thermal'
-    #BCM_thermal_path = '/tmp/bcm_debug'
+    # Written by accton_as7326_asic_temp.py, which samples the SDK on its
+    # own schedule: millidegrees C on one line.  Older than
+    # BCM_thermal_max_age seconds is treated like an SDK that is not ready.
+    BCM_thermal_path = '/var/run/accton_as7326_bcm_temp'
+    BCM_thermal_max_age = 60
     """ Dictionary where
         key1 = thermal id index (integer) starting from 1
         value = path to fan device file (string) """
@@ -76,7 +79,10 @@ class ThermalUtil(object):
             THERMAL_NUM_4_IDX: ['15', '4b'],
            }
 
-    def __init__(self):
+    def __init__(self, cache=None):
+        """'cache' is a monitorutil.SysfsCache to read the nodes through"""
+        self._thermal_to_device_fd_mapping = {}
+        self._cache = cache
         thermal_path = self.BASE_VAL_PATH
 
         for x in range(self.THERMAL_NUM_1_IDX, self.THERMAL_NUM_4_IDX+1):
@@ -87,60 +93,91 @@ class ThermalUtil(object):
             #print "_thermal_to_device_path_mapping=%s"%self._thermal_to_device_path_mapping[x]
         self._thermal_to_device_path_mapping[self.THERMAL_NUM_5_IDX] =  self.CPU_thermal_PATH
         #print "_thermal_to_device_path_mapping=%s"%self._thermal_to_device_path_mapping[self.THERMAL_NUM_5_IDX]
+
+        if cache is None:
+            for x in self._thermal_to_device_path_mapping:
+                self._open_node(x)
             
     def _get_thermal_val(self, thermal_num):
         if thermal_num < self.THERMAL_NUM_1_IDX or thermal_num > self.THERMAL_NUM_MAX:
             logging.debug('GET. Parameter error. thermal_num, %d', thermal_num)
             return None
         if thermal_num < self.THERMAL_NUM_6_IDX:
-            device_path = self.get_thermal_to_device_path(thermal_num)
-            for filename in glob.glob(device_path):
-                try:
-                    val_file = open(filename, 'r')
-                except IOError as e:
-                    logging.error('GET. unable to open file: %s', str(e))
-                    return None
-            content = val_file.readline().rstrip()
+            content = self._read_node(thermal_num)
+            if content is None:
+                return None
             if content == '':
-                logging.debug('GET. content is NULL. device_path:%s', device_path)
+                logging.debug('GET. content is NULL. device_path:%s', self.get_thermal_to_device_path(thermal_num))
                 return None
-            try:
-		        val_file.close()
-            except:
-                logging.debug('GET. unable to close file. device_path:%s', device_path)
-                return None      
             return int(content)
         else:
-            log_os_system(self.BCM_thermal_cmd,0)
-            file_path = self.BCM_thermal_path
-            check_file = open(file_path)
-            try:
-                check_file = open(file_path)
-            except IOError as e:
-                print "Error: unable to open file: %s" % str(e) 
-                return 0  
-            file_str = check_file.read()
-            search_str="average current temperature is"
-            print "file_str.find=%s"%file_str.find(search_str)
-            str_len = len(search_str)
-            idx=file_str.find(search_str)
-            if idx==-1:
-                print "bcm sdk is not ready ,retrun 0"
+            return self._get_bcm_thermal_val()
+
+    def _get_bcm_thermal_val(self):
+        try:
+            age = time.time() - os.stat(self.BCM_thermal_path).st_mtime
+            if age > self.BCM_thermal_max_age:
+                logging.debug('GET. bcm temperature is %d seconds old', age)
                 return 0
-            else:               
-                #print "file_str[idx]=%c"%file_str[idx+str_len+1]
-                #print "file_str[idx]=%c"%file_str[idx+str_len+2]
-                #print "file_str[idx]=%c"%file_str[idx+str_len+2+1]
-                #print "file_str[idx]=%c"%file_str[idx+str_len+2+2]
-                #print "file_str[idx]=%c"%file_str[idx+str_len+2+3]
-                #print "file_str[idx]=%c"%file_str[idx+str_len+2+4]
-                #print "file_str[idx]=%c"%file_str[idx+str_len+2+5]
-                #print "file_str[idx]=%c"%file_str[idx+str_len+2+6]
-                temp_str=file_str[idx+str_len+1] + file_str[idx+str_len+2] + file_str[idx+str_len+3]+file_str[idx+str_len+4] +file_str[idx+str_len+5]
-                print "bcm temp_str=%s"%temp_str
-                check_file.close()                 
-                return float(temp_str)*1000
+            with open(self.BCM_thermal_path) as check_file:
+                content = check_file.readline().rstrip()
+        except (IOError, OSError) as e:
+            logging.debug('GET. bcm temperature not available: %s', str(e))
+            return 0
+
+        if content == '':
+            return 0
+        return int(content)
  
+    def _open_node(self, thermal_num):
+        """The hwmon*/ part of the path is only resolved here, once per open"""
+        device_path = self.get_thermal_to_device_path(thermal_num)
+        for filename in glob.glob(device_path):
+            try:
+                fd = os.open(filename, os.O_RDONLY)
+            except OSError as e:
+                logging.error('GET. unable to open file: %s', str(e))
+                return None
+            self._thermal_to_device_fd_mapping[thermal_num] = fd
+            return fd
+
+        return None
+
+    def _read_node(self, thermal_num):
+        """Read a sysfs node through a descriptor kept open across calls.
+        A read error drops the descriptor, the next call opens it again."""
+        if self._cache is not None:
+            return self._cache.read(self.get_thermal_to_device_path(thermal_num))
+
+        fd = self._thermal_to_device_fd_mapping.get(thermal_num)
+        if fd is None:
+            fd = self._open_node(thermal_num)
+            if fd is None:
+                return None
+
+        try:
+            os.lseek(fd, 0, os.SEEK_SET)
+            return os.read(fd, 64).rstrip()
+        except OSError as e:
+            logging.debug('GET. unable to read file. thermal_num:%d, %s', thermal_num, str(e))
+            self._close_node(thermal_num)
+            return None
+
+    def _close_node(self, thermal_num):
+        fd = self._thermal_to_device_fd_mapping.pop(thermal_num, None)
+        if fd is not None:
+            try:
+                os.close(fd)
+            except OSError:
+                pass
+
+    def close(self):
+        for thermal_num in self._thermal_to_device_fd_mapping.keys():
+            self._close_node(thermal_num)
+
+    def __del__(self):
+        self.close()
+
     def get_num_thermals(self):
         return self.THERMAL_NUM_MAX
 
@@ -156,6 +193,12 @@ class ThermalUtil(object):
     def get_thermal_to_device_path(self, thermal_num):
         return self._thermal_to_device_path_mapping[thermal_num]
 
+    def get_all(self):
+        """Read every sysfs thermal sensor in one pass, {thermal_num: value or None}.
+        The BCM temperature is not included, it is not a sysfs node."""
+        return dict((x, self._get_thermal_val(x))
+                    for x in range(self.THERMAL_NUM_1_IDX, self.THERMAL_NUM_5_IDX+1))
+
     def get_thermal_1_val(self):      
         return self._get_thermal_node_val(self.THERMAL_NUM_1_IDX)
 
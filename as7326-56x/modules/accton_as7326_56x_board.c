@@ -0,0 +1,171 @@
+/*
+ * I2C topology of the accton as7326_56x
+ *
+ * Copyright (C) 2018 Accton Technology Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+/*
+ * Registers the muxes, CPLDs, PSUs, fan board, thermal sensors and
+ * transceiver EEPROMs that accton_as7326_util.py used to create one
+ * "echo ... > new_device" at a time.  Each pca9548 creates its channel
+ * buses while it is registered, so the table is walked in order with
+ * the same bus numbers the util script relies on.  'ready' reads Y once
+ * every device is in place.
+ */
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/init.h>
+#include <linux/i2c.h>
+#include <linux/err.h>
+
+#define DRVNAME "as7326_56x_board"
+
+#define NUM_OF_SFP_PORT         58
+#define QSFP_PORT_START         48      /* ports 49-56 */
+#define QSFP_PORT_END           56
+
+struct board_dev {
+    int bus;
+    struct i2c_board_info info;
+};
+
+#define BOARD_DEV(_bus, _type, _addr) \
+    { .bus = (_bus), .info = { I2C_BOARD_INFO(_type, _addr) } }
+
+static const struct board_dev as7326_56x_devs[] = {
+    BOARD_DEV(0,  "pca9548", 0x77),
+    BOARD_DEV(1,  "pca9548", 0x70),
+    BOARD_DEV(1,  "pca9548", 0x71),
+    BOARD_DEV(24, "pca9548", 0x72),
+    BOARD_DEV(2,  "pca9548", 0x70),
+    BOARD_DEV(33, "pca9548", 0x71),
+    BOARD_DEV(34, "pca9548", 0x72),
+    BOARD_DEV(35, "pca9548", 0x73),
+    BOARD_DEV(36, "pca9548", 0x74),
+    BOARD_DEV(37, "pca9548", 0x75),
+    BOARD_DEV(38, "pca9548", 0x76),
+    BOARD_DEV(0,  "24c04",   0x56),
+
+    BOARD_DEV(11, "as7326_56x_fan",  0x66),
+    BOARD_DEV(15, "lm75",            0x48),
+    BOARD_DEV(15, "lm75",            0x49),
+    BOARD_DEV(15, "lm75",            0x4a),
+    BOARD_DEV(15, "lm75",            0x4b),
+    BOARD_DEV(17, "as7326_56x_psu1", 0x51),
+    BOARD_DEV(17, "ym2651",          0x59),
+    BOARD_DEV(13, "as7326_56x_psu2", 0x53),
+    BOARD_DEV(13, "ym2651",          0x5b),
+    BOARD_DEV(18, "as7326_56x_cpld1", 0x60),
+    BOARD_DEV(12, "as7326_56x_cpld2", 0x62),
+    BOARD_DEV(19, "as7326_56x_cpld3", 0x64),
+};
+
+/* Bus of each front port's EEPROM, port 1 first */
+static const int sfp_bus[NUM_OF_SFP_PORT] = {
+    42, 41, 44, 43, 47, 45, 46, 50,
+    48, 49, 52, 51, 53, 56, 55, 54,
+    58, 57, 60, 59, 61, 63, 62, 64,
+    66, 68, 65, 67, 69, 71, 72, 70,
+    74, 73, 76, 75, 77, 79, 78, 80,
+    81, 82, 84, 85, 83, 87, 88, 86,
+    25, 26, 27, 28, 29, 30, 31, 32,    /* QSFP */
+    22, 23                             /* SFP+ from CPU NIF */
+};
+
+static bool ready;
+module_param(ready, bool, S_IRUGO);
+MODULE_PARM_DESC(ready, "all devices of the board are registered");
+
+static struct i2c_client *clients[ARRAY_SIZE(as7326_56x_devs) + NUM_OF_SFP_PORT];
+static int num_clients;
+
+static int board_add_device(int bus, const struct i2c_board_info *info)
+{
+    struct i2c_adapter *adap;
+    struct i2c_client *client;
+
+    adap = i2c_get_adapter(bus);
+    if (!adap) {
+        pr_err(DRVNAME ": i2c-%d not found for %s 0x%x\n", bus, info->type, info->addr);
+        return -ENODEV;
+    }
+
+    client = i2c_new_device(adap, info);
+    i2c_put_adapter(adap);
+    if (!client) {
+        pr_err(DRVNAME ": failed to add %s 0x%x on i2c-%d\n", info->type, info->addr, bus);
+        return -ENODEV;
+    }
+
+    clients[num_clients++] = client;
+    return 0;
+}
+
+static void board_remove_devices(void)
+{
+    /* Reverse order, children before the mux that provides their bus */
+    while (num_clients > 0) {
+        i2c_unregister_device(clients[--num_clients]);
+    }
+}
+
+static int __init as7326_56x_board_init(void)
+{
+    struct i2c_board_info info;
+    int i, ret;
+
+    for (i = 0; i < ARRAY_SIZE(as7326_56x_devs); i++) {
+        ret = board_add_device(as7326_56x_devs[i].bus, &as7326_56x_devs[i].info);
+        if (ret < 0) {
+            goto exit_remove;
+        }
+    }
+
+    for (i = 0; i < NUM_OF_SFP_PORT; i++) {
+        memset(&info, 0, sizeof(info));
+        strlcpy(info.type, (i >= QSFP_PORT_START && i < QSFP_PORT_END) ?
+                           "optoe1" : "optoe2", I2C_NAME_SIZE);
+        info.addr = 0x50;
+
+        ret = board_add_device(sfp_bus[i], &info);
+        if (ret < 0) {
+            goto exit_remove;
+        }
+    }
+
+    ready = true;
+    return 0;
+
+exit_remove:
+    board_remove_devices();
+    return ret;
+}
+
+static void __exit as7326_56x_board_exit(void)
+{
+    ready = false;
+    board_remove_devices();
+}
+
+module_init(as7326_56x_board_init);
+module_exit(as7326_56x_board_exit);
+
+/* The muxes must bind while they are registered to create the buses */
+MODULE_SOFTDEP("pre: i2c_mux_pca954x");
+MODULE_DESCRIPTION("accton as7326_56x i2c board devices");
+MODULE_LICENSE("GPL");
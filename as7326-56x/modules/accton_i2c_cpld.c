@@ -29,22 +29,65 @@
 #include <linux/slab.h>
 #include <linux/device.h>
 #include <linux/i2c.h>
+#include <linux/srcu.h>
 #include <linux/version.h>
 #include <linux/stat.h>
 #include <linux/hwmon-sysfs.h>
 #include <linux/delay.h>
+#include <linux/interrupt.h>
+#include <linux/gpio.h>
+#include <linux/kobject.h>
 
 #define I2C_RW_RETRY_COUNT				10
 #define I2C_RW_RETRY_INTERVAL			60 /* ms */
 
-static LIST_HEAD(cpld_client_list);
-static struct mutex     list_lock;
+#define NUM_OF_PRESENT_REGS				4
+
+/*
+ * Optional module present interrupt.  When the CPLD's interrupt line is
+ * described by firmware (client->irq) or given as a GPIO here, a threaded
+ * handler acknowledges it, re-reads the present bank and answers
+ * module_present_all from that copy for up to present_poll_ms.  A change
+ * wakes poll() waiters on module_present_all with sysfs_notify() and sends
+ * a KOBJ_CHANGE uevent with PRESENT_CHANGED=%llx and PRESENT=%llx, bit 0
+ * the first port of module_present_all, as accton_i2c_cpld does.
+ *
+ * The status register to acknowledge is given in irq_status_reg: it is
+ * read and the bits read are written back, which clears read-to-clear and
+ * write-1-to-clear registers alike.  A firmware interrupt may be level
+ * triggered, so it is only taken with a status register; a GPIO is taken
+ * on its falling edge either way.  Without an interrupt the driver stays
+ * polled.
+ */
+static int irq_gpio[3] = { -1, -1, -1 };
+module_param_array(irq_gpio, int, NULL, S_IRUGO);
+MODULE_PARM_DESC(irq_gpio, "interrupt GPIO of CPLD1..3, -1 uses the firmware IRQ if any");
+
+static int irq_status_reg[3] = { -1, -1, -1 };
+module_param_array(irq_status_reg, int, NULL, S_IRUGO);
+MODULE_PARM_DESC(irq_status_reg, "interrupt status register of CPLD1..3, -1 if none");
+
+static unsigned int present_poll_ms = 200;
+module_param(present_poll_ms, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(present_poll_ms, "longest module_present_all is served from the interrupt copy, in ms");
+
+#define CPLD_CLIENT_MAX_ADDR    0x80    /* 7-bit addresses */
 
 struct cpld_client_node {
     struct i2c_client *client;
-    struct list_head   list;
+    struct mutex       lock;    /* held across one transaction */
 };
 
+/*
+ * CPLD clients indexed by I2C address.  The exported accessors look the
+ * client up under SRCU and hold only that CPLD's mutex across the bus
+ * transaction, so CPLDs on different buses are accessed concurrently.
+ * list_lock only orders add/remove.
+ */
+static struct cpld_client_node __rcu *cpld_clients[CPLD_CLIENT_MAX_ADDR];
+static struct mutex     list_lock;
+DEFINE_STATIC_SRCU(cpld_client_srcu);
+
 enum cpld_type {
     as7326_56x_cpld1,
     as7326_56x_cpld2,
@@ -55,6 +98,12 @@ struct as7326_56x_cpld_data {
     enum cpld_type   type;
     struct device   *hwmon_dev;
     struct mutex     update_lock;
+
+    int              irq;           /* 0 when polled */
+    int              irq_gpio;      /* -1 unless we requested the gpio */
+    char             present_valid;
+    unsigned long    present_updated;               /* jiffies */
+    u8               present[NUM_OF_PRESENT_REGS]; /* as module_present_all */
 };
 
 static const struct i2c_device_id as7326_56x_cpld_id[] = {
@@ -581,30 +630,23 @@ static const struct attribute_group as7326_56x_cpld1_group = {
 	.attrs = as7326_56x_cpld1_attributes,
 };
 
-static ssize_t show_present_all(struct device *dev, struct device_attribute *da,
-             char *buf)
+/* One pass over the present bank, 1 = present */
+static int as7326_56x_cpld_read_present(struct i2c_client *client, u8 *values)
 {
 	int i, status;
-	u8 values[4]  = {0};
 	u8 regs[] = {0x9, 0xA, 0xB, 0x18};
-	struct i2c_client *client = to_i2c_client(dev);
 	struct as7326_56x_cpld_data *data = i2c_get_clientdata(client);
 
-	mutex_lock(&data->update_lock);
-
     for (i = 0; i < ARRAY_SIZE(regs); i++) {
         status = as7326_56x_cpld_read_internal(client, regs[i]);
         
         if (status < 0) {
-            goto exit;
+            return status;
         }
 
         values[i] = ~(u8)status;
     }
 
-	mutex_unlock(&data->update_lock);
-
-    /* Return values 1 -> 56 in order */
     if (data->type == as7326_56x_cpld2) {
         values[3] &= 0xF;
     }
@@ -612,12 +654,96 @@ static ssize_t show_present_all(struct device *dev, struct device_attribute *da,
         values[3] &= 0x3;
     }
 
-    return sprintf(buf, "%.2x %.2x %.2x %.2x\n",
-                        values[0], values[1], values[2], values[3]);
+    return 0;
+}
+
+static u64 as7326_56x_cpld_present_bits(const u8 *values)
+{
+    u64 bits = 0;
+    int i;
+
+    for (i = 0; i < NUM_OF_PRESENT_REGS; i++) {
+        bits |= (u64)values[i] << (i * 8);
+    }
+
+    return bits;
+}
+
+/*
+ * Re-reads the present bank into data->present, with update_lock held.
+ * 'changed' gets the bits that differ from the last good read, none on
+ * the first one.
+ */
+static int as7326_56x_cpld_update_present(struct i2c_client *client, u64 *changed)
+{
+    struct as7326_56x_cpld_data *data = i2c_get_clientdata(client);
+    u8 values[NUM_OF_PRESENT_REGS];
+    int status;
+
+    *changed = 0;
+
+    status = as7326_56x_cpld_read_present(client, values);
+    if (status < 0) {
+        data->present_valid = 0;
+        return status;
+    }
+
+    if (data->present_valid) {
+        *changed = as7326_56x_cpld_present_bits(values) ^
+                   as7326_56x_cpld_present_bits(data->present);
+    }
+
+    memcpy(data->present, values, sizeof(values));
+    data->present_valid = 1;
+    data->present_updated = jiffies;
+    return 0;
+}
+
+static void as7326_56x_cpld_present_notify(struct i2c_client *client,
+                                           const u8 *values, u64 changed)
+{
+    char env_changed[40], env_present[40];
+    char *envp[] = { env_changed, env_present, NULL };
+
+    sysfs_notify(&client->dev.kobj, NULL, "module_present_all");
+
+    snprintf(env_changed, sizeof(env_changed), "PRESENT_CHANGED=%llx", changed);
+    snprintf(env_present, sizeof(env_present), "PRESENT=%llx",
+             as7326_56x_cpld_present_bits(values));
+    kobject_uevent_env(&client->dev.kobj, KOBJ_CHANGE, envp);
+}
+
+static ssize_t show_present_all(struct device *dev, struct device_attribute *da,
+             char *buf)
+{
+	int status = 0;
+	u8 values[NUM_OF_PRESENT_REGS]  = {0};
+	struct i2c_client *client = to_i2c_client(dev);
+	struct as7326_56x_cpld_data *data = i2c_get_clientdata(client);
+	u64 changed = 0;
+
+	mutex_lock(&data->update_lock);
+
+    /* The interrupt copy, unless an interrupt may have gone missing */
+    if (!data->irq || !data->present_valid ||
+        time_after(jiffies, data->present_updated + msecs_to_jiffies(present_poll_ms))) {
+        status = as7326_56x_cpld_update_present(client, &changed);
+    }
+    memcpy(values, data->present, sizeof(values));
 
-exit:
 	mutex_unlock(&data->update_lock);
-	return status;
+
+    if (status < 0) {
+        return status;
+    }
+
+    if (changed) {
+        as7326_56x_cpld_present_notify(client, values, changed);
+    }
+
+    /* Return values 1 -> 56 in order */
+    return sprintf(buf, "%.2x %.2x %.2x %.2x\n",
+                        values[0], values[1], values[2], values[3]);
 }
 
 static ssize_t show_rxlos_all(struct device *dev, struct device_attribute *da,
@@ -826,44 +952,57 @@ exit:
 
 static void as7326_56x_cpld_add_client(struct i2c_client *client)
 {
-    struct cpld_client_node *node = kzalloc(sizeof(struct cpld_client_node), GFP_KERNEL);
+    struct cpld_client_node *node;
 
+    if (client->addr >= CPLD_CLIENT_MAX_ADDR) {
+        return;
+    }
+
+    node = kzalloc(sizeof(struct cpld_client_node), GFP_KERNEL);
     if (!node) {
         dev_dbg(&client->dev, "Can't allocate cpld_client_node (0x%x)\n", client->addr);
         return;
     }
 
     node->client = client;
+    mutex_init(&node->lock);
 
-	mutex_lock(&list_lock);
-    list_add(&node->list, &cpld_client_list);
-	mutex_unlock(&list_lock);
+    mutex_lock(&list_lock);
+    if (rcu_access_pointer(cpld_clients[client->addr])) {
+        /* Same address on another bus, the first one keeps the slot */
+        mutex_unlock(&list_lock);
+        dev_warn(&client->dev, "cpld 0x%x already registered\n", client->addr);
+        kfree(node);
+        return;
+    }
+    rcu_assign_pointer(cpld_clients[client->addr], node);
+    mutex_unlock(&list_lock);
 }
 
 static void as7326_56x_cpld_remove_client(struct i2c_client *client)
 {
-    struct list_head    *list_node = NULL;
-    struct cpld_client_node *cpld_node = NULL;
-    int found = 0;
-
-	mutex_lock(&list_lock);
+    struct cpld_client_node *node = NULL;
 
-    list_for_each(list_node, &cpld_client_list)
-    {
-        cpld_node = list_entry(list_node, struct cpld_client_node, list);
-
-        if (cpld_node->client == client) {
-            found = 1;
-            break;
-        }
+    if (client->addr >= CPLD_CLIENT_MAX_ADDR) {
+        return;
     }
 
-    if (found) {
-        list_del(list_node);
-        kfree(cpld_node);
+    mutex_lock(&list_lock);
+    node = rcu_dereference_protected(cpld_clients[client->addr],
+                                     lockdep_is_held(&list_lock));
+    if (node && node->client == client) {
+        RCU_INIT_POINTER(cpld_clients[client->addr], NULL);
+    }
+    else {
+        node = NULL;
     }
+    mutex_unlock(&list_lock);
 
-	mutex_unlock(&list_lock);
+    if (node) {
+        /* Wait for accessors still using this client */
+        synchronize_srcu(&cpld_client_srcu);
+        kfree(node);
+    }
 }
 
 static ssize_t show_version(struct device *dev, struct device_attribute *attr, char *buf)
@@ -880,6 +1019,102 @@ static ssize_t show_version(struct device *dev, struct device_attribute *attr, c
     return sprintf(buf, "%d", val);
 }
 
+static irqreturn_t as7326_56x_cpld_irq_thread(int irq, void *dev_id)
+{
+    struct i2c_client *client = dev_id;
+    struct as7326_56x_cpld_data *data = i2c_get_clientdata(client);
+    int reg = irq_status_reg[data->type];
+    u8 values[NUM_OF_PRESENT_REGS];
+    u64 changed;
+    int status;
+
+    mutex_lock(&data->update_lock);
+
+    /* Acknowledge first, a change after it raises the line again */
+    if (reg >= 0) {
+        status = as7326_56x_cpld_read_internal(client, reg);
+        if (status > 0) {
+            as7326_56x_cpld_write_internal(client, reg, status);
+        }
+    }
+
+    status = as7326_56x_cpld_update_present(client, &changed);
+    memcpy(values, data->present, sizeof(values));
+    mutex_unlock(&data->update_lock);
+
+    if (status >= 0 && changed) {
+        as7326_56x_cpld_present_notify(client, values, changed);
+    }
+
+    return IRQ_HANDLED;
+}
+
+static int as7326_56x_cpld_irq_init(struct i2c_client *client)
+{
+    struct as7326_56x_cpld_data *data = i2c_get_clientdata(client);
+    unsigned long flags = IRQF_ONESHOT;
+    int gpio = irq_gpio[data->type];
+    int irq = client->irq, ret;
+
+    data->irq_gpio = -1;
+
+    if (gpio_is_valid(gpio)) {
+        ret = gpio_request_one(gpio, GPIOF_IN, client->name);
+        if (ret) {
+            return ret;
+        }
+
+        data->irq_gpio = gpio;
+        irq = gpio_to_irq(gpio);
+        flags |= IRQF_TRIGGER_FALLING; /* active low, firmware IRQs carry their own trigger */
+    }
+
+    if (irq <= 0) {
+        ret = irq;
+        goto exit_gpio;
+    }
+
+    /* Nothing would acknowledge a level triggered firmware interrupt */
+    if (data->irq_gpio < 0 && irq_status_reg[data->type] < 0) {
+        ret = -ENODEV;
+        goto exit_gpio;
+    }
+
+    ret = request_threaded_irq(irq, NULL, as7326_56x_cpld_irq_thread, flags,
+                               client->name, client);
+    if (ret) {
+        goto exit_gpio;
+    }
+
+    data->irq = irq;
+
+    /* Prime the cache, from now on it follows the interrupts */
+    as7326_56x_cpld_irq_thread(irq, client);
+    return 0;
+
+exit_gpio:
+    if (data->irq_gpio >= 0) {
+        gpio_free(data->irq_gpio);
+        data->irq_gpio = -1;
+    }
+    return ret;
+}
+
+static void as7326_56x_cpld_irq_exit(struct i2c_client *client)
+{
+    struct as7326_56x_cpld_data *data = i2c_get_clientdata(client);
+
+    if (data->irq) {
+        free_irq(data->irq, client);
+        data->irq = 0;
+    }
+
+    if (data->irq_gpio >= 0) {
+        gpio_free(data->irq_gpio);
+        data->irq_gpio = -1;
+    }
+}
+
 /*
  * I2C init/probing/exit functions
  */
@@ -927,6 +1162,16 @@ static int as7326_56x_cpld_probe(struct i2c_client *client,
     }
 
     as7326_56x_cpld_add_client(client);
+
+    /* Interrupt support is optional, stay polled if there is none */
+    data->irq_gpio = -1;
+    if (data->type == as7326_56x_cpld1 || data->type == as7326_56x_cpld2) {
+        ret = as7326_56x_cpld_irq_init(client);
+        if (ret) {
+            dev_dbg(&client->dev, "no present interrupt (%d), polling\n", ret);
+        }
+    }
+
     return 0;
 
 exit_free:
@@ -940,6 +1185,7 @@ static int as7326_56x_cpld_remove(struct i2c_client *client)
     struct as7326_56x_cpld_data *data = i2c_get_clientdata(client);
     const struct attribute_group *group = NULL;
 
+    as7326_56x_cpld_irq_exit(client);
     as7326_56x_cpld_remove_client(client);
 
     /* Remove sysfs hooks */
@@ -1004,23 +1250,21 @@ static int as7326_56x_cpld_write_internal(struct i2c_client *client, u8 reg, u8
 
 int as7326_56x_cpld_read(unsigned short cpld_addr, u8 reg)
 {
-    struct list_head   *list_node = NULL;
-    struct cpld_client_node *cpld_node = NULL;
-    int ret = -EPERM;
+    struct cpld_client_node *node;
+    int ret = -EPERM, idx;
 
-    mutex_lock(&list_lock);
-
-    list_for_each(list_node, &cpld_client_list)
-    {
-        cpld_node = list_entry(list_node, struct cpld_client_node, list);
-
-        if (cpld_node->client->addr == cpld_addr) {
-            ret = as7326_56x_cpld_read_internal(cpld_node->client, reg);
-    		break;
-        }
+    if (cpld_addr >= CPLD_CLIENT_MAX_ADDR) {
+        return ret;
     }
 
-	mutex_unlock(&list_lock);
+    idx = srcu_read_lock(&cpld_client_srcu);
+    node = srcu_dereference(cpld_clients[cpld_addr], &cpld_client_srcu);
+    if (node) {
+        mutex_lock(&node->lock);
+        ret = as7326_56x_cpld_read_internal(node->client, reg);
+        mutex_unlock(&node->lock);
+    }
+    srcu_read_unlock(&cpld_client_srcu, idx);
 
     return ret;
 }
@@ -1028,23 +1272,21 @@ EXPORT_SYMBOL(as7326_56x_cpld_read);
 
 int as7326_56x_cpld_write(unsigned short cpld_addr, u8 reg, u8 value)
 {
-    struct list_head   *list_node = NULL;
-    struct cpld_client_node *cpld_node = NULL;
-    int ret = -EIO;
+    struct cpld_client_node *node;
+    int ret = -EIO, idx;
 
-	mutex_lock(&list_lock);
-
-    list_for_each(list_node, &cpld_client_list)
-    {
-        cpld_node = list_entry(list_node, struct cpld_client_node, list);
-
-        if (cpld_node->client->addr == cpld_addr) {
-            ret = as7326_56x_cpld_write_internal(cpld_node->client, reg, value);
-            break;
-        }
+    if (cpld_addr >= CPLD_CLIENT_MAX_ADDR) {
+        return ret;
     }
 
-	mutex_unlock(&list_lock);
+    idx = srcu_read_lock(&cpld_client_srcu);
+    node = srcu_dereference(cpld_clients[cpld_addr], &cpld_client_srcu);
+    if (node) {
+        mutex_lock(&node->lock);
+        ret = as7326_56x_cpld_write_internal(node->client, reg, value);
+        mutex_unlock(&node->lock);
+    }
+    srcu_read_unlock(&cpld_client_srcu, idx);
 
     return ret;
 }
@@ -0,0 +1 @@
+../../common/modules/accton_trace.h
\ No newline at end of file
@@ -18,50 +18,39 @@
 # ------------------------------------------------------------------
 # HISTORY:
 #    mm/dd/yyyy (A.D.)
-#    8/10/2018:  Jostar create for as5712-54x
+#    10/14/2026: Sample the BCM temperature for ThermalUtil
 # ------------------------------------------------------------------
 
+# The only way to the switch ASIC temperature is the SDK shell, and a
+# bcmcmd round trip can block for seconds while the SDK is busy.  This
+# daemon is the only one that asks: it samples "show temp" every
+# <interval> seconds and leaves the result in ThermalUtil.BCM_thermal_path,
+# where every monitor reads it without touching the SDK.
+
 try:
     import os
     import sys, getopt
-    import subprocess
-    import click
-    import imp
+    import re
+    import commands
     import logging
-    import logging.config
     import logging.handlers
-    import types
-    import time  # this is only being used as part of the example
-    import traceback
-    from tabulate import tabulate
-    
+    import time
+    from as7326_56x.thermalutil import ThermalUtil
 except ImportError as e:
     raise ImportError('%s - required module not found' % str(e))
 
 # Deafults
 VERSION = '1.0'
-FUNCTION_NAME = '/usr/local/bin/accton_as5712_monitor_fan'
+FUNCTION_NAME = '/usr/local/bin/accton_as7326_asic_temp'
+DEFAULT_INTERVAL = 10
+
+BCM_thermal_cmd = 'bcmcmd "show temp"'
+BCM_thermal_re = re.compile(r'average current temperature is\s*([0-9.]+)')
 
-global log_file
-global log_level
 
-fan_status_state=[2, 2, 2, 2, 2]  #init state=2, fault=1, normal=0
-# Make a class we can use to capture stdout and sterr in the log
 class device_monitor(object):
 
     def __init__(self, log_file, log_level):
-        
-        self.fan_num = 5
-        self.fan_path = "/sys/devices/platform/as5712_54x_fan/"        
-           
-        self.fault = {
-            0: "fan1_fault",
-            1: "fan2_fault",
-            2: "fan3_fault",
-            3: "fan4_fault",
-            4: "fan5_fault"
-        }        
-        
         """Needs a logger and a logger level."""
         # set up logging to file
         logging.basicConfig(
@@ -71,71 +60,73 @@ class device_monitor(object):
             format= '[%(asctime)s] {%(pathname)s:%(lineno)d} %(levelname)s - %(message)s',
             datefmt='%H:%M:%S'
         )
-        
         # set up logging to console
         if log_level == logging.DEBUG:
             console = logging.StreamHandler()
-            console.setLevel(logging.DEBUG)
+            console.setLevel(log_level)
             formatter = logging.Formatter('%(name)-12s: %(levelname)-8s %(message)s')
             console.setFormatter(formatter)
             logging.getLogger('').addHandler(console)
 
         sys_handler = logging.handlers.SysLogHandler(address = '/dev/log')
-        #sys_handler.setLevel(logging.WARNING)       
-        sys_handler.setLevel(logging.INFO)       
-        logging.getLogger('').addHandler(sys_handler)        
-
-        #logging.debug('SET. logfile:%s / loglevel:%d', log_file, log_level)
-        
-    def manage_fan(self):
-        
-        FAN_STATUS_FAULT = 1
-        FAN_STATUS_NORMAL = 0
-        
-        global fan_status_state
-       
-        for idx in range (0, self.fan_num):           
-            node = self.fan_path + self.fault[idx]
-            try:
-                val_file = open(node)
-            except IOError as e:
-                print "Error: unable to open file: %s" % str(e)          
-                return False
-            content = val_file.readline().rstrip()
-            val_file.close()
-            # content is a string, either "0" or "1"
-            if content == "1":
-                if fan_status_state[idx]!=FAN_STATUS_FAULT:
-                    logging.warning("Alarm for FAN-%d fault is detected", idx+1);
-                    fan_status_state[idx]=FAN_STATUS_FAULT
-            else:
-                if fan_status_state[idx]!=FAN_STATUS_NORMAL:
-                    fan_status_state[idx]=FAN_STATUS_NORMAL
-                    logging.info("FAN-%d normal is detected", idx+1);
-      
+        sys_handler.setLevel(logging.WARNING)
+        logging.getLogger('').addHandler(sys_handler)
+
+        self.path = ThermalUtil.BCM_thermal_path
+        self.ready = False
+
+    def sample(self):
+        status, output = commands.getstatusoutput(BCM_thermal_cmd)
+        match = BCM_thermal_re.search(output) if status == 0 else None
+        if match is None:
+            if self.ready:
+                logging.info('bcm sdk is not answering "show temp"')
+            self.ready = False
+            return False
+
+        temp = int(float(match.group(1)) * 1000)
+        logging.debug('bcm temp=%d', temp)
+
+        # readers only ever see a whole value
+        tmp_path = self.path + '.tmp'
+        try:
+            with open(tmp_path, 'w') as f:
+                f.write('%d\n' % temp)
+            os.rename(tmp_path, self.path)
+        except (IOError, OSError) as e:
+            logging.error('unable to write %s: %s', self.path, str(e))
+            return False
+
+        if not self.ready:
+            logging.info('bcm temperature is available, %d', temp)
+        self.ready = True
         return True
 
 def main(argv):
     log_file = '%s.log' % FUNCTION_NAME
     log_level = logging.INFO
+    interval = DEFAULT_INTERVAL
     if len(sys.argv) != 1:
         try:
-            opts, args = getopt.getopt(argv,'hdl:',['lfile='])
+            opts, args = getopt.getopt(argv,'hdl:i:',['lfile=', 'interval='])
         except getopt.GetoptError:
-            print 'Usage: %s [-d] [-l <log_file>]' % sys.argv[0]
+            print 'Usage: %s [-d] [-l <log_file>] [-i <interval>]' % sys.argv[0]
             return 0
         for opt, arg in opts:
             if opt == '-h':
-                print 'Usage: %s [-d] [-l <log_file>]' % sys.argv[0]
+                print 'Usage: %s [-d] [-l <log_file>] [-i <interval>]' % sys.argv[0]
                 return 0
             elif opt in ('-d', '--debug'):
                 log_level = logging.DEBUG
             elif opt in ('-l', '--lfile'):
                 log_file = arg
+            elif opt in ('-i', '--interval'):
+                interval = int(arg)
+
     monitor = device_monitor(log_file, log_level)
     while True:
-        monitor.manage_fan()
-        time.sleep(3)
+        monitor.sample()
+        time.sleep(interval)
 
 if __name__ == '__main__':
     main(sys.argv[1:])
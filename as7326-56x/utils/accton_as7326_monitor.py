@@ -20,6 +20,7 @@
 #    mm/dd/yyyy (A.D.)
 #    3/23/2018: Roy Lee modify for as7326_56x
 #    6/26/2018: Jostar implement by new thermal policy from HW RD
+#    10/14/2026: Keep the fan duty cycle on a warm restart
 # ------------------------------------------------------------------
 
 try:
@@ -37,6 +38,7 @@ try:
     from tabulate import tabulate
     from as7326_56x.fanutil import FanUtil
     from as7326_56x.thermalutil import ThermalUtil
+    from as7326_56x.monitorutil import SysfsCache, MonitorScheduler
 except ImportError as e:
     raise ImportError('%s - required module not found' % str(e))
 
@@ -87,6 +89,18 @@ class switch(object):
 
 fan_policy_state=1
 alarm_state = 0 #0->default or clear, 1-->alarm detect
+
+# Shutdown on (sensor_LM75_49 + Thermal sensor_LM75_CPU_4B) /2 in
+# (66C, 200C], the LEVEL_TEMP_CRITICAL of the fan policy.  Anything above
+# is a bogus reading.  Checked every THERMAL_SHUTDOWN_PERIOD seconds, apart
+# from the fan policy.
+THERMAL_SHUTDOWN_TEMP = 66000
+THERMAL_SHUTDOWN_TEMP_MAX = 200000
+THERMAL_SHUTDOWN_PERIOD = 1
+
+# Duty cycles of the policy levels, as read back from the fan CPLD
+WARM_DUTY_CYCLES = [38, 75, 100]
+
 test_temp = 0
 test_temp_list = [0, 0, 0, 0, 0, 0]
 
@@ -118,11 +132,116 @@ class device_monitor(object):
             logging.getLogger('').addHandler(console)
 
         sys_handler = handler = logging.handlers.SysLogHandler(address = '/dev/log')
-        sys_handler.setLevel(logging.WARNING)       
+        # INFO for the FAN and PSU present/power good events
+        sys_handler.setLevel(logging.INFO)
         logging.getLogger('').addHandler(sys_handler)
 
         #logging.debug('SET. logfile:%s / loglevel:%d', log_file, log_level)
-          
+
+        self.shutdown_last_check = 0
+        self.shutdown_max_reaction = 0
+
+        # one cache for every task: a node is read once per tick
+        self.cache = SysfsCache()
+        self.thermal = ThermalUtil(self.cache)
+        self.fan = FanUtil(self.cache)
+
+        self.fan_num = 6
+        self.fan_path = "/sys/bus/i2c/devices/11-0066/"
+        self.fan_state = [2] * self.fan_num         #init state=2, insert=1, remove=0
+        self.fan_status_state = [2] * self.fan_num  #init state=2, fault=1, normal=0
+
+        self.psu_num = 2
+        self.psu_path = "/sys/bus/i2c/devices/"
+        self.psu_mapping = {
+            0: "17-0051",
+            1: "13-0053",
+        }
+        self.psu_state = [2, 2]
+        self.psu_power_status = [2, 2]
+
+    def fan_status_nodes(self):
+        """The nodes the fan driver sysfs_notify()s"""
+        return [self.fan_path + 'fan%d_%s' % (idx+1, node)
+                for idx in range(0, self.fan_num) for node in ('present', 'fault')]
+
+    def manage_fan_status(self):
+        """FAN present and fault alarms"""
+        FAN_STATE_REMOVE = 0
+        FAN_STATE_INSERT = 1
+
+        FAN_STATUS_FAULT = 1
+        FAN_STATUS_NORMAL = 0
+
+        for idx in range (0, self.fan_num):
+            content = self.cache.read(self.fan_path + 'fan%d_present' % (idx+1))
+            if content is None:
+                return False
+            # content is a string, either "0" or "1"
+            if content == "1":
+                if self.fan_state[idx]!=FAN_STATE_INSERT:
+                    self.fan_state[idx]=FAN_STATE_INSERT
+                    logging.info("FAN-%d present is detected", idx+1)
+            else:
+                if self.fan_state[idx]!=FAN_STATE_REMOVE:
+                    self.fan_state[idx]=FAN_STATE_REMOVE
+                    logging.warning("Alarm for FAN-%d absent is detected", idx+1)
+
+        for idx in range (0, self.fan_num):
+            content = self.cache.read(self.fan_path + 'fan%d_fault' % (idx+1))
+            if content is None:
+                return False
+            # content is a string, either "0" or "1"
+            if content == "1":
+                if self.fan_status_state[idx]!=FAN_STATUS_FAULT:
+                    if self.fan_state[idx] == FAN_STATE_INSERT:
+                        logging.warning("Alarm for FAN-%d failed is detected", idx+1)
+                        self.fan_status_state[idx]=FAN_STATUS_FAULT
+            else:
+                self.fan_status_state[idx]=FAN_STATUS_NORMAL
+
+        return True
+
+    def manage_psu(self):
+        """PSU present and power good alarms"""
+        PSU_STATE_REMOVE = 0
+        PSU_STATE_INSERT = 1
+
+        PSU_STATUS_NO_POWER = 0
+        PSU_STATUS_POWER_GOOD = 1
+
+        for idx in range (0, self.psu_num):
+            content = self.cache.read(self.psu_path + self.psu_mapping[idx] + '/psu_present')
+            if content is None:
+                return False
+            # content is a string, either "0" or "1"
+            if content == "1":
+                if self.psu_state[idx]!=PSU_STATE_INSERT:
+                    self.psu_state[idx]=PSU_STATE_INSERT
+                    logging.info("PSU-%d present is detected", idx+1)
+            else:
+                if self.psu_state[idx]!=PSU_STATE_REMOVE:
+                    self.psu_state[idx]=PSU_STATE_REMOVE
+                    logging.warning("Alarm for PSU-%d absent is detected", idx+1)
+                    self.psu_power_status[idx]=PSU_STATUS_NO_POWER
+
+        for idx in range (0, self.psu_num):
+            content = self.cache.read(self.psu_path + self.psu_mapping[idx] + '/psu_power_good')
+            if content is None:
+                return False
+            # content is a string, either "0" or "1"
+            if content == "0":
+                if self.psu_power_status[idx]!=PSU_STATUS_NO_POWER:
+                    if self.psu_state[idx]==PSU_STATE_INSERT:
+                        logging.warning("Alarm for PSU-%d fault is detected", idx+1)
+                        self.psu_power_status[idx]=PSU_STATUS_NO_POWER
+            else:
+                if self.psu_power_status[idx] !=PSU_STATUS_POWER_GOOD:
+                    logging.info("PSU-%d power_good is detected", idx+1)
+                    self.psu_power_status[idx]=PSU_STATUS_POWER_GOOD
+
+        return True
+
     def get_state_from_fan_policy(self, temp, policy):
         state=0
          
@@ -142,6 +261,42 @@ class device_monitor(object):
             logging.debug('set default state')
         return state
     
+    def manage_thermal_shutdown(self):
+        """Over-temperature shutdown: reads only lm75_49 and lm75_4b"""
+        global test_temp
+        global test_temp_list
+
+        start = time.time()
+        if test_temp==0:
+            temp2 = self.thermal._get_thermal_val(self.thermal.THERMAL_NUM_2_IDX)
+            temp4 = self.thermal._get_thermal_val(self.thermal.THERMAL_NUM_4_IDX)
+        else:
+            temp2 = test_temp_list[1]
+            temp4 = test_temp_list[3]
+
+        # worst case from a crossing to acting on it: the time since the
+        # previous check plus this one's reads
+        if self.shutdown_last_check:
+            reaction = time.time() - self.shutdown_last_check
+            if reaction > self.shutdown_max_reaction:
+                self.shutdown_max_reaction = reaction
+                logging.info('thermal shutdown worst-case reaction time is %d ms', reaction * 1000)
+        self.shutdown_last_check = start
+
+        if not temp2 or not temp4:
+            # the fan policy runs the fans at 75% on a missing sensor
+            logging.debug('thermal shutdown: lm75_49=%s, lm75_4b=%s, not checked', temp2, temp4)
+            return False
+
+        temp_get = (temp2 + temp4)/2
+        if temp_get > THERMAL_SHUTDOWN_TEMP_MAX:
+            logging.warning('thermal shutdown: %d is out of range, not acted on', temp_get)
+            return True
+        if temp_get > THERMAL_SHUTDOWN_TEMP:
+            logging.critical('Alarm for temperature critical is detected (%d), reboot DUT', temp_get)
+            os.system('reboot')
+        return True
+
     def manage_fans(self):
         
         thermal_pwm_list = {} #Ori sort is lm75_48, 49, 4a, 4b, cpu, bcm
@@ -171,8 +326,8 @@ class device_monitor(object):
         4: [66000, 200000,  LEVEL_TEMP_CRITICAL],        
         }
               
-        thermal = ThermalUtil()
-        fan = FanUtil()
+        thermal = self.thermal
+        fan = self.fan
         fan_dir=fan.get_fan_dir(1)            
         if fan_dir > 1:
             fan_dri=1 #something wrong, set fan_dir to default val
@@ -230,43 +385,29 @@ class device_monitor(object):
         #else:
         new_state = fan_policy_state
         
+        # LEVEL_TEMP_CRITICAL only runs the fans at full speed here, the
+        # shutdown itself is up to manage_thermal_shutdown()
         #logging.warning('Temperature high alarm testing')       
         if ori_state==LEVEL_FAN_DEF:            
            if new_state==LEVEL_TEMP_HIGH:
                if alarm_state==0:
                    logging.warning('Alarm for temperature high is detected')
                alarm_state=1
-           if new_state==LEVEL_TEMP_CRITICAL:
-               logging.critical('Alarm for temperature critical is detected, reboot DUT')
-               time.sleep(2)
-               os.system('reboot')           
         if ori_state==LEVEL_FAN_MID:
             if new_state==LEVEL_TEMP_HIGH:
                 if alarm_state==0:
                     logging.warning('Alarm for temperature high is detected')
                 alarm_state=1 
-            if new_state==LEVEL_TEMP_CRITICAL:
-                logging.critical('Alarm for temperature critical is detected')
-                time.sleep(2)
-                os.system('reboot') 
         if ori_state==LEVEL_FAN_MAX:
             if new_state==LEVEL_TEMP_HIGH:
                 if alarm_state==0:
                     logging.warning('Alarm for temperature high is detected') 
                 alarm_state=1
-            if new_state==LEVEL_TEMP_CRITICAL:
-                logging.critical('Alarm for temperature critical is detected')
-                time.sleep(2)
-                os.system('reboot') 
             if alarm_state==1:
                 if temp_get < (fan_policy[3][0] - 5000):  #below 65 C, clear alarm
                     logging.warning('Alarm for temperature high is cleared')
                     alarm_state=0
         if ori_state==LEVEL_TEMP_HIGH:
-            if new_state==LEVEL_TEMP_CRITICAL:
-                logging.critical('Alarm for temperature critical is detected')
-                time.sleep(2)
-                os.system('reboot')
             if new_state <= LEVEL_FAN_MID:
                 logging.warning('Alarm for temperature high is cleared')
                 alarm_state=0
@@ -313,13 +454,24 @@ def main(argv):
             print test_temp_list                       
     
     fan = FanUtil()
-    fan.set_fan_duty_cycle(38)
-    print "set default fan speed to 37.5%"
+    # A duty cycle of a policy level is what the monitor before us left
+    # (fast-reboot, pmon restart): the first round of the policy moves
+    # on from it.  Anything else is the CPLD default after a cold start.
+    duty = fan.get_fan_duty_cycle()
+    if duty in WARM_DUTY_CYCLES:
+        print "fan speed at %d%%, warm restart" % duty
+    else:
+        fan.set_fan_duty_cycle(38)
+        print "set default fan speed to 37.5%"
     monitor = device_monitor(log_file, log_level)
+    scheduler = MonitorScheduler(monitor.cache)
+    # first, so it runs ahead of the others when they are due together
+    scheduler.register('thermal shutdown', THERMAL_SHUTDOWN_PERIOD, monitor.manage_thermal_shutdown)
+    scheduler.register('fan policy', 5, monitor.manage_fans)
+    scheduler.register('fan status', 3, monitor.manage_fan_status, notify=monitor.fan_status_nodes())
+    scheduler.register('psu status', 3, monitor.manage_psu)
     # Loop forever, doing something useful hopefully:
-    while True:
-        monitor.manage_fans()
-        time.sleep(5)
+    scheduler.run()
 
 if __name__ == '__main__':
     main(sys.argv[1:])
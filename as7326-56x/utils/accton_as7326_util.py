@@ -31,9 +31,14 @@ options:
     -h | --help     : this help message
     -d | --debug    : run with debug mode
     -f | --force    : ignore error during installation or clean
+    -s | --staged   : install in parallel stages and print their timing
+    -c | --clock    : program the 8V89307 clock chip and reset the MAC
+                      during install
+    -v | --verify   : with --clock, read the clock chip setup back
 command:
     install     : install drivers and generate related sysfs nodes
     clean       : uninstall drivers and remove related sysfs nodes
+                  (the optoe EEPROM caches are kept for the next install)
     show        : show all systen status
     sff         : dump SFP eeprom
     set         : change board setting with fan|led|sfp
@@ -43,8 +48,12 @@ import os
 import commands
 import sys, getopt
 import logging
+import accton_sff
 import re
 import time
+import subprocess
+import fcntl
+import ctypes
 from collections import namedtuple
 
 
@@ -58,6 +67,9 @@ args = []
 ALL_DEVICE = {}
 DEVICE_NO = {'led':5, 'fan':6,'thermal':4, 'psu':2, 'sfp':58}
 FORCE = 0
+STAGED = 0
+CLOCK = 0
+VERIFY = 0
 #logging.basicConfig(filename= PROJECT_NAME+'.log', filemode='w',level=logging.DEBUG)
 #logging.basicConfig(level=logging.INFO)
 
@@ -71,13 +83,19 @@ def main():
     global DEBUG
     global args
     global FORCE
+    global STAGED
+    global CLOCK
+    global VERIFY
 
     if len(sys.argv)<2:
         show_help()
 
-    options, args = getopt.getopt(sys.argv[1:], 'hdf', ['help',
+    options, args = getopt.getopt(sys.argv[1:], 'hdfscv', ['help',
                                                        'debug',
                                                        'force',
+                                                       'staged',
+                                                       'clock',
+                                                       'verify',
                                                           ])
     if DEBUG == True:                
         print options
@@ -92,6 +110,12 @@ def main():
             logging.basicConfig(level=logging.INFO)
         elif opt in ('-f', '--force'):
             FORCE = 1
+        elif opt in ('-s', '--staged'):
+            STAGED = 1
+        elif opt in ('-c', '--clock'):
+            CLOCK = 1
+        elif opt in ('-v', '--verify'):
+            VERIFY = 1
         else:
             logging.info('no option')
     for arg in args:
@@ -104,6 +128,8 @@ def main():
         elif arg == 'sff':
             if len(args)!=2:
                 show_eeprom_help()
+            elif args[1] == 'all':
+                show_eeprom_all()
             elif int(args[1]) ==0 or int(args[1]) > DEVICE_NO['sfp']:
                 show_eeprom_help()
             else:
@@ -136,6 +162,7 @@ def  show_set_help():
 def  show_eeprom_help():
     cmd =  sys.argv[0].split("/")[-1]+ " "  + args[0]
     print  "    use \""+ cmd + " 1-56 \" to dump sfp# eeprom"
+    print  "    use \""+ cmd + " all \" to dump the eeprom of every present sfp"
     sys.exit(0)
 
 def my_log(txt):
@@ -161,128 +188,207 @@ def driver_check():
         return False
     return True
 
-def set_8v89307():
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x2D 0x00", 0)#Select to Page 0
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x7F 0x05", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x7E 0x85", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x7B 0x00", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x7A 0x00", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x79 0x40", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x78 0x06", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x73 0x40", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x72 0x40", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x71 0x0A", 0) # OUT3:25MHz
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x70 0x00", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x6B 0x4E", 0) # OUT1:1pps
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x69 0x00", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x68 0x00", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x67 0x19", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x66 0xAB", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x65 0x8C", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x64 0x00", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x63 0x00", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x62 0x00", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x5F 0x00", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x5E 0x00", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x5D 0x00", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x5C 0x78", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x5B 0x02", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x5A 0xE5", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x59 0x88", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x58 0x4B", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x57 0x6C", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x56 0x6C", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x55 0x80", 0) # Lock to DPLL, output 625MHz
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x53 0x00", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x52 0x81", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x50 0x00", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x4F 0x00", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x4E 0x00", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x4C 0xCB", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x4A 0x00", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x45 0x66", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x44 0x66", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x42 0x80", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x41 0x03", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x40 0x01", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x3F 0x08", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x3E 0x04", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x3D 0x20", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x3C 0x13", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x3B 0x00", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x3A 0x98", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x39 0x01", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x38 0xE6", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x37 0x04", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x36 0xCE", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x35 0x7C", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x34 0x01", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x33 0x08", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x32 0x08", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x31 0x08", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x30 0x03", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x2F 0x23", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x2E 0x0B", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x2D 0x00", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x28 0x76", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x27 0x54", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x25 0x00", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x24 0x03", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x23 0x06", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x1A 0x8C", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x19 0x8C", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x18 0x00", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x16 0x0D", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x11 0x00", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x10 0x00", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x0E 0x3F", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x0D 0xFF", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x0C 0x02", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x0B 0xA1", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x0A 0x89", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x09 0xA2", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x08 0x32", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x06 0x00", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x05 0x00", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x04 0x00", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x03 0x00", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x02 0x05", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x01 0x33", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x00 0x91", 0)
+# 8V89307 clock setup, (register, value) in programming order
+CLK_8V89307_ADDR = 0x54
+CLK_8V89307_INIT = [
+    (0x2D, 0x00),  # Select to Page 0
+    (0x7F, 0x05),
+    (0x7E, 0x85),
+    (0x7B, 0x00),
+    (0x7A, 0x00),
+    (0x79, 0x40),
+    (0x78, 0x06),
+    (0x73, 0x40),
+    (0x72, 0x40),
+    (0x71, 0x0A),  # OUT3:25MHz
+    (0x70, 0x00),
+    (0x6B, 0x4E),  # OUT1:1pps
+    (0x69, 0x00),
+    (0x68, 0x00),
+    (0x67, 0x19),
+    (0x66, 0xAB),
+    (0x65, 0x8C),
+    (0x64, 0x00),
+    (0x63, 0x00),
+    (0x62, 0x00),
+    (0x5F, 0x00),
+    (0x5E, 0x00),
+    (0x5D, 0x00),
+    (0x5C, 0x78),
+    (0x5B, 0x02),
+    (0x5A, 0xE5),
+    (0x59, 0x88),
+    (0x58, 0x4B),
+    (0x57, 0x6C),
+    (0x56, 0x6C),
+    (0x55, 0x80),  # Lock to DPLL, output 625MHz
+    (0x53, 0x00),
+    (0x52, 0x81),
+    (0x50, 0x00),
+    (0x4F, 0x00),
+    (0x4E, 0x00),
+    (0x4C, 0xCB),
+    (0x4A, 0x00),
+    (0x45, 0x66),
+    (0x44, 0x66),
+    (0x42, 0x80),
+    (0x41, 0x03),
+    (0x40, 0x01),
+    (0x3F, 0x08),
+    (0x3E, 0x04),
+    (0x3D, 0x20),
+    (0x3C, 0x13),
+    (0x3B, 0x00),
+    (0x3A, 0x98),
+    (0x39, 0x01),
+    (0x38, 0xE6),
+    (0x37, 0x04),
+    (0x36, 0xCE),
+    (0x35, 0x7C),
+    (0x34, 0x01),
+    (0x33, 0x08),
+    (0x32, 0x08),
+    (0x31, 0x08),
+    (0x30, 0x03),
+    (0x2F, 0x23),
+    (0x2E, 0x0B),
+    (0x2D, 0x00),
+    (0x28, 0x76),
+    (0x27, 0x54),
+    (0x25, 0x00),
+    (0x24, 0x03),
+    (0x23, 0x06),
+    (0x1A, 0x8C),
+    (0x19, 0x8C),
+    (0x18, 0x00),
+    (0x16, 0x0D),
+    (0x11, 0x00),
+    (0x10, 0x00),
+    (0x0E, 0x3F),
+    (0x0D, 0xFF),
+    (0x0C, 0x02),
+    (0x0B, 0xA1),
+    (0x0A, 0x89),
+    (0x09, 0xA2),
+    (0x08, 0x32),
+    (0x06, 0x00),
+    (0x05, 0x00),
+    (0x04, 0x00),
+    (0x03, 0x00),
+    (0x02, 0x05),
+    (0x01, 0x33),
+    (0x00, 0x91),
 
     # PreDivider_Parameters
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x23 0x05", 0) #IN1
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x24 0x03", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x25 0x00", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x23 0x06", 0) #IN2
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x24 0x03", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x25 0x00", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x23 0x03", 0) #IN3
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x24 0x00", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x25 0x00", 0)
+    (0x23, 0x05),  # IN1
+    (0x24, 0x03),
+    (0x25, 0x00),
+    (0x23, 0x06),  # IN2
+    (0x24, 0x03),
+    (0x25, 0x00),
+    (0x23, 0x03),  # IN3
+    (0x24, 0x00),
+    (0x25, 0x00),
 
     # Page1_Parameters
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x2D 0x01", 0)#Select to Page 1
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x30 0x03", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x31 0x08", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x32 0x08", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x33 0x08", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x35 0x7C", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x36 0xCE", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x37 0x04", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x38 0xE6", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x39 0x01", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x3A 0x98", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x3B 0x00", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x3C 0x13", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x3D 0x20", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x54 0x2D 0x00", 0)#Return to Page 0
+    (0x2D, 0x01),  # Select to Page 1
+    (0x30, 0x03),
+    (0x31, 0x08),
+    (0x32, 0x08),
+    (0x33, 0x08),
+    (0x35, 0x7C),
+    (0x36, 0xCE),
+    (0x37, 0x04),
+    (0x38, 0xE6),
+    (0x39, 0x01),
+    (0x3A, 0x98),
+    (0x3B, 0x00),
+    (0x3C, 0x13),
+    (0x3D, 0x20),
+    (0x2D, 0x00),  # Return to Page 0
+]
 
+# Muxes left on the path to the clock chip by cpld_reset_mac()
+CLK_8V89307_MUX = [0x70, 0x77]
+
+I2C_RDWR = 0x0707
+I2C_M_RD = 0x0001
+I2C_RDWR_MAX_MSGS = 42          # I2C_RDWR_IOCTL_MAX_MSGS of i2c-dev
+
+class i2c_msg(ctypes.Structure):
+    _fields_ = [('addr', ctypes.c_uint16),
+                ('flags', ctypes.c_uint16),
+                ('len', ctypes.c_uint16),
+                ('buf', ctypes.POINTER(ctypes.c_uint8))]
+
+class i2c_rdwr_ioctl_data(ctypes.Structure):
+    _fields_ = [('msgs', ctypes.POINTER(i2c_msg)),
+                ('nmsgs', ctypes.c_uint32)]
+
+def i2c_rdwr(bus, groups):
+    # groups is a list of transfers, each a list of (addr, flags, buf).
+    # A transfer is never split across ioctls, so a register pointer
+    # write stays in front of its read.  Read data lands in buf.
+    fd = os.open('/dev/i2c-%d' % bus, os.O_RDWR)
+    try:
+        pending = []
+        for group in groups + [None]:
+            if group is not None and len(pending) + len(group) <= I2C_RDWR_MAX_MSGS:
+                pending.extend(group)
+                continue
+            if pending:
+                msgs = (i2c_msg * len(pending))()
+                for i, (addr, flags, buf) in enumerate(pending):
+                    msgs[i].addr = addr
+                    msgs[i].flags = flags
+                    msgs[i].len = len(buf)
+                    msgs[i].buf = ctypes.cast(buf, ctypes.POINTER(ctypes.c_uint8))
+                fcntl.ioctl(fd, I2C_RDWR, i2c_rdwr_ioctl_data(msgs, len(pending)))
+            pending = list(group) if group is not None else []
+    finally:
+        os.close(fd)
+
+def set_8v89307_i2cset():
+    for reg, val in CLK_8V89307_INIT:
+        log_os_system("i2cset -y 0 0x%02x 0x%02x 0x%02x" % (CLK_8V89307_ADDR, reg, val), 0)
     #reset the in-path mux
-    ret, lsmod = log_os_system("i2cset -y 0 0x70 0x0", 0)
-    ret, lsmod = log_os_system("i2cset -y 0 0x77 0x0", 0)
+    for mux in CLK_8V89307_MUX:
+        log_os_system("i2cset -y 0 0x%02x 0x0" % mux, 0)
+
+def set_8v89307():
+    # The whole table goes through one open of /dev/i2c-0 with I2C_RDWR
+    # instead of an i2cset process per register.  With VERIFY each write
+    # is read back right after it, i.e. on the page it was written to.
+    u8_2 = ctypes.c_uint8 * 2
+    u8_1 = ctypes.c_uint8 * 1
+    groups = []
+    checks = []
+    for reg, val in CLK_8V89307_INIT:
+        group = [(CLK_8V89307_ADDR, 0, u8_2(reg, val))]
+        if VERIFY:
+            rd = u8_1(0)
+            group += [(CLK_8V89307_ADDR, 0, u8_1(reg)),
+                      (CLK_8V89307_ADDR, I2C_M_RD, rd)]
+            checks.append((reg, val, rd))
+        groups.append(group)
+    #reset the in-path mux
+    for mux in CLK_8V89307_MUX:
+        groups.append([(mux, 0, u8_1(0))])
+
+    try:
+        i2c_rdwr(0, groups)
+    except (IOError, OSError) as e:
+        logging.info('I2C_RDWR failed: ' + str(e) + ', using i2cset')
+        set_8v89307_i2cset()
+        return True
+
+    bad = 0
+    for reg, val, rd in checks:
+        if rd[0] != val:
+            print '8v89307: reg 0x%02x wrote 0x%02x read 0x%02x' % (reg, val, rd[0])
+            bad += 1
+    return bad == 0
 
-	
 def cpld_reset_mac():
     ret, lsmod = log_os_system("i2cset -y 0 0x77 0x1", 0)
     ret, lsmod = log_os_system("i2cset -y 0 0x70 0x1", 0)
@@ -291,7 +397,8 @@ def cpld_reset_mac():
         #printf "Device 8v89307(0x54) not found"
         return True
 
-    set_8v89307()
+    if not set_8v89307():
+        print '8v89307: setup did not read back as written'
     #flip MAC reset at CPLD
     ret, lsmod = log_os_system("i2cset -y 0 0x77 0x1", 0)
     ret, lsmod = log_os_system("i2cset -y 0 0x71 0x2", 0)
@@ -313,9 +420,10 @@ kos = [
 def driver_install():
     global FORCE
     
-    #reset MAC and IDT 82V89307
+    #reset MAC and IDT 82V89307, only on request: it resets the MAC
     status, output = log_os_system('modprobe i2c_dev', 1)
-    #status = cpld_reset_mac()
+    if CLOCK:
+        status = cpld_reset_mac()
 
     status, output = log_os_system("depmod", 1)
     for i in range(0,len(kos)):
@@ -406,6 +514,80 @@ mknod2 =[
 
 
 
+# Registers everything in mknod and the optoe EEPROMs from the kernel
+BOARD_MODULE = 'accton_as7326_56x_board'
+BOARD_READY = '/sys/module/'+BOARD_MODULE+'/parameters/ready'
+
+def board_install():
+    status, output = log_os_system('modprobe '+BOARD_MODULE, 1)
+    if status:
+        return status
+
+    for i in range(0, 50):
+        try:
+            with open(BOARD_READY) as f:
+                if f.read().strip() == 'Y':
+                    return 0
+        except IOError:
+            pass
+        time.sleep(0.1)
+    return 1
+
+def board_uninstall():
+    if not os.path.exists('/sys/module/'+BOARD_MODULE):
+        return 1
+    status, output = log_os_system('modprobe -rq '+BOARD_MODULE, 1)
+    return status
+
+# The optoe EEPROM caches, kept across a driver reload.  tmpfs: a pmon
+# restart finds them, a reboot does not.  optoe takes an image back only
+# if the module holds the same identifier and serial number.
+OPTOE_CACHE_DIR = '/run/accton/optoe_cache/'
+
+def optoe_cache_save():
+    try:
+        if not os.path.isdir(OPTOE_CACHE_DIR):
+            os.makedirs(OPTOE_CACHE_DIR)
+    except OSError as e:
+        logging.info('unable to create %s: %s', OPTOE_CACHE_DIR, str(e))
+        return 0
+
+    saved = 0
+    for bus in sfp_map:
+        name = '%d-0050' % bus
+        try:
+            with open(i2c_prefix+name+'/cache_image', 'rb') as f:
+                image = f.read()
+            with open(OPTOE_CACHE_DIR+name, 'wb') as f:
+                f.write(image)
+            saved += 1
+        except IOError:
+            continue
+    return saved
+
+def optoe_cache_restore():
+    restored = 0
+    for bus in sfp_map:
+        name = '%d-0050' % bus
+        path = OPTOE_CACHE_DIR+name
+        if not os.path.exists(path):
+            continue
+        try:
+            with open(path, 'rb') as f:
+                image = f.read()
+            # one write: optoe only takes a whole image
+            with open(i2c_prefix+name+'/cache_image', 'wb', 0) as f:
+                f.write(image)
+            restored += 1
+        except IOError as e:
+            # another module, or none: the cache simply fills again
+            logging.info('%s: cache image not restored: %s', name, str(e))
+        try:
+            os.remove(path)
+        except OSError:
+            pass
+    return restored
+
 def i2c_order_check():
     # This project has only 1 i2c bus.
     return 0
@@ -413,6 +595,9 @@ def i2c_order_check():
 def device_install():
     global FORCE
 
+    if board_install() == 0:
+        return
+
     order = i2c_order_check()
 
     # if 0x70 is not exist @i2c-1, use reversed bus order
@@ -452,6 +637,9 @@ def device_install():
 def device_uninstall():
     global FORCE
 
+    if board_uninstall() == 0:
+        return
+
     status, output =log_os_system("ls /sys/bus/i2c/devices/1-0076", 0)
     if status==0:
         I2C_ORDER=1
@@ -491,7 +679,133 @@ def system_ready():
         return False
     return True
 
+# Staged install: the modules of a stage load in parallel, and the next
+# stage starts once every readiness path of this one exists (or reads
+# the given value) instead of after a fixed sleep.
+install_stages = [
+    ('bus',
+     ['modprobe i2c_dev',
+      'modprobe i2c_mux_pca954x force_deselect_on_exit=1',
+      'modprobe accton_i2c_cpld'],
+     [('/sys/module/i2c_dev', None),
+      ('/sys/module/i2c_mux_pca954x', None),
+      ('/sys/module/accton_i2c_cpld', None)]),
+    ('drivers',
+     ['modprobe ym2651y',
+      'modprobe accton_as7326_56x_fan',
+      'modprobe optoe',
+      'modprobe accton_as7326_56x_leds',
+      'modprobe accton_as7326_56x_psu'],
+     [('/sys/module/ym2651y', None),
+      ('/sys/module/accton_as7326_56x_fan', None),
+      ('/sys/module/optoe', None),
+      ('/sys/module/accton_as7326_56x_leds', None),
+      ('/sys/module/accton_as7326_56x_psu', None)]),
+    ('devices',
+     ['modprobe '+BOARD_MODULE],
+     [(BOARD_READY, 'Y'),
+      (i2c_prefix+'18-0060/version', None),
+      (i2c_prefix+'12-0062/version', None),
+      (i2c_prefix+'19-0064/version', None)]),
+]
+STAGE_TIMEOUT = 10
+
+def run_parallel(cmds):
+    procs = []
+    for cmd in cmds:
+        logging.info('Run :'+cmd)
+        procs.append((cmd, subprocess.Popen(cmd, shell=True,
+                            stdout=subprocess.PIPE, stderr=subprocess.STDOUT)))
+    status = 0
+    for cmd, p in procs:
+        output = p.communicate()[0]
+        my_log (cmd +"with result:" + str(p.returncode))
+        my_log ("      output:"+output)
+        if p.returncode:
+            print('Failed :'+cmd)
+            status = p.returncode
+    return status
+
+def path_ready(path, value):
+    try:
+        with open(path) as f:
+            data = f.read().strip()
+    except IOError:
+        # module directories can't be read, only looked up
+        return value is None and os.path.isdir(path)
+    return value is None or data == value
+
+def wait_ready(checks, timeout):
+    deadline = time.time() + timeout
+    pending = checks
+    while True:
+        pending = [c for c in pending if not path_ready(c[0], c[1])]
+        if not pending:
+            return 0
+        if time.time() > deadline:
+            print 'Timed out waiting for '+', '.join([c[0] for c in pending])
+            return 1
+        time.sleep(0.02)
+
+def staged_install():
+    global FORCE
+    timing = []
+    status = 0
+    start = time.time()
+
+    # The same checks and steps as the sequential install, only the
+    # loading itself runs in parallel stages
+    print "Checking system...."
+    skip = []
+    if driver_check() == False:
+        print "No driver, installing...."
+        if CLOCK:
+            # before the muxes and CPLDs are bound, as driver_install does
+            log_os_system('modprobe i2c_dev', 1)
+            cpld_reset_mac()
+        log_os_system("depmod", 1)
+    else:
+        print PROJECT_NAME.upper()+" drivers detected...."
+        skip += ['bus', 'drivers']
+    if device_exist():
+        print PROJECT_NAME.upper()+" devices detected...."
+        skip.append('devices')
+    else:
+        print "No device, installing...."
+
+    for name, cmds, checks in install_stages:
+        if name in skip:
+            continue
+        t0 = time.time()
+        status = run_parallel(cmds)
+        if status == 0:
+            status = wait_ready(checks, STAGE_TIMEOUT)
+        if status and name == 'devices':
+            # no board module, create the devices one by one
+            status = device_install()
+        timing.append((name, time.time() - t0, status))
+        if status and FORCE == 0:
+            break
+        if name == 'devices':
+            print "Restored %d EEPROM cache(s)" % optoe_cache_restore()
+
+    if timing:
+        print "Install stage timing:"
+        for name, t, st in timing:
+            print "    %-10s %8.1f ms%s" % (name, t * 1000, "  FAILED" if st else "")
+        print "    %-10s %8.1f ms" % ('total', (time.time() - start) * 1000)
+    return status if FORCE == 0 else 0
+
 def do_install():
+    if STAGED:
+        status = staged_install()
+        if status:
+            return status
+        # The inventory of sff, show and set, see accton_sff.py
+        devices_info()
+        accton_sff.save_index(PROJECT_NAME, ALL_DEVICE)
+        return
+
     print "Checking system...."
     if driver_check() == False:
         print "No driver, installing...."
@@ -507,15 +821,21 @@ def do_install():
         if status:
             if FORCE == 0:
                 return  status
+        print "Restored %d EEPROM cache(s)" % optoe_cache_restore()
     else:
         print PROJECT_NAME.upper()+" devices detected...."
+    # The inventory of sff, show and set, see accton_sff.py
+    devices_info()
+    accton_sff.save_index(PROJECT_NAME, ALL_DEVICE)
     return
 
 def do_uninstall():
+    accton_sff.remove_index(PROJECT_NAME)
     print "Checking system...."
     if not device_exist():
         print PROJECT_NAME.upper() +" has no device installed...."
     else:
+        optoe_cache_save()
         print "Removing device...."
         status = device_uninstall()
         if status:
@@ -588,36 +908,39 @@ def devices_info():
                     print("   "+"   "+k)
     return
 
-def show_eeprom(index):
+def load_devices():
+    global ALL_DEVICE
+    if len(ALL_DEVICE)==0:
+        ALL_DEVICE = accton_sff.load_index(PROJECT_NAME) or {}
+    return len(ALL_DEVICE)!=0
+
+# The index written by install stands for system_ready() as well
+def devices_ready():
+    if load_devices():
+        return True
     if system_ready()==False:
         print("System's not ready.")
         print("Please install first!")
-        return
+        return False
+    devices_info()
+    return True
 
-    if len(ALL_DEVICE)==0:
-        devices_info()
-    node = ALL_DEVICE['sfp'] ['sfp'+str(index)][0]
-    node = node.replace(node.split("/")[-1], 'eeprom')
-    # check if got hexdump command in current environment
-    ret, log = log_os_system("which hexdump", 0)
-    ret, log2 = log_os_system("which busybox hexdump", 0)
-    if len(log):
-        hex_cmd = 'hexdump'
-    elif len(log2):
-        hex_cmd = ' busybox hexdump'
-    else:
-        log = 'Failed : no hexdump cmd!!'
-        logging.info(log)
-        print log
-        return 1
+# ALL_DEVICE['sfp'] has the CPLD attributes, the EEPROM is the optoe client
+def eeprom_node(index):
+    return i2c_prefix+str(sfp_map[index-1])+'-0050/eeprom'
 
-    print node + ":"
-    ret, log = log_os_system("cat "+node+"| "+hex_cmd+" -C", 1)
-    if ret==0:
-        print  log
-    else:
-        print "**********device no found**********"
-    return
+def show_eeprom(index):
+    if not devices_ready():
+        return
+    return accton_sff.dump(eeprom_node(index))
+
+def show_eeprom_all():
+    if not devices_ready():
+        return
+    ports = []
+    for i in range(1, DEVICE_NO['sfp']+1):
+        ports.append((i, ALL_DEVICE['sfp']['sfp'+str(i)][0], eeprom_node(i)))
+    return accton_sff.dump_present(ports)
 
 def set_device(args):
     global DEVICE_NO
@@ -627,7 +950,7 @@ def set_device(args):
         print("Please install first!")
         return
 
-    if len(ALL_DEVICE)==0:
+    if not load_devices():
         devices_info()
 
     if args[0]=='led':
@@ -688,7 +1011,7 @@ def device_traversal():
         print("Please install first!")
         return
 
-    if len(ALL_DEVICE)==0:
+    if not load_devices():
         devices_info()
     for i in sorted(ALL_DEVICE.keys()):
         print("============================================")
@@ -37,7 +37,7 @@
 static ssize_t show_status(struct device *dev, struct device_attribute *da, char *buf);
 static ssize_t show_model_name(struct device *dev, struct device_attribute *da, char *buf);
 static int as7712_32x_psu_read_block(struct i2c_client *client, u8 command, u8 *data,int data_len);
-extern int accton_i2c_cpld_read(unsigned short cpld_addr, u8 reg);
+extern int accton_i2c_cpld_read_cached(unsigned short cpld_addr, u8 reg);
 
 /* Addresses scanned 
  */
@@ -49,9 +49,9 @@ struct as7712_32x_psu_data {
     struct device      *hwmon_dev;
     struct mutex        update_lock;
     char                valid;           /* !=0 if registers are valid */
-    unsigned long       last_updated;    /* In jiffies */
     u8  index;           /* PSU index */
     u8  status;          /* Status(present/power_good) register read from CPLD */
+    u8  psu_bits;        /* This PSU's bits of status when the eeprom was read */
     char model_name[9]; /* Model name, read from eeprom */
 };
 
@@ -219,51 +219,60 @@ static int as7712_32x_psu_read_block(struct i2c_client *client, u8 command, u8 *
     return result;
 }
 
+/* Present and power good bits of this PSU in the CPLD status register */
+#define PSU_STATUS_BITS(index)  (BIT(1 - (index)) | BIT(3 - (index)))
+
 static struct as7712_32x_psu_data *as7712_32x_psu_update_device(struct device *dev)
 {
     struct i2c_client *client = to_i2c_client(dev);
     struct as7712_32x_psu_data *data = i2c_get_clientdata(client);
-    
+    int status;
+    u8  psu_bits;
+
     mutex_lock(&data->update_lock);
 
-    if (time_after(jiffies, data->last_updated + HZ + HZ / 2)
-        || !data->valid) {
-        int status;
-		int power_good = 0;
+    /* Read psu status, from the CPLD driver's shadow copy while it is fresh */
+    status = accton_i2c_cpld_read_cached(0x60, 0x2);
 
-        dev_dbg(&client->dev, "Starting as7712_32x update\n");
+    if (status < 0) {
+        dev_dbg(&client->dev, "cpld reg 0x60 err %d\n", status);
+    }
+    else {
+        data->status = status;
+    }
+
+    /* The eeprom only has to be read again when the PSU comes, goes,
+     * or its power good changes
+     */
+    psu_bits = data->status & PSU_STATUS_BITS(data->index);
+    if (data->valid && psu_bits == data->psu_bits) {
+        goto exit;
+    }
+
+    dev_dbg(&client->dev, "Starting as7712_32x update\n");
+    data->psu_bits = psu_bits;
+
+    /* Read model name */
+    memset(data->model_name, 0, sizeof(data->model_name));
+
+    if (data->status >> (3-data->index) & 0x1) { /* power good */
+        status = as7712_32x_psu_read_block(client, 0x20, data->model_name,
+                                           ARRAY_SIZE(data->model_name)-1);
 
-        /* Read psu status */
-        status = accton_i2c_cpld_read(0x60, 0x2);
-        
         if (status < 0) {
-            dev_dbg(&client->dev, "cpld reg 0x60 err %d\n", status);
+            data->model_name[0] = '\0';
+            dev_dbg(&client->dev, "unable to read model name from (0x%x)\n", client->addr);
+            data->valid = 0;    /* try again on the next read */
+            goto exit;
         }
         else {
-            data->status = status;
-        }
-		
-        /* Read model name */
-        memset(data->model_name, 0, sizeof(data->model_name));
-        power_good = (data->status >> (3-data->index) & 0x1);
-		
-        if (power_good) {
-            status = as7712_32x_psu_read_block(client, 0x20, data->model_name, 
-                                               ARRAY_SIZE(data->model_name)-1);
-
-            if (status < 0) {
-                data->model_name[0] = '\0';
-                dev_dbg(&client->dev, "unable to read model name from (0x%x)\n", client->addr);
-            }
-            else {
-                data->model_name[ARRAY_SIZE(data->model_name)-1] = '\0';
-            }
+            data->model_name[ARRAY_SIZE(data->model_name)-1] = '\0';
         }
-        
-        data->last_updated = jiffies;
-        data->valid = 1;
     }
 
+    data->valid = 1;
+
+exit:
     mutex_unlock(&data->update_lock);
 
     return data;
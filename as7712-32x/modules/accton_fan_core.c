@@ -0,0 +1 @@
+../../common/modules/accton_fan_core.c
\ No newline at end of file
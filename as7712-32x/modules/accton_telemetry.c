@@ -0,0 +1 @@
+../../common/modules/accton_telemetry.c
\ No newline at end of file
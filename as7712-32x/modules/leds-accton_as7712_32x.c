@@ -29,6 +29,8 @@
 #include <linux/leds.h>
 #include <linux/slab.h>
 #include <linux/dmi.h>
+#include <linux/spinlock.h>
+#include <linux/workqueue.h>
 
 extern int accton_i2c_cpld_read (unsigned short cpld_addr, u8 reg);
 extern int accton_i2c_cpld_write(unsigned short cpld_addr, u8 reg, u8 value);
@@ -41,12 +43,34 @@ extern void led_classdev_suspend(struct led_classdev *led_cdev);
 #define DRVNAME "accton_as7712_32x_led"
 #define ENABLE_PORT_LED		1
 
+#if (ENABLE_PORT_LED == 1)
+#define PORT_NUM			32
+#define PORT_LED_PER_PORT	4
+#define PORT_LED_NUM		(PORT_NUM * PORT_LED_PER_PORT)
+
+static unsigned int port_led_refresh_ms = 50;
+module_param(port_led_refresh_ms, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(port_led_refresh_ms, "Port LED changes are written out this often, in ms (default 50)");
+#endif
+
 struct accton_as7712_32x_led_data {
 	struct platform_device *pdev;
 	struct mutex	 update_lock;
 	char			 valid;		   /* != 0 if registers are valid */
 	unsigned long	last_updated;	/* In jiffies */
 	u8			   reg_val[1];	  /* only 1 register*/
+#if (ENABLE_PORT_LED == 1)
+	/*
+	 * Port LED bank: brightness_set only records the wanted CPLD value,
+	 * port_led_work writes the ones that differ from the hardware.
+	 */
+	struct delayed_work	port_led_work;
+	spinlock_t		port_led_lock;		/* set may run in atomic context */
+	u8				port_led_target[PORT_LED_NUM];	/* under port_led_lock */
+	DECLARE_BITMAP(port_led_dirty, PORT_LED_NUM);	/* under port_led_lock */
+	u8				port_led_hw[PORT_LED_NUM];		/* under update_lock */
+	DECLARE_BITMAP(port_led_known, PORT_LED_NUM);	/* port_led_hw[] is valid */
+#endif
 };
 
 static struct accton_as7712_32x_led_data  *ledctl = NULL;
@@ -183,15 +207,20 @@ static void accton_as7712_32x_led_set(struct led_classdev *led_cdev,
 									  enum led_brightness led_light_mode, enum led_type type);
 
 static int accton_getLedReg(enum led_type type, u8 *reg)
-{	 
+{
 	int i;
-	for (i = 0; i < ARRAY_SIZE(led_reg_map); i++) {	
-		if(led_reg_map[i].types & (type<<1)){
+
+	if (type >= 32) {	/* port LEDs, not in led_reg_map */
+		return -1;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(led_reg_map); i++) {
+		if(led_reg_map[i].types & (1<<type)) {
 			*reg = led_reg_map[i].reg_addr;
-			return 0;
+			return i;
 		}
 	}
-	return 1;
+	return -1;
 }
 
 
@@ -242,64 +271,87 @@ static int accton_as7712_32x_led_write_value(u8 reg, u8 value)
 	return accton_i2c_cpld_write(LED_CNTRLER_I2C_ADDRESS, reg, value);
 }
 
-static void accton_as7712_32x_led_update(void)
+/*
+ * reg_val[] shadows the LED registers.  It is refreshed from the CPLD
+ * when older than 1.5s, and kept in step by every write in between.
+ * Called with update_lock held.
+ */
+static int __accton_as7712_32x_led_update(void)
 {
-	mutex_lock(&ledctl->update_lock);
+	int i;
 
-	if (time_after(jiffies, ledctl->last_updated + HZ + HZ / 2)
-		|| !ledctl->valid) {
-		int i;
-
-		dev_dbg(&ledctl->pdev->dev, "Starting accton_as7712_32x_led update\n");
-
-		/* Update LED data
-		 */
-		for (i = 0; i < ARRAY_SIZE(ledctl->reg_val); i++) {
-			int status = accton_as7712_32x_led_read_value(led_reg_map[i].reg_addr);
-			
-			if (status < 0) {
-				ledctl->valid = 0;
-				dev_dbg(&ledctl->pdev->dev, "reg %d, err %d\n", led_reg_map[i].reg_addr, status);
-				goto exit;
-			}
-			else
-			{
-				ledctl->reg_val[i] = status; 
-			}
+	if (!time_after(jiffies, ledctl->last_updated + HZ + HZ / 2)
+			&& ledctl->valid) {
+		return 0;
+	}
+
+	dev_dbg(&ledctl->pdev->dev, "Starting accton_as7712_32x_led update\n");
+
+	/* Update LED data
+	 */
+	for (i = 0; i < ARRAY_SIZE(ledctl->reg_val); i++) {
+		int status = accton_as7712_32x_led_read_value(led_reg_map[i].reg_addr);
+
+		if (status < 0) {
+			ledctl->valid = 0;
+			dev_dbg(&ledctl->pdev->dev, "reg %d, err %d\n", led_reg_map[i].reg_addr, status);
+			return status;
 		}
-		
-		ledctl->last_updated = jiffies;
-		ledctl->valid = 1;
+		ledctl->reg_val[i] = status;
 	}
-	
-exit:	
+
+	ledctl->last_updated = jiffies;
+	ledctl->valid = 1;
+	return 0;
+}
+
+static void accton_as7712_32x_led_update(void)
+{
+	mutex_lock(&ledctl->update_lock);
+	__accton_as7712_32x_led_update();
 	mutex_unlock(&ledctl->update_lock);
 }
 
+/* Write register idx only if the value changes.  Called with update_lock held. */
+static int __accton_as7712_32x_led_write_reg(int idx, u8 value)
+{
+	int status;
+
+	if (value == ledctl->reg_val[idx]) {
+		return 0;
+	}
+
+	status = accton_as7712_32x_led_write_value(led_reg_map[idx].reg_addr, value);
+	if (status < 0) {
+		ledctl->valid = 0;
+		dev_dbg(&ledctl->pdev->dev, "reg %d, err %d\n", led_reg_map[idx].reg_addr, status);
+		return status;
+	}
+
+	ledctl->reg_val[idx] = value;
+	return 0;
+}
+
 static void accton_as7712_32x_led_set(struct led_classdev *led_cdev,
-									  enum led_brightness led_light_mode, 
+									  enum led_brightness led_light_mode,
 									  enum led_type type)
 {
-	int reg_val;
-	u8 reg	;
+	int idx;
+	u8 reg;
 	mutex_lock(&ledctl->update_lock);
 
-	if( !accton_getLedReg(type, &reg))
-	{
+	idx = accton_getLedReg(type, &reg);
+	if (idx < 0) {
 		dev_dbg(&ledctl->pdev->dev, "Not match item for %d.\n", type);
+		goto exit;
 	}
-	
-	reg_val = accton_as7712_32x_led_read_value(reg);
-	
-	if (reg_val < 0) {
-		dev_dbg(&ledctl->pdev->dev, "reg %d, err %d\n", reg, reg_val);
+
+	if (__accton_as7712_32x_led_update() < 0) {
 		goto exit;
 	}
-	reg_val = led_light_mode_to_reg_val(type, led_light_mode, reg_val);  
-	accton_as7712_32x_led_write_value(reg, reg_val);
 
-	/* to prevent the slow-update issue */
-	ledctl->valid = 0;
+	__accton_as7712_32x_led_write_reg(idx, led_light_mode_to_reg_val(type, led_light_mode,
+														  ledctl->reg_val[idx]));
 
 exit:
 	mutex_unlock(&ledctl->update_lock);
@@ -361,6 +413,27 @@ static int accton_as7712_32x_port_led_write_value(unsigned short cpld_addr, u8 r
 	return accton_i2c_cpld_write(cpld_addr, reg, value);
 }
 
+/* Port LED n is LED n % 4 of port n / 4 */
+static void port_led_cpld_reg(int n, unsigned short *cpld_addr, u8 *reg)
+{
+	int port = n / PORT_LED_PER_PORT;
+
+	*cpld_addr = (port < 16) ? 0x64 : 0x62;
+	*reg	   = (0x50 + (port % 16) * 4 + n % PORT_LED_PER_PORT);
+}
+
+static int port_led_index(const char *name)
+{
+	unsigned int port, lid;
+
+	if (sscanf(name, "port%u_led%u", &port, &lid) != 2 ||
+		port >= PORT_NUM || lid >= PORT_LED_PER_PORT) {
+		return -EINVAL;
+	}
+
+	return port * PORT_LED_PER_PORT + lid;
+}
+
 static int port_led_mode_to_cpld_val(int mode)
 {
 	u8 color    = 0;
@@ -434,55 +507,200 @@ static int cpld_val_to_port_led_mode(uint8_t value)
 }
 
 
+static void accton_as7712_32x_port_led_work(struct work_struct *work)
+{
+	unsigned long flags;
+	int n, retry = 0;
+
+	mutex_lock(&ledctl->update_lock);
+
+	for (n = 0; n < PORT_LED_NUM; n++) {
+		unsigned short cpld_addr;
+		u8 reg, value;
+
+		spin_lock_irqsave(&ledctl->port_led_lock, flags);
+		if (!test_and_clear_bit(n, ledctl->port_led_dirty)) {
+			spin_unlock_irqrestore(&ledctl->port_led_lock, flags);
+			continue;
+		}
+		value = ledctl->port_led_target[n];
+		spin_unlock_irqrestore(&ledctl->port_led_lock, flags);
+
+		if (test_bit(n, ledctl->port_led_known) && ledctl->port_led_hw[n] == value) {
+			continue;
+		}
+
+		port_led_cpld_reg(n, &cpld_addr, &reg);
+		if (accton_as7712_32x_port_led_write_value(cpld_addr, reg, value) < 0) {
+			dev_dbg(&ledctl->pdev->dev, "Unable to write cpld(0x%x), reg(0x%x)\n", cpld_addr, reg);
+			set_bit(n, ledctl->port_led_dirty);
+			retry = 1;
+			continue;
+		}
+
+		ledctl->port_led_hw[n] = value;
+		set_bit(n, ledctl->port_led_known);
+	}
+
+	mutex_unlock(&ledctl->update_lock);
+
+	if (retry) {
+		schedule_delayed_work(&ledctl->port_led_work, msecs_to_jiffies(port_led_refresh_ms));
+	}
+}
+
+/* Returns 0 or -EINVAL for an unknown mode, the write happens later. May be called in atomic context */
+static int accton_as7712_32x_port_led_queue(int n, int mode)
+{
+	unsigned long flags;
+	int value = port_led_mode_to_cpld_val(mode);
+
+	if (value < 0) {
+		dev_dbg(&ledctl->pdev->dev, "Unknow port led mode(%d)\n", mode);
+		return value;
+	}
+
+	spin_lock_irqsave(&ledctl->port_led_lock, flags);
+	ledctl->port_led_target[n] = value;
+	set_bit(n, ledctl->port_led_dirty);
+	spin_unlock_irqrestore(&ledctl->port_led_lock, flags);
+
+	return 0;
+}
+
 static void accton_as7712_32x_port_led_set(struct led_classdev *cdev,
 										   enum led_brightness led_light_mode)
 {
-	unsigned int port, lid;
-	unsigned short cpld_addr;
-	u8 reg, value;
-	sscanf(cdev->name, "accton_as7712_32x_led::port%u_led%u", &port, &lid);
+	int n = port_led_index(strrchr(cdev->name, ':') + 1);
 
-	if (port > 32 || lid > 4) {
-		dev_dbg(&ledctl->pdev->dev, "Port(%u), Led_id(%u) not match\n", port, lid);
+	if (n < 0) {
+		dev_dbg(&ledctl->pdev->dev, "Port led(%s) not match\n", cdev->name);
 		return;
 	}
 
-	cpld_addr = (port < 16) ? 0x64 : 0x62;
-	reg       = (0x50 + (port % 16) * 4 + lid);
-	value	  = port_led_mode_to_cpld_val(led_light_mode);
+	if (accton_as7712_32x_port_led_queue(n, led_light_mode) == 0) {
+		/* a no-op if already pending, so changes close together share a pass */
+		schedule_delayed_work(&ledctl->port_led_work, msecs_to_jiffies(port_led_refresh_ms));
+	}
+}
 
-	if (value < 0) {
-		dev_dbg(&ledctl->pdev->dev, "Unknow port led mode(%d)\n", led_light_mode);
-		return;
+/* The wanted mode, the same as the hardware once written out */
+static int accton_as7712_32x_port_led_mode(int n)
+{
+	unsigned long flags;
+	int value;
+
+	mutex_lock(&ledctl->update_lock);
+	if (!test_bit(n, ledctl->port_led_known)) {
+		unsigned short cpld_addr;
+		u8 reg;
+
+		port_led_cpld_reg(n, &cpld_addr, &reg);
+		value = accton_as7712_32x_port_led_read_value(cpld_addr, reg);
+		if (value < 0) {
+			dev_dbg(&ledctl->pdev->dev, "Unable to read reg value from cpld(0x%x), reg(0x%x)\n", cpld_addr, reg);
+			mutex_unlock(&ledctl->update_lock);
+			return value;
+		}
+		ledctl->port_led_hw[n] = value;
+		set_bit(n, ledctl->port_led_known);
+
+		spin_lock_irqsave(&ledctl->port_led_lock, flags);
+		if (!test_bit(n, ledctl->port_led_dirty)) {
+			ledctl->port_led_target[n] = value;
+		}
+		spin_unlock_irqrestore(&ledctl->port_led_lock, flags);
 	}
+	mutex_unlock(&ledctl->update_lock);
+
+	spin_lock_irqsave(&ledctl->port_led_lock, flags);
+	value = ledctl->port_led_target[n];
+	spin_unlock_irqrestore(&ledctl->port_led_lock, flags);
 
-	accton_as7712_32x_port_led_write_value(cpld_addr, reg, value);
+	return cpld_val_to_port_led_mode(value);
 }
 
 static enum led_brightness accton_as7712_32x_port_led_get(struct led_classdev *cdev)
 {
-	unsigned int port, lid;
-	unsigned short cpld_addr;
-	u8 reg, value;
-	sscanf(cdev->name, "accton_as7712_32x_led::port%u_led%u", &port, &lid);
+	int n = port_led_index(strrchr(cdev->name, ':') + 1);
 
-	if (port > 32 || lid > 4) {
-		dev_dbg(&ledctl->pdev->dev, "Port(%u), Led_id(%u) not match\n", port, lid);
+	if (n < 0) {
+		dev_dbg(&ledctl->pdev->dev, "Port led(%s) not match\n", cdev->name);
 		return -EINVAL;
 	}
 
-	cpld_addr = (port < 16) ? 0x64 : 0x62;
-	reg       = (0x50 + (port % 16) * 4 + lid);
-	value 	  = accton_as7712_32x_port_led_read_value(cpld_addr, reg);
-	
-	if (value < 0) {
-		dev_dbg(&ledctl->pdev->dev, "Unable to read reg value from cpld(0x%x), reg(0x%x)\n", cpld_addr, reg);
-		return value;
+	return accton_as7712_32x_port_led_mode(n);
+}
+
+/*
+ * "port_leds" sets any number of port LEDs at once:
+ * "port0_led0=16 port1_led0=17 ...", brightness values as for the
+ * per LED files.  All of them are written out in the next pass of
+ * port_led_work.  Reading it lists every port LED in the same form.
+ */
+static ssize_t accton_as7712_32x_port_led_batch_show(struct device *dev,
+										struct device_attribute *da, char *buf)
+{
+	int n, mode, len = 0;
+
+	for (n = 0; n < PORT_LED_NUM; n++) {
+		mode = accton_as7712_32x_port_led_mode(n);
+		if (mode < 0) {
+			return mode;
+		}
+		len += sprintf(buf + len, "%sport%d_led%d=%d", n ? " " : "",
+					   n / PORT_LED_PER_PORT, n % PORT_LED_PER_PORT, mode);
 	}
 
-	return cpld_val_to_port_led_mode(value);
+	len += sprintf(buf + len, "\n");
+	return len;
 }
 
+static ssize_t accton_as7712_32x_port_led_batch_store(struct device *dev,
+										struct device_attribute *da,
+										const char *buf, size_t count)
+{
+	char *str, *p, *tok;
+	int status = count;
+
+	str = kstrndup(buf, count, GFP_KERNEL);
+	if (!str) {
+		return -ENOMEM;
+	}
+
+	p = str;
+	while ((tok = strsep(&p, " \t\n")) != NULL) {
+		char *val = strchr(tok, '=');
+		long mode;
+		int n;
+
+		if (!*tok) {
+			continue;
+		}
+		if (!val) {
+			status = -EINVAL;
+			break;
+		}
+		*val++ = '\0';
+
+		n = port_led_index(tok);
+		if (n < 0 || kstrtol(val, 10, &mode) ||
+			accton_as7712_32x_port_led_queue(n, mode) < 0) {
+			status = -EINVAL;
+			break;
+		}
+	}
+	kfree(str);
+
+	/* whatever was queued before an error still goes out */
+	schedule_delayed_work(&ledctl->port_led_work, msecs_to_jiffies(port_led_refresh_ms));
+
+	return status;
+}
+
+static DEVICE_ATTR(port_leds, S_IRUGO | S_IWUSR, accton_as7712_32x_port_led_batch_show,
+				   accton_as7712_32x_port_led_batch_store);
+
 #define _PORT_LED_CLASSDEV(port, lid)									\
 	[LED_TYPE_PORT##port##_LED##lid] = {								\
 		.name			 = "accton_as7712_32x_led::port"#port"_led"#lid,\
@@ -576,6 +794,109 @@ static struct led_classdev accton_as7712_32x_leds[] = {
 #endif
 };
 
+/*
+ * "leds" sets the CPLD driven LEDs in one go: "diag=2 loc=0", with the
+ * LED names and brightness values of the led class devices above.
+ * Port LEDs are not part of it, a port LED name is rejected.
+ * Each register is written at most once.  Reading it gives the same form.
+ */
+static const char *accton_as7712_32x_led_name(enum led_type type)
+{
+	return strrchr(accton_as7712_32x_leds[type].name, ':') + 1;
+}
+
+static ssize_t accton_as7712_32x_led_batch_show(struct device *dev,
+									  struct device_attribute *da, char *buf)
+{
+	int type, idx, len = 0;
+	u8 reg;
+
+	mutex_lock(&ledctl->update_lock);
+	if (__accton_as7712_32x_led_update() < 0) {
+		mutex_unlock(&ledctl->update_lock);
+		return -EIO;
+	}
+
+	for (type = 0; type <= LED_TYPE_PSU2; type++) {
+		idx = accton_getLedReg(type, &reg);
+		if (idx < 0) {
+			continue;
+		}
+		len += sprintf(buf + len, "%s%s=%d", len ? " " : "", accton_as7712_32x_led_name(type),
+					   led_reg_val_to_light_mode(type, ledctl->reg_val[idx]));
+	}
+	mutex_unlock(&ledctl->update_lock);
+
+	len += sprintf(buf + len, "\n");
+	return len;
+}
+
+static ssize_t accton_as7712_32x_led_batch_store(struct device *dev,
+									   struct device_attribute *da,
+									   const char *buf, size_t count)
+{
+	u8 reg_val[ARRAY_SIZE(ledctl->reg_val)];
+	char *str, *p, *tok;
+	int i, status;
+
+	str = kstrndup(buf, count, GFP_KERNEL);
+	if (!str) {
+		return -ENOMEM;
+	}
+
+	mutex_lock(&ledctl->update_lock);
+	status = __accton_as7712_32x_led_update();
+	if (status < 0) {
+		goto exit;
+	}
+	memcpy(reg_val, ledctl->reg_val, sizeof(reg_val));
+
+	p = str;
+	while ((tok = strsep(&p, " \t\n")) != NULL) {
+		char *val = strchr(tok, '=');
+		int type, idx = -1;
+		long mode;
+		u8 reg;
+
+		if (!*tok) {
+			continue;
+		}
+		if (!val) {
+			status = -EINVAL;
+			goto exit;
+		}
+		*val++ = '\0';
+
+		for (type = 0; type <= LED_TYPE_PSU2; type++) {
+			if (!strcmp(accton_as7712_32x_led_name(type), tok)) {
+				idx = accton_getLedReg(type, &reg);
+				break;
+			}
+		}
+		if (idx < 0 || kstrtol(val, 10, &mode) ||
+			mode < 0 || mode > accton_as7712_32x_leds[type].max_brightness) {
+			status = -EINVAL;
+			goto exit;
+		}
+		reg_val[idx] = led_light_mode_to_reg_val(type, mode, reg_val[idx]);
+	}
+
+	for (i = 0; i < ARRAY_SIZE(reg_val); i++) {
+		status = __accton_as7712_32x_led_write_reg(i, reg_val[i]);
+		if (status < 0) {
+			goto exit;
+		}
+	}
+	status = count;
+
+exit:
+	mutex_unlock(&ledctl->update_lock);
+	kfree(str);
+	return status;
+}
+
+static DEVICE_ATTR(leds, S_IRUGO | S_IWUSR, accton_as7712_32x_led_batch_show, accton_as7712_32x_led_batch_store);
+
 static int accton_as7712_32x_led_suspend(struct platform_device *dev,
 		pm_message_t state)
 {
@@ -620,6 +941,16 @@ static int accton_as7712_32x_led_probe(struct platform_device *pdev)
 		}
 	}
 
+	/* the batched interface is optional, the LEDs work without it */
+	if (i == ARRAY_SIZE(accton_as7712_32x_leds) && device_create_file(&pdev->dev, &dev_attr_leds)) {
+		dev_warn(&pdev->dev, "unable to create the leds attribute\n");
+	}
+#if (ENABLE_PORT_LED == 1)
+	if (i == ARRAY_SIZE(accton_as7712_32x_leds) && device_create_file(&pdev->dev, &dev_attr_port_leds)) {
+		dev_warn(&pdev->dev, "unable to create the port_leds attribute\n");
+	}
+#endif
+
 	return ret;
 }
 
@@ -627,10 +958,21 @@ static int accton_as7712_32x_led_remove(struct platform_device *pdev)
 {
 	int i;
 
+	device_remove_file(&pdev->dev, &dev_attr_leds);
+#if (ENABLE_PORT_LED == 1)
+	device_remove_file(&pdev->dev, &dev_attr_port_leds);
+#endif
+
 	for (i = 0; i < ARRAY_SIZE(accton_as7712_32x_leds); i++) {
 		led_classdev_unregister(&accton_as7712_32x_leds[i]);
 	}
 
+#if (ENABLE_PORT_LED == 1)
+	/* write out what is still pending, then make sure nothing is requeued */
+	flush_delayed_work(&ledctl->port_led_work);
+	cancel_delayed_work_sync(&ledctl->port_led_work);
+#endif
+
 	return 0;
 }
 
@@ -662,6 +1004,10 @@ static int __init accton_as7712_32x_led_init(void)
 	}
 
 	mutex_init(&ledctl->update_lock);
+#if (ENABLE_PORT_LED == 1)
+	spin_lock_init(&ledctl->port_led_lock);
+	INIT_DELAYED_WORK(&ledctl->port_led_work, accton_as7712_32x_port_led_work);
+#endif
 
 	ledctl->pdev = platform_device_register_simple(DRVNAME, -1, NULL, 0);
 	if (IS_ERR(ledctl->pdev)) {
@@ -24,6 +24,7 @@
 
 try:
     import time
+    import os
     import logging
     import glob
     from collections import namedtuple
@@ -53,39 +54,77 @@ class ThermalUtil(object):
            }
 
     def __init__(self):
+        self._thermal_to_device_fd_mapping = {}
         thermal_path = self.BASE_VAL_PATH
 
         for x in range(self.THERMAL_NUM_1_IDX, self.THERMAL_NUM_ON_MAIN_BROAD+1):
             self._thermal_to_device_path_mapping[x] = thermal_path.format(
                 self._thermal_to_device_node_mapping[x][0],
                 self._thermal_to_device_node_mapping[x][1])
-            
+
+        for x in self._thermal_to_device_path_mapping:
+            self._open_node(x)
+
     def _get_thermal_node_val(self, thermal_num):
         if thermal_num < self.THERMAL_NUM_1_IDX or thermal_num > self.THERMAL_NUM_ON_MAIN_BROAD:
             logging.debug('GET. Parameter error. thermal_num, %d', thermal_num)
             return None
 
+        content = self._read_node(thermal_num)
+        if content is None:
+            return None
+
+        if content == '':
+            logging.debug('GET. content is NULL. device_path:%s', self.get_thermal_to_device_path(thermal_num))
+            return None
+
+        return int(content)
+
+    def _open_node(self, thermal_num):
+        """The hwmon*/ part of the path is only resolved here, once per open"""
         device_path = self.get_thermal_to_device_path(thermal_num)
         for filename in glob.glob(device_path):
             try:
-                val_file = open(filename, 'r')
-            except IOError as e:
+                fd = os.open(filename, os.O_RDONLY)
+            except OSError as e:
                 logging.error('GET. unable to open file: %s', str(e))
                 return None
-
-        content = val_file.readline().rstrip()
-
-        if content == '':
-            logging.debug('GET. content is NULL. device_path:%s', device_path)
-            return None
+            self._thermal_to_device_fd_mapping[thermal_num] = fd
+            return fd
+
+        return None
+
+    def _read_node(self, thermal_num):
+        """Read a sysfs node through a descriptor kept open across calls.
+        A read error drops the descriptor, the next call opens it again."""
+        fd = self._thermal_to_device_fd_mapping.get(thermal_num)
+        if fd is None:
+            fd = self._open_node(thermal_num)
+            if fd is None:
+                return None
 
         try:
-		    val_file.close()
-        except:
-            logging.debug('GET. unable to close file. device_path:%s', device_path)
+            os.lseek(fd, 0, os.SEEK_SET)
+            return os.read(fd, 64).rstrip()
+        except OSError as e:
+            logging.debug('GET. unable to read file. thermal_num:%d, %s', thermal_num, str(e))
+            self._close_node(thermal_num)
             return None
-      
-        return int(content)
+
+    def _close_node(self, thermal_num):
+        fd = self._thermal_to_device_fd_mapping.pop(thermal_num, None)
+        if fd is not None:
+            try:
+                os.close(fd)
+            except OSError:
+                pass
+
+    def close(self):
+        for thermal_num in self._thermal_to_device_fd_mapping.keys():
+            self._close_node(thermal_num)
+
+    def __del__(self):
+        self.close()
 
 
     def get_num_thermals(self):
@@ -103,6 +142,11 @@ class ThermalUtil(object):
     def get_thermal_to_device_path(self, thermal_num):
         return self._thermal_to_device_path_mapping[thermal_num]
 
+    def get_all(self):
+        """Read every thermal sensor in one pass, {thermal_num: value or None}"""
+        return dict((x, self._get_thermal_node_val(x))
+                    for x in range(self.THERMAL_NUM_1_IDX, self.THERMAL_NUM_ON_MAIN_BROAD+1))
+
     def get_thermal_1_val(self):      
         return self._get_thermal_node_val(self.THERMAL_NUM_1_IDX)
 
@@ -25,6 +25,7 @@
 #include <linux/module.h>
 #include <linux/jiffies.h>
 #include <linux/i2c.h>
+#include <linux/srcu.h>
 #include <linux/hwmon.h>
 #include <linux/hwmon-sysfs.h>
 #include <linux/err.h>
@@ -33,18 +34,52 @@
 #include <linux/slab.h>
 #include <linux/delay.h>
 #include <linux/list.h>
+#include <linux/workqueue.h>
+#include <linux/kobject.h>
+#include "accton_sfp_core.h"
 
-static LIST_HEAD(cpld_client_list);
-static struct mutex	 list_lock;
+#define CPLD_CLIENT_MAX_ADDR    0x80    /* 7-bit addresses */
 
 struct cpld_client_node {
 	struct i2c_client *client;
-	struct list_head   list;
+	struct mutex       lock;    /* held across one transaction */
 };
 
+/*
+ * CPLD clients indexed by I2C address.  The exported accessors look the
+ * client up under SRCU and hold only that CPLD's mutex across the bus
+ * transaction, so list_lock is never held across I2C.  list_lock only
+ * orders add/remove.
+ */
+static struct cpld_client_node __rcu *cpld_clients[CPLD_CLIENT_MAX_ADDR];
+static struct mutex	 list_lock;
+DEFINE_STATIC_SRCU(cpld_client_srcu);
+
 #define I2C_RW_RETRY_COUNT				10
 #define I2C_RW_RETRY_INTERVAL			60 /* ms */
 
+#define NUM_OF_QSFP_PORT				32
+#define CPLD_OFFSET_QSFP_PRESENT		0x30
+#define CPLD_OFFSET_PSU_STATUS			0x02	/* PSU present/power good */
+
+/*
+ * Transceiver presence is polled in the background and changes are
+ * pushed to userspace: sysfs_notify() on module_present_all and on each
+ * module_present_<n> that changed, plus a KOBJ_CHANGE uevent with
+ * PRESENT_CHANGED/PRESENT port masks (bit0 = port 1).  Userspace can
+ * then sleep in poll() instead of re-reading module_present_all.
+ */
+static unsigned int present_poll_ms = 200;
+module_param(present_poll_ms, uint, S_IRUGO);
+MODULE_PARM_DESC(present_poll_ms, "transceiver presence poll interval in ms, 0 disables");
+
+/*
+ * The same poll keeps a copy of the PSU status register for the PSU
+ * driver, see as7716_32x_cpld_psu_status().  -1 until the first poll
+ * and while the last one failed.
+ */
+static atomic_t psu_status = ATOMIC_INIT(-1);
+
 static ssize_t show_present(struct device *dev, struct device_attribute *da,
              char *buf);
 static ssize_t show_present_all(struct device *dev, struct device_attribute *da,
@@ -57,6 +92,8 @@ static ssize_t get_mode_reset(struct device *dev, struct device_attribute *da,
 			char *buf);
 static ssize_t set_mode_reset(struct device *dev, struct device_attribute *da,
 			const char *buf, size_t count);
+static ssize_t set_reset_all(struct device *dev, struct device_attribute *da,
+			const char *buf, size_t count);
 
 static int as7716_32x_cpld_read_internal(struct i2c_client *client, u8 reg);
 static int as7716_32x_cpld_write_internal(struct i2c_client *client, u8 reg, u8 value);
@@ -64,6 +101,10 @@ static int as7716_32x_cpld_write_internal(struct i2c_client *client, u8 reg, u8
 struct as7716_32x_cpld_data {
     struct device      *hwmon_dev;
     struct mutex        update_lock;
+    struct i2c_client  *client;
+    struct delayed_work present_work;
+    u32                 present;        /* bit0:port1, last polled value */
+    char                present_valid;
 };
 
 /* Addresses scanned for as7716_32x_cpld
@@ -77,6 +118,7 @@ enum as7716_32x_cpld_sysfs_attributes {
 	CPLD_VERSION,
 	ACCESS,
 	MODULE_PRESENT_ALL,
+	MODULE_RESET_ALL,
 	/* transceiver attributes */
 	TRANSCEIVER_PRESENT_ATTR_ID(1),
 	TRANSCEIVER_PRESENT_ATTR_ID(2),
@@ -162,6 +204,7 @@ static SENSOR_DEVICE_ATTR(version, S_IRUGO, show_version, NULL, CPLD_VERSION);
 static SENSOR_DEVICE_ATTR(access, S_IWUSR, NULL, access, ACCESS);
 /* transceiver attributes */
 static SENSOR_DEVICE_ATTR(module_present_all, S_IRUGO, show_present_all, NULL, MODULE_PRESENT_ALL);
+static SENSOR_DEVICE_ATTR(module_reset_all, S_IWUSR, NULL, set_reset_all, MODULE_RESET_ALL);
 DECLARE_TRANSCEIVER_SENSOR_DEVICE_ATTR(1);
 DECLARE_TRANSCEIVER_SENSOR_DEVICE_ATTR(2);
 DECLARE_TRANSCEIVER_SENSOR_DEVICE_ATTR(3);
@@ -234,6 +277,7 @@ static struct attribute *as7716_32x_cpld_attributes[] = {
     &sensor_dev_attr_access.dev_attr.attr,
 	/* transceiver attributes */
 	&sensor_dev_attr_module_present_all.dev_attr.attr,
+	&sensor_dev_attr_module_reset_all.dev_attr.attr,
 	DECLARE_TRANSCEIVER_ATTR(1),
 	DECLARE_TRANSCEIVER_ATTR(2),
 	DECLARE_TRANSCEIVER_ATTR(3),
@@ -479,46 +523,124 @@ static int as7716_32x_cpld_write_internal(struct i2c_client *client, u8 reg, u8
     return status;
 }
 
+static void as7716_32x_cpld_present_notify(struct i2c_client *client,
+            u32 present, u32 changed)
+{
+	char name[24], env_changed[32], env_present[32];
+	char *envp[] = { env_changed, env_present, NULL };
+	int i;
+
+	for (i = 0; i < NUM_OF_QSFP_PORT; i++) {
+		if (!(changed & BIT(i))) {
+			continue;
+		}
+
+		snprintf(name, sizeof(name), "module_present_%d", i + 1);
+		sysfs_notify(&client->dev.kobj, NULL, name);
+	}
+	sysfs_notify(&client->dev.kobj, NULL, "module_present_all");
+
+	snprintf(env_changed, sizeof(env_changed), "PRESENT_CHANGED=%.8x", changed);
+	snprintf(env_present, sizeof(env_present), "PRESENT=%.8x", present);
+	kobject_uevent_env(&client->dev.kobj, KOBJ_CHANGE, envp);
+}
+
+static void as7716_32x_cpld_present_work(struct work_struct *work)
+{
+	struct as7716_32x_cpld_data *data = container_of(to_delayed_work(work),
+	                                    struct as7716_32x_cpld_data, present_work);
+	void (*present_update)(unsigned short, u8, u8);
+	u32 present = 0;
+	int i, status = 0;
+
+	/* Lets accton_sfp_core, if loaded, see a swap between its own reads */
+	present_update = symbol_get(sfp_core_present_update);
+
+	mutex_lock(&data->update_lock);
+	for (i = 0; i < NUM_OF_QSFP_PORT / 8; i++) {
+		status = as7716_32x_cpld_read_internal(data->client, CPLD_OFFSET_QSFP_PRESENT + i);
+		if (unlikely(status < 0)) {
+			break;
+		}
+
+		if (present_update) {
+			present_update(data->client->addr, CPLD_OFFSET_QSFP_PRESENT + i, status);
+		}
+		present |= (u32)(u8)~status << (i * 8); /* active low */
+	}
+	atomic_set(&psu_status,
+	           as7716_32x_cpld_read_internal(data->client, CPLD_OFFSET_PSU_STATUS));
+	mutex_unlock(&data->update_lock);
+
+	if (present_update) {
+		symbol_put(sfp_core_present_update);
+	}
+
+	if (status >= 0) {
+		if (data->present_valid && present != data->present) {
+			as7716_32x_cpld_present_notify(data->client, present, present ^ data->present);
+		}
+
+		data->present = present;
+		data->present_valid = 1;
+	}
+
+	schedule_delayed_work(&data->present_work, msecs_to_jiffies(present_poll_ms));
+}
+
 static void as7716_32x_cpld_add_client(struct i2c_client *client)
 {
-	struct cpld_client_node *node = kzalloc(sizeof(struct cpld_client_node), GFP_KERNEL);
-	
+	struct cpld_client_node *node;
+
+	if (client->addr >= CPLD_CLIENT_MAX_ADDR) {
+		return;
+	}
+
+	node = kzalloc(sizeof(struct cpld_client_node), GFP_KERNEL);
 	if (!node) {
 		dev_dbg(&client->dev, "Can't allocate cpld_client_node (0x%x)\n", client->addr);
 		return;
 	}
-	
+
 	node->client = client;
-	
+	mutex_init(&node->lock);
+
 	mutex_lock(&list_lock);
-	list_add(&node->list, &cpld_client_list);
+	if (rcu_access_pointer(cpld_clients[client->addr])) {
+		/* Same address on another bus, the first one keeps the slot */
+		mutex_unlock(&list_lock);
+		dev_warn(&client->dev, "cpld 0x%x already registered\n", client->addr);
+		kfree(node);
+		return;
+	}
+	rcu_assign_pointer(cpld_clients[client->addr], node);
 	mutex_unlock(&list_lock);
 }
 
 static void as7716_32x_cpld_remove_client(struct i2c_client *client)
 {
-	struct list_head		*list_node = NULL;
-	struct cpld_client_node *cpld_node = NULL;
-	int found = 0;
-	
-	mutex_lock(&list_lock);
+	struct cpld_client_node *node = NULL;
 
-	list_for_each(list_node, &cpld_client_list)
-	{
-		cpld_node = list_entry(list_node, struct cpld_client_node, list);
-		
-		if (cpld_node->client == client) {
-			found = 1;
-			break;
-		}
+	if (client->addr >= CPLD_CLIENT_MAX_ADDR) {
+		return;
 	}
-	
-	if (found) {
-		list_del(list_node);
-		kfree(cpld_node);
+
+	mutex_lock(&list_lock);
+	node = rcu_dereference_protected(cpld_clients[client->addr],
+	                                 lockdep_is_held(&list_lock));
+	if (node && node->client == client) {
+		RCU_INIT_POINTER(cpld_clients[client->addr], NULL);
+	}
+	else {
+		node = NULL;
 	}
-	
 	mutex_unlock(&list_lock);
+
+	if (node) {
+		/* Wait for accessors still using this client */
+		synchronize_srcu(&cpld_client_srcu);
+		kfree(node);
+	}
 }
 
 static int as7716_32x_cpld_probe(struct i2c_client *client,
@@ -541,6 +663,8 @@ static int as7716_32x_cpld_probe(struct i2c_client *client,
 
     i2c_set_clientdata(client, data);
     mutex_init(&data->update_lock);
+    data->client = client;
+    INIT_DELAYED_WORK(&data->present_work, as7716_32x_cpld_present_work);
     dev_info(&client->dev, "chip found\n");
 
 	/* Register sysfs hooks */
@@ -557,6 +681,10 @@ static int as7716_32x_cpld_probe(struct i2c_client *client,
 
 	as7716_32x_cpld_add_client(client);
 
+	if (present_poll_ms) {
+		schedule_delayed_work(&data->present_work, 0);
+	}
+
 	dev_info(&client->dev, "%s: cpld '%s'\n",
 		 dev_name(data->hwmon_dev), client->name);
 
@@ -575,6 +703,8 @@ static int as7716_32x_cpld_remove(struct i2c_client *client)
 {
     struct as7716_32x_cpld_data *data = i2c_get_clientdata(client);
 
+    cancel_delayed_work_sync(&data->present_work);
+    atomic_set(&psu_status, -1);
     hwmon_device_unregister(data->hwmon_dev);
     sysfs_remove_group(&client->dev.kobj, &as7716_32x_cpld_group);
     kfree(data);
@@ -585,23 +715,21 @@ static int as7716_32x_cpld_remove(struct i2c_client *client)
 
 int as7716_32x_cpld_read(unsigned short cpld_addr, u8 reg)
 {
-	struct list_head   *list_node = NULL;
-	struct cpld_client_node *cpld_node = NULL;
-	int ret = -EPERM;
-	
-	mutex_lock(&list_lock);
+	struct cpld_client_node *node;
+	int ret = -EPERM, idx;
 
-	list_for_each(list_node, &cpld_client_list)
-	{
-		cpld_node = list_entry(list_node, struct cpld_client_node, list);
-		
-		if (cpld_node->client->addr == cpld_addr) {
-			ret = i2c_smbus_read_byte_data(cpld_node->client, reg);
-			break;
-		}
+	if (cpld_addr >= CPLD_CLIENT_MAX_ADDR) {
+		return ret;
 	}
-	
-	mutex_unlock(&list_lock);
+
+	idx = srcu_read_lock(&cpld_client_srcu);
+	node = srcu_dereference(cpld_clients[cpld_addr], &cpld_client_srcu);
+	if (node) {
+		mutex_lock(&node->lock);
+		ret = i2c_smbus_read_byte_data(node->client, reg);
+		mutex_unlock(&node->lock);
+	}
+	srcu_read_unlock(&cpld_client_srcu, idx);
 
 	return ret;
 }
@@ -609,28 +737,43 @@ EXPORT_SYMBOL(as7716_32x_cpld_read);
 
 int as7716_32x_cpld_write(unsigned short cpld_addr, u8 reg, u8 value)
 {
-	struct list_head   *list_node = NULL;
-	struct cpld_client_node *cpld_node = NULL;
-	int ret = -EIO;
-	
-	mutex_lock(&list_lock);
+	struct cpld_client_node *node;
+	int ret = -EIO, idx;
 
-	list_for_each(list_node, &cpld_client_list)
-	{
-		cpld_node = list_entry(list_node, struct cpld_client_node, list);
-		
-		if (cpld_node->client->addr == cpld_addr) {
-			ret = i2c_smbus_write_byte_data(cpld_node->client, reg, value);
-			break;
-		}
+	if (cpld_addr >= CPLD_CLIENT_MAX_ADDR) {
+		return ret;
 	}
-	
-	mutex_unlock(&list_lock);
+
+	idx = srcu_read_lock(&cpld_client_srcu);
+	node = srcu_dereference(cpld_clients[cpld_addr], &cpld_client_srcu);
+	if (node) {
+		mutex_lock(&node->lock);
+		ret = i2c_smbus_write_byte_data(node->client, reg, value);
+		mutex_unlock(&node->lock);
+	}
+	srcu_read_unlock(&cpld_client_srcu, idx);
 
 	return ret;
 }
 EXPORT_SYMBOL(as7716_32x_cpld_write);
 
+/*
+ * PSU status register (0x60 reg 0x02) as of the last presence poll, so
+ * the PSU driver does not go to the CPLD on each update.  Read from the
+ * CPLD when polling is off or the last poll failed.
+ */
+int as7716_32x_cpld_psu_status(void)
+{
+	int status = atomic_read(&psu_status);
+
+	if (status >= 0) {
+		return status;
+	}
+
+	return as7716_32x_cpld_read(0x60, CPLD_OFFSET_PSU_STATUS);
+}
+EXPORT_SYMBOL(as7716_32x_cpld_psu_status);
+
 static ssize_t get_mode_reset(struct device *dev, struct device_attribute *da,
 			char *buf)
 {
@@ -743,6 +886,59 @@ exit:
 }
 
 
+/*
+ * module_reset_all: "<value> [<change mask>]" in hex, bit0 = port 1,
+ * 1 = hold in reset.  Only ports in the change mask (default all) are
+ * touched, with one write per register and no read when all 8 ports of
+ * a register change.
+ */
+static ssize_t set_reset_all(struct device *dev, struct device_attribute *da,
+			const char *buf, size_t count)
+{
+    struct i2c_client *client = to_i2c_client(dev);
+    struct as7716_32x_cpld_data *data = i2c_get_clientdata(client);
+	unsigned long long value, change = ~0ULL;
+	int i, status = 0;
+	u8 v, cm;
+
+	if (sscanf(buf, "%llx %llx", &value, &change) < 1) {
+		return -EINVAL;
+	}
+
+	if (value >> NUM_OF_QSFP_PORT) {
+		return -EINVAL;
+	}
+
+	value = ~value;		/* reset is active low */
+
+	mutex_lock(&data->update_lock);
+	for (i = 0; i < NUM_OF_QSFP_PORT/8; i++) {
+		cm = change >> (i*8);
+		v  = value >> (i*8);
+		if (!cm) {
+			continue;
+		}
+
+		if (cm != 0xff) {
+			status = as7716_32x_cpld_read_internal(client, 0x04 + i);
+			if (unlikely(status < 0)) {
+				goto exit;
+			}
+			v = (status & ~cm) | (v & cm);
+		}
+
+		status = as7716_32x_cpld_write_internal(client, 0x04 + i, v);
+		if (unlikely(status < 0)) {
+			goto exit;
+		}
+	}
+	mutex_unlock(&data->update_lock);
+	return count;
+
+exit:
+	mutex_unlock(&data->update_lock);
+	return status;
+}
 
 static const struct i2c_device_id as7716_32x_cpld_id[] = {
     { "as7716_32x_cpld1", 0 },
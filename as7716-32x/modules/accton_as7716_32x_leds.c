@@ -124,15 +124,15 @@ static void as7716_32x_led_set(struct led_classdev *led_cdev,
 
 
 static int getLedReg(enum led_type type, u8 *reg)
-{	 
+{
 	int i;
-	for (i = 0; i < ARRAY_SIZE(led_reg_map); i++) {	
-		if(led_reg_map[i].types & (type<<1)){
+	for (i = 0; i < ARRAY_SIZE(led_reg_map); i++) {
+		if(led_reg_map[i].types & (1<<type)) {
 			*reg = led_reg_map[i].reg_addr;
-			return 0;
+			return i;
 		}
 	}
-	return 1;
+	return -1;
 }
 
 
@@ -183,64 +183,87 @@ static int as7716_32x_led_write_value(u8 reg, u8 value)
 	return as7716_32x_cpld_write(LED_CNTRLER_I2C_ADDRESS, reg, value);
 }
 
-static void as7716_32x_led_update(void)
+/*
+ * reg_val[] shadows the LED registers.  It is refreshed from the CPLD
+ * when older than 1.5s, and kept in step by every write in between.
+ * Called with update_lock held.
+ */
+static int __as7716_32x_led_update(void)
 {
-	mutex_lock(&ledctl->update_lock);
+	int i;
 
-	if (time_after(jiffies, ledctl->last_updated + HZ + HZ / 2)
-		|| !ledctl->valid) {
-		int i;
-
-		dev_dbg(&ledctl->pdev->dev, "Starting as7716_32x_led update\n");
-
-		/* Update LED data
-		 */
-		for (i = 0; i < ARRAY_SIZE(ledctl->reg_val); i++) {
-			int status = as7716_32x_led_read_value(led_reg_map[i].reg_addr);
-			
-			if (status < 0) {
-				ledctl->valid = 0;
-				dev_dbg(&ledctl->pdev->dev, "reg %d, err %d\n", led_reg_map[i].reg_addr, status);
-				goto exit;
-			}
-			else
-			{
-				ledctl->reg_val[i] = status; 
-			}
+	if (!time_after(jiffies, ledctl->last_updated + HZ + HZ / 2)
+			&& ledctl->valid) {
+		return 0;
+	}
+
+	dev_dbg(&ledctl->pdev->dev, "Starting as7716_32x_led update\n");
+
+	/* Update LED data
+	 */
+	for (i = 0; i < ARRAY_SIZE(ledctl->reg_val); i++) {
+		int status = as7716_32x_led_read_value(led_reg_map[i].reg_addr);
+
+		if (status < 0) {
+			ledctl->valid = 0;
+			dev_dbg(&ledctl->pdev->dev, "reg %d, err %d\n", led_reg_map[i].reg_addr, status);
+			return status;
 		}
-		
-		ledctl->last_updated = jiffies;
-		ledctl->valid = 1;
+		ledctl->reg_val[i] = status;
 	}
-	
-exit:	
+
+	ledctl->last_updated = jiffies;
+	ledctl->valid = 1;
+	return 0;
+}
+
+static void as7716_32x_led_update(void)
+{
+	mutex_lock(&ledctl->update_lock);
+	__as7716_32x_led_update();
 	mutex_unlock(&ledctl->update_lock);
 }
 
+/* Write register idx only if the value changes.  Called with update_lock held. */
+static int __as7716_32x_led_write_reg(int idx, u8 value)
+{
+	int status;
+
+	if (value == ledctl->reg_val[idx]) {
+		return 0;
+	}
+
+	status = as7716_32x_led_write_value(led_reg_map[idx].reg_addr, value);
+	if (status < 0) {
+		ledctl->valid = 0;
+		dev_dbg(&ledctl->pdev->dev, "reg %d, err %d\n", led_reg_map[idx].reg_addr, status);
+		return status;
+	}
+
+	ledctl->reg_val[idx] = value;
+	return 0;
+}
+
 static void as7716_32x_led_set(struct led_classdev *led_cdev,
-									  enum led_brightness led_light_mode, 
+									  enum led_brightness led_light_mode,
 									  enum led_type type)
 {
-	int reg_val;
-	u8 reg	;
+	int idx;
+	u8 reg;
 	mutex_lock(&ledctl->update_lock);
 
-	if( !getLedReg(type, &reg))
-	{
+	idx = getLedReg(type, &reg);
+	if (idx < 0) {
 		dev_dbg(&ledctl->pdev->dev, "Not match item for %d.\n", type);
+		goto exit;
 	}
-	
-	reg_val = as7716_32x_led_read_value(reg);
-	
-	if (reg_val < 0) {
-		dev_dbg(&ledctl->pdev->dev, "reg %d, err %d\n", reg, reg_val);
+
+	if (__as7716_32x_led_update() < 0) {
 		goto exit;
 	}
-	reg_val = led_light_mode_to_reg_val(type, led_light_mode, reg_val);  
-	as7716_32x_led_write_value(reg, reg_val);
 
-	/* to prevent the slow-update issue */
-	ledctl->valid = 0;
+	__as7716_32x_led_write_reg(idx, led_light_mode_to_reg_val(type, led_light_mode,
+														  ledctl->reg_val[idx]));
 
 exit:
 	mutex_unlock(&ledctl->update_lock);
@@ -324,6 +347,108 @@ static struct led_classdev as7716_32x_leds[] = {
 	},
 };
 
+/*
+ * "leds" sets the CPLD driven LEDs in one go: "diag=2 loc=0", with the
+ * LED names and brightness values of the led class devices above.
+ * Each register is written at most once.  Reading it gives the same form.
+ */
+static const char *as7716_32x_led_name(enum led_type type)
+{
+	return strrchr(as7716_32x_leds[type].name, ':') + 1;
+}
+
+static ssize_t as7716_32x_led_batch_show(struct device *dev,
+									  struct device_attribute *da, char *buf)
+{
+	int type, idx, len = 0;
+	u8 reg;
+
+	mutex_lock(&ledctl->update_lock);
+	if (__as7716_32x_led_update() < 0) {
+		mutex_unlock(&ledctl->update_lock);
+		return -EIO;
+	}
+
+	for (type = 0; type < ARRAY_SIZE(as7716_32x_leds); type++) {
+		idx = getLedReg(type, &reg);
+		if (idx < 0) {
+			continue;
+		}
+		len += sprintf(buf + len, "%s%s=%d", len ? " " : "", as7716_32x_led_name(type),
+					   led_reg_val_to_light_mode(type, ledctl->reg_val[idx]));
+	}
+	mutex_unlock(&ledctl->update_lock);
+
+	len += sprintf(buf + len, "\n");
+	return len;
+}
+
+static ssize_t as7716_32x_led_batch_store(struct device *dev,
+									   struct device_attribute *da,
+									   const char *buf, size_t count)
+{
+	u8 reg_val[ARRAY_SIZE(ledctl->reg_val)];
+	char *str, *p, *tok;
+	int i, status;
+
+	str = kstrndup(buf, count, GFP_KERNEL);
+	if (!str) {
+		return -ENOMEM;
+	}
+
+	mutex_lock(&ledctl->update_lock);
+	status = __as7716_32x_led_update();
+	if (status < 0) {
+		goto exit;
+	}
+	memcpy(reg_val, ledctl->reg_val, sizeof(reg_val));
+
+	p = str;
+	while ((tok = strsep(&p, " \t\n")) != NULL) {
+		char *val = strchr(tok, '=');
+		int type, idx = -1;
+		long mode;
+		u8 reg;
+
+		if (!*tok) {
+			continue;
+		}
+		if (!val) {
+			status = -EINVAL;
+			goto exit;
+		}
+		*val++ = '\0';
+
+		for (type = 0; type < ARRAY_SIZE(as7716_32x_leds); type++) {
+			if (!strcmp(as7716_32x_led_name(type), tok)) {
+				idx = getLedReg(type, &reg);
+				break;
+			}
+		}
+		if (idx < 0 || kstrtol(val, 10, &mode) ||
+			mode < 0 || mode > as7716_32x_leds[type].max_brightness) {
+			status = -EINVAL;
+			goto exit;
+		}
+		reg_val[idx] = led_light_mode_to_reg_val(type, mode, reg_val[idx]);
+	}
+
+	for (i = 0; i < ARRAY_SIZE(reg_val); i++) {
+		status = __as7716_32x_led_write_reg(i, reg_val[i]);
+		if (status < 0) {
+			goto exit;
+		}
+	}
+	status = count;
+
+exit:
+	mutex_unlock(&ledctl->update_lock);
+	kfree(str);
+	return status;
+}
+
+static DEVICE_ATTR(leds, S_IRUGO | S_IWUSR, as7716_32x_led_batch_show, as7716_32x_led_batch_store);
+
 static int as7716_32x_led_suspend(struct platform_device *dev,
 		pm_message_t state)
 {
@@ -369,6 +494,11 @@ static int as7716_32x_led_probe(struct platform_device *pdev)
 			led_classdev_unregister(&as7716_32x_leds[i]);
 		}
 	}
+
+	/* the batched interface is optional, the LEDs work without it */
+	if (i == ARRAY_SIZE(as7716_32x_leds) && device_create_file(&pdev->dev, &dev_attr_leds)) {
+		dev_warn(&pdev->dev, "unable to create the leds attribute\n");
+	}
     
 	return 0;
 }
@@ -377,6 +507,8 @@ static int as7716_32x_led_remove(struct platform_device *pdev)
 {
 	int i;
 
+	device_remove_file(&pdev->dev, &dev_attr_leds);
+
 	for (i = 0; i < ARRAY_SIZE(as7716_32x_leds); i++) {
 		led_classdev_unregister(&as7716_32x_leds[i]);
 	}
@@ -42,7 +42,7 @@
 static ssize_t show_status(struct device *dev, struct device_attribute *da, char *buf);
 static ssize_t show_string(struct device *dev, struct device_attribute *da, char *buf);
 static int as7716_32x_psu_read_block(struct i2c_client *client, u8 command, u8 *data,int data_len);
-extern int as7716_32x_cpld_read (unsigned short cpld_addr, u8 reg);
+extern int as7716_32x_cpld_psu_status(void);
 
 /* Addresses scanned 
  */
@@ -54,9 +54,9 @@ struct as7716_32x_psu_data {
     struct device      *hwmon_dev;
     struct mutex        update_lock;
     char                valid;           /* !=0 if registers are valid */
-    unsigned long       last_updated;    /* In jiffies */
     u8  index;           /* PSU index */
     u8  status;          /* Status(present/power_good) register read from CPLD */
+    u8  psu_bits;        /* This PSU's bits of status when the eeprom was read */
     char model_name[MAX_MODEL_NAME+1]; /* Model name, read from eeprom */
     char fan_dir[DC12V_FAN_DIR_LEN+1]; /* DC12V fan direction */
 };
@@ -298,64 +298,70 @@ static int as7716_32x_psu_model_name_get(struct device *dev)
     return -ENODATA;
 }
 
+/* Present and power good bits of this PSU in the CPLD status register */
+#define PSU_STATUS_BITS(index)  (BIT(1 - (index)) | BIT(3 - (index)))
+
 static struct as7716_32x_psu_data *as7716_32x_psu_update_device(struct device *dev)
 {
     struct i2c_client *client = to_i2c_client(dev);
     struct as7716_32x_psu_data *data = i2c_get_clientdata(client);
-    
+    int status;
+    u8  psu_bits;
+
     mutex_lock(&data->update_lock);
 
-    if (time_after(jiffies, data->last_updated + HZ + HZ / 2)
-        || !data->valid) {
-        int status;
-		int power_good = 0;
+    /* Read psu status, a copy the CPLD driver keeps from its poll */
+    status = as7716_32x_cpld_psu_status();
 
+    if (status < 0) {
+        dev_dbg(&client->dev, "cpld reg 0x60 err %d\n", status);
         data->valid = 0;
-        dev_dbg(&client->dev, "Starting as7716_32x update\n");
+        goto exit;
+    }
+    else {
+        data->status = status;
+    }
 
-        /* Read psu status */
-        status = as7716_32x_cpld_read(0x60, 0x2);
-        
-        if (status < 0) {
-            dev_dbg(&client->dev, "cpld reg 0x60 err %d\n", status);
+    /* The eeprom only has to be read again when the PSU comes, goes,
+     * or its power good changes
+     */
+    psu_bits = data->status & PSU_STATUS_BITS(data->index);
+    if (data->valid && psu_bits == data->psu_bits) {
+        goto exit;
+    }
+
+    data->valid = 0;
+    data->psu_bits = psu_bits;
+    dev_dbg(&client->dev, "Starting as7716_32x update\n");
+
+    /* Read model name */
+    memset(data->model_name, 0, sizeof(data->model_name));
+    memset(data->fan_dir, 0, sizeof(data->fan_dir));
+
+    if (data->status >> (3-data->index) & 0x1) { /* power good */
+        if (as7716_32x_psu_model_name_get(dev) < 0) {
             goto exit;
         }
-        else {
-            data->status = status;
-        }
-		
-        /* Read model name */
-        memset(data->model_name, 0, sizeof(data->model_name));
-        memset(data->fan_dir, 0, sizeof(data->fan_dir));
-        power_good = (data->status >> (3-data->index) & 0x1);
-		
-        if (power_good) {
-            if (as7716_32x_psu_model_name_get(dev) < 0) {
+
+        if (strncmp(data->model_name,
+                    models[PSU_TYPE_DC_12V].model_name,
+                    models[PSU_TYPE_DC_12V].length) == 0)
+        {
+            /* Read fan direction */
+            status = as7716_32x_psu_read_block(client, DC12V_FAN_DIR_OFFSET,
+                                               data->fan_dir, DC12V_FAN_DIR_LEN);
+
+            if (status < 0) {
+                data->fan_dir[0] = '\0';
+                dev_dbg(&client->dev, "unable to read fan direction from (0x%x) offset(0x%x)\n",
+                                      client->addr, DC12V_FAN_DIR_OFFSET);
                 goto exit;
             }
-            
-            if (strncmp(data->model_name, 
-                        models[PSU_TYPE_DC_12V].model_name,
-                        models[PSU_TYPE_DC_12V].length) == 0)
-            {
-                /* Read fan direction */
-                
-                status = as7716_32x_psu_read_block(client, DC12V_FAN_DIR_OFFSET, 
-                                                   data->fan_dir, DC12V_FAN_DIR_LEN);
-                
-                if (status < 0) {
-                    data->fan_dir[0] = '\0';
-                    dev_dbg(&client->dev, "unable to read fan direction from (0x%x) offset(0x%x)\n", 
-                                          client->addr, DC12V_FAN_DIR_OFFSET);
-                    goto exit;
-                }
-            }
         }
-        
-        data->last_updated = jiffies;
-        data->valid = 1;
     }
 
+    data->valid = 1;
+
 exit:
     mutex_unlock(&data->update_lock);
 
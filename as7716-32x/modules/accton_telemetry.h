@@ -0,0 +1 @@
+../../common/modules/accton_telemetry.h
\ No newline at end of file
@@ -44,6 +44,10 @@
  *	        Offset 384-511 is in page 0, in the upper half of 51/A2/...
  *	        Offset 512-639 is in page 1, in the upper half of 51/A2/...
  *	        Offset 'n' is in page (n/128)-3 (for n > 383)
+ *	g) CMIS devices (optoe3) are one address devices whose pages 10h-FFh
+ *	        also depend on the bank select register (offset 126).  Bank
+ *	        'b' page 'p' is presented where page (b*256)+p would be, so
+ *	        bank 0 is laid out exactly like a QSFP.
  *
  *	                    One I2c addressed (eg QSFP) Memory Map
  *
@@ -115,11 +119,19 @@
 #include <linux/slab.h>
 #include <linux/delay.h>
 #include <linux/mutex.h>
+#include <linux/rwsem.h>
 #include <linux/sysfs.h>
 #include <linux/jiffies.h>
+#include <linux/ktime.h>
+#include <linux/log2.h>
 #include <linux/i2c.h>
 #include <linux/types.h>
 #include <linux/memory.h>
+#include <linux/spinlock.h>
+#include <linux/workqueue.h>
+#include "accton_i2c_stats.h"
+#include "accton_telemetry.h"
+#include "accton_trace.h"
 
 /*
  * The optoe driver is for read/write access to the EEPROM on standard
@@ -165,6 +177,14 @@ struct optoe_platform_data {
  */
 #define TWO_ADDR_EEPROM_SIZE ((3 + OPTOE_ARCH_PAGES) * OPTOE_PAGE_SIZE)
 #define TWO_ADDR_EEPROM_UNPAGED_SIZE (4 * OPTOE_PAGE_SIZE)
+/*
+ * CMIS devices are single address, with pages 10h-FFh repeated in
+ * each bank.  Bank b page p sits where page (b * 256 + p) would be,
+ * so bank 0 is laid out like a QSFP.  Banks 0-3 cover 32 lanes.
+ */
+#define CMIS_BANKS 4
+#define CMIS_EEPROM_SIZE ((1 + CMIS_BANKS * OPTOE_ARCH_PAGES) * OPTOE_PAGE_SIZE)
+#define CMIS_EEPROM_UNPAGED_SIZE (2 * OPTOE_PAGE_SIZE)
 
 /* a few constants to find our way around the EEPROM */
 #define OPTOE_PAGE_SELECT_REG   0x7F
@@ -172,7 +192,68 @@ struct optoe_platform_data {
 #define ONE_ADDR_NOT_PAGEABLE (1<<2)
 #define TWO_ADDR_PAGEABLE_REG 0x40
 #define TWO_ADDR_PAGEABLE (1<<4)
+#define CMIS_BANK_SELECT_REG 0x7E
+#define CMIS_FLAT_MEM_REG 0x02
+#define CMIS_FLAT_MEM (1<<7)
+#define CMIS_MODULE_STATE_REG 0x03
+#define CMIS_MODULE_STATE_MASK 0x0E
+#define CMIS_FIRST_BANKED_PAGE 0x10
 #define OPTOE_ID_REG 0
+#define OPTOE_PAGE_UNKNOWN (-1)
+
+/*
+ * EEPROM cache.  A chunk is one 128 byte slice of the linear address
+ * space presented by the driver (offset >> 7), so for QSFP chunk 0 is
+ * lower page 00h, chunk 1 is upper page 00h and chunk 4 is page 03h.
+ * Only the first OPTOE_CACHE_CHUNKS chunks are cached, which covers
+ * every page defined by SFF-8436/8636 and SFF-8472.
+ */
+#define OPTOE_CACHE_CHUNKS 8
+
+struct optoe_chunk_cache {
+	u8 data[OPTOE_PAGE_SIZE];
+	unsigned long last_updated;	/* in jiffies */
+	unsigned generation;		/* optoe->generation when filled */
+	char valid;
+};
+
+/*
+ * The "cache_image" bin attribute: the valid chunks, saved by the
+ * platform code before the driver is unloaded (to tmpfs) and written
+ * back after it is loaded again, so a pmon restart does not re-read
+ * every EEPROM.  A write is only taken if the module still has the
+ * identifier and vendor serial number of the image.
+ */
+#define OPTOE_CACHE_IMAGE_MAGIC 0x4354504f	/* "OPTC" */
+#define OPTOE_CACHE_IMAGE_VERSION 1
+
+struct optoe_cache_image {
+	u32 magic;
+	u8 version;
+	u8 dev_class;
+	u8 valid;		/* bit per chunk */
+	u8 reserved;
+	u8 data[OPTOE_CACHE_CHUNKS][OPTOE_PAGE_SIZE];
+} __packed;
+
+/*
+ * DOM sampler.  When enabled, a delayed work reads the monitor bytes
+ * every dom_sample_ms into a small ring, exported through the
+ * "dom_samples" bin attribute as OPTOE_DOM_RING_SIZE records, oldest
+ * first.  Slots not filled yet read back as all zero.
+ */
+#define OPTOE_DOM_SAMPLE_LEN	48
+#define OPTOE_DOM_RING_SIZE	16
+#define OPTOE_DOM_MIN_INTERVAL	100	/* msec */
+
+struct optoe_dom_sample {
+	u64 timestamp_ns;	/* ktime_get(), monotonic */
+	u32 seq;		/* 1 for the first sample, then +1 */
+	u8 offset;		/* of data[0], within the page it came from */
+	u8 len;			/* valid bytes in data */
+	u8 reserved[2];
+	u8 data[OPTOE_DOM_SAMPLE_LEN];
+} __packed;
 
 /* The maximum length of a port name */
 #define MAX_PORT_NAME_LEN 20
@@ -188,10 +269,23 @@ struct optoe_data {
 	 */
 	struct mutex lock;
 	struct bin_attribute bin;
+
+	/*
+	 * cache_sem guards cache[], generation and dev_class for readers
+	 * that don't take lock: a read fully served from the cache only
+	 * needs it shared.  Writers hold lock first, then cache_sem
+	 * exclusive for just the update, never across bus I/O.
+	 */
+	struct rw_semaphore cache_sem;
 	struct attribute_group attr_group;
 
+	struct i2c_stats *stats;
+	struct accton_tlm *tlm;		/* the DOM samples */
+
 	u8 *writebuf;
 	unsigned write_max;
+	unsigned write_limit;		/* largest write_max writebuf can hold */
+	unsigned write_poll_us;
 
 	unsigned num_addresses;
 
@@ -202,6 +296,39 @@ struct optoe_data {
 	/* dev_class: ONE_ADDR (QSFP) or TWO_ADDR (SFP) */
 	int dev_class;
 
+	/*
+	 * Static ranges stay cached until the generation is bumped (module
+	 * removed, replaced or reset), volatile ranges expire after
+	 * cache_ttl_ms.
+	 */
+	struct optoe_chunk_cache cache[OPTOE_CACHE_CHUNKS];
+	unsigned generation;
+	unsigned cache_ttl_ms;
+
+	/*
+	 * Page last written to the page select register, or
+	 * OPTOE_PAGE_UNKNOWN.  With lazy_page_restore set the module is
+	 * left on that page after an access instead of going back to 0.
+	 */
+	int cur_page;
+	int cur_bank;			/* CMIS only, same rules as cur_page */
+	int lazy_page_restore;
+
+	/*
+	 * Plain I2C adapters: select the page in the same transfer as the
+	 * read.  Cleared if the module turns out not to latch the select.
+	 */
+	int combined_select;
+
+	/* DOM sampler; the ring is protected by dom_lock, not by lock */
+	struct delayed_work dom_work;
+	unsigned dom_sample_ms;		/* 0 when stopped */
+	spinlock_t dom_lock;
+	struct optoe_dom_sample dom_ring[OPTOE_DOM_RING_SIZE];
+	unsigned dom_head;		/* next slot to fill */
+	u32 dom_seq;
+	struct bin_attribute dom_bin;
+
 	struct i2c_client *client[];
 };
 
@@ -227,22 +354,74 @@ static unsigned io_limit = OPTOE_PAGE_SIZE;
  */
 static unsigned write_timeout = 25;
 
+/*
+ * While a module is busy with an internal write cycle it NACKs; poll it
+ * at this interval instead of sleeping a whole tick per attempt (which
+ * is 10 msec at HZ=100, for a write that usually takes 1-5 msec).
+ */
+static unsigned write_poll_us = 100;
+
+/*
+ * DOM values and flags change all the time, but xcvrd and friends read
+ * them in bursts; serving a burst from one fetch is good enough.
+ * 0 disables caching of volatile ranges.
+ */
+static unsigned cache_ttl_ms = 100;
+
 /*
  * flags to distinguish one-address (QSFP family) from two-address (SFP family)
  * If the family is not known, figure it out when the device is accessed
  */
 #define ONE_ADDR 1
 #define TWO_ADDR 2
+#define CMIS_ADDR 3
 
 static const struct i2c_device_id optoe_ids[] = {
 	{ "optoe1", ONE_ADDR },
 	{ "optoe2", TWO_ADDR },
+	{ "optoe3", CMIS_ADDR },
 	{ "sff8436", ONE_ADDR },
 	{ "24c04", TWO_ADDR },
 	{ /* END OF LIST */ }
 };
 MODULE_DEVICE_TABLE(i2c, optoe_ids);
 
+/*
+ * Ranges (in the linear address space) that the module updates on its
+ * own.  Everything else is static while the module stays plugged in,
+ * or only changes when we write it.
+ */
+struct optoe_volatile_range {
+	int dev_class;
+	unsigned start;
+	unsigned end;
+};
+
+/* Monitor values: temperature, Vcc, then Tx bias, Tx and Rx power */
+struct optoe_dom_range {
+	int dev_class;
+	unsigned start;		/* linear offset */
+	unsigned len;
+};
+
+static const struct optoe_dom_range optoe_dom_ranges[] = {
+	/* SFF-8636 lower page 22-57, Rx power/Tx bias/Tx power per lane */
+	{ ONE_ADDR, 22, 36 },
+	/* SFF-8472 A2h 96-105 */
+	{ TWO_ADDR, 256 + 96, 10 },
+	/* CMIS lower page 14-25, module temperature, Vcc and aux monitors */
+	{ CMIS_ADDR, 14, 12 },
+};
+
+static const struct optoe_volatile_range optoe_volatile_ranges[] = {
+	/* QSFP lower page: status, interrupt flags, monitors, controls */
+	{ ONE_ADDR, 0, OPTOE_PAGE_SIZE },
+	/* SFP A2h: diagnostics, status/control, alarm and warning flags */
+	{ TWO_ADDR, 256 + 96, 256 + OPTOE_PAGE_SIZE },
+	/* CMIS lower page: module state, flags, monitors, controls */
+	{ CMIS_ADDR, 0, OPTOE_PAGE_SIZE },
+};
+
 /*-------------------------------------------------------------------------*/
 /*
  * This routine computes the addressing information to be used for
@@ -262,6 +441,10 @@ MODULE_DEVICE_TABLE(i2c, optoe_ids);
  *     Pages are accessible on the upper half of client[1].
  *     Offset >127 are in 128 byte pages mapped into the upper half
  *
+ *     CMIS is QSFP with banks: what would be page (bank * 256 + page)
+ *     is that page of that bank.  The bank only matters for pages
+ *     10h-FFh, it is 0 for the others and for the other classes.
+ *
  *     Callers must not read/write beyond the end of a client or a page
  *     without recomputing the client/page.  Hence offset (within page)
  *     plus length must be less than or equal to 128.  (Note that this
@@ -272,11 +455,12 @@ MODULE_DEVICE_TABLE(i2c, optoe_ids);
  */
 
 static uint8_t optoe_translate_offset(struct optoe_data *optoe,
-		loff_t *offset, struct i2c_client **client)
+		loff_t *offset, struct i2c_client **client, int *bank)
 {
 	unsigned page = 0;
 
 	*client = optoe->client[0];
+	*bank = 0;
 
 	/* if SFP style, offset > 255, shift to i2c addr 0x51 */
 	if (optoe->dev_class == TWO_ADDR) {
@@ -300,20 +484,47 @@ static uint8_t optoe_translate_offset(struct optoe_data *optoe,
 	/* 0x80 places the offset in the top half, offset is last 7 bits */
 	*offset = OPTOE_PAGE_SIZE + (*offset & 0x7f);
 
-	return page;  /* note also returning client and offset */
+	if (optoe->dev_class == CMIS_ADDR) {
+		*bank = page / OPTOE_ARCH_PAGES;
+		page %= OPTOE_ARCH_PAGES;
+	}
+
+	return page;  /* note also returning client, offset and bank */
 }
 
-static ssize_t optoe_eeprom_read(struct optoe_data *optoe,
-		    struct i2c_client *client,
+/*
+ * Wait before the next attempt to reach a module that NACKed because it
+ * is still busy writing (acknowledge polling).
+ */
+static void optoe_ack_poll_wait(struct optoe_data *optoe)
+{
+	usleep_range(optoe->write_poll_us, optoe->write_poll_us * 2);
+	i2c_stats_retry(optoe->stats);
+}
+
+/*
+ * Read from the current page, or with page >= 0 (plain I2C only) select
+ * that page first within the same transfer.  The select register is
+ * read back in that transfer too; -EPROTO means the module did not
+ * latch the page and the data must be thrown away.
+ */
+static ssize_t optoe_eeprom_read_paged(struct optoe_data *optoe,
+		    struct i2c_client *client, int page,
 		    char *buf, unsigned offset, size_t count)
 {
-	struct i2c_msg msg[2];
+	struct i2c_msg msg[5];
 	u8 msgbuf[2];
-	unsigned long timeout, read_time;
-	int status, i;
+	u8 selbuf[2];
+	u8 selected = 0;
+	ktime_t start;
+	s64 read_time;
+	int status, i, nmsgs = 0;
 
 	memset(msg, 0, sizeof(msg));
 
+	/* Short enough not to hold off a fan or PSU poll of the same bus */
+	count = i2c_sched_chunk(optoe->stats, count);
+
 	switch (optoe->use_smbus) {
 	case I2C_SMBUS_I2C_BLOCK_DATA:
 		/*smaller eeproms can work given some SMBus extension calls */
@@ -334,17 +545,44 @@ static ssize_t optoe_eeprom_read(struct optoe_data *optoe,
 		 * io_limit data bytes.  msgbuf is u8 and will cast to our
 		 * needs.
 		 */
+		if (count > io_limit)
+			count = io_limit;
+
+		if (page >= 0) {
+			/* write page select, then read it back */
+			selbuf[0] = OPTOE_PAGE_SELECT_REG;
+			selbuf[1] = page;
+
+			msg[nmsgs].addr = client->addr;
+			msg[nmsgs].buf = selbuf;
+			msg[nmsgs].len = 2;
+			nmsgs++;
+
+			msg[nmsgs].addr = client->addr;
+			msg[nmsgs].buf = selbuf;
+			msg[nmsgs].len = 1;
+			nmsgs++;
+
+			msg[nmsgs].addr = client->addr;
+			msg[nmsgs].flags = I2C_M_RD;
+			msg[nmsgs].buf = &selected;
+			msg[nmsgs].len = 1;
+			nmsgs++;
+		}
+
 		i = 0;
 		msgbuf[i++] = offset;
 
-		msg[0].addr = client->addr;
-		msg[0].buf = msgbuf;
-		msg[0].len = i;
+		msg[nmsgs].addr = client->addr;
+		msg[nmsgs].buf = msgbuf;
+		msg[nmsgs].len = i;
+		nmsgs++;
 
-		msg[1].addr = client->addr;
-		msg[1].flags = I2C_M_RD;
-		msg[1].buf = buf;
-		msg[1].len = count;
+		msg[nmsgs].addr = client->addr;
+		msg[nmsgs].flags = I2C_M_RD;
+		msg[nmsgs].buf = buf;
+		msg[nmsgs].len = count;
+		nmsgs++;
 	}
 
 	/*
@@ -352,17 +590,18 @@ static ssize_t optoe_eeprom_read(struct optoe_data *optoe,
 	 * loop a few times until this one succeeds, waiting at least
 	 * long enough for one entire page write to work.
 	 */
-	timeout = jiffies + msecs_to_jiffies(write_timeout);
+	start = ktime_get();
 	do {
-		read_time = jiffies;
+		read_time = ktime_us_delta(ktime_get(), start);
 
 		switch (optoe->use_smbus) {
 		case I2C_SMBUS_I2C_BLOCK_DATA:
-			status = i2c_smbus_read_i2c_block_data(client, offset,
-					count, buf);
+			status = i2c_stats_read_i2c_block_data(optoe->stats,
+					client, offset, count, buf);
 			break;
 		case I2C_SMBUS_WORD_DATA:
-			status = i2c_smbus_read_word_data(client, offset);
+			status = i2c_stats_read_word_data(optoe->stats,
+					client, offset);
 			if (status >= 0) {
 				buf[0] = status & 0xff;
 				if (count == 2)
@@ -371,16 +610,21 @@ static ssize_t optoe_eeprom_read(struct optoe_data *optoe,
 			}
 			break;
 		case I2C_SMBUS_BYTE_DATA:
-			status = i2c_smbus_read_byte_data(client, offset);
+			status = i2c_stats_read_byte_data(optoe->stats,
+					client, offset);
 			if (status >= 0) {
 				buf[0] = status;
 				status = count;
 			}
 			break;
 		default:
-			status = i2c_transfer(client->adapter, msg, 2);
-			if (status == 2)
+			status = i2c_stats_transfer(optoe->stats,
+					client->adapter, msg, nmsgs);
+			if (status == nmsgs) {
+				if (page >= 0 && selected != page)
+					return -EPROTO;
 				status = count;
+			}
 		}
 
 		dev_dbg(&client->dev, "eeprom read %zu@%d --> %d (%ld)\n",
@@ -392,13 +636,23 @@ static ssize_t optoe_eeprom_read(struct optoe_data *optoe,
 		if (status == -ENXIO) /* no module present */
 			return status;
 
-		/* REVISIT: at HZ=100, this is sloooow */
-		msleep(1);
-	} while (time_before(read_time, timeout));
+		if (status == -EHOSTDOWN) /* segment isolated */
+			return status;
+
+		optoe_ack_poll_wait(optoe);
+	} while (read_time < write_timeout * USEC_PER_MSEC);
 
 	return -ETIMEDOUT;
 }
 
+static ssize_t optoe_eeprom_read(struct optoe_data *optoe,
+		    struct i2c_client *client,
+		    char *buf, unsigned offset, size_t count)
+{
+	return optoe_eeprom_read_paged(optoe, client, OPTOE_PAGE_UNKNOWN,
+			buf, offset, count);
+}
+
 static ssize_t optoe_eeprom_write(struct optoe_data *optoe,
 		    		struct i2c_client *client,
 				const char *buf,
@@ -406,12 +660,13 @@ static ssize_t optoe_eeprom_write(struct optoe_data *optoe,
 {
 	struct i2c_msg msg;
 	ssize_t status;
-	unsigned long timeout, write_time;
+	ktime_t start;
+	s64 write_time;
 	unsigned next_page_start;
 	int i = 0;
 
 	/* write max is at most a page
-	 * (In this driver, write_max is actually one byte!)
+	 * (By default write_max is one byte, see AN-2079 in probe)
 	 */
 	if (count > optoe->write_max)
 		count = optoe->write_max;
@@ -421,6 +676,15 @@ static ssize_t optoe_eeprom_write(struct optoe_data *optoe,
 	if (offset + count > next_page_start)
 		count = next_page_start - offset;
 
+	/*
+	 * Modules buffer sequential writes in small internal pages
+	 * (4 bytes SFF-8636, 8 bytes CMIS); write_max is a power of two,
+	 * don't let a multi-byte write straddle one of those.
+	 */
+	next_page_start = roundup(offset + 1, optoe->write_max);
+	if (offset + count > next_page_start)
+		count = next_page_start - offset;
+
 	switch (optoe->use_smbus) {
 	case I2C_SMBUS_I2C_BLOCK_DATA:
 		/*smaller eeproms can work given some SMBus extension calls */
@@ -449,41 +713,42 @@ static ssize_t optoe_eeprom_write(struct optoe_data *optoe,
 	}
 
 	/*
-	 * Reads fail if the previous write didn't complete yet. We may
+	 * Writes fail if the previous write didn't complete yet. We may
 	 * loop a few times until this one succeeds, waiting at least
 	 * long enough for one entire page write to work.
 	 */
-	timeout = jiffies + msecs_to_jiffies(write_timeout);
+	start = ktime_get();
 	do {
-		write_time = jiffies;
+		write_time = ktime_us_delta(ktime_get(), start);
 
 		switch (optoe->use_smbus) {
 		case I2C_SMBUS_I2C_BLOCK_DATA:
-			status = i2c_smbus_write_i2c_block_data(client,
-						offset, count, buf);
+			status = i2c_stats_write_i2c_block_data(optoe->stats,
+						client, offset, count, buf);
 			if (status == 0)
 				status = count;
 			break;
 		case I2C_SMBUS_WORD_DATA:
 			if (count == 2) {
-				status = i2c_smbus_write_word_data(client,
-					offset, (u16)((buf[0])|(buf[1] << 8)));
+				status = i2c_stats_write_word_data(optoe->stats,
+					client, offset, (u16)((buf[0])|(buf[1] << 8)));
 			} else {
 				/* count = 1 */
-				status = i2c_smbus_write_byte_data(client,
-					offset, buf[0]);
+				status = i2c_stats_write_byte_data(optoe->stats,
+					client, offset, buf[0]);
 			}
 			if (status == 0)
 				status = count;
 			break;
 		case I2C_SMBUS_BYTE_DATA:
-			status = i2c_smbus_write_byte_data(client, offset,
-						buf[0]);
+			status = i2c_stats_write_byte_data(optoe->stats,
+						client, offset, buf[0]);
 			if (status == 0)
 				status = count;
 			break;
 		default:
-			status = i2c_transfer(client->adapter, &msg, 1);
+			status = i2c_stats_transfer(optoe->stats,
+					client->adapter, &msg, 1);
 			if (status == 1)
 				status = count;
 			break;
@@ -495,14 +760,73 @@ static ssize_t optoe_eeprom_write(struct optoe_data *optoe,
 		if (status == count)
 			return count;
 
-		/* REVISIT: at HZ=100, this is sloooow */
-		msleep(1);
-	} while (time_before(write_time, timeout));
+		if (status == -EHOSTDOWN) /* segment isolated */
+			return status;
+
+		optoe_ack_poll_wait(optoe);
+	} while (write_time < write_timeout * USEC_PER_MSEC);
 
 	return -ETIMEDOUT;
 }
 
 
+/*
+ * The one client that has a page select register: 0x50 for QSFP,
+ * 0x51 for SFP.
+ */
+static struct i2c_client *optoe_paged_client(struct optoe_data *optoe)
+{
+	return optoe->client[(optoe->dev_class == TWO_ADDR) ? 1 : 0];
+}
+
+/* Does going to this bank/page need a bank select write first? */
+static int optoe_bank_change(struct optoe_data *optoe, int bank, u8 page)
+{
+	return optoe->dev_class == CMIS_ADDR &&
+		page >= CMIS_FIRST_BANKED_PAGE && optoe->cur_bank != bank;
+}
+
+/*
+ * On CMIS the bank select byte only takes effect with the next page
+ * select write, so a bank change always rewrites the page as well.
+ */
+static int optoe_select_page(struct optoe_data *optoe,
+		struct i2c_client *client, int bank, u8 page)
+{
+	u8 bankval = bank;
+	int ret;
+
+	if (optoe_bank_change(optoe, bank, page)) {
+		ret = optoe_eeprom_write(optoe, client, &bankval,
+				CMIS_BANK_SELECT_REG, 1);
+		optoe->cur_page = OPTOE_PAGE_UNKNOWN;
+		if (ret < 0) {
+			dev_dbg(&client->dev,
+				"Write bank register for bank %d failed ret:%d!\n",
+					bank, ret);
+			optoe->cur_bank = OPTOE_PAGE_UNKNOWN;
+			return ret;
+		}
+		optoe->cur_bank = bank;
+	}
+
+	if (optoe->cur_page == page)
+		return 0;
+
+	ret = optoe_eeprom_write(optoe, client, &page,
+			OPTOE_PAGE_SELECT_REG, 1);
+	if (ret < 0) {
+		dev_dbg(&client->dev,
+			"Write page register for page %d failed ret:%d!\n",
+				page, ret);
+		optoe->cur_page = OPTOE_PAGE_UNKNOWN;
+		return ret;
+	}
+
+	optoe->cur_page = page;
+	return 0;
+}
+
 static ssize_t optoe_eeprom_update_client(struct optoe_data *optoe,
 				char *buf, loff_t off, 
 				size_t count, optoe_opcode_e opcode)
@@ -510,21 +834,52 @@ static ssize_t optoe_eeprom_update_client(struct optoe_data *optoe,
 	struct i2c_client *client;
 	ssize_t retval = 0;
 	uint8_t page = 0;
+	int bank = 0;
 	loff_t phy_offset = off;
+	unsigned int offset;
+	size_t len = count;
+	ktime_t start = accton_trace_eeprom_start();
 	int ret = 0;
 
-	page = optoe_translate_offset(optoe, &phy_offset, &client);
+	page = optoe_translate_offset(optoe, &phy_offset, &client, &bank);
+	offset = phy_offset;
 	dev_dbg(&client->dev,
 			"optoe_eeprom_update_client off %lld  page:%d phy_offset:%lld, count:%ld, opcode:%d\n",
 			off, page, phy_offset, (long int) count, opcode);
-	if (page > 0) {
-		ret = optoe_eeprom_write(optoe, client, &page, 
-			OPTOE_PAGE_SELECT_REG, 1);
+	/*
+	 * Only the upper half of the paged client is affected by the page
+	 * select register.  Page 0 also has to be selected explicitly,
+	 * since the module may have been left on another page.
+	 */
+	if (phy_offset >= OPTOE_PAGE_SIZE && client == optoe_paged_client(optoe)) {
+		if (opcode == OPTOE_READ_OP && optoe->combined_select &&
+		    optoe->cur_page != page &&
+		    !optoe_bank_change(optoe, bank, page)) {
+			ret = optoe_eeprom_read_paged(optoe, client, page,
+					buf, phy_offset, count);
+			if (ret == -EPROTO) {
+				dev_notice(&client->dev,
+					"page select not latched in a combined transfer, "
+					"using separate writes\n");
+				optoe->combined_select = 0;
+				optoe->cur_page = OPTOE_PAGE_UNKNOWN;
+			} else if (ret < 0) {
+				optoe->cur_page = OPTOE_PAGE_UNKNOWN;
+				retval = ret;
+				goto exit;
+			} else {
+				optoe->cur_page = page;
+				buf += ret;
+				phy_offset += ret;
+				count -= ret;
+				retval += ret;
+			}
+		}
+
+		ret = optoe_select_page(optoe, client, bank, page);
 		if (ret < 0) {
-			dev_dbg(&client->dev,
-				"Write page register for page %d failed ret:%d!\n",
-					page, ret);
-			return ret;
+			retval = ret;
+			goto exit;
 		}
 	}
 
@@ -549,22 +904,333 @@ static ssize_t optoe_eeprom_update_client(struct optoe_data *optoe,
 		retval += status;
 	}
 
+exit:
+	if (opcode == OPTOE_READ_OP)
+		trace_accton_eeprom_read(&client->dev, page, offset, len,
+				accton_trace_duration(start), retval);
+	else
+		trace_accton_eeprom_write(&client->dev, page, offset, len,
+				accton_trace_duration(start), retval);
+	return retval;
+}
 
-	if (page > 0) {
-		/* return the page register to page 0 (why?) */
-		page = 0;
-		ret = optoe_eeprom_write(optoe, client, &page, 
-			OPTOE_PAGE_SELECT_REG, 1);
-		if (ret < 0) {
-			dev_err(&client->dev,
-				"Restore page register to 0 failed:%d!\n", ret);
-			/* error only if nothing has been transferred */
-			if (retval == 0) retval = ret;
-		}
+/*
+ * Put the module back on page 0 once the whole access is done, so other
+ * users of the module (and pre-optoe tools) find it where they expect.
+ * Skipped in lazy mode; the next access selects whatever page it needs.
+ */
+static int optoe_restore_page(struct optoe_data *optoe)
+{
+	struct i2c_client *client = optoe_paged_client(optoe);
+	int ret;
+
+	if (!client || optoe->lazy_page_restore || optoe->cur_page == 0)
+		return 0;
+
+	ret = optoe_select_page(optoe, client, 0, 0);
+	if (ret < 0)
+		dev_err(&client->dev,
+			"Restore page register to 0 failed:%d!\n", ret);
+
+	return ret;
+}
+
+/*-------------------------------------------------------------------------*/
+/*
+ * EEPROM cache.  All of these are called with optoe->lock held, the
+ * ones changing the cache take cache_sem for the update as well.
+ *
+ * Bumping the generation drops everything at once.  That happens when
+ * the platform code tells us about a presence/reset transition (through
+ * the cache_generation attribute), when an access fails (the module is
+ * probably gone), or when the identifier byte changes under us.
+ */
+static void optoe_cache_invalidate(struct optoe_data *optoe)
+{
+	down_write(&optoe->cache_sem);
+	optoe->generation++;
+	up_write(&optoe->cache_sem);
+
+	/* a new module powers up on page 0, an unhappy one may be anywhere */
+	if (optoe->lazy_page_restore)
+		optoe->cur_page = OPTOE_PAGE_UNKNOWN;
+	optoe->cur_bank = OPTOE_PAGE_UNKNOWN;
+}
+
+static void optoe_cache_drop(struct optoe_data *optoe, loff_t off)
+{
+	unsigned chunk = off >> 7;
+
+	if (chunk < OPTOE_CACHE_CHUNKS) {
+		down_write(&optoe->cache_sem);
+		optoe->cache[chunk].valid = 0;
+		up_write(&optoe->cache_sem);
 	}
-	return retval;
+}
+
+/* Does [off, off + len) cover the page (or CMIS bank) select register? */
+static int optoe_range_has_page_select(struct optoe_data *optoe,
+		loff_t off, size_t len)
+{
+	loff_t reg = OPTOE_PAGE_SELECT_REG;
+	loff_t first = reg;
+
+	if (optoe->dev_class == TWO_ADDR)
+		first = reg += 256;
+	else if (optoe->dev_class == CMIS_ADDR)
+		first = CMIS_BANK_SELECT_REG;
+
+	return off <= reg && (off + len) > first;
+}
+
+static int optoe_range_volatile(struct optoe_data *optoe,
+		loff_t off, size_t len)
+{
+	const struct optoe_volatile_range *range;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(optoe_volatile_ranges); i++) {
+		range = &optoe_volatile_ranges[i];
+		if (range->dev_class == optoe->dev_class &&
+		    off < range->end && (off + len) > range->start)
+			return 1;
+	}
+
+	return 0;
+}
+
+/*
+ * Copy [off, off + len) out of the cache if it is there and still good.
+ * The range must not cross a chunk boundary.  Returns 1 on a hit.
+ */
+static int optoe_cache_lookup(struct optoe_data *optoe,
+		char *buf, loff_t off, size_t len)
+{
+	struct optoe_chunk_cache *cc;
+	unsigned chunk = off >> 7;
+
+	if (chunk >= OPTOE_CACHE_CHUNKS)
+		return 0;
+
+	cc = &optoe->cache[chunk];
+	if (!cc->valid || cc->generation != optoe->generation)
+		return 0;
+
+	if (optoe_range_volatile(optoe, off, len)) {
+		if (!optoe->cache_ttl_ms)
+			return 0;
+		if (time_after(jiffies, cc->last_updated +
+				msecs_to_jiffies(optoe->cache_ttl_ms)))
+			return 0;
+	}
+
+	memcpy(buf, &cc->data[off & 0x7f], len);
+	return 1;
+}
+
+/*
+ * Read a range that lies within one chunk.  On a miss the whole chunk
+ * is fetched, so the rest of the page is served from memory next time.
+ * The page is read into a local copy and only then published, so
+ * lock-free readers never wait for the bus.
+ */
+static ssize_t optoe_cached_read(struct optoe_data *optoe,
+		char *buf, loff_t off, size_t count)
+{
+	struct optoe_chunk_cache *cc;
+	unsigned chunk = off >> 7;
+	u8 page[OPTOE_PAGE_SIZE];
+	ssize_t status;
+	int had_id;
+	u8 old_id, old_state;
+
+	if (optoe_cache_lookup(optoe, buf, off, count)) {
+		i2c_stats_cache(optoe->stats, true);
+		return count;
+	}
+	i2c_stats_cache(optoe->stats, false);
+
+	if (chunk >= OPTOE_CACHE_CHUNKS)
+		return optoe_eeprom_update_client(optoe, buf, off,
+				count, OPTOE_READ_OP);
+
+	cc = &optoe->cache[chunk];
+	had_id = cc->valid && cc->generation == optoe->generation;
+	old_id = cc->data[OPTOE_ID_REG];
+	old_state = cc->data[CMIS_MODULE_STATE_REG] & CMIS_MODULE_STATE_MASK;
+
+	status = optoe_eeprom_update_client(optoe, page,
+			chunk * OPTOE_PAGE_SIZE, OPTOE_PAGE_SIZE, OPTOE_READ_OP);
+	if (status != OPTOE_PAGE_SIZE) {
+		optoe_cache_drop(optoe, off);
+		if (status <= 0)
+			return status;
+		/* short chunk, don't cache it, just do what was asked */
+		return optoe_eeprom_update_client(optoe, buf, off,
+				count, OPTOE_READ_OP);
+	}
+
+	/* a different module showed up without anyone telling us */
+	if (chunk == 0 && had_id && old_id != page[OPTOE_ID_REG]) {
+		dev_dbg(&optoe->client[0]->dev,
+			"identifier changed 0x%x -> 0x%x, dropping cache\n",
+			old_id, page[OPTOE_ID_REG]);
+		optoe_cache_invalidate(optoe);
+	} else if (chunk == 0 && had_id && optoe->dev_class == CMIS_ADDR &&
+		   old_state != (page[CMIS_MODULE_STATE_REG] & CMIS_MODULE_STATE_MASK)) {
+		/* static pages 00h-02h are only good for one module state */
+		dev_dbg(&optoe->client[0]->dev,
+			"module state changed 0x%x -> 0x%x, dropping cache\n",
+			old_state >> 1,
+			(page[CMIS_MODULE_STATE_REG] & CMIS_MODULE_STATE_MASK) >> 1);
+		optoe_cache_invalidate(optoe);
+	}
+
+	down_write(&optoe->cache_sem);
+	memcpy(cc->data, page, OPTOE_PAGE_SIZE);
+	cc->generation = optoe->generation;
+	cc->last_updated = jiffies;
+	cc->valid = 1;
+	up_write(&optoe->cache_sem);
+
+	memcpy(buf, &page[off & 0x7f], count);
+	return count;
+}
+
+/* Linear offset of the 16 byte vendor serial number */
+static int optoe_serial_offset(struct optoe_data *optoe)
+{
+	switch (optoe->dev_class) {
+	case TWO_ADDR:
+		return 68;		/* SFF-8472 A0h */
+	case ONE_ADDR:
+		return 128 + 68;	/* SFF-8636 upper page 00h */
+	case CMIS_ADDR:
+		return 128 + 38;	/* CMIS upper page 00h */
+	default:
+		return -1;
+	}
+}
+
+static ssize_t optoe_cache_image_read(struct file *filp, struct kobject *kobj,
+		struct bin_attribute *attr,
+		char *buf, loff_t off, size_t count)
+{
+	struct i2c_client *client = to_i2c_client(container_of(kobj,
+				struct device, kobj));
+	struct optoe_data *optoe = i2c_get_clientdata(client);
+	struct optoe_cache_image *image;
+	size_t size = sizeof(*image);
+	int i;
+
+	if (off >= size)
+		return 0;
+	if (off + count > size)
+		count = size - off;
+
+	image = kzalloc(size, GFP_KERNEL);
+	if (!image)
+		return -ENOMEM;
+
+	image->magic = OPTOE_CACHE_IMAGE_MAGIC;
+	image->version = OPTOE_CACHE_IMAGE_VERSION;
+
+	down_read(&optoe->cache_sem);
+	image->dev_class = optoe->dev_class;
+	for (i = 0; i < OPTOE_CACHE_CHUNKS; i++) {
+		struct optoe_chunk_cache *cc = &optoe->cache[i];
+
+		if (!cc->valid || cc->generation != optoe->generation)
+			continue;
+		memcpy(image->data[i], cc->data, OPTOE_PAGE_SIZE);
+		image->valid |= 1 << i;
+	}
+	up_read(&optoe->cache_sem);
+
+	memcpy(buf, (char *)image + off, count);
+	kfree(image);
+
+	return count;
 }
 
+/*
+ * Only a whole image is taken.  The identifier and serial number are
+ * read from the module, 17 bytes instead of the pages the image holds;
+ * -ESTALE if they differ, the caller then simply lets the cache fill.
+ */
+static ssize_t optoe_cache_image_write(struct file *filp, struct kobject *kobj,
+		struct bin_attribute *attr,
+		char *buf, loff_t off, size_t count)
+{
+	struct i2c_client *client = to_i2c_client(container_of(kobj,
+				struct device, kobj));
+	struct optoe_data *optoe = i2c_get_clientdata(client);
+	struct optoe_cache_image *image = (struct optoe_cache_image *)buf;
+	unsigned long expired;
+	u8 id, serial[16];
+	ssize_t status;
+	int sn, i;
+
+	if (off != 0 || count != sizeof(*image))
+		return -EINVAL;
+	if (image->magic != OPTOE_CACHE_IMAGE_MAGIC ||
+	    image->version != OPTOE_CACHE_IMAGE_VERSION)
+		return -EINVAL;
+
+	mutex_lock(&optoe->lock);
+
+	sn = optoe_serial_offset(optoe);
+	if (image->dev_class != optoe->dev_class || sn < 0 ||
+	    !(image->valid & 1) || !(image->valid & (1 << (sn >> 7)))) {
+		status = -EINVAL;
+		goto exit;
+	}
+
+	status = optoe_eeprom_update_client(optoe, &id, OPTOE_ID_REG, 1,
+			OPTOE_READ_OP);
+	if (status == 1)
+		status = optoe_eeprom_update_client(optoe, serial, sn,
+				sizeof(serial), OPTOE_READ_OP);
+	if (status != sizeof(serial)) {
+		status = (status < 0) ? status : -EIO;
+		goto exit;
+	}
+
+	if (id != image->data[0][OPTOE_ID_REG] ||
+	    memcmp(serial, &image->data[sn >> 7][sn & 0x7f], sizeof(serial))) {
+		status = -ESTALE;
+		goto exit;
+	}
+
+	/* volatile bytes come back expired, so they are read fresh */
+	expired = jiffies - msecs_to_jiffies(optoe->cache_ttl_ms) - 1;
+
+	down_write(&optoe->cache_sem);
+	for (i = 0; i < OPTOE_CACHE_CHUNKS; i++) {
+		struct optoe_chunk_cache *cc = &optoe->cache[i];
+
+		if (!(image->valid & (1 << i)))
+			continue;
+		memcpy(cc->data, image->data[i], OPTOE_PAGE_SIZE);
+		cc->generation = optoe->generation;
+		cc->last_updated = expired;
+		cc->valid = 1;
+	}
+	up_write(&optoe->cache_sem);
+	status = count;
+
+exit:
+	mutex_unlock(&optoe->lock);
+	return status;
+}
+
+static struct bin_attribute optoe_cache_image_attr = {
+	.attr = { .name = "cache_image", .mode = S_IRUSR | S_IWUSR },
+	.size = sizeof(struct optoe_cache_image),
+	.read = optoe_cache_image_read,
+	.write = optoe_cache_image_write,
+};
+
 /*
  * Figure out if this access is within the range of supported pages.
  * Note this is called on every access because we don't know if the
@@ -578,7 +1244,7 @@ static ssize_t optoe_eeprom_update_client(struct optoe_data *optoe,
  *     - initial offset exceeds supported pages, return -EINVAL
  */
 static ssize_t optoe_page_legal(struct optoe_data *optoe, 
-		loff_t off, size_t len)
+		loff_t off, size_t len, int may_io)
 {
 	struct i2c_client *client = optoe->client[0];
 	u8 regval;
@@ -593,9 +1259,13 @@ static ssize_t optoe_page_legal(struct optoe_data *optoe,
 		/* if offset exceeds possible pages, we're not good */
 		if (off >= TWO_ADDR_EEPROM_SIZE) return -EINVAL;
 		/* in between, are pages supported? */
-		status = optoe_eeprom_read(optoe, client, &regval, 
-				TWO_ADDR_PAGEABLE_REG, 1);
-		if (status < 0) return status;  /* error out (no module?) */
+		if (!optoe_cache_lookup(optoe, &regval,
+					TWO_ADDR_PAGEABLE_REG, 1)) {
+			if (!may_io) return -EAGAIN;
+			status = optoe_eeprom_read(optoe, client, &regval,
+					TWO_ADDR_PAGEABLE_REG, 1);
+			if (status < 0) return status;  /* error out (no module?) */
+		}
 		if (regval & TWO_ADDR_PAGEABLE) {
 			/* Pages supported, trim len to the end of pages */
 			maxlen = TWO_ADDR_EEPROM_SIZE - off;
@@ -608,6 +1278,30 @@ static ssize_t optoe_page_legal(struct optoe_data *optoe,
 		dev_dbg(&client->dev,
 			"page_legal, SFP, off %lld len %ld\n",
 			off, (long int) len);
+	} else if (optoe->dev_class == CMIS_ADDR) {
+		/* CMIS case, banks beyond what the eeprom file holds are cut off */
+		size_t size = min_t(size_t, CMIS_EEPROM_SIZE, optoe->chip.byte_len);
+
+		if ((off + len) <= CMIS_EEPROM_UNPAGED_SIZE) return len;
+		if (off >= size) return -EINVAL;
+		if (!optoe_cache_lookup(optoe, &regval,
+					CMIS_FLAT_MEM_REG, 1)) {
+			if (!may_io) return -EAGAIN;
+			status = optoe_eeprom_read(optoe, client, &regval,
+					CMIS_FLAT_MEM_REG, 1);
+			if (status < 0) return status;  /* error out (no module?) */
+		}
+		if (regval & CMIS_FLAT_MEM) {
+			/* flat memory, lower page and page 00h only */
+			if (off >= CMIS_EEPROM_UNPAGED_SIZE) return -EINVAL;
+			maxlen = CMIS_EEPROM_UNPAGED_SIZE - off;
+		} else {
+			maxlen = size - off;
+		}
+		len = (len > maxlen) ? maxlen : len;
+		dev_dbg(&client->dev,
+			"page_legal, CMIS, off %lld len %ld\n",
+			off, (long int) len);
 	} else {
 		/* QSFP case */
 		/* if no pages needed, we're good */
@@ -615,9 +1309,13 @@ static ssize_t optoe_page_legal(struct optoe_data *optoe,
 		/* if offset exceeds possible pages, we're not good */
 		if (off >= ONE_ADDR_EEPROM_SIZE) return -EINVAL;
 		/* in between, are pages supported? */
-		status = optoe_eeprom_read(optoe, client, &regval, 
-				ONE_ADDR_PAGEABLE_REG, 1);
-		if (status < 0) return status;  /* error out (no module?) */
+		if (!optoe_cache_lookup(optoe, &regval,
+					ONE_ADDR_PAGEABLE_REG, 1)) {
+			if (!may_io) return -EAGAIN;
+			status = optoe_eeprom_read(optoe, client, &regval,
+					ONE_ADDR_PAGEABLE_REG, 1);
+			if (status < 0) return status;  /* error out (no module?) */
+		}
 		if (regval & ONE_ADDR_NOT_PAGEABLE) {
 			/* pages not supported, trim len to unpaged size */
 			if (off >= ONE_ADDR_EEPROM_UNPAGED_SIZE) return -EINVAL;
@@ -634,6 +1332,47 @@ static ssize_t optoe_page_legal(struct optoe_data *optoe,
 	return len;
 }
 
+/*
+ * Serve a read from the cache alone, under the shared side of cache_sem
+ * so that it doesn't queue behind a slow access holding optoe->lock.
+ * Returns the length read, or 0 if any part of it needs the bus.
+ */
+static ssize_t optoe_read_cached(struct optoe_data *optoe,
+		char *buf, loff_t off, size_t len)
+{
+	ssize_t status;
+	loff_t pos, end;
+	size_t chunk_len;
+	int hits = 0;
+
+	down_read(&optoe->cache_sem);
+
+	status = optoe_page_legal(optoe, off, len, 0);
+	if (status <= 0) {
+		/* errors are reported by the locked path */
+		status = 0;
+		goto out;
+	}
+
+	end = off + status;
+	for (pos = off; pos < end; pos += chunk_len, hits++) {
+		chunk_len = min_t(loff_t, end, (pos | 0x7f) + 1) - pos;
+		if (!optoe_cache_lookup(optoe, buf + (pos - off),
+					pos, chunk_len)) {
+			status = 0;
+			goto out;
+		}
+	}
+
+out:
+	up_read(&optoe->cache_sem);
+
+	while (status > 0 && hits--)
+		i2c_stats_cache(optoe->stats, true);
+
+	return status;
+}
+
 static ssize_t optoe_read_write(struct optoe_data *optoe,
 		char *buf, loff_t off, size_t len, optoe_opcode_e opcode)
 {
@@ -650,6 +1389,12 @@ static ssize_t optoe_read_write(struct optoe_data *optoe,
 	if (unlikely(!len))
 		return len;
 
+	if (opcode == OPTOE_READ_OP) {
+		retval = optoe_read_cached(optoe, buf, off, len);
+		if (retval > 0)
+			return retval;
+	}
+
 	/*
 	 * Read data from chip, protecting against concurrent updates
 	 * from this host, but not from other I2C masters.
@@ -659,7 +1404,7 @@ static ssize_t optoe_read_write(struct optoe_data *optoe,
 	/*
 	 * Confirm this access fits within the device suppored addr range 
 	 */
-	status = optoe_page_legal(optoe, off, len);
+	status = optoe_page_legal(optoe, off, len, 1);
 	if (status < 0) {
 		goto err;
 	}
@@ -697,7 +1442,8 @@ static ssize_t optoe_read_write(struct optoe_data *optoe,
 					OPTOE_PAGE_SIZE))
 				chunk_len = pending_len;
 			else
-				chunk_len = OPTOE_PAGE_SIZE - off;
+				chunk_len = OPTOE_PAGE_SIZE -
+					(off - chunk_start_offset);
 		} else {
 			chunk_offset = chunk_start_offset;
 			if (pending_len > OPTOE_PAGE_SIZE)
@@ -715,8 +1461,19 @@ static ssize_t optoe_read_write(struct optoe_data *optoe,
 		 * note: chunk_offset is from the start of the EEPROM, 
 		 * not the start of the chunk 
 		 */
-		status = optoe_eeprom_update_client(optoe, buf, 
-				chunk_offset, chunk_len, opcode);
+		if (opcode == OPTOE_READ_OP) {
+			status = optoe_cached_read(optoe, buf,
+					chunk_offset, chunk_len);
+		} else {
+			status = optoe_eeprom_update_client(optoe, buf,
+					chunk_offset, chunk_len, opcode);
+			optoe_cache_drop(optoe, chunk_offset);
+			/* someone is driving the page select register by hand */
+			if (optoe_range_has_page_select(optoe,
+					chunk_offset, chunk_len))
+				optoe->cur_page = optoe->cur_bank =
+					OPTOE_PAGE_UNKNOWN;
+		}
 		if (status != chunk_len) {
 			/* This is another 'no device present' path */
 			dev_dbg(&client->dev, 
@@ -728,11 +1485,18 @@ static ssize_t optoe_read_write(struct optoe_data *optoe,
 		pending_len -= status;
 		retval += status;
 	}
+	optoe_restore_page(optoe);
 	mutex_unlock(&optoe->lock);
 
 	return retval;
 
 err:
+	/* no module, or one that is misbehaving; don't trust the cache */
+	if (status < 0)
+		optoe_cache_invalidate(optoe);
+	/* if the select itself failed, the next access rewrites it anyway */
+	if (optoe->cur_page != OPTOE_PAGE_UNKNOWN)
+		optoe_restore_page(optoe);
 	mutex_unlock(&optoe->lock);
 
 	return status;
@@ -789,13 +1553,121 @@ static ssize_t optoe_macc_write(struct memory_accessor *macc,
 
 /*-------------------------------------------------------------------------*/
 
+/*
+ * DOM sampler.  Each device is the only optoe on its mux segment, so
+ * one work per device is one per bus segment.  It only samples when it
+ * gets the device lock right away; if userspace is in the middle of an
+ * access, that sample is simply skipped.
+ */
+static void optoe_dom_sample(struct optoe_data *optoe)
+{
+	const struct optoe_dom_range *range = NULL;
+	struct optoe_dom_sample sample;
+	struct accton_tlm_value v = { .name = "offset" };
+	unsigned long flags;
+	ssize_t status;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(optoe_dom_ranges); i++) {
+		if (optoe_dom_ranges[i].dev_class == optoe->dev_class) {
+			range = &optoe_dom_ranges[i];
+			break;
+		}
+	}
+	if (!range)
+		return;
+
+	memset(&sample, 0, sizeof(sample));
+	status = optoe_eeprom_update_client(optoe, sample.data,
+			range->start, range->len, OPTOE_READ_OP);
+	if (status != range->len) {
+		/* empty cage or unhappy module, leave the ring alone */
+		if (status < 0)
+			optoe_cache_invalidate(optoe);
+		return;
+	}
+
+	sample.timestamp_ns = ktime_to_ns(ktime_get());
+	sample.offset = range->start & 0x7f;
+	sample.len = range->len;
+
+	spin_lock_irqsave(&optoe->dom_lock, flags);
+	sample.seq = ++optoe->dom_seq;
+	optoe->dom_ring[optoe->dom_head] = sample;
+	optoe->dom_head = (optoe->dom_head + 1) % OPTOE_DOM_RING_SIZE;
+	spin_unlock_irqrestore(&optoe->dom_lock, flags);
+
+	/* only sent when the bytes differ from the previous sample */
+	v.data = sample.offset;
+	accton_tlm_publish(optoe->tlm, &v, 1, sample.data, sample.len);
+}
+
+static void optoe_dom_work_handler(struct work_struct *work)
+{
+	struct optoe_data *optoe = container_of(to_delayed_work(work),
+					struct optoe_data, dom_work);
+	unsigned interval = ACCESS_ONCE(optoe->dom_sample_ms);
+
+	if (!interval)
+		return;
+
+	if (mutex_trylock(&optoe->lock)) {
+		optoe_dom_sample(optoe);
+		mutex_unlock(&optoe->lock);
+	}
+
+	schedule_delayed_work(&optoe->dom_work, msecs_to_jiffies(interval));
+}
+
+static ssize_t optoe_dom_bin_read(struct file *filp, struct kobject *kobj,
+		struct bin_attribute *attr,
+		char *buf, loff_t off, size_t count)
+{
+	struct i2c_client *client = to_i2c_client(container_of(kobj,
+				struct device, kobj));
+	struct optoe_data *optoe = i2c_get_clientdata(client);
+	struct optoe_dom_sample *ring;
+	unsigned long flags;
+	unsigned head;
+	size_t size = sizeof(optoe->dom_ring);
+
+	if (off >= size)
+		return 0;
+	if (off + count > size)
+		count = size - off;
+
+	ring = kmalloc(size, GFP_KERNEL);
+	if (!ring)
+		return -ENOMEM;
+
+	/* unroll the ring so the oldest sample comes first */
+	spin_lock_irqsave(&optoe->dom_lock, flags);
+	head = optoe->dom_head;
+	memcpy(ring, &optoe->dom_ring[head],
+		(OPTOE_DOM_RING_SIZE - head) * sizeof(*ring));
+	memcpy(&ring[OPTOE_DOM_RING_SIZE - head], optoe->dom_ring,
+		head * sizeof(*ring));
+	spin_unlock_irqrestore(&optoe->dom_lock, flags);
+
+	memcpy(buf, (char *)ring + off, count);
+	kfree(ring);
+
+	return count;
+}
+
+/*-------------------------------------------------------------------------*/
+
 static int optoe_remove(struct i2c_client *client)
 {
 	struct optoe_data *optoe;
 	int i;
 
 	optoe = i2c_get_clientdata(client);
+	optoe->dom_sample_ms = 0;
+	cancel_delayed_work_sync(&optoe->dom_work);
+
 	sysfs_remove_group(&client->dev.kobj, &optoe->attr_group);
+	sysfs_remove_bin_file(&client->dev.kobj, &optoe->dom_bin);
 	sysfs_remove_bin_file(&client->dev.kobj, &optoe->bin);
 
 	for (i = 1; i < optoe->num_addresses; i++)
@@ -805,6 +1677,8 @@ static int optoe_remove(struct i2c_client *client)
 	eeprom_device_unregister(optoe->eeprom_dev);
 #endif
 
+	accton_tlm_unregister(optoe->tlm);
+	i2c_stats_unregister(optoe->stats);
 	kfree(optoe->writebuf);
 	kfree(optoe);
 	return 0;
@@ -871,14 +1745,20 @@ static ssize_t set_dev_class(struct device *dev,
 
 	/*
 	 * dev_class is actually the number of sfp ports used, thus
-	 * legal values are "1" (QSFP class) and "2" (SFP class)
+	 * legal values are "1" (QSFP class) and "2" (SFP class),
+	 * plus "3" (CMIS class, one address like QSFP)
 	 */
 	if (sscanf(buf, "%d", &dev_class) != 1 ||
-		dev_class < 1 || dev_class > 2)
+		dev_class < 1 || dev_class > 3)
 		return -EINVAL;
 
 	mutex_lock(&optoe->lock);
+	/* a lock-free reader must not see the new class with the old cache */
+	down_write(&optoe->cache_sem);
 	optoe->dev_class = dev_class;
+	optoe->generation++;
+	up_write(&optoe->cache_sem);
+	optoe->cur_page = optoe->cur_bank = OPTOE_PAGE_UNKNOWN;
 	mutex_unlock(&optoe->lock);
 
 	return count;
@@ -887,14 +1767,259 @@ static ssize_t set_dev_class(struct device *dev,
 static DEVICE_ATTR(dev_class,  S_IRUGO | S_IWUSR,
 					show_dev_class, set_dev_class);
 
+static ssize_t show_cache_generation(struct device *dev,
+			struct device_attribute *dattr, char *buf)
+{
+	struct i2c_client *client = to_i2c_client(dev);
+	struct optoe_data *optoe = i2c_get_clientdata(client);
+	ssize_t count;
+
+	mutex_lock(&optoe->lock);
+	count = sprintf(buf, "%u\n", optoe->generation);
+	mutex_unlock(&optoe->lock);
+
+	return count;
+}
+
+/*
+ * Any write bumps the generation.  The platform code (or xcvrd) does
+ * this on a presence or reset transition of the port.
+ */
+static ssize_t set_cache_generation(struct device *dev,
+			struct device_attribute *attr,
+			const char *buf, size_t count)
+{
+	struct i2c_client *client = to_i2c_client(dev);
+	struct optoe_data *optoe = i2c_get_clientdata(client);
+
+	mutex_lock(&optoe->lock);
+	optoe_cache_invalidate(optoe);
+	mutex_unlock(&optoe->lock);
+
+	return count;
+}
+
+static DEVICE_ATTR(cache_generation,  S_IRUGO | S_IWUSR,
+			show_cache_generation, set_cache_generation);
+
+static ssize_t show_cache_ttl_ms(struct device *dev,
+			struct device_attribute *dattr, char *buf)
+{
+	struct i2c_client *client = to_i2c_client(dev);
+	struct optoe_data *optoe = i2c_get_clientdata(client);
+	ssize_t count;
+
+	mutex_lock(&optoe->lock);
+	count = sprintf(buf, "%u\n", optoe->cache_ttl_ms);
+	mutex_unlock(&optoe->lock);
+
+	return count;
+}
+
+static ssize_t set_cache_ttl_ms(struct device *dev,
+			struct device_attribute *attr,
+			const char *buf, size_t count)
+{
+	struct i2c_client *client = to_i2c_client(dev);
+	struct optoe_data *optoe = i2c_get_clientdata(client);
+	unsigned ttl;
+
+	if (kstrtouint(buf, 10, &ttl))
+		return -EINVAL;
+
+	mutex_lock(&optoe->lock);
+	optoe->cache_ttl_ms = ttl;
+	mutex_unlock(&optoe->lock);
+
+	return count;
+}
+
+static DEVICE_ATTR(cache_ttl_ms,  S_IRUGO | S_IWUSR,
+			show_cache_ttl_ms, set_cache_ttl_ms);
+
+static ssize_t show_lazy_page_restore(struct device *dev,
+			struct device_attribute *dattr, char *buf)
+{
+	struct i2c_client *client = to_i2c_client(dev);
+	struct optoe_data *optoe = i2c_get_clientdata(client);
+	ssize_t count;
+
+	mutex_lock(&optoe->lock);
+	count = sprintf(buf, "%d\n", optoe->lazy_page_restore);
+	mutex_unlock(&optoe->lock);
+
+	return count;
+}
+
+/*
+ * "1" leaves the module on the last page used.  Only safe when nothing
+ * else (another I2C master, a tool poking the module directly) relies
+ * on the module sitting on page 0.
+ */
+static ssize_t set_lazy_page_restore(struct device *dev,
+			struct device_attribute *attr,
+			const char *buf, size_t count)
+{
+	struct i2c_client *client = to_i2c_client(dev);
+	struct optoe_data *optoe = i2c_get_clientdata(client);
+	int lazy;
+
+	if (sscanf(buf, "%d", &lazy) != 1 || lazy < 0 || lazy > 1)
+		return -EINVAL;
+
+	mutex_lock(&optoe->lock);
+	optoe->lazy_page_restore = lazy;
+	if (!lazy)
+		optoe_restore_page(optoe);
+	mutex_unlock(&optoe->lock);
+
+	return count;
+}
+
+static DEVICE_ATTR(lazy_page_restore,  S_IRUGO | S_IWUSR,
+			show_lazy_page_restore, set_lazy_page_restore);
+
+static ssize_t show_write_max(struct device *dev,
+			struct device_attribute *dattr, char *buf)
+{
+	struct i2c_client *client = to_i2c_client(dev);
+	struct optoe_data *optoe = i2c_get_clientdata(client);
+	ssize_t count;
+
+	mutex_lock(&optoe->lock);
+	count = sprintf(buf, "%u\n", optoe->write_max);
+	mutex_unlock(&optoe->lock);
+
+	return count;
+}
+
+/*
+ * Largest single write transaction, a power of two up to a page.
+ * Raising it from 1 lets bulk writes (firmware download, password and
+ * configuration blocks) go out several bytes per transaction.
+ */
+static ssize_t set_write_max(struct device *dev,
+			struct device_attribute *attr,
+			const char *buf, size_t count)
+{
+	struct i2c_client *client = to_i2c_client(dev);
+	struct optoe_data *optoe = i2c_get_clientdata(client);
+	unsigned write_max;
+
+	if (!optoe->writebuf)
+		return -EPERM;
+
+	if (kstrtouint(buf, 10, &write_max) ||
+	    !is_power_of_2(write_max) || write_max > optoe->write_limit)
+		return -EINVAL;
+
+	mutex_lock(&optoe->lock);
+	optoe->write_max = write_max;
+	mutex_unlock(&optoe->lock);
+
+	return count;
+}
+
+static DEVICE_ATTR(write_max,  S_IRUGO | S_IWUSR,
+			show_write_max, set_write_max);
+
+static ssize_t show_write_poll_us(struct device *dev,
+			struct device_attribute *dattr, char *buf)
+{
+	struct i2c_client *client = to_i2c_client(dev);
+	struct optoe_data *optoe = i2c_get_clientdata(client);
+	ssize_t count;
+
+	mutex_lock(&optoe->lock);
+	count = sprintf(buf, "%u\n", optoe->write_poll_us);
+	mutex_unlock(&optoe->lock);
+
+	return count;
+}
+
+static ssize_t set_write_poll_us(struct device *dev,
+			struct device_attribute *attr,
+			const char *buf, size_t count)
+{
+	struct i2c_client *client = to_i2c_client(dev);
+	struct optoe_data *optoe = i2c_get_clientdata(client);
+	unsigned poll_us;
+
+	/* usleep_range() below 10 usec is pointless */
+	if (kstrtouint(buf, 10, &poll_us) || poll_us < 10 ||
+	    poll_us > write_timeout * USEC_PER_MSEC)
+		return -EINVAL;
+
+	mutex_lock(&optoe->lock);
+	optoe->write_poll_us = poll_us;
+	mutex_unlock(&optoe->lock);
+
+	return count;
+}
+
+static DEVICE_ATTR(write_poll_us,  S_IRUGO | S_IWUSR,
+			show_write_poll_us, set_write_poll_us);
+
+static ssize_t show_dom_sample_ms(struct device *dev,
+			struct device_attribute *dattr, char *buf)
+{
+	struct i2c_client *client = to_i2c_client(dev);
+	struct optoe_data *optoe = i2c_get_clientdata(client);
+
+	return sprintf(buf, "%u\n", ACCESS_ONCE(optoe->dom_sample_ms));
+}
+
+/*
+ * Sampling period in msec, 0 stops the sampler.  Anything faster than
+ * OPTOE_DOM_MIN_INTERVAL would mostly measure the module's own update
+ * rate and eat into the bus time left for xcvrd.
+ */
+static ssize_t set_dom_sample_ms(struct device *dev,
+			struct device_attribute *attr,
+			const char *buf, size_t count)
+{
+	struct i2c_client *client = to_i2c_client(dev);
+	struct optoe_data *optoe = i2c_get_clientdata(client);
+	unsigned interval;
+
+	if (kstrtouint(buf, 10, &interval))
+		return -EINVAL;
+	if (interval && interval < OPTOE_DOM_MIN_INTERVAL)
+		interval = OPTOE_DOM_MIN_INTERVAL;
+
+	/* not under optoe->lock, the work takes it (trylock) itself */
+	optoe->dom_sample_ms = 0;
+	cancel_delayed_work_sync(&optoe->dom_work);
+	optoe->dom_sample_ms = interval;
+	if (interval)
+		schedule_delayed_work(&optoe->dom_work, 0);
+
+	return count;
+}
+
+static DEVICE_ATTR(dom_sample_ms,  S_IRUGO | S_IWUSR,
+			show_dom_sample_ms, set_dom_sample_ms);
+
 static struct attribute *optoe_attrs[] = {
 	&dev_attr_port_name.attr,
 	&dev_attr_dev_class.attr,
+	&dev_attr_cache_generation.attr,
+	&dev_attr_cache_ttl_ms.attr,
+	&dev_attr_lazy_page_restore.attr,
+	&dev_attr_write_max.attr,
+	&dev_attr_write_poll_us.attr,
+	&dev_attr_dom_sample_ms.attr,
+	NULL,
+};
+
+static struct bin_attribute *optoe_bin_attrs[] = {
+	&optoe_cache_image_attr,
 	NULL,
 };
 
 static struct attribute_group optoe_attr_group = {
 	.attrs = optoe_attrs,
+	.bin_attrs = optoe_bin_attrs,
 };
 
 static int optoe_probe(struct i2c_client *client,
@@ -963,6 +2088,9 @@ static int optoe_probe(struct i2c_client *client,
 	}
 
 	mutex_init(&optoe->lock);
+	init_rwsem(&optoe->cache_sem);
+	spin_lock_init(&optoe->dom_lock);
+	INIT_DELAYED_WORK(&optoe->dom_work, optoe_dom_work_handler);
 
 	/* determine whether this is a one-address or two-address module */
 	if ((strcmp(client->name, "optoe1") == 0) || 
@@ -976,15 +2104,26 @@ static int optoe_probe(struct i2c_client *client,
 		/* SFP family */
 		optoe->dev_class = TWO_ADDR;
 		chip.byte_len = TWO_ADDR_EEPROM_SIZE;
-	} else {     /* those were the only two choices */
+	} else if (strcmp(client->name, "optoe3") == 0) {
+		/* CMIS family */
+		optoe->dev_class = CMIS_ADDR;
+		chip.byte_len = CMIS_EEPROM_SIZE;
+		num_addresses = 1;
+	} else {     /* those were the only choices */
 		err = -EINVAL;
 		goto exit;
 	}
 
 	dev_dbg(&client->dev, "dev_class: %d\n", optoe->dev_class);
 	optoe->use_smbus = use_smbus;
+	optoe->combined_select = !use_smbus;
 	optoe->chip = chip;
 	optoe->num_addresses = num_addresses;
+	optoe->cache_ttl_ms = cache_ttl_ms;
+	optoe->write_poll_us = write_poll_us;
+	/* modules power up on page 0, and we always leave them there */
+	optoe->cur_page = 0;
+	optoe->cur_bank = 0;
 	strcpy(optoe->port_name, "unitialized");
 
 	/*
@@ -999,6 +2138,12 @@ static int optoe_probe(struct i2c_client *client,
 
 	optoe->macc.read = optoe_macc_read;
 
+	sysfs_bin_attr_init(&optoe->dom_bin);
+	optoe->dom_bin.attr.name = "dom_samples";
+	optoe->dom_bin.attr.mode = S_IRUGO;
+	optoe->dom_bin.read = optoe_dom_bin_read;
+	optoe->dom_bin.size = sizeof(optoe->dom_ring);
+
 	if (!use_smbus ||
 			(i2c_check_functionality(client->adapter,
 				I2C_FUNC_SMBUS_WRITE_I2C_BLOCK)) ||
@@ -1014,20 +2159,26 @@ static int optoe_probe(struct i2c_client *client,
 		 * Application Note AN-2071.
 		 */
 		unsigned write_max = 1;
+		unsigned write_limit = io_limit;
 
 		optoe->macc.write = optoe_macc_write;
 
 		optoe->bin.write = optoe_bin_write;
 		optoe->bin.attr.mode |= S_IWUSR;
 
-		if (write_max > io_limit)
-			write_max = io_limit;
-		if (use_smbus && write_max > I2C_SMBUS_BLOCK_MAX)
-			write_max = I2C_SMBUS_BLOCK_MAX;
+		/*
+		 * Modules known to take larger sequential writes can be
+		 * switched up to write_limit through the write_max attribute.
+		 */
+		if (use_smbus && write_limit > I2C_SMBUS_BLOCK_MAX)
+			write_limit = I2C_SMBUS_BLOCK_MAX;
+		if (write_max > write_limit)
+			write_max = write_limit;
 		optoe->write_max = write_max;
+		optoe->write_limit = write_limit;
 
 		/* buffer (data + address at the beginning) */
-		optoe->writebuf = kmalloc(write_max + 2, GFP_KERNEL);
+		optoe->writebuf = kmalloc(write_limit + 2, GFP_KERNEL);
 		if (!optoe->writebuf) {
 			err = -ENOMEM;
 			goto exit_kfree;
@@ -1038,6 +2189,9 @@ static int optoe_probe(struct i2c_client *client,
 	}
 
 	optoe->client[0] = client;
+	optoe->stats = i2c_stats_register(&client->dev);
+	optoe->tlm = accton_tlm_register(&client->dev, ACCTON_TLM_KIND_DOM);
+	i2c_stats_set_class(optoe->stats, I2C_SCHED_BULK);
 
 	/* use a dummy I2C device for two-address chips */
 	for (i = 1; i < num_addresses; i++) {
@@ -1056,11 +2210,19 @@ static int optoe_probe(struct i2c_client *client,
 	if (err)
 		goto err_struct;
 
+	err = sysfs_create_bin_file(&client->dev.kobj, &optoe->dom_bin);
+	if (err) {
+		sysfs_remove_bin_file(&client->dev.kobj, &optoe->bin);
+		goto err_struct;
+	}
+
 	optoe->attr_group = optoe_attr_group;
 
 	err = sysfs_create_group(&client->dev.kobj, &optoe->attr_group);
 	if (err) {
 		dev_err(&client->dev, "failed to create sysfs attribute group.\n");
+		sysfs_remove_bin_file(&client->dev.kobj, &optoe->dom_bin);
+		sysfs_remove_bin_file(&client->dev.kobj, &optoe->bin);
 		goto err_struct;
 	}
 #ifdef EEPROM_CLASS
@@ -1094,6 +2256,7 @@ static int optoe_probe(struct i2c_client *client,
 #ifdef EEPROM_CLASS
 err_sysfs_cleanup:
 	sysfs_remove_group(&client->dev.kobj, &optoe->attr_group);
+	sysfs_remove_bin_file(&client->dev.kobj, &optoe->dom_bin);
 	sysfs_remove_bin_file(&client->dev.kobj, &optoe->bin);
 #endif
 
@@ -1103,6 +2266,8 @@ err_struct:
 			i2c_unregister_device(optoe->client[i]);
 	}
 
+	accton_tlm_unregister(optoe->tlm);
+	i2c_stats_unregister(optoe->stats);
 	kfree(optoe->writebuf);
 exit_kfree:
 	kfree(optoe);
@@ -107,6 +107,10 @@ class accton_as7716_monitor(object):
 
         logging.debug('SET. logfile:%s / loglevel:%d', log_file, log_level)
 
+        # kept across cycles, their sysfs nodes stay open
+        self.thermal = ThermalUtil()
+        self.fan = FanUtil()
+
     def manage_fans(self):
         
         fan_policy_f2b = {
@@ -122,8 +126,8 @@ class accton_as7716_monitor(object):
            3: [69, 15500, 0],
         }
   
-        thermal = ThermalUtil()
-        fan = FanUtil()
+        thermal = self.thermal
+        fan = self.fan
         get_temp = thermal.get_thermal_temp()            
         
         cur_duty_cycle = fan.get_fan_duty_cycle()
@@ -38,6 +38,22 @@
 #define THERMAL_SENSORS_DRIVER     "lm75"
 #define STRING_TO_DEC_VALUE		10
 
+/*
+ * BMC OEM command for the fans: 4 bytes per fan, low nibble of the first
+ * one 0 if present, front rpm little endian in the third and fourth.
+ * The rear rpm of fan N follows at 26 + 4 * N.
+ */
+#define IPMI_FAN_CMD            0x14
+#define IPMI_FAN_RESP_LEN       48
+#define IPMI_FAN_REAR_OFFSET    26
+
+extern int as7716_32xb_ipmi_cached(u8 cmd, const u8 *req, int req_len, u8 *resp, int resp_max);
+
+/* Read the values from the BMC here instead of having drv_handler push them */
+static bool ipmi_fetch = 1;
+module_param(ipmi_fetch, bool, S_IRUGO);
+MODULE_PARM_DESC(ipmi_fetch, "Fetch the fan status and speeds over IPMI (default 1)");
+
 #define		IN
 #define		OUT
 
@@ -756,6 +772,32 @@ static ssize_t fan_value_store(struct device *dev, struct device_attribute *da,
     mutex_unlock(&data->update_lock);    
     return size;
 }
+/* Called with data->update_lock held */
+static int as7716_32xb_fan_ipmi_update(struct as7716_32xb_fan_data *data)
+{
+    u8 resp[IPMI_FAN_RESP_LEN];
+    int i, status;
+
+    status = as7716_32xb_ipmi_cached(IPMI_FAN_CMD, NULL, 0, resp, sizeof(resp));
+    if (status < 0) {
+        return status;
+    }
+    if (status < IPMI_FAN_RESP_LEN) {
+        return -EIO;
+    }
+
+    for (i = 0; i < FAN_NUM_MAX; i++) {
+        u8 *front = &resp[i * 4];
+        u8 *rear  = &resp[IPMI_FAN_REAR_OFFSET + i * 4];
+
+        data->present[i] = !(front[0] & 0xf);
+        data->front_speed_rpm[i] = front[2] | (front[3] << 8);
+        data->rear_speed_rpm[i]  = rear[0] | (rear[1] << 8);
+    }
+
+    return 0;
+}
+
 static ssize_t fan_value_show(struct device *dev, struct device_attribute *da,
              char *buf)
 {
@@ -767,6 +809,14 @@ static ssize_t fan_value_show(struct device *dev, struct device_attribute *da,
     //printk("ffan_value_show\n");
     //printk("attr->index=%d\n", attr->index);
     mutex_lock(&data->update_lock);
+    if (ipmi_fetch && attr->index != FAN_DUTY_CYCLE_PERCENTAGE) {
+        status = as7716_32xb_fan_ipmi_update(data);
+        if (status < 0) {
+            mutex_unlock(&data->update_lock);
+            return status;
+        }
+        status = -EINVAL;
+    }
     switch (attr->index)
     {
         case FAN_DUTY_CYCLE_PERCENTAGE:
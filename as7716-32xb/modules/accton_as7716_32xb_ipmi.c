@@ -0,0 +1,350 @@
+/*
+ * IPMI client for the Accton as7716 32xb
+ *
+ * Copyright (C) 2018 Accton Technology Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+/*
+ * On the as7716-32xb the BMC owns the QSFP, thermal, fan and PSU buses
+ * and serves them through OEM raw commands (netfn 0x34), the same ones
+ * the drv_handler issues with ipmitool.  This module holds one kernel
+ * IPMI user on the first system interface and runs those commands for
+ * the other as7716_32xb drivers, one at a time.
+ *
+ * Sensor requests go through as7716_32xb_ipmi_cached(): the last answer
+ * to each distinct request is kept for cache_ttl_ms, so every attribute
+ * of a fan or PSU read in one go costs a single round trip to the BMC.
+ */
+
+#include <linux/module.h>
+#include <linux/jiffies.h>
+#include <linux/err.h>
+#include <linux/mutex.h>
+#include <linux/spinlock.h>
+#include <linux/completion.h>
+#include <linux/slab.h>
+#include <linux/ipmi.h>
+
+#define DRVNAME "as7716_32xb_ipmi"
+
+#define IPMI_NETFN_OEM          0x34
+#define IPMI_TIMEOUT            (2 * HZ)
+#define IPMI_MAX_RETRIES        1
+#define IPMI_RETRY_TIME_MS      500
+#define IPMI_CACHE_ENTRIES      8
+#define IPMI_CACHE_REQ_MAX      4
+
+struct as7716_32xb_ipmi_cache {
+    char            valid;
+    u8              cmd;
+    u8              req[IPMI_CACHE_REQ_MAX];
+    int             req_len;
+    unsigned long   last_updated;   /* In jiffies */
+    int             len;
+    unsigned char   data[IPMI_MAX_MSG_LENGTH];
+};
+
+struct as7716_32xb_ipmi_data {
+    struct mutex        lock;       /* one request in flight, protects user */
+    ipmi_user_t         user;
+    int                 if_num;
+    struct completion   done;
+
+    spinlock_t          rx_lock;    /* the receive handler may run in irq context */
+    long                msgid;      /* of the request being waited for */
+    long                rx_msgid;   /* of the answer in rx_* */
+    int                 rx_result;
+    int                 rx_len;
+    unsigned char       rx_data[IPMI_MAX_MSG_LENGTH];
+
+    struct as7716_32xb_ipmi_cache cache[IPMI_CACHE_ENTRIES];    /* under lock */
+    int                 cache_next;     /* entry to recycle */
+};
+
+static unsigned int cache_ttl_ms = 1000;
+module_param(cache_ttl_ms, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(cache_ttl_ms, "How long a sensor answer is reused, in ms (default 1000)");
+
+static struct as7716_32xb_ipmi_data *ipmi_data;
+
+static void as7716_32xb_ipmi_msg_handler(struct ipmi_recv_msg *msg, void *user_msg_data)
+{
+    struct as7716_32xb_ipmi_data *data = user_msg_data;
+    unsigned long flags;
+
+    spin_lock_irqsave(&data->rx_lock, flags);
+    if (msg->msgid != data->msgid) {
+        /* answer to a request that already timed out */
+        spin_unlock_irqrestore(&data->rx_lock, flags);
+        ipmi_free_recv_msg(msg);
+        return;
+    }
+
+    if (msg->recv_type != IPMI_RESPONSE_RECV_TYPE || msg->msg.data_len < 1) {
+        data->rx_result = -EIO;
+        data->rx_len = 0;
+    }
+    else if (msg->msg.data[0] != 0) {
+        /* completion code */
+        data->rx_result = -EIO;
+        data->rx_len = 0;
+    }
+    else {
+        data->rx_result = 0;
+        data->rx_len = msg->msg.data_len - 1;
+        memcpy(data->rx_data, msg->msg.data + 1, data->rx_len);
+    }
+    data->rx_msgid = msg->msgid;
+
+    /* under rx_lock, so it cannot land after the next reinit_completion() */
+    complete(&data->done);
+    spin_unlock_irqrestore(&data->rx_lock, flags);
+
+    ipmi_free_recv_msg(msg);
+}
+
+static struct ipmi_user_hndl as7716_32xb_ipmi_hndl = {
+    .ipmi_recv_hndl = as7716_32xb_ipmi_msg_handler,
+};
+
+/* Called with data->lock held */
+static int __as7716_32xb_ipmi_raw(struct as7716_32xb_ipmi_data *data, u8 cmd,
+                                  const u8 *req, int req_len, u8 *resp, int resp_max)
+{
+    struct ipmi_system_interface_addr addr;
+    struct kernel_ipmi_msg msg;
+    unsigned char tx_data[IPMI_MAX_MSG_LENGTH];
+    unsigned long flags;
+    long msgid;
+    int status;
+
+    if (req_len < 0 || req_len > sizeof(tx_data)) {
+        return -EINVAL;
+    }
+    if (!data->user) {
+        return -ENODEV;
+    }
+
+    addr.addr_type = IPMI_SYSTEM_INTERFACE_ADDR_TYPE;
+    addr.channel   = IPMI_BMC_CHANNEL;
+    addr.lun       = 0;
+
+    memcpy(tx_data, req, req_len);
+    msg.netfn    = IPMI_NETFN_OEM;
+    msg.cmd      = cmd;
+    msg.data     = tx_data;
+    msg.data_len = req_len;
+
+    spin_lock_irqsave(&data->rx_lock, flags);
+    msgid = ++data->msgid;
+    reinit_completion(&data->done);
+    spin_unlock_irqrestore(&data->rx_lock, flags);
+
+    status = ipmi_request_settime(data->user, (struct ipmi_addr *)&addr,
+                                  msgid, &msg, data, 0,
+                                  IPMI_MAX_RETRIES, IPMI_RETRY_TIME_MS);
+    if (status) {
+        spin_lock_irqsave(&data->rx_lock, flags);
+        data->msgid++;
+        spin_unlock_irqrestore(&data->rx_lock, flags);
+        return status;
+    }
+
+    wait_for_completion_timeout(&data->done, IPMI_TIMEOUT);
+
+    spin_lock_irqsave(&data->rx_lock, flags);
+    /* rx_* may still hold the answer to an earlier request */
+    status = (data->rx_msgid == msgid) ? data->rx_result : -ETIMEDOUT;
+    if (status == 0) {
+        status = min_t(int, data->rx_len, resp_max);
+        memcpy(resp, data->rx_data, status);
+    }
+    /* a late answer to this request is dropped by the handler */
+    data->msgid++;
+    spin_unlock_irqrestore(&data->rx_lock, flags);
+
+    return status;
+}
+
+/*
+ * Run OEM command 'cmd' with 'req_len' bytes of request data and copy
+ * up to 'resp_max' bytes of the response, completion code stripped.
+ * Returns the number of bytes copied or a negative errno.
+ */
+int as7716_32xb_ipmi_raw(u8 cmd, const u8 *req, int req_len, u8 *resp, int resp_max)
+{
+    struct as7716_32xb_ipmi_data *data = ipmi_data;
+    int status;
+
+    if (!data) {
+        return -ENODEV;
+    }
+
+    mutex_lock(&data->lock);
+    status = __as7716_32xb_ipmi_raw(data, cmd, req, req_len, resp, resp_max);
+    mutex_unlock(&data->lock);
+
+    return status;
+}
+EXPORT_SYMBOL(as7716_32xb_ipmi_raw);
+
+/*
+ * Same as as7716_32xb_ipmi_raw(), but an answer to the same request that
+ * is younger than cache_ttl_ms is returned without asking the BMC again.
+ * Failed requests are not cached.
+ */
+int as7716_32xb_ipmi_cached(u8 cmd, const u8 *req, int req_len, u8 *resp, int resp_max)
+{
+    struct as7716_32xb_ipmi_data *data = ipmi_data;
+    struct as7716_32xb_ipmi_cache *entry = NULL;
+    int i, status;
+
+    if (!data) {
+        return -ENODEV;
+    }
+    if (req_len < 0 || req_len > IPMI_CACHE_REQ_MAX) {
+        return as7716_32xb_ipmi_raw(cmd, req, req_len, resp, resp_max);
+    }
+
+    mutex_lock(&data->lock);
+    for (i = 0; i < IPMI_CACHE_ENTRIES; i++) {
+        struct as7716_32xb_ipmi_cache *c = &data->cache[i];
+
+        if (c->valid && c->cmd == cmd && c->req_len == req_len &&
+            !memcmp(c->req, req, req_len)) {
+            entry = c;
+            break;
+        }
+    }
+
+    if (entry && !time_after(jiffies, entry->last_updated + msecs_to_jiffies(cache_ttl_ms))) {
+        status = min_t(int, entry->len, resp_max);
+        memcpy(resp, entry->data, status);
+        goto exit;
+    }
+
+    if (!entry) {
+        entry = &data->cache[data->cache_next];
+        data->cache_next = (data->cache_next + 1) % IPMI_CACHE_ENTRIES;
+    }
+
+    entry->valid = 0;
+    status = __as7716_32xb_ipmi_raw(data, cmd, req, req_len,
+                                    entry->data, sizeof(entry->data));
+    if (status < 0) {
+        goto exit;
+    }
+
+    entry->cmd = cmd;
+    memcpy(entry->req, req, req_len);
+    entry->req_len = req_len;
+    entry->len = status;
+    entry->last_updated = jiffies;
+    entry->valid = 1;
+
+    status = min_t(int, entry->len, resp_max);
+    memcpy(resp, entry->data, status);
+
+exit:
+    mutex_unlock(&data->lock);
+    return status;
+}
+EXPORT_SYMBOL(as7716_32xb_ipmi_cached);
+
+static void as7716_32xb_ipmi_new_smi(int if_num, struct device *dev)
+{
+    struct as7716_32xb_ipmi_data *data = ipmi_data;
+    int status;
+
+    mutex_lock(&data->lock);
+    if (data->user) {
+        /* already bound to the first interface */
+        goto exit;
+    }
+
+    status = ipmi_create_user(if_num, &as7716_32xb_ipmi_hndl, data, &data->user);
+    if (status) {
+        data->user = NULL;
+        pr_err(DRVNAME ": unable to create IPMI user on interface %d (%d)\n",
+               if_num, status);
+        goto exit;
+    }
+    data->if_num = if_num;
+
+exit:
+    mutex_unlock(&data->lock);
+}
+
+static void as7716_32xb_ipmi_smi_gone(int if_num)
+{
+    struct as7716_32xb_ipmi_data *data = ipmi_data;
+
+    mutex_lock(&data->lock);
+    if (data->user && data->if_num == if_num) {
+        ipmi_destroy_user(data->user);
+        data->user = NULL;
+    }
+    mutex_unlock(&data->lock);
+}
+
+static struct ipmi_smi_watcher as7716_32xb_ipmi_watcher = {
+    .owner    = THIS_MODULE,
+    .new_smi  = as7716_32xb_ipmi_new_smi,
+    .smi_gone = as7716_32xb_ipmi_smi_gone,
+};
+
+static int __init as7716_32xb_ipmi_init(void)
+{
+    int status;
+
+    ipmi_data = kzalloc(sizeof(struct as7716_32xb_ipmi_data), GFP_KERNEL);
+    if (!ipmi_data) {
+        return -ENOMEM;
+    }
+    mutex_init(&ipmi_data->lock);
+    spin_lock_init(&ipmi_data->rx_lock);
+    init_completion(&ipmi_data->done);
+
+    status = ipmi_smi_watcher_register(&as7716_32xb_ipmi_watcher);
+    if (status) {
+        kfree(ipmi_data);
+        ipmi_data = NULL;
+    }
+
+    return status;
+}
+
+static void __exit as7716_32xb_ipmi_exit(void)
+{
+    ipmi_smi_watcher_unregister(&as7716_32xb_ipmi_watcher);
+
+    mutex_lock(&ipmi_data->lock);
+    if (ipmi_data->user) {
+        ipmi_destroy_user(ipmi_data->user);
+        ipmi_data->user = NULL;
+    }
+    mutex_unlock(&ipmi_data->lock);
+
+    kfree(ipmi_data);
+    ipmi_data = NULL;
+}
+
+module_init(as7716_32xb_ipmi_init);
+module_exit(as7716_32xb_ipmi_exit);
+
+MODULE_DESCRIPTION("as7716_32xb IPMI client");
+MODULE_LICENSE("GPL");
@@ -11,7 +11,32 @@
 #include <linux/dmi.h>
 
 #define STRING_TO_DEC_VALUE		10
-#define EEPROM_DATA_SIZE   		512
+#define EEPROM_PAGE_SIZE   		128
+#define EEPROM_PAGE_NUM    		2       /* lower page and upper page 0 */
+#define EEPROM_DATA_SIZE   		(EEPROM_PAGE_SIZE * EEPROM_PAGE_NUM)
+#define EEPROM_NAME        		"eeprom"
+#define QSFP_PORT_NUM      		32
+
+/* BMC OEM command for QSFP presence (all ports) and EEPROM pages */
+#define IPMI_QSFP_CMD      		0x10
+#define IPMI_QSFP_PRESENT  		0x10
+#define QSFP_PRESENT_TTL   		(HZ)
+#define QSFP_DOM_TTL       		(HZ)    /* the lower page holds the monitors */
+
+extern int as7716_32xb_ipmi_raw(u8 cmd, const u8 *req, int req_len, u8 *resp, int resp_max);
+
+/* Read the EEPROMs from the BMC here instead of having drv_handler push them */
+static bool ipmi_fetch = 1;
+module_param(ipmi_fetch, bool, S_IRUGO);
+MODULE_PARM_DESC(ipmi_fetch, "Fetch QSFP EEPROMs over IPMI (default 1)");
+
+/* One presence answer covers every port, shared by all the clients */
+static struct {
+    struct mutex   lock;
+    char           valid;
+    unsigned long  last_updated;    /* In jiffies */
+    u8             present[QSFP_PORT_NUM];
+} qsfp_present;
 
 
 /* Addresses scanned 
@@ -23,10 +48,14 @@ static const unsigned short normal_i2c[] = { I2C_CLIENT_END };
 struct as7716_32xb_oom_data {
     struct device  *hwmon_dev;
     struct mutex   lock;
+    struct bin_attribute eeprom_attr;
     u8  index;
+    u8             port;            /* 1 based */
     unsigned char  eeprom[EEPROM_DATA_SIZE];
     char           port_name[MAX_PORT_NAME_LEN];
-   
+    int            present;         /* -1 until known */
+    char           page_valid[EEPROM_PAGE_NUM];
+    unsigned long  page_updated[EEPROM_PAGE_NUM];   /* In jiffies */
 };
 
 
@@ -40,97 +69,158 @@ enum as7716_32xb_oom_sysfs_attributes {
 /* sysfs attributes for hwmon 
  */
 
-static ssize_t oom_info_store(struct device *dev, struct device_attribute *da,
-			const char *buf, size_t count);
-static ssize_t oom_info_show(struct device *dev, struct device_attribute *da,
-             char *buf);
 static ssize_t show_port_name(struct device *dev,
 			struct device_attribute *dattr, char *buf);
 static ssize_t set_port_name(struct device *dev,
 			struct device_attribute *attr,
 			const char *buf, size_t count);             
-static SENSOR_DEVICE_ATTR(eeprom,  S_IWUSR|S_IRUGO, oom_info_show, oom_info_store, 0);
 static SENSOR_DEVICE_ATTR(port_name,  S_IRUGO | S_IWUSR, show_port_name, set_port_name, 1);
 
 
 static struct attribute *as7716_32xb_oom_attributes[] = {
-    &sensor_dev_attr_eeprom.dev_attr.attr,
     &sensor_dev_attr_port_name.dev_attr.attr,
     NULL
 };
 
 
-static ssize_t oom_info_show(struct device *dev, struct device_attribute *da,
-             char *buf)
+static int as7716_32xb_oom_port_present(u8 port)
+{
+    int status = 0;
+
+    mutex_lock(&qsfp_present.lock);
+    if (time_after(jiffies, qsfp_present.last_updated + QSFP_PRESENT_TTL) ||
+        !qsfp_present.valid) {
+        u8 req = IPMI_QSFP_PRESENT;
+
+        status = as7716_32xb_ipmi_raw(IPMI_QSFP_CMD, &req, 1,
+                                      qsfp_present.present, QSFP_PORT_NUM);
+        qsfp_present.valid = (status == QSFP_PORT_NUM);
+        qsfp_present.last_updated = jiffies;
+        if (status >= 0 && status != QSFP_PORT_NUM) {
+            status = -EIO;
+        }
+    }
+
+    if (qsfp_present.valid) {
+        status = (qsfp_present.present[port - 1] == 1);
+    }
+    mutex_unlock(&qsfp_present.lock);
+
+    return status;
+}
+
+/*
+ * Bring data->eeprom up to date from the BMC.  Upper page 0 is static
+ * and kept until the module is removed or replaced; the lower page has
+ * the DOM values and is refetched once it is older than QSFP_DOM_TTL.
+ * Called with data->lock held.
+ */
+static int as7716_32xb_oom_update(struct as7716_32xb_oom_data *data)
+{
+    int present, page, status;
+
+    present = as7716_32xb_oom_port_present(data->port);
+    if (present < 0) {
+        return present;
+    }
+
+    if (present != data->present) {
+        /* presence changed, nothing cached is valid anymore */
+        memset(data->eeprom, 0xFF, EEPROM_DATA_SIZE);
+        memset(data->page_valid, 0, sizeof(data->page_valid));
+        data->present = present;
+    }
+    if (!present) {
+        return 0;
+    }
+
+    for (page = 0; page < EEPROM_PAGE_NUM; page++) {
+        u8 req[2] = { data->port, page };
+
+        if (data->page_valid[page] &&
+            (page != 0 || !time_after(jiffies, data->page_updated[page] + QSFP_DOM_TTL))) {
+            continue;
+        }
+
+        status = as7716_32xb_ipmi_raw(IPMI_QSFP_CMD, req, sizeof(req),
+                                      data->eeprom + page * EEPROM_PAGE_SIZE,
+                                      EEPROM_PAGE_SIZE);
+        if (status != EEPROM_PAGE_SIZE) {
+            data->page_valid[page] = 0;
+            return (status < 0) ? status : -EIO;
+        }
+        data->page_valid[page] = 1;
+        data->page_updated[page] = jiffies;
+    }
+
+    return 0;
+}
+
+/*
+ * The eeprom file is the raw image, lower page first, and takes reads
+ * and writes at any offset.  drv_handler (or anything else bridging the
+ * BMC) may push just the bytes that changed, e.g. the DOM values.
+ */
+static ssize_t oom_bin_read(struct file *filp, struct kobject *kobj,
+		struct bin_attribute *attr,
+		char *buf, loff_t off, size_t count)
 {
-    struct i2c_client *client = to_i2c_client(dev);
+    struct i2c_client *client = to_i2c_client(container_of(kobj, struct device, kobj));
     struct as7716_32xb_oom_data *data = i2c_get_clientdata(client);
-    int i;    
-  
+    int status;
+
+    if (off >= EEPROM_DATA_SIZE) {
+        return 0;
+    }
+    if (off + count > EEPROM_DATA_SIZE) {
+        count = EEPROM_DATA_SIZE - off;
+    }
+
     mutex_lock(&data->lock);
-    memcpy(buf, data->eeprom, EEPROM_DATA_SIZE);
-    //for(i=0; i < EEPROM_DATA_SIZE ; i++)
-    //{ 
-    //    buf[i]=data->eeprom[i];
-     //   printk("buf[%d]=0x%x ",i, buf[i]);
-    //}
-    //status = EEPROM_DATA_SIZE+1;
-   
-    
-    memcpy(buf, data->eeprom, 256);
+    if (ipmi_fetch) {
+        status = as7716_32xb_oom_update(data);
+        if (status < 0) {
+            mutex_unlock(&data->lock);
+            return status;
+        }
+    }
+    memcpy(buf, data->eeprom + off, count);
     mutex_unlock(&data->lock);
-    
-    return 256;
+
+    return count;
 }
 
-static ssize_t oom_info_store(struct device *dev, struct device_attribute *da,
-			const char *buf, size_t size)
+static ssize_t oom_bin_write(struct file *filp, struct kobject *kobj,
+				struct bin_attribute *attr,
+				char *buf, loff_t off, size_t count)
 {
-    struct i2c_client *client = to_i2c_client(dev);
+    struct i2c_client *client = to_i2c_client(container_of(kobj, struct device, kobj));
     struct as7716_32xb_oom_data *data = i2c_get_clientdata(client);
-    int i=0, j=0, k=0;
-    unsigned char str[3];
-    unsigned int val;
-   
-   // printk("strlen(buf)=%d\n",strlen(buf));
-    k=0;
-    mutex_lock(&data->lock);  
-    memset(data->eeprom, 0xFF, EEPROM_DATA_SIZE);  
-    memset(str, 0x0, 3);
-    if(strlen(buf) >= 256 )
-    {
-        for(i=0; i < strlen(buf) ; i++)
-        {   
-           // printk("i=%d ", i);
-            for(j=0;j<2; j++)
-            {
-                str[j]=buf[i+j];
-            }
-            sscanf(str, "%x", &val);
-            //printk("str=%s val=0x%x ", str, val);
-            i=j+i-1;
-            if(k>=EEPROM_DATA_SIZE)
-            {
-                break;
-            }
-            data->eeprom[k]=(unsigned char)val;
-            //printk("data->eeprom[%d]=0x%x\n",k, data->eeprom[k]);
-            k++;
-        }
+
+    if (off >= EEPROM_DATA_SIZE) {
+        return -EFBIG;
     }
-    //printk("buf=\n");
-    //for(i=0; i < strlen(buf) ; i++)
-    //{
-       // printk("%c%c ", buf[i], buf[i+1]);
-       // if((i % 31)==0)
-         //   printk("\n");
-    //}
-    //printk("\n");
-   
-    
+    if (off + count > EEPROM_DATA_SIZE) {
+        count = EEPROM_DATA_SIZE - off;
+    }
+
+    mutex_lock(&data->lock);
+    memcpy(data->eeprom + off, buf, count);
     mutex_unlock(&data->lock);
-    return size;
 
+    return count;
+}
+
+static int oom_sysfs_eeprom_init(struct kobject *kobj, struct bin_attribute *eeprom)
+{
+    sysfs_bin_attr_init(eeprom);
+    eeprom->attr.name = EEPROM_NAME;
+    eeprom->attr.mode = S_IWUSR | S_IRUGO;
+    eeprom->read      = oom_bin_read;
+    eeprom->write     = oom_bin_write;
+    eeprom->size      = EEPROM_DATA_SIZE;
+
+    return sysfs_create_bin_file(kobj, eeprom);
 }
 			
 static ssize_t show_port_name(struct device *dev,
@@ -186,6 +276,14 @@ static int as7716_32xb_oom_probe(struct i2c_client *client,
     i2c_set_clientdata(client, data);
     data->index = dev_id->driver_data;
     mutex_init(&data->lock);
+    /* drv_handler instantiates port N at address 0xN, e.g. port 12 at 0x12 */
+    data->port    = (client->addr >> 4) * 10 + (client->addr & 0xf);
+    data->present = -1;
+    memset(data->eeprom, 0xFF, EEPROM_DATA_SIZE);
+    if (data->port < 1 || data->port > QSFP_PORT_NUM) {
+        status = -EINVAL;
+        goto exit_free;
+    }
 
     dev_info(&client->dev, "chip found\n");
 
@@ -195,10 +293,15 @@ static int as7716_32xb_oom_probe(struct i2c_client *client,
         goto exit_free;
     }
 
+    status = oom_sysfs_eeprom_init(&client->dev.kobj, &data->eeprom_attr);
+    if (status) {
+        goto exit_remove;
+    }
+
     data->hwmon_dev = hwmon_device_register(&client->dev);
     if (IS_ERR(data->hwmon_dev)) {
         status = PTR_ERR(data->hwmon_dev);
-        goto exit_remove;
+        goto exit_remove_eeprom;
     }
 
     dev_info(&client->dev, "%s: oom '%s'\n",
@@ -206,6 +309,8 @@ static int as7716_32xb_oom_probe(struct i2c_client *client,
     
     return 0;
 
+exit_remove_eeprom:
+    sysfs_remove_bin_file(&client->dev.kobj, &data->eeprom_attr);
 exit_remove:
     sysfs_remove_group(&client->dev.kobj, &as7716_32xb_oom_group);
 exit_free:
@@ -220,6 +325,7 @@ static int as7716_32xb_oom_remove(struct i2c_client *client)
     struct as7716_32xb_oom_data *data = i2c_get_clientdata(client);
 
     hwmon_device_unregister(data->hwmon_dev);
+    sysfs_remove_bin_file(&client->dev.kobj, &data->eeprom_attr);
     sysfs_remove_group(&client->dev.kobj, &as7716_32xb_oom_group);
     kfree(data);
     
@@ -251,6 +357,7 @@ static struct i2c_driver as7716_32xb_oom_driver = {
 
 static int __init as7716_32xb_oom_init(void)
 {
+    mutex_init(&qsfp_present.lock);
     return i2c_add_driver(&as7716_32xb_oom_driver);
 }
 
@@ -12,6 +12,26 @@
 
 #define STRING_TO_DEC_VALUE		10
 
+/*
+ * Same BMC OEM command as the psu driver: with power on (low nibble of
+ * byte 2 set) temperature, fan rpm and output power follow, little
+ * endian, from byte 13 on.
+ */
+#define IPMI_PSU_CMD            0x16
+#define IPMI_PSU_RESP_LEN       19
+#define IPMI_PSU_TEMP_OFFSET    13
+#define IPMI_PSU_FAN_OFFSET     15
+#define IPMI_PSU_POUT_OFFSET    17
+#define PSU1_PMBUS_ADDR         0x5b
+#define PSU2_PMBUS_ADDR         0x58
+
+extern int as7716_32xb_ipmi_cached(u8 cmd, const u8 *req, int req_len, u8 *resp, int resp_max);
+
+/* Read the values from the BMC here instead of having drv_handler push them */
+static bool ipmi_fetch = 1;
+module_param(ipmi_fetch, bool, S_IRUGO);
+MODULE_PARM_DESC(ipmi_fetch, "Fetch temperature, fan speed and output power over IPMI (default 1)");
+
 
 /* Addresses scanned 
  */
@@ -153,6 +173,44 @@ static struct attribute *as7716_32xb_pmbus_attributes[] = {
 };
 
 
+/* Called with data->update_lock held */
+static int as7716_32xb_pmbus_ipmi_update(struct i2c_client *client,
+                                         struct as7716_32xb_pmbus_data *data)
+{
+    u8 req, resp[IPMI_PSU_RESP_LEN];
+    int status;
+
+    if (client->addr == PSU1_PMBUS_ADDR) {
+        req = 1;
+    }
+    else if (client->addr == PSU2_PMBUS_ADDR) {
+        req = 2;
+    }
+    else {
+        return 0;
+    }
+
+    status = as7716_32xb_ipmi_cached(IPMI_PSU_CMD, &req, 1, resp, sizeof(resp));
+    if (status < 0) {
+        return status;
+    }
+    if (status < IPMI_PSU_RESP_LEN) {
+        return -EIO;
+    }
+
+    if ((resp[2] & 0xf) != 1) {
+        /* powered off, drv_handler reported 0 as well */
+        data->temp = 0;
+        data->fan_speed = 0;
+        data->p_out = 0;
+        return 0;
+    }
+    data->temp = (resp[IPMI_PSU_TEMP_OFFSET] | (resp[IPMI_PSU_TEMP_OFFSET + 1] << 8)) * 1000;
+    data->fan_speed = resp[IPMI_PSU_FAN_OFFSET] | (resp[IPMI_PSU_FAN_OFFSET + 1] << 8);
+    data->p_out = resp[IPMI_PSU_POUT_OFFSET] | (resp[IPMI_PSU_POUT_OFFSET + 1] << 8);
+    return 0;
+}
+
 static ssize_t pmbus_info_show(struct device *dev, struct device_attribute *da,
              char *buf)
 {
@@ -163,6 +221,22 @@ static ssize_t pmbus_info_show(struct device *dev, struct device_attribute *da,
     //printk("pmbus_info_show\n");
     printk("attr->index=%d\n", attr->index);
     mutex_lock(&data->update_lock);
+    switch (ipmi_fetch ? attr->index : -1)
+    {
+        case PSU_P_OUT:
+        case PSU_P_OUT_UV:
+        case PSU_TEMP1_INPUT:
+        case PSU_FAN1_SPEED:
+            status = as7716_32xb_pmbus_ipmi_update(client, data);
+            if (status < 0) {
+                mutex_unlock(&data->update_lock);
+                return status;
+            }
+            status = -EINVAL;
+            break;
+        default:
+            break;
+    }
     switch (attr->index)
     {
         case PSU_POWER_ON:
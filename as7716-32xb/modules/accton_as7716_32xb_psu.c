@@ -43,6 +43,20 @@
 static int as7716_32xb_psu_read_block(struct i2c_client *client, u8 command, u8 *data,int data_len);
 extern int as7716_32xb_cpld_read (unsigned short cpld_addr, u8 reg);
 
+/*
+ * BMC OEM command for a PSU (id 1 or 2): low nibble of byte 0 is 0 if
+ * present, low nibble of byte 2 is power good.
+ */
+#define IPMI_PSU_CMD            0x16
+#define IPMI_PSU_STATUS_LEN     3
+
+extern int as7716_32xb_ipmi_cached(u8 cmd, const u8 *req, int req_len, u8 *resp, int resp_max);
+
+/* Read the values from the BMC here instead of having drv_handler push them */
+static bool ipmi_fetch = 1;
+module_param(ipmi_fetch, bool, S_IRUGO);
+MODULE_PARM_DESC(ipmi_fetch, "Fetch present and power good over IPMI (default 1)");
+
 /* Addresses scanned 
  */
 static const unsigned short normal_i2c[] = { I2C_CLIENT_END };
@@ -89,6 +103,26 @@ static struct attribute *as7716_32xb_psu_attributes[] = {
     NULL
 };
 
+/* Called with data->update_lock held */
+static int as7716_32xb_psu_ipmi_update(struct as7716_32xb_psu_data *data)
+{
+    u8 req = data->index + 1;
+    u8 resp[IPMI_PSU_STATUS_LEN];
+    int status;
+
+    status = as7716_32xb_ipmi_cached(IPMI_PSU_CMD, &req, 1, resp, sizeof(resp));
+    if (status < 0) {
+        return status;
+    }
+    if (status < IPMI_PSU_STATUS_LEN) {
+        return -EIO;
+    }
+
+    data->present    = !(resp[0] & 0xf);
+    data->power_good = data->present ? (resp[2] & 0xf) : 0;
+    return 0;
+}
+
 static ssize_t psu_info_show(struct device *dev, struct device_attribute *da,
              char *buf)
 {
@@ -99,6 +133,14 @@ static ssize_t psu_info_show(struct device *dev, struct device_attribute *da,
     //printk("psu_info_show\n");
    // printk("attr->index=%d\n", attr->index);
     mutex_lock(&data->update_lock);
+    if (ipmi_fetch && (attr->index == PSU_PRESENT || attr->index == PSU_POWER_GOOD)) {
+        status = as7716_32xb_psu_ipmi_update(data);
+        if (status < 0) {
+            mutex_unlock(&data->update_lock);
+            return status;
+        }
+        status = -EINVAL;
+    }
     switch (attr->index)
     {
         case PSU_PRESENT:
@@ -15,6 +15,19 @@
 
 #define TEMP1_MAX_HYST_DEFAULT  75000
 #define TEMP1_MAX_DEFAULT       80000
+
+/* BMC OEM command for the thermal sensors, 3 bytes each, degree C last */
+#define IPMI_THERMAL_CMD        0x12
+#define IPMI_THERMAL_NUM        3
+#define IPMI_THERMAL_ADDR_BASE  0x48    /* drv_handler puts sensor N at 0x48 + N */
+
+extern int as7716_32xb_ipmi_cached(u8 cmd, const u8 *req, int req_len, u8 *resp, int resp_max);
+
+/* Read the values from the BMC here instead of having drv_handler push them */
+static bool ipmi_fetch = 1;
+module_param(ipmi_fetch, bool, S_IRUGO);
+MODULE_PARM_DESC(ipmi_fetch, "Fetch the temperatures over IPMI (default 1)");
+
 /* Addresses scanned 
  */
 static const unsigned short normal_i2c[] = { I2C_CLIENT_END };
@@ -58,6 +71,30 @@ static struct attribute *as7716_32xb_thermal_attributes[] = {
 };
 
 
+/* Called with data->update_lock held */
+static int as7716_32xb_thermal_ipmi_update(struct i2c_client *client,
+                                           struct as7716_32xb_thermal_data *data)
+{
+    u8 resp[IPMI_THERMAL_NUM * 3];
+    int sensor = client->addr - IPMI_THERMAL_ADDR_BASE;
+    int status;
+
+    if (sensor < 0 || sensor >= IPMI_THERMAL_NUM) {
+        return 0;
+    }
+
+    status = as7716_32xb_ipmi_cached(IPMI_THERMAL_CMD, NULL, 0, resp, sizeof(resp));
+    if (status < 0) {
+        return status;
+    }
+    if (status < (sensor + 1) * 3) {
+        return -EIO;
+    }
+
+    data->temp1_input = resp[sensor * 3 + 2] * 1000;
+    return 0;
+}
+
 static ssize_t temp_info_show(struct device *dev, struct device_attribute *da,
              char *buf)
 {
@@ -67,6 +104,14 @@ static ssize_t temp_info_show(struct device *dev, struct device_attribute *da,
     int status = -EINVAL;
     
     mutex_lock(&data->update_lock);
+    if (ipmi_fetch && attr->index == TEMP1_INPUT) {
+        status = as7716_32xb_thermal_ipmi_update(client, data);
+        if (status < 0) {
+            mutex_unlock(&data->update_lock);
+            return status;
+        }
+        status = -EINVAL;
+    }
     switch (attr->index)
     {
         case TEMP1_INPUT:
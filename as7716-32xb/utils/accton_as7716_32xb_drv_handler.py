@@ -33,6 +33,9 @@ try:
     import time  # this is only being used as part of the example
     import traceback
     import commands
+    import binascii
+    import select
+    import string
     from tabulate import tabulate    
 except ImportError as e:
     raise ImportError('%s - required module not found' % str(e))
@@ -68,6 +71,100 @@ def log_os_system(cmd, show):
             print('Failed :'+cmd)
     return  status, output
 
+
+class ipmi_shell(object):
+    """One 'ipmitool shell' kept open for every BMC request.
+
+    Falls back to a process per command if the shell cannot be started.
+    """
+    PROMPT = "ipmitool> "
+    TIMEOUT = 5
+
+    def __init__(self):
+        self.proc = None
+
+    def start(self):
+        try:
+            self.proc = subprocess.Popen(["ipmitool", "shell"],
+                                         stdin=subprocess.PIPE,
+                                         stdout=subprocess.PIPE,
+                                         stderr=subprocess.STDOUT,
+                                         close_fds=True)
+        except OSError as e:
+            logging.info('Failed to start ipmitool shell: ' + str(e))
+            self.proc = None
+            return False
+        if self.read_prompt() is None:
+            self.stop()
+            return False
+        return True
+
+    def stop(self):
+        if self.proc is None:
+            return
+        try:
+            self.proc.kill()
+            self.proc.wait()
+        except OSError:
+            pass
+        self.proc = None
+
+    def read_prompt(self):
+        fd = self.proc.stdout.fileno()
+        deadline = time.time() + self.TIMEOUT
+        out = ""
+        while not out.endswith(self.PROMPT):
+            left = deadline - time.time()
+            if left <= 0:
+                return None
+            ready, _, _ = select.select([fd], [], [], left)
+            if not ready:
+                return None
+            chunk = os.read(fd, 4096)
+            if not chunk:
+                return None
+            out += chunk
+        return out[:-len(self.PROMPT)]
+
+    def run(self, cmd):
+        """Run an ipmitool command, e.g. 'raw 0x34 0x12'. None on failure."""
+        logging.info('Run :ipmitool ' + cmd)
+        for retry in range(2):
+            if self.proc is None and not self.start():
+                break
+            try:
+                self.proc.stdin.write(cmd + "\n")
+                self.proc.stdin.flush()
+            except IOError:
+                self.stop()
+                continue
+            out = self.read_prompt()
+            if out is not None:
+                return out
+            self.stop()
+
+        status, out = log_os_system("ipmitool " + cmd, 0)
+        if status:
+            return None
+        return out
+
+    def raw(self, cmd):
+        """Run a raw command and return the answer as one hex string."""
+        out = self.run(cmd)
+        if out is None:
+            return None
+        hex_str = ""
+        for line in out.splitlines():
+            line = line.strip()
+            if line == cmd.strip():
+                # the shell may echo the command back
+                continue
+            hex_str += line.replace(" ", "")
+        if not hex_str or not all(c in string.hexdigits for c in hex_str):
+            logging.info('Failed :ipmitool ' + cmd + ' : ' + out)
+            return None
+        return hex_str
+
       
 # Make a class we can use to capture stdout and sterr in the log
 class accton_as7716xb_drv_handler(object):    
@@ -78,18 +175,17 @@ class accton_as7716xb_drv_handler(object):
     BASE_I2C_PATH="/sys/bus/i2c/devices/"
     QSFP_PRESENT_PATH = "/sys/bus/i2c/devices/0-0060/module_present_"
     QSFP_RESET_PATH = "/sys/bus/i2c/devices/0-0060/module_reset_"
-    QSFP_PRESENT_FILE = "/tmp/ipmi_qsfp_pres"
-    QSFP_EEPROM_FILE = "/tmp/ipmi_qsfp_ee_"
-    THERMAL_FILE = "/tmp/ipmi_thermal"    
-    IPMI_CMD_QSFP = "ipmitool raw 0x34 0x10 "
-    IPMI_CMD_THERMAL = "ipmitool raw 0x34 0x12 "
-    IPMI_CMD_FAN     = "ipmitool raw 0x34 0x14 "
-    IPMI_CMD_PSU     ="ipmitool raw 0x34 0x16 "
-    IPMI_CMD_SYS_EEPROM_1  ="ipmitool raw 0x34 0x18 0x0 0x80"
-    IPMI_CMD_SYS_EEPROM_2  ="ipmitool raw 0x34 0x18 0x80 0x80"
+    QSFP_EEPROM_SIZE = 256
+    QSFP_PAGE_SIZE = 128
+    QSFP_DOM_INTERVAL = 10    # seconds between lower page (DOM) refreshes
+    IPMI_CMD_QSFP = "raw 0x34 0x10 "
+    IPMI_CMD_THERMAL = "raw 0x34 0x12 "
+    IPMI_CMD_FAN     = "raw 0x34 0x14 "
+    IPMI_CMD_PSU     ="raw 0x34 0x16 "
+    IPMI_CMD_SYS_EEPROM_1  ="raw 0x34 0x18 0x0 0x80"
+    IPMI_CMD_SYS_EEPROM_2  ="raw 0x34 0x18 0x80 0x80"
     FAN_ID_START = 1
     FAN_ID_END = 6
-    FAN_FILE = "/tmp/ipmi_fan"
     FAN_PATH = "/sys/bus/i2c/devices/0-0066/fan"
     PSU_ID_START = 1
     PSU_ID_END = 2
@@ -97,10 +193,8 @@ class accton_as7716xb_drv_handler(object):
     PSU2_PATH = "/sys/bus/i2c/devices/0-0050/"
     PSU1_PMBUS_PATH = "/sys/bus/i2c/devices/0-005b/"
     PSU2_PMBUS_PATH = "/sys/bus/i2c/devices/0-0058/"
-    PSU_FILE = "/tmp/ipmi_psu_"
-    SYS_EEPROM_FILE_1 = "/tmp/ipmi_sys_eeprom_1"
-    SYS_EEPROM_FILE_2 = "/tmp/ipmi_sys_eeprom_2"
     SYS_EEPROM_PATH = "/sys/bus/i2c/devices/0-0056/eeprom"
+    IPMI_FETCH_PATH = "/sys/module/%s/parameters/ipmi_fetch"
     
 
     def __init__(self, log_file, log_level):
@@ -123,108 +217,114 @@ class accton_as7716xb_drv_handler(object):
             logging.getLogger('').addHandler(console)
 
         logging.debug('SET. logfile:%s / loglevel:%d', log_file, log_level)
+        self.oom_ipmi_fetch = self.check_ipmi_fetch('accton_as7716_32xb_oom')
+        self.thermal_ipmi_fetch = self.check_ipmi_fetch('accton_as7716_32xb_thermal')
+        self.fan_ipmi_fetch = self.check_ipmi_fetch('accton_as7716_32xb_fan')
+        self.psu_ipmi_fetch = self.check_ipmi_fetch('accton_as7716_32xb_psu') and \
+                              self.check_ipmi_fetch('accton_as7716_32xb_pmbus')
+        self.ipmi = ipmi_shell()
+        # QSFP state from the last sweep: presence, lower page and its age
+        self.qsfp_present = {}
+        self.qsfp_lower_page = {}
+        self.qsfp_dom_time = {}
+
+    def check_ipmi_fetch(self, module):
+        # The driver reads the BMC over IPMI itself when this is set
+        try:
+            with open(self.IPMI_FETCH_PATH % module) as f:
+                return f.read().strip() == 'Y'
+        except IOError:
+            return False
+
+    def set_qsfp_eeprom(self, port, data, offset=0):
+        # The oom eeprom file is raw binary and takes writes at any offset
+        path = self.BASE_I2C_PATH + "0-00%02d/eeprom" % port
+        try:
+            with open(path, 'r+b', 0) as f:
+                f.seek(offset)
+                f.write(data)
+        except IOError as e:
+            logging.debug("%s: %s", path, str(e))
+
+    def get_qsfp_page(self, port, page):
+        str_line = self.ipmi.raw(self.IPMI_CMD_QSFP + str(port) + " 0x0" + str(page))
+        if str_line is None or len(str_line) < self.QSFP_PAGE_SIZE*2:
+            return None
+        return binascii.unhexlify(str_line[:self.QSFP_PAGE_SIZE*2])
+
+    def qsfp_insert(self, port):
+        # Fetch both pages once, the upper page is static
+        lower = self.get_qsfp_page(port, 0)
+        upper = self.get_qsfp_page(port, 1)
+        if lower is None or upper is None:
+            return False
+        self.set_qsfp_eeprom(port, lower + upper)
+        self.qsfp_lower_page[port] = lower
+        self.qsfp_dom_time[port] = time.time()
+        return True
+
+    def qsfp_remove(self, port):
+        self.set_qsfp_eeprom(port, '\xff' * self.QSFP_EEPROM_SIZE)
+        self.qsfp_lower_page.pop(port, None)
+        self.qsfp_dom_time.pop(port, None)
+
+    def qsfp_refresh_dom(self, port):
+        # Refetch the lower page and push only the span that changed
+        if time.time() - self.qsfp_dom_time.get(port, 0) < self.QSFP_DOM_INTERVAL:
+            return True
+        lower = self.get_qsfp_page(port, 0)
+        if lower is None:
+            return False
+        self.qsfp_dom_time[port] = time.time()
+        old = self.qsfp_lower_page.get(port)
+        if old == lower:
+            return True
+        if old is None:
+            start, end = 0, len(lower)
+        else:
+            diff = [k for k in range(len(lower)) if lower[k] != old[k]]
+            start, end = diff[0], diff[-1] + 1
+        self.set_qsfp_eeprom(port, lower[start:end], start)
+        self.qsfp_lower_page[port] = lower
+        return True
 
     def manage_ipmi_qsfp(self):        
         logging.debug ("drv hanlder-manage_ipmi_qsfp")
-        print "drv hanlder"
         #Handle QSFP case
-        ipmi_cmd = self.IPMI_CMD_QSFP + " 0x10 > " +self.QSFP_PRESENT_FILE
-        log_os_system(ipmi_cmd, 0)
-        file_path = self.QSFP_PRESENT_FILE
-        check_file = open(file_path)
-        try:
-            check_file = open(file_path)
-        except IOError as e:
-            print "Error: unable to open file: %s" % str(e)   
-        line = check_file.readline()
-        pres_line= line.rstrip().replace(" ","")
-        while line:
-            line = check_file.readline()            
-            pres_line+=line.rstrip().replace(" ","")
-        check_file.close() 
-        
+        pres_line = self.ipmi.raw(self.IPMI_CMD_QSFP + " 0x10")
+        if pres_line is None or len(pres_line) < self.QSFP_PORT_END*2:
+            return False
         
         for i in range(self.QSFP_PORT_START, self.QSFP_PORT_END+1, 1):
-            if i>1:
-                k=(i-1)*2 +1 
-            else:
-                k=1;
-            if pres_line[k] == '1':
-                #Set QSFP present
-                #print "port-%d present" %i
-                set_drv_cmd = "echo 1 > " + self.QSFP_PRESENT_PATH + str(i)
+            k=(i-1)*2 +1 
+            present = (pres_line[k] == '1')
+            if self.qsfp_present.get(i) != present:
+                #Presence changed, tell the CPLD driver
+                set_drv_cmd = "echo " + str(int(present)) + " > " + self.QSFP_PRESENT_PATH + str(i)
                 log_os_system(set_drv_cmd, 0)
-                #Read QSFP EEPROM
-                ipmi_cmd = self.IPMI_CMD_QSFP +str(i)+ " 0x00 > " +self.QSFP_EEPROM_FILE + str(i) + "_1"
-                log_os_system(ipmi_cmd, 0)
-                ipmi_cmd = self.IPMI_CMD_QSFP +str(i)+ " 0x01 > " +self.QSFP_EEPROM_FILE + str(i) + "_2"
-                log_os_system(ipmi_cmd, 0)
-                file_path = self.QSFP_EEPROM_FILE + str(i) + "_1"
-                check_file = open(file_path)
-                try:
-                    check_file = open(file_path)
-                except IOError as e:
-                    print "Error: unable to open file: %s" % str(e)
-                line = check_file.readline()
-                str_line= line.rstrip().replace(" ","")
-                while line:
-                    line = check_file.readline()            
-                    str_line+=line.rstrip().replace(" ","")
-                check_file.close()
-                file_path = self.QSFP_EEPROM_FILE + str(i) + "_2"
-                check_file = open(file_path)
-                try:
-                    check_file = open(file_path)
-                except IOError as e:
-                    print "Error: unable to open file: %s" % str(e)
-                line = check_file.readline()
-                str_line+= line.rstrip().replace(" ","")
-                
-                while line:
-                    line = check_file.readline()
-                    str_line+=line.rstrip().replace(" ","")
-                check_file.close()
-                #Set QSFP EEPROM
-                if(i < 10):
-                    set_drv_cmd = "echo " + str_line+ " > " + self.BASE_I2C_PATH + "0-000"+str(i) +"/eeprom"
-                else:
-                    set_drv_cmd = "echo " + str_line+ " > " + self.BASE_I2C_PATH + "0-00"+str(i) +"/eeprom"
-                #print(set_drv_cmd)
-                log_os_system(set_drv_cmd, 0)
-            else:
-                ipmi_cmd = "echo 0 > " + self.QSFP_PRESENT_PATH + str(i)
-                log_os_system(ipmi_cmd, 0)
-                if(i < 10):
-                    set_drv_cmd = "echo 0 > " + self.BASE_I2C_PATH + "0-000"+str(i) +"/eeprom"
+                if self.oom_ipmi_fetch:
+                    self.qsfp_present[i] = present
+                    continue
+                if present:
+                    if not self.qsfp_insert(i):
+                        #Try again on the next sweep
+                        continue
                 else:
-                    set_drv_cmd = "echo 0 > " + self.BASE_I2C_PATH + "0-00"+str(i) +"/eeprom"
-                #print(set_drv_cmd)
-                log_os_system(set_drv_cmd, 0)
-                
-            time.sleep(0.01) 
+                    self.qsfp_remove(i)
+                self.qsfp_present[i] = present
+            elif present and not self.oom_ipmi_fetch:
+                self.qsfp_refresh_dom(i)
         return True
         
     def manage_ipmi_thermal(self):
         logging.debug ("drv hanlder-manage_ipmi_thermal")
         #Handle thermal case
         #ipmitool raw 0x34 0x12 
-        ipmi_cmd = self.IPMI_CMD_THERMAL + " > " +self.THERMAL_FILE  
-        log_os_system(ipmi_cmd, 0)
-        file_path = self.THERMAL_FILE
-        check_file = open(file_path)
-        try:
-            check_file = open(file_path)
-        except IOError as e:
-            print "Error: unable to open file: %s" % str(e)
-        line = check_file.readline()
-        str_line= line.rstrip().replace(" ","")
-        while line:
-            line = check_file.readline()            
-            str_line+=line.rstrip().replace(" ","")
-        check_file.close()       
+        str_line = self.ipmi.raw(self.IPMI_CMD_THERMAL)
+        if str_line is None or len(str_line) < 18:
+            return False
         val_str= "0x" + str(str_line[4])+str(str_line[5])
         val_int=int(val_str, 16)*1000
-        check_file.close()
         set_drv_cmd = "echo "+str(val_int) + " > " + self.BASE_I2C_PATH + "0-0048/temp1_input"
         log_os_system(set_drv_cmd,0)
         val_str= "0x" + str(str_line[10])+str(str_line[11])
@@ -242,21 +342,9 @@ class accton_as7716xb_drv_handler(object):
         logging.debug ("drv hanlder-manage_ipmi_fan")
         #Handle fan case
         #ipmitool raw  0x34 0x14
-        ipmi_cmd = self.IPMI_CMD_FAN + " > " +self.FAN_FILE  
-        log_os_system(ipmi_cmd, 0)
-        file_path = self.FAN_FILE
-        #print(file_path)
-        check_file = open(file_path)
-        try:
-            check_file = open(file_path)
-        except IOError as e:
-            print "Error: unable to open file: %s" % str(e)   
-        line = check_file.readline()
-        str_line= line.rstrip().replace(" ","")
-        while line:
-            line = check_file.readline()            
-            str_line+=line.rstrip().replace(" ","")
-        check_file.close()        
+        str_line = self.ipmi.raw(self.IPMI_CMD_FAN)
+        if str_line is None or len(str_line) < 96:
+            return False
         #print (str_line)
         k=0
         for i in range(self.FAN_ID_START, self.FAN_ID_END+1, 1):
@@ -287,25 +375,13 @@ class accton_as7716xb_drv_handler(object):
         #cpld access psu
         for i in range(self.PSU_ID_START, self.PSU_ID_END+1, 1):
             #present case
-            ipmi_cmd = self.IPMI_CMD_PSU + str(i) + " > " +self.PSU_FILE + str(i)  
-            log_os_system(ipmi_cmd, 0)
+            str_line = self.ipmi.raw(self.IPMI_CMD_PSU + str(i))
+            if str_line is None or len(str_line) < 38:
+                continue
             if i==1:
                psu_sysfs_path = self.PSU1_PATH
             else:
                psu_sysfs_path = self.PSU2_PATH
-            file_path = self.PSU_FILE + str(i)
-            #print(file_path)
-            check_file = open(file_path)
-            try:
-                check_file = open(file_path)
-            except IOError as e:
-                print "Error: unable to open file: %s" % str(e)   
-            line = check_file.readline()
-            str_line= line.rstrip().replace(" ","")
-            while line:
-                line = check_file.readline()            
-                str_line+=line.rstrip().replace(" ","")
-            check_file.close()  
             #print (line)            
             if str_line[1]=='0': 
                 int_val=1 #psu insert
@@ -361,37 +437,11 @@ class accton_as7716xb_drv_handler(object):
         #ipmitool -raw 0x34 0x18 0x00 0x80
         #ipmitool -raw 0x34 0x18 0x80 0x80
         
-        ipmi_cmd = self.IPMI_CMD_SYS_EEPROM_1 + " > " + self.SYS_EEPROM_FILE_1
-        log_os_system(ipmi_cmd, 0)        
-        ipmi_cmd = self.IPMI_CMD_SYS_EEPROM_2 + " > " + self.SYS_EEPROM_FILE_2
-        log_os_system(ipmi_cmd, 0)
-        
-        #Read SYS EEPROM
-        file_path = self.SYS_EEPROM_FILE_1
-        check_file = open(file_path)
-        try:
-            check_file = open(file_path)
-        except IOError as e:
-            print "Error: unable to open file: %s" % str(e)
-        line = check_file.readline()
-        str_line= line.rstrip().replace(" ","")
-        while line:
-            line = check_file.readline()            
-            str_line+=line.rstrip().replace(" ","")
-        check_file.close()
-        
-        file_path = self.SYS_EEPROM_FILE_2
-        check_file = open(file_path)
-        try:
-            check_file = open(file_path)
-        except IOError as e:
-            print "Error: unable to open file: %s" % str(e)
-        line = check_file.readline()
-        str_line+= line.rstrip().replace(" ","")
-        while line:
-            line = check_file.readline()
-            str_line+=line.rstrip().replace(" ","")
-        check_file.close()
+        str_line = self.ipmi.raw(self.IPMI_CMD_SYS_EEPROM_1)
+        str_line_2 = self.ipmi.raw(self.IPMI_CMD_SYS_EEPROM_2)
+        if str_line is None or str_line_2 is None:
+            return False
+        str_line += str_line_2
         #print(len(str_line))
         #print(str_line)
         set_drv_cmd = "echo " + str_line+ " > " + self.SYS_EEPROM_PATH
@@ -429,14 +479,19 @@ def main(argv):
     while True:
         logging.debug ("monitor.manage_ipmi")
         if set_sys_eeprom==0:
-            monitor.manage_ipmi_sys()
-            set_sys_eeprom=1
+            if monitor.manage_ipmi_sys():
+                set_sys_eeprom=1
         monitor.manage_ipmi_qsfp()
         time.sleep(0.1)        
-        monitor.manage_ipmi_thermal()
-        monitor.manage_ipmi_psu()
+        if not monitor.thermal_ipmi_fetch:
+            monitor.manage_ipmi_thermal()
+        if not monitor.psu_ipmi_fetch:
+            monitor.manage_ipmi_psu()
+        else:
+            time.sleep(2)
         time.sleep(0.1)        
-        monitor.manage_ipmi_fan()
+        if not monitor.fan_ipmi_fetch:
+            monitor.manage_ipmi_fan()
         time.sleep(0.05)        
 
 if __name__ == '__main__':
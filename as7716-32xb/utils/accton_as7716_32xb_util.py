@@ -34,6 +34,7 @@ import os
 import commands
 import sys, getopt
 import logging
+import accton_sff
 import re
 import time
 from collections import namedtuple
@@ -189,6 +190,8 @@ def main():
         elif arg == 'sff':
             if len(args)!=2:
                 show_eeprom_help()
+            elif args[1] == 'all':
+                show_eeprom_all()
             elif int(args[1]) ==0 or int(args[1]) > DEVICE_NO['sfp']:
                 show_eeprom_help()
             else:
@@ -221,6 +224,7 @@ def  show_set_help():
 def  show_eeprom_help():
     cmd =  sys.argv[0].split("/")[-1]+ " "  + args[0]
     print  "    use \""+ cmd + " 1-32 \" to dump sfp# eeprom"
+    print  "    use \""+ cmd + " all \" to dump the eeprom of every present sfp"
     sys.exit(0)
 
 def my_log(txt):
@@ -254,6 +258,7 @@ kos = [
 'modprobe ipmi_msghandler',
 'modprobe ipmi_si',
 'modprobe ipmi_devintf',
+'modprobe accton_as7716_32xb_ipmi',
 'modprobe i2c_dev',
 'modprobe accton_i2c_cpld',
 'modprobe accton_as7716_32xb_cpld1',
@@ -396,9 +401,13 @@ def do_install():
                 return  status
     else:
         print PROJECT_NAME.upper()+" devices detected...."
+    # The inventory of sff, show and set, see accton_sff.py
+    devices_info()
+    accton_sff.save_index(PROJECT_NAME, ALL_DEVICE)
     return
 
 def do_uninstall():
+    accton_sff.remove_index(PROJECT_NAME)
     print "Checking systemm...."
     if not device_exist():
         print PROJECT_NAME.upper() +" has no device installed...."
@@ -479,36 +488,39 @@ def devices_info():
                     print("   "+"   "+k)
     return
 
-def show_eeprom(index):
+def load_devices():
+    global ALL_DEVICE
+    if len(ALL_DEVICE)==0:
+        ALL_DEVICE = accton_sff.load_index(PROJECT_NAME) or {}
+    return len(ALL_DEVICE)!=0
+
+# The index written by install stands for system_ready() as well
+def devices_ready():
+    if load_devices():
+        return True
     if system_ready()==False:
         print("System's not ready.")
         print("Please install first!")
-        return
+        return False
+    devices_info()
+    return True
 
-    if len(ALL_DEVICE)==0:
-        devices_info()
+def eeprom_node(index):
     node = ALL_DEVICE['sfp'] ['sfp'+str(index)][0]
-    node = node.replace(node.split("/")[-1], 'sfp_eeprom')
-    # check if got hexdump command in current environment
-    ret, log = log_os_system("which hexdump", 0)
-    ret, log2 = log_os_system("which busybox hexdump", 0)
-    if len(log):
-        hex_cmd = 'hexdump'
-    elif len(log2):
-        hex_cmd = ' busybox hexdump'
-    else:
-        log = 'Failed : no hexdump cmd!!'
-        logging.info(log)
-        print log
-        return 1
-
-    print node + ":"
-    ret, log = log_os_system("cat "+node+"| "+hex_cmd+" -C", 1)
-    if ret==0:
-        print  log
-    else:
-        print "**********device no found**********"
-    return
+    return node.replace(node.split("/")[-1], 'sfp_eeprom')
+
+def show_eeprom(index):
+    if not devices_ready():
+        return
+    return accton_sff.dump(eeprom_node(index))
+
+def show_eeprom_all():
+    if not devices_ready():
+        return
+    ports = []
+    for i in range(1, DEVICE_NO['sfp']+1):
+        ports.append((i, ALL_DEVICE['sfp']['sfp'+str(i)][0], eeprom_node(i)))
+    return accton_sff.dump_present(ports)
 
 def set_device(args):
     global DEVICE_NO
@@ -518,7 +530,7 @@ def set_device(args):
         print("Please install first!")
         return
 
-    if len(ALL_DEVICE)==0:
+    if not load_devices():
         devices_info()
 
     if args[0]=='led':
@@ -580,7 +592,7 @@ def device_traversal():
         print("Please install first!")
         return
 
-    if len(ALL_DEVICE)==0:
+    if not load_devices():
         devices_info()
     for i in sorted(ALL_DEVICE.keys()):
         print("============================================")
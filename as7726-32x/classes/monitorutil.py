@@ -0,0 +1 @@
+../../common/classes/monitorutil.py
\ No newline at end of file
@@ -52,6 +52,7 @@ struct as7726_32x_psu_data {
     unsigned long       last_updated;    /* In jiffies */
     u8  index;           /* PSU index */
     u8  status;          /* Status(present/power_good) register read from CPLD */
+    u8  psu_bits;        /* This PSU's bits of status when the eeprom was read */
     char model_name[9]; /* Model name, read from eeprom */
 };
 
@@ -219,6 +220,9 @@ static int as7726_32x_psu_read_block(struct i2c_client *client, u8 command, u8 *
     return result;
 }
 
+/* Present and power good bits of this PSU in the CPLD status register */
+#define PSU_STATUS_BITS(index)  (BIT(1 - (index)) | BIT(3 - (index)))
+
 static struct as7726_32x_psu_data *as7726_32x_psu_update_device(struct device *dev)
 {
     struct i2c_client *client = to_i2c_client(dev);
@@ -229,7 +233,7 @@ static struct as7726_32x_psu_data *as7726_32x_psu_update_device(struct device *d
     if (time_after(jiffies, data->last_updated + HZ + HZ / 2)
             || !data->valid) {
         int status;
-        int power_good = 0;
+        u8  psu_bits;
 
         dev_dbg(&client->dev, "Starting as7726_32x update\n");
 
@@ -243,19 +247,28 @@ static struct as7726_32x_psu_data *as7726_32x_psu_update_device(struct device *d
             data->status = status;
         }
 
-        /* Read model name */
-        memset(data->model_name, 0, sizeof(data->model_name));
-        power_good = (data->status >> (3-data->index) & 0x1);
-
-        if (power_good) {
-            status = as7726_32x_psu_read_block(client, 0x20, data->model_name,
-                                               ARRAY_SIZE(data->model_name)-1);
-            if (status < 0) {
-                data->model_name[0] = '\0';
-                dev_dbg(&client->dev, "unable to read model name from (0x%x)\n", client->addr);
-            }
-            else {
-                data->model_name[ARRAY_SIZE(data->model_name)-1] = '\0';
+        /* The eeprom only has to be read again when the PSU comes, goes,
+         * or its power good changes
+         */
+        psu_bits = data->status & PSU_STATUS_BITS(data->index);
+        if (!data->valid || psu_bits != data->psu_bits) {
+            data->psu_bits = psu_bits;
+
+            /* Read model name */
+            memset(data->model_name, 0, sizeof(data->model_name));
+
+            if (data->status >> (3-data->index) & 0x1) { /* power good */
+                status = as7726_32x_psu_read_block(client, 0x20, data->model_name,
+                                                   ARRAY_SIZE(data->model_name)-1);
+                if (status < 0) {
+                    data->model_name[0] = '\0';
+                    dev_dbg(&client->dev, "unable to read model name from (0x%x)\n", client->addr);
+                    data->valid = 0;    /* try again on the next read */
+                    goto exit;
+                }
+                else {
+                    data->model_name[ARRAY_SIZE(data->model_name)-1] = '\0';
+                }
             }
         }
 
@@ -263,6 +276,7 @@ static struct as7726_32x_psu_data *as7726_32x_psu_update_device(struct device *d
         data->valid = 1;
     }
 
+exit:
     mutex_unlock(&data->update_lock);
 
     return data;
@@ -29,12 +29,14 @@ try:
     import imp
     import logging
     import logging.config
+    import logging.handlers
     import types
     import time  # this is only being used as part of the example
     import traceback
     from tabulate import tabulate
     from as7726_32x.fanutil import FanUtil
     from as7726_32x.thermalutil import ThermalUtil
+    from as7726_32x.monitorutil import SysfsCache, MonitorScheduler
 except ImportError as e:
     raise ImportError('%s - required module not found' % str(e))
 
@@ -104,8 +106,116 @@ class accton_as7726_monitor(object):
             console.setFormatter(formatter)
             logging.getLogger('').addHandler(console)
 
+        # the alarms of the FAN and PSU tasks go to syslog as well
+        sys_handler = logging.handlers.SysLogHandler(address = '/dev/log')
+        sys_handler.setLevel(logging.INFO)
+        logging.getLogger('').addHandler(sys_handler)
+
         logging.debug('SET. logfile:%s / loglevel:%d', log_file, log_level)
 
+        # one cache for every task: a node is read once per tick
+        self.cache = SysfsCache()
+        self.thermal = ThermalUtil(self.cache)
+        self.fan = FanUtil(self.cache)
+
+        self.fan_num = 6
+        self.fan_path = "/sys/bus/i2c/devices/54-0066/"
+        self.fan_state = [2] * self.fan_num         #init state=2, insert=1, remove=0
+        self.fan_status_state = [2] * self.fan_num  #init state=2, fault=1, normal=0
+
+        self.psu_num = 2
+        self.psu_path = "/sys/bus/i2c/devices/"
+        self.psu_mapping = {
+            0: "50-0053",
+            1: "49-0050",
+        }
+        self.psu_state = [2, 2]
+        self.psu_power_status = [2, 2]
+
+    def fan_status_nodes(self):
+        """The nodes the fan driver sysfs_notify()s"""
+        return [self.fan_path + 'fan%d_%s' % (idx+1, node)
+                for idx in range(0, self.fan_num) for node in ('present', 'fault')]
+
+    def manage_fan_status(self):
+        """FAN present and fault alarms"""
+        FAN_STATE_REMOVE = 0
+        FAN_STATE_INSERT = 1
+
+        FAN_STATUS_FAULT = 1
+        FAN_STATUS_NORMAL = 0
+
+        for idx in range (0, self.fan_num):
+            content = self.cache.read(self.fan_path + 'fan%d_present' % (idx+1))
+            if content is None:
+                return False
+            # content is a string, either "0" or "1"
+            if content == "1":
+                if self.fan_state[idx]!=FAN_STATE_INSERT:
+                    self.fan_state[idx]=FAN_STATE_INSERT
+                    logging.info("FAN-%d present is detected", idx+1)
+            else:
+                if self.fan_state[idx]!=FAN_STATE_REMOVE:
+                    self.fan_state[idx]=FAN_STATE_REMOVE
+                    logging.warning("Alarm for FAN-%d absent is detected", idx+1)
+
+        for idx in range (0, self.fan_num):
+            content = self.cache.read(self.fan_path + 'fan%d_fault' % (idx+1))
+            if content is None:
+                return False
+            # content is a string, either "0" or "1"
+            if content == "1":
+                if self.fan_status_state[idx]!=FAN_STATUS_FAULT:
+                    if self.fan_state[idx] == FAN_STATE_INSERT:
+                        logging.warning("Alarm for FAN-%d failed is detected", idx+1)
+                        self.fan_status_state[idx]=FAN_STATUS_FAULT
+            else:
+                self.fan_status_state[idx]=FAN_STATUS_NORMAL
+
+        return True
+
+    def manage_psu(self):
+        """PSU present and power good alarms"""
+        PSU_STATE_REMOVE = 0
+        PSU_STATE_INSERT = 1
+
+        PSU_STATUS_NO_POWER = 0
+        PSU_STATUS_POWER_GOOD = 1
+        PSU_STATUS_IDLE = 2
+
+        for idx in range (0, self.psu_num):
+            content = self.cache.read(self.psu_path + self.psu_mapping[idx] + '/psu_present')
+            if content is None:
+                return False
+            # content is a string, either "0" or "1"
+            if content == "1":
+                if self.psu_state[idx]!=PSU_STATE_INSERT:
+                    self.psu_state[idx]=PSU_STATE_INSERT
+                    logging.info("PSU-%d present is detected", idx+1)
+            else:
+                if self.psu_state[idx]!=PSU_STATE_REMOVE:
+                    self.psu_state[idx]=PSU_STATE_REMOVE
+                    logging.warning("Alarm for PSU-%d absent is detected", idx+1)
+                    self.psu_power_status[idx]=PSU_STATUS_IDLE
+
+        for idx in range (0, self.psu_num):
+            content = self.cache.read(self.psu_path + self.psu_mapping[idx] + '/psu_power_good')
+            if content is None:
+                return False
+            # content is a string, either "0" or "1"
+            if content == "0":
+                if self.psu_power_status[idx]!=PSU_STATUS_NO_POWER:
+                    if self.psu_state[idx]==PSU_STATE_INSERT:
+                        logging.warning("Alarm for PSU-%d failed is detected", idx+1)
+                        self.psu_power_status[idx]=PSU_STATUS_NO_POWER
+            else:
+                if self.psu_state[idx]==PSU_STATE_INSERT:
+                    if self.psu_power_status[idx]!=PSU_STATUS_POWER_GOOD:
+                        logging.info("PSU-%d power_good is detected", idx+1)
+                        self.psu_power_status[idx]=PSU_STATUS_POWER_GOOD
+
+        return True
+
     def manage_fans(self):
         
         fan_policy_f2b = {
@@ -121,8 +231,8 @@ class accton_as7726_monitor(object):
            3: [69, 15500, 0],
         }
   
-        thermal = ThermalUtil()
-        fan = FanUtil()
+        thermal = self.thermal
+        fan = self.fan
         get_temp = thermal.get_thermal_temp()            
         
         cur_duty_cycle = fan.get_fan_duty_cycle()
@@ -178,29 +288,31 @@ class accton_as7726_monitor(object):
 
 
 def main(argv):
-    #log_file = '%s.log' % FUNCTION_NAME
-    #log_level = logging.INFO
-    #if len(sys.argv) != 1:
-    #    try:
-    #        opts, args = getopt.getopt(argv,'hdl:',['lfile='])
-    #    except getopt.GetoptError:
-    #        print 'Usage: %s [-d] [-l <log_file>]' % sys.argv[0]
-    #        return 0
-    #    for opt, arg in opts:
-    #        if opt == '-h':
-    #            print 'Usage: %s [-d] [-l <log_file>]' % sys.argv[0]
-    #            return 0
-    #        elif opt in ('-d', '--debug'):
-    #            log_level = logging.DEBUG
-    #        elif opt in ('-l', '--lfile'):
-    #            log_file = arg
-
-    #monitor = accton_as7726_monitor(log_file, log_level)
+    log_file = '%s.log' % FUNCTION_NAME
+    log_level = logging.INFO
+    if len(sys.argv) != 1:
+        try:
+            opts, args = getopt.getopt(argv,'hdl:',['lfile='])
+        except getopt.GetoptError:
+            print 'Usage: %s [-d] [-l <log_file>]' % sys.argv[0]
+            return 0
+        for opt, arg in opts:
+            if opt == '-h':
+                print 'Usage: %s [-d] [-l <log_file>]' % sys.argv[0]
+                return 0
+            elif opt in ('-d', '--debug'):
+                log_level = logging.DEBUG
+            elif opt in ('-l', '--lfile'):
+                log_file = arg
 
+    monitor = accton_as7726_monitor(log_file, log_level)
+    scheduler = MonitorScheduler(monitor.cache)
+    # the fan policy is not enabled on this platform yet
+    #scheduler.register('fan policy', 1, monitor.manage_fans)
+    scheduler.register('fan status', 3, monitor.manage_fan_status, notify=monitor.fan_status_nodes())
+    scheduler.register('psu status', 3, monitor.manage_psu)
     # Loop forever, doing something useful hopefully:
-    while True:
-        #monitor.manage_fans()
-        time.sleep(1)
+    scheduler.run()
 
 if __name__ == '__main__':
     main(sys.argv[1:])
@@ -42,7 +42,7 @@
 
 static ssize_t show_status(struct device *dev, struct device_attribute *da, char *buf);
 static struct as7816_64x_psu_data *as7816_64x_psu_update_device(struct device *dev);
-extern int accton_i2c_cpld_read (u8 cpld_addr, u8 reg);
+extern int accton_i2c_cpld_read_cached(unsigned short cpld_addr, u8 reg);
 
 /* Addresses scanned 
  */
@@ -54,7 +54,6 @@ struct as7816_64x_psu_data {
     struct device      *hwmon_dev;
     struct mutex        update_lock;
     char                valid;           /* !=0 if registers are valid */
-    unsigned long       last_updated;    /* In jiffies */
     u8  index;           /* PSU index */
     u8  status;          /* Status(present/power_good) register read from CPLD */
 };             
@@ -190,31 +189,24 @@ static struct as7816_64x_psu_data *as7816_64x_psu_update_device(struct device *d
     struct i2c_client *client = to_i2c_client(dev);
     struct as7816_64x_psu_data *data = i2c_get_clientdata(client);
     
+    int status;
+
     mutex_lock(&data->update_lock);
 
-    if (time_after(jiffies, data->last_updated + HZ + HZ / 2)
-        || !data->valid) {
-        int status;
+    dev_dbg(&client->dev, "Starting as7816_64x update\n");
+
+    /* Read psu status, from the CPLD driver's shadow copy while it is fresh */
+    status = accton_i2c_cpld_read_cached(PSU_STATUS_I2C_ADDR, PSU_STATUS_I2C_REG_OFFSET);
 
+    if (status < 0) {
+        dev_dbg(&client->dev, "cpld reg (0x%x) err %d\n", PSU_STATUS_I2C_ADDR, status);
         data->valid = 0;
-        dev_dbg(&client->dev, "Starting as7816_64x update\n");
-
-		/* Read psu status */
-        status = accton_i2c_cpld_read(PSU_STATUS_I2C_ADDR, PSU_STATUS_I2C_REG_OFFSET);
-		
-		if (status < 0) {
-			dev_dbg(&client->dev, "cpld reg (0x%x) err %d\n", PSU_STATUS_I2C_ADDR, status);
-			goto exit;
-		}
-		else {
-			data->status = status;
-		}
-
-		data->last_updated = jiffies;
-		data->valid = 1;
-	}
+    }
+    else {
+        data->status = status;
+        data->valid = 1;
+    }
 
-exit:
 	mutex_unlock(&data->update_lock);
 
 	return data;
@@ -0,0 +1,326 @@
+#!/usr/bin/env python
+#
+# Copyright (C) 2018 Accton Technology Corporation
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+# ------------------------------------------------------------------
+# HISTORY:
+#    mm/dd/yyyy (A.D.)
+#    10/14/2026: Driver benchmarks on simulated I2C buses
+# ------------------------------------------------------------------
+
+"""
+Usage: %(scriptName)s [options] [workload ...]
+
+Loads accton_i2c_sim and the drivers, puts an optoe at 0x50 of every
+simulated bus, a CPLD, a PSU and a fan board on the first one, runs the
+workloads and unloads everything again.
+
+options:
+    -h | --help             : this help message
+    -d | --debug            : run with debug mode
+    -m | --modules <dirs>   : ':' separated dirs with the built .ko files,
+                              default %(modules)s
+    -p | --ports <n>        : simulated ports/buses, default 32
+    -n | --iterations <n>   : passes over each workload, default 10
+    -L | --latency <us>     : time of one bus transaction, default 100
+    -N | --nack <ppm>       : NACKed transactions per million, default 0
+    -s | --seed <n>         : seed of the NACK sequence, default 1
+    -c | --cpld <name>      : CPLD device name, default cpld_as7716
+    -S | --smbus-only       : simulate an SMBus only controller
+    -u | --uncached         : update_interval_ms=0 on every driver that has it
+workload:
+    eeprom      : read the whole EEPROM of every port
+    presence    : read module_present_all
+    psu         : read the PSU output, temperature and fan attributes
+    fan         : read every fan*_input
+    (all of them by default)
+
+Every workload prints one line of transactions, bytes, NACKs, read
+errors, wall time and per read latency percentiles.  With the same
+options the transaction counts are the same from run to run, so two
+driver versions can be told apart by them alone.
+"""
+
+import os
+import sys, getopt
+import glob
+import logging
+import subprocess
+import time
+
+SCRIPT_DIR = os.path.dirname(os.path.abspath(__file__))
+DEFAULT_MODULES = ':'.join([
+    SCRIPT_DIR,
+    os.path.join(SCRIPT_DIR, '..', 'modules'),
+    os.path.join(SCRIPT_DIR, '..', '..', 'as7716-32x', 'modules'),
+])
+
+# In load order, unloaded the other way round
+MODULES = ['accton_i2c_sim', 'accton_i2c_stats', 'accton_telemetry', 'optoe', 'accton_i2c_cpld',
+           'accton_pmbus_psu', 'ym2651y', 'accton_fan_core', 'accton_as7716_32x_fan']
+
+SIM_PARAMS = '/sys/module/accton_i2c_sim/parameters/'
+SIM_DEBUGFS = '/sys/kernel/debug/accton_i2c_sim/'
+I2C_DEVICES = '/sys/bus/i2c/devices/'
+
+ADDR_EEPROM = 0x50
+ADDR_PSU = 0x5b
+ADDR_CPLD = 0x60
+ADDR_FAN = 0x66
+
+PSU_NODES = ['psu_v_out', 'psu_i_out', 'psu_p_out', 'psu_temp1_input',
+             'psu_fan1_speed_rpm']
+
+WORKLOADS = ['eeprom', 'presence', 'psu', 'fan']
+
+def log_os_system(cmd, show):
+    logging.info('Run :' + cmd)
+    status = subprocess.call(cmd, shell=True)
+    logging.debug('%s with result: %d', cmd, status)
+    if status and show:
+        print('Failed :' + cmd)
+    return status
+
+
+def write_node(path, value):
+    try:
+        with open(path, 'w') as f:
+            f.write(str(value))
+    except IOError as e:
+        logging.error('unable to write %s: %s', path, str(e))
+        return False
+    return True
+
+
+def read_node(path):
+    try:
+        with open(path, 'r') as f:
+            return f.read().strip()
+    except IOError:
+        return None
+
+
+def find_module(dirs, name):
+    for d in dirs:
+        ko = os.path.join(d, name + '.ko')
+        if os.path.isfile(ko):
+            return ko
+    return None
+
+
+def sim_buses():
+    """Bus numbers of the simulated adapters, in adapter order"""
+    buses = []
+    for path in glob.glob(I2C_DEVICES + 'i2c-*/name'):
+        name = read_node(path)
+        if name and name.startswith('accton-i2c-sim '):
+            buses.append((int(name.split()[1]), int(path.split('/')[-2][4:])))
+    return [bus for index, bus in sorted(buses)]
+
+
+def device_path(bus, addr):
+    return I2C_DEVICES + '%d-%04x/' % (bus, addr)
+
+
+def new_device(bus, name, addr):
+    return write_node(I2C_DEVICES + 'i2c-%d/new_device' % bus, '%s 0x%02x' % (name, addr))
+
+
+def delete_device(bus, addr):
+    if os.path.exists(device_path(bus, addr)):
+        write_node(I2C_DEVICES + 'i2c-%d/delete_device' % bus, '0x%02x' % addr)
+
+
+class Bench(object):
+
+    def __init__(self, options):
+        self.opt = options
+        self.buses = []
+        self.loaded = []
+
+    def setup(self):
+        dirs = self.opt['modules'].split(':')
+        for name in MODULES:
+            ko = find_module(dirs, name)
+            if ko is None:
+                print 'No %s.ko in %s, build it first' % (name, self.opt['modules'])
+                return False
+            params = ''
+            if name == 'accton_i2c_sim':
+                params = 'nr_adapters=%d latency_us=%d nack_ppm=0 seed=%d i2c=%d' % (
+                    self.opt['ports'], self.opt['latency'], self.opt['seed'],
+                    0 if self.opt['smbus_only'] else 1)
+            if log_os_system('insmod %s %s' % (ko, params), 1):
+                return False
+            self.loaded.append(name)
+
+        self.buses = sim_buses()
+        if len(self.buses) != self.opt['ports']:
+            print 'Found %d simulated buses, expected %d' % (len(self.buses), self.opt['ports'])
+            return False
+
+        # Probing runs NACK free, the drivers must all come up
+        for bus in self.buses:
+            new_device(bus, 'optoe1', ADDR_EEPROM)
+        new_device(self.buses[0], self.opt['cpld'], ADDR_CPLD)
+        new_device(self.buses[0], 'ym2651', ADDR_PSU)
+        new_device(self.buses[0], 'as7716_32x_fan', ADDR_FAN)
+
+        if self.opt['uncached']:
+            for path in glob.glob(I2C_DEVICES + '*/update_interval_ms'):
+                write_node(path, 0)
+
+        write_node(SIM_PARAMS + 'nack_ppm', self.opt['nack'])
+        return True
+
+    def teardown(self):
+        if self.buses:
+            write_node(SIM_PARAMS + 'nack_ppm', 0)
+            delete_device(self.buses[0], ADDR_FAN)
+            delete_device(self.buses[0], ADDR_PSU)
+            delete_device(self.buses[0], ADDR_CPLD)
+            for bus in self.buses:
+                delete_device(bus, ADDR_EEPROM)
+        for name in reversed(self.loaded):
+            log_os_system('rmmod %s' % name, 1)
+        self.loaded = []
+
+    def counters(self):
+        total = {'transactions': 0, 'bytes': 0, 'nacks': 0}
+        for key in total:
+            for path in glob.glob(SIM_DEBUGFS + '*/' + key):
+                value = read_node(path)
+                if value is not None:
+                    total[key] += int(value)
+        return total
+
+    def reset_counters(self):
+        for path in glob.glob(SIM_DEBUGFS + '*/reset'):
+            write_node(path, 1)
+
+    def nodes(self, workload):
+        first = self.buses[0]
+        if workload == 'eeprom':
+            return [device_path(bus, ADDR_EEPROM) + 'eeprom' for bus in self.buses]
+        if workload == 'presence':
+            return [device_path(first, ADDR_CPLD) + 'module_present_all']
+        if workload == 'psu':
+            return [device_path(first, ADDR_PSU) + node for node in PSU_NODES]
+        if workload == 'fan':
+            return sorted(glob.glob(device_path(first, ADDR_FAN) + 'fan*_input'))
+        return []
+
+    def run(self, workload):
+        nodes = self.nodes(workload)
+        if not nodes:
+            print '%-9s no nodes' % workload
+            return
+
+        latencies = []
+        errors = 0
+        self.reset_counters()
+        start = time.time()
+        for i in range(self.opt['iterations']):
+            for path in nodes:
+                t = time.time()
+                try:
+                    with open(path, 'rb') as f:
+                        f.read()
+                except IOError:
+                    errors += 1
+                latencies.append(time.time() - t)
+        wall = time.time() - start
+        c = self.counters()
+
+        latencies.sort()
+        def pct(p):
+            return latencies[min(len(latencies) - 1, int(len(latencies) * p / 100.0))] * 1e6
+
+        print ('%-9s reads=%d transactions=%d bytes=%d nacks=%d errors=%d wall_ms=%.1f '
+               'p50_us=%.0f p99_us=%.0f max_us=%.0f' % (
+                   workload, len(latencies), c['transactions'], c['bytes'], c['nacks'],
+                   errors, wall * 1000, pct(50), pct(99), latencies[-1] * 1e6))
+
+
+def main():
+    options = {'modules': DEFAULT_MODULES, 'ports': 32, 'iterations': 10,
+               'latency': 100, 'nack': 0, 'seed': 1, 'cpld': 'cpld_as7716',
+               'smbus_only': False, 'uncached': False}
+    usage = __doc__ % {'scriptName': sys.argv[0].split("/")[-1],
+                       'modules': DEFAULT_MODULES}
+
+    try:
+        opts, args = getopt.getopt(sys.argv[1:], 'hdm:p:n:L:N:s:c:Su',
+                                   ['help', 'debug', 'modules=', 'ports=', 'iterations=',
+                                    'latency=', 'nack=', 'seed=', 'cpld=',
+                                    'smbus-only', 'uncached'])
+    except getopt.GetoptError:
+        print usage
+        return 1
+
+    for opt, arg in opts:
+        if opt in ('-h', '--help'):
+            print usage
+            return 0
+        elif opt in ('-d', '--debug'):
+            logging.basicConfig(level=logging.DEBUG)
+        elif opt in ('-m', '--modules'):
+            options['modules'] = arg
+        elif opt in ('-p', '--ports'):
+            options['ports'] = int(arg)
+        elif opt in ('-n', '--iterations'):
+            options['iterations'] = int(arg)
+        elif opt in ('-L', '--latency'):
+            options['latency'] = int(arg)
+        elif opt in ('-N', '--nack'):
+            options['nack'] = int(arg)
+        elif opt in ('-s', '--seed'):
+            options['seed'] = int(arg)
+        elif opt in ('-c', '--cpld'):
+            options['cpld'] = arg
+        elif opt in ('-S', '--smbus-only'):
+            options['smbus_only'] = True
+        elif opt in ('-u', '--uncached'):
+            options['uncached'] = True
+
+    workloads = args or WORKLOADS
+    for w in workloads:
+        if w not in WORKLOADS:
+            print usage
+            return 1
+
+    if os.geteuid() != 0:
+        print 'Root is needed to load the drivers'
+        return 1
+
+    bench = Bench(options)
+    try:
+        if not bench.setup():
+            return 1
+        print ('# ports=%d iterations=%d latency_us=%d nack_ppm=%d seed=%d cpld=%s%s%s' % (
+            options['ports'], options['iterations'], options['latency'], options['nack'],
+            options['seed'], options['cpld'],
+            ' smbus-only' if options['smbus_only'] else '',
+            ' uncached' if options['uncached'] else ''))
+        for w in workloads:
+            bench.run(w)
+    finally:
+        bench.teardown()
+
+    return 0
+
+if __name__ == '__main__':
+    sys.exit(main())
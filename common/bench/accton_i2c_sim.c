@@ -0,0 +1,442 @@
+/*
+ * Simulated I2C adapters for benchmarking the accton drivers
+ *
+ * Copyright (C) 2018 Accton Technology Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+/*
+ * Much like i2c-stub, but made to take timings on: nr_adapters buses
+ * ("accton-i2c-sim <n>"), each answering at every address of chips[]
+ * with a 256 byte register file.  Bytes 128-255 are paged SFF-8436
+ * style, the page being the last value written to byte 127.
+ *
+ *   latency_us		time every transaction takes, spent sleeping
+ *   nack_ppm		transactions per million answered with -ENXIO
+ *   seed			start of the NACK sequence, the same seed gives
+ *					the same NACKs on the same workload
+ *   i2c			0 to model an SMBus only controller
+ *
+ * All but nr_adapters, chips and pages may be changed at run time.
+ * /sys/kernel/debug/accton_i2c_sim/<bus>/ counts transactions, bytes
+ * and nacks of each bus, write anything to reset there to clear them.
+ */
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/slab.h>
+#include <linux/i2c.h>
+#include <linux/delay.h>
+#include <linux/debugfs.h>
+#include <linux/fs.h>
+
+#define DRVNAME				"accton_i2c_sim"
+#define SIM_MAX_ADAPTERS	64
+#define SIM_MAX_CHIPS		8
+#define SIM_MAX_PAGES		256
+#define SIM_PAGE_REG		127
+#define SIM_PAGE_SIZE		128
+
+static unsigned int nr_adapters = 1;
+module_param(nr_adapters, uint, S_IRUGO);
+MODULE_PARM_DESC(nr_adapters, "Number of simulated buses, default 1");
+
+static unsigned short chips[SIM_MAX_CHIPS] = { 0x50, 0x51, 0x5b, 0x60, 0x66 };
+static int nr_chips = 5;
+module_param_array(chips, ushort, &nr_chips, S_IRUGO);
+MODULE_PARM_DESC(chips, "Chip addresses on every bus, default 0x50,0x51,0x5b,0x60,0x66");
+
+static unsigned int pages = 4;
+module_param(pages, uint, S_IRUGO);
+MODULE_PARM_DESC(pages, "Upper pages of each chip, default 4");
+
+static unsigned int latency_us;
+module_param(latency_us, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(latency_us, "Time of one transaction in us, default 0");
+
+static unsigned int nack_ppm;
+module_param(nack_ppm, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(nack_ppm, "NACKed transactions per million, default 0");
+
+static unsigned int seed = 1;
+module_param(seed, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(seed, "Seed of the NACK sequence, default 1");
+
+static bool i2c = true;
+module_param(i2c, bool, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(i2c, "Offer plain I2C transfers besides SMBus, default 1");
+
+static u8 eeprom_id = 0x11;
+module_param(eeprom_id, byte, S_IRUGO);
+MODULE_PARM_DESC(eeprom_id, "Byte 0 of the chips at 0x50, default 0x11 (QSFP28)");
+
+struct sim_chip {
+	unsigned short	addr;
+	u8				pointer;
+	u8				regs[256];		/* 128-255 mirror the selected page */
+	u8				*upper;			/* pages * SIM_PAGE_SIZE */
+};
+
+struct sim_adapter {
+	struct i2c_adapter	adap;
+	struct sim_chip		chips[SIM_MAX_CHIPS];
+	u32					rand;
+	unsigned int		rand_seed;	/* seed 'rand' was started from */
+
+	struct dentry		*dir;
+	u64					transactions;
+	u64					bytes;
+	u64					nacks;
+};
+
+static struct sim_adapter *sim_adapters[SIM_MAX_ADAPTERS];
+static struct dentry *sim_root;
+
+static struct sim_chip *sim_find_chip(struct sim_adapter *sim, u16 addr)
+{
+	int i;
+
+	for (i = 0; i < nr_chips; i++) {
+		if (sim->chips[i].addr == addr) {
+			return &sim->chips[i];
+		}
+	}
+
+	return NULL;
+}
+
+static u8 *sim_reg(struct sim_chip *chip, u8 reg)
+{
+	unsigned int page = chip->regs[SIM_PAGE_REG];
+
+	if (reg < SIM_PAGE_SIZE || page >= pages) {
+		return &chip->regs[reg];
+	}
+
+	return &chip->upper[page * SIM_PAGE_SIZE + reg - SIM_PAGE_SIZE];
+}
+
+static u8 sim_read(struct sim_chip *chip)
+{
+	return *sim_reg(chip, chip->pointer++);
+}
+
+static void sim_write(struct sim_chip *chip, u8 value)
+{
+	*sim_reg(chip, chip->pointer++) = value;
+}
+
+/*
+ * Time and fate of one transaction.  xorshift32 keeps the NACKs the
+ * same from run to run, whatever the kernel's own random state is.
+ */
+static int sim_begin(struct sim_adapter *sim, struct sim_chip *chip)
+{
+	if (sim->rand_seed != seed) {
+		sim->rand_seed = seed;
+		sim->rand = (seed + sim->adap.nr) ? : 1;
+	}
+
+	sim->rand ^= sim->rand << 13;
+	sim->rand ^= sim->rand >> 17;
+	sim->rand ^= sim->rand << 5;
+
+	if (latency_us >= 20) {
+		usleep_range(latency_us, latency_us + latency_us / 8);
+	}
+	else if (latency_us) {
+		udelay(latency_us);
+	}
+
+	sim->transactions++;
+	if (!chip || (sim->rand % 1000000) < nack_ppm) {
+		sim->nacks++;
+		return -ENXIO;
+	}
+
+	return 0;
+}
+
+static int sim_smbus_xfer(struct i2c_adapter *adap, u16 addr, unsigned short flags,
+			char read_write, u8 command, int size, union i2c_smbus_data *data)
+{
+	struct sim_adapter *sim = i2c_get_adapdata(adap);
+	struct sim_chip *chip = sim_find_chip(sim, addr);
+	int i, len, status;
+
+	status = sim_begin(sim, chip);
+	if (status < 0) {
+		return status;
+	}
+
+	switch (size) {
+	case I2C_SMBUS_QUICK:
+		len = 0;
+		break;
+	case I2C_SMBUS_BYTE:
+		if (read_write == I2C_SMBUS_READ) {
+			data->byte = sim_read(chip);
+		}
+		else {
+			chip->pointer = command;
+		}
+		len = 1;
+		break;
+	case I2C_SMBUS_BYTE_DATA:
+		chip->pointer = command;
+		if (read_write == I2C_SMBUS_READ) {
+			data->byte = sim_read(chip);
+		}
+		else {
+			sim_write(chip, data->byte);
+		}
+		len = 1;
+		break;
+	case I2C_SMBUS_WORD_DATA:
+		chip->pointer = command;
+		if (read_write == I2C_SMBUS_READ) {
+			data->word = sim_read(chip);
+			data->word |= sim_read(chip) << 8;
+		}
+		else {
+			sim_write(chip, data->word & 0xff);
+			sim_write(chip, data->word >> 8);
+		}
+		len = 2;
+		break;
+	case I2C_SMBUS_I2C_BLOCK_DATA:
+		chip->pointer = command;
+		len = min_t(int, data->block[0], I2C_SMBUS_BLOCK_MAX);
+		for (i = 1; i <= len; i++) {
+			if (read_write == I2C_SMBUS_READ) {
+				data->block[i] = sim_read(chip);
+			}
+			else {
+				sim_write(chip, data->block[i]);
+			}
+		}
+		break;
+	case I2C_SMBUS_BLOCK_DATA:
+		/* The block length is the register itself, as PMBus strings have it */
+		chip->pointer = command;
+		if (read_write == I2C_SMBUS_READ) {
+			len = min_t(int, sim_read(chip), I2C_SMBUS_BLOCK_MAX);
+			data->block[0] = len;
+			for (i = 1; i <= len; i++) {
+				data->block[i] = sim_read(chip);
+			}
+		}
+		else {
+			len = min_t(int, data->block[0], I2C_SMBUS_BLOCK_MAX);
+			sim_write(chip, len);
+			for (i = 1; i <= len; i++) {
+				sim_write(chip, data->block[i]);
+			}
+		}
+		break;
+	default:
+		return -EOPNOTSUPP;
+	}
+
+	sim->bytes += len;
+	return 0;
+}
+
+/* A write sets the pointer with its first byte, reads continue from it */
+static int sim_master_xfer(struct i2c_adapter *adap, struct i2c_msg *msgs, int num)
+{
+	struct sim_adapter *sim = i2c_get_adapdata(adap);
+	int i, j, status;
+
+	if (!i2c) {
+		return -EOPNOTSUPP;
+	}
+
+	for (i = 0; i < num; i++) {
+		struct sim_chip *chip = sim_find_chip(sim, msgs[i].addr);
+
+		status = sim_begin(sim, chip);
+		if (status < 0) {
+			return status;
+		}
+
+		for (j = 0; j < msgs[i].len; j++) {
+			if (msgs[i].flags & I2C_M_RD) {
+				msgs[i].buf[j] = sim_read(chip);
+			}
+			else if (j == 0) {
+				chip->pointer = msgs[i].buf[0];
+			}
+			else {
+				sim_write(chip, msgs[i].buf[j]);
+			}
+		}
+		sim->bytes += msgs[i].len;
+	}
+
+	return num;
+}
+
+static u32 sim_functionality(struct i2c_adapter *adap)
+{
+	return (i2c ? I2C_FUNC_I2C : 0) | I2C_FUNC_SMBUS_QUICK | I2C_FUNC_SMBUS_BYTE |
+		   I2C_FUNC_SMBUS_BYTE_DATA | I2C_FUNC_SMBUS_WORD_DATA |
+		   I2C_FUNC_SMBUS_BLOCK_DATA | I2C_FUNC_SMBUS_I2C_BLOCK;
+}
+
+static const struct i2c_algorithm sim_algorithm = {
+	.master_xfer	= sim_master_xfer,
+	.smbus_xfer		= sim_smbus_xfer,
+	.functionality	= sim_functionality,
+};
+
+static ssize_t sim_reset_write(struct file *file, const char __user *buf,
+			size_t count, loff_t *ppos)
+{
+	struct sim_adapter *sim = file->private_data;
+
+	i2c_lock_adapter(&sim->adap);
+	sim->transactions = 0;
+	sim->bytes = 0;
+	sim->nacks = 0;
+	i2c_unlock_adapter(&sim->adap);
+
+	return count;
+}
+
+static const struct file_operations sim_reset_fops = {
+	.owner = THIS_MODULE,
+	.open  = simple_open,
+	.write = sim_reset_write,
+};
+
+static void sim_remove_adapter(struct sim_adapter *sim)
+{
+	int i;
+
+	debugfs_remove_recursive(sim->dir);
+	i2c_del_adapter(&sim->adap);
+	for (i = 0; i < nr_chips; i++) {
+		kfree(sim->chips[i].upper);
+	}
+	kfree(sim);
+}
+
+static struct sim_adapter *sim_add_adapter(int index)
+{
+	struct sim_adapter *sim;
+	int i, status;
+
+	sim = kzalloc(sizeof(struct sim_adapter), GFP_KERNEL);
+	if (!sim) {
+		return ERR_PTR(-ENOMEM);
+	}
+
+	for (i = 0; i < nr_chips; i++) {
+		struct sim_chip *chip = &sim->chips[i];
+
+		chip->addr = chips[i];
+		if (pages) {
+			chip->upper = kzalloc(pages * SIM_PAGE_SIZE, GFP_KERNEL);
+			if (!chip->upper) {
+				status = -ENOMEM;
+				goto exit_free;
+			}
+		}
+		if (chip->addr == 0x50) {
+			chip->regs[0] = eeprom_id;
+		}
+	}
+
+	sim->adap.owner = THIS_MODULE;
+	sim->adap.class = I2C_CLASS_HWMON;
+	sim->adap.algo = &sim_algorithm;
+	snprintf(sim->adap.name, sizeof(sim->adap.name), "accton-i2c-sim %d", index);
+	i2c_set_adapdata(&sim->adap, sim);
+
+	status = i2c_add_adapter(&sim->adap);
+	if (status) {
+		goto exit_free;
+	}
+
+	if (!IS_ERR_OR_NULL(sim_root)) {
+		sim->dir = debugfs_create_dir(dev_name(&sim->adap.dev), sim_root);
+	}
+	if (!IS_ERR_OR_NULL(sim->dir)) {
+		debugfs_create_u64("transactions", S_IRUGO, sim->dir, &sim->transactions);
+		debugfs_create_u64("bytes", S_IRUGO, sim->dir, &sim->bytes);
+		debugfs_create_u64("nacks", S_IRUGO, sim->dir, &sim->nacks);
+		debugfs_create_file("reset", S_IWUSR, sim->dir, sim, &sim_reset_fops);
+	}
+
+	return sim;
+
+exit_free:
+	for (i = 0; i < nr_chips; i++) {
+		kfree(sim->chips[i].upper);
+	}
+	kfree(sim);
+	return ERR_PTR(status);
+}
+
+static void sim_cleanup(void)
+{
+	int i;
+
+	for (i = SIM_MAX_ADAPTERS - 1; i >= 0; i--) {
+		if (sim_adapters[i]) {
+			sim_remove_adapter(sim_adapters[i]);
+			sim_adapters[i] = NULL;
+		}
+	}
+
+	debugfs_remove_recursive(sim_root);
+}
+
+static int __init accton_i2c_sim_init(void)
+{
+	int i;
+
+	if (!nr_adapters || nr_adapters > SIM_MAX_ADAPTERS || pages > SIM_MAX_PAGES) {
+		return -EINVAL;
+	}
+
+	sim_root = debugfs_create_dir(DRVNAME, NULL);
+
+	for (i = 0; i < nr_adapters; i++) {
+		struct sim_adapter *sim = sim_add_adapter(i);
+
+		if (IS_ERR(sim)) {
+			sim_cleanup();
+			return PTR_ERR(sim);
+		}
+		sim_adapters[i] = sim;
+	}
+
+	return 0;
+}
+
+static void __exit accton_i2c_sim_exit(void)
+{
+	sim_cleanup();
+}
+
+module_init(accton_i2c_sim_init);
+module_exit(accton_i2c_sim_exit);
+
+MODULE_AUTHOR("Brandon Chuang <brandon_chuang@accton.com.tw>");
+MODULE_DESCRIPTION("Simulated I2C adapters for accton driver benchmarks");
+MODULE_LICENSE("GPL");
@@ -0,0 +1,409 @@
+/*
+ * Agreement and speed of the accton_pmbus_conv.h conversions
+ *
+ * Copyright (C) 2018 Accton Technology Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+/*
+ * insmod runs every conversion against the code the drivers had before
+ * accton_pmbus_conv.h, over every register value (and a sweep of data
+ * values for the data to register direction), then times both.  The
+ * results go to the kernel log.  The module never stays loaded: the
+ * load fails with -EINVAL on any disagreement, with -EAGAIN otherwise.
+ *
+ *   make modules -C /lib/modules/$(uname -r)/build M=$PWD/common/bench
+ *   insmod common/bench/accton_pmbus_conv_bench.ko rounds=20; dmesg | tail
+ */
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/ktime.h>
+#include "../modules/accton_pmbus_conv.h"
+
+static unsigned int rounds = 10;
+module_param(rounds, uint, S_IRUGO);
+MODULE_PARM_DESC(rounds, "Passes over the inputs of each timing, default 10");
+
+/* The PSU core scales of its LINEAR values, and the PMBus core's units */
+static const int trunc_scales[] = { 1, 1000, 1000000 };
+static const int floor_digits[] = { 0, 3, 6 };
+
+/* m, b, R of DIRECT PSUs in the field plus some edge cases */
+static const int direct_coef[][3] = {
+	{ 1, 0, 0 }, { 1, 0, -1 }, { 1, 0, -3 }, { 2, 0, -2 }, { 3, 1000, -2 },
+	{ 20, 0, 0 }, { 100, -5, -1 }, { 9274, -3000, -1 }, { 5, 20, 1 }, { 0, 0, 0 },
+};
+
+static volatile long sink;
+
+/* accton_pmbus_psu.h, before */
+static int ref_two_complement(u16 data, u8 valid_bit, int mask)
+{
+	u16  valid_data  = data & mask;
+	bool is_negative = valid_data >> (valid_bit - 1);
+
+	return is_negative ? (-(((~valid_data) & mask) + 1)) : valid_data;
+}
+
+static int ref_psu_linear11(u16 value, int scale)
+{
+	int exponent = ref_two_complement(value >> 11, 5, 0x1f);
+	int mantissa = ref_two_complement(value & 0x7ff, 11, 0x7ff);
+
+	return (exponent >= 0) ? (mantissa << exponent) * scale :
+							 (mantissa * scale) / (1 << -exponent);
+}
+
+static int ref_psu_linear16(u16 value, u8 vout_mode, int scale)
+{
+	int exponent = ref_two_complement(vout_mode, 5, 0x1f);
+	int mantissa = value;
+
+	return (exponent > 0) ? (mantissa << exponent) * scale :
+							(mantissa * scale) / (1 << -exponent);
+}
+
+/* accton_pmbus_3y.c, before; digits 0 for fans, 3, 6 for power */
+static long ref_reg2data_linear(u16 data, bool linear16, int vout_exp, int digits)
+{
+	s16 exponent;
+	s32 mantissa;
+	long val;
+
+	if (linear16) {
+		exponent = vout_exp;
+		mantissa = (u16) data;
+	}
+	else {
+		exponent = ((s16)data) >> 11;
+		mantissa = ((s16)((data & 0x7ff) << 5)) >> 5;
+	}
+
+	val = mantissa;
+	if (digits >= 3)
+		val = val * 1000L;
+	if (digits >= 6)
+		val = val * 1000L;
+
+	if (exponent >= 0)
+		val <<= exponent;
+	else
+		val >>= -exponent;
+
+	return val;
+}
+
+static long ref_reg2data_direct(u16 data, long m, long b, long R, int digits)
+{
+	long val = (s16) data;
+
+	if (m == 0)
+		return 0;
+
+	R = -R;
+	if (digits >= 3) {
+		R += 3;
+		b *= 1000;
+	}
+	if (digits >= 6) {
+		R += 3;
+		b *= 1000;
+	}
+
+	while (R > 0) {
+		val *= 10;
+		R--;
+	}
+	while (R < 0) {
+		val = DIV_ROUND_CLOSEST(val, 10);
+		R++;
+	}
+
+	return (val - b) / m;
+}
+
+static u16 ref_data2reg_linear(long val, bool linear16, int vout_exp, int digits)
+{
+	s16 exponent = 0, mantissa;
+	bool negative = false;
+
+	if (val == 0)
+		return 0;
+
+	if (linear16) {
+		if (val < 0)
+			return 0;
+		if (vout_exp < 0)
+			val <<= -vout_exp;
+		else
+			val >>= vout_exp;
+		val = DIV_ROUND_CLOSEST(val, 1000);
+		return val & 0xffff;
+	}
+
+	if (val < 0) {
+		negative = true;
+		val = -val;
+	}
+
+	if (digits == 6)
+		val = DIV_ROUND_CLOSEST(val, 1000L);
+	if (digits == 0)
+		val = val * 1000;
+
+	while (val >= PMBUS_CONV_MAX_MANTISSA && exponent < 15) {
+		exponent++;
+		val >>= 1;
+	}
+	while (val < PMBUS_CONV_MIN_MANTISSA && exponent > -15) {
+		exponent--;
+		val <<= 1;
+	}
+
+	mantissa = DIV_ROUND_CLOSEST(val, 1000);
+	if (mantissa > 0x3ff)
+		mantissa = 0x3ff;
+	if (negative)
+		mantissa = -mantissa;
+
+	return (mantissa & 0x7ff) | ((exponent << 11) & 0xf800);
+}
+
+static u16 ref_data2reg_direct(long val, long m, long b, long R, int digits)
+{
+	if (digits >= 6) {
+		R -= 3;
+		b *= 1000;
+	}
+	if (digits >= 3) {
+		R -= 3;
+		b *= 1000;
+	}
+	val = val * m + b;
+
+	while (R > 0) {
+		val *= 10;
+		R--;
+	}
+	while (R < 0) {
+		val = DIV_ROUND_CLOSEST(val, 10);
+		R++;
+	}
+
+	return val;
+}
+
+/* The accton_pmbus_3y.c wrappers, after */
+static long new_reg2data_linear(u16 reg, bool linear16, int vout_exp, int digits)
+{
+	if (linear16)
+		return pmbus_conv_linear_floor(reg, vout_exp, 1000L);
+
+	return pmbus_conv_linear_floor(pmbus_conv_linear11_mant(reg),
+								   pmbus_conv_linear11_exp(reg),
+								   pmbus_conv_pow10[digits]);
+}
+
+static u16 new_data2reg_linear(long val, bool linear16, int vout_exp, int digits)
+{
+	if (linear16)
+		return pmbus_conv_data2linear16(val, vout_exp);
+
+	if (val == 0)
+		return 0;
+	if (digits == 6)
+		val = DIV_ROUND_CLOSEST(val, 1000L);
+	if (digits == 0)
+		val = val * 1000;
+
+	return pmbus_conv_data2linear11(val);
+}
+
+/* Data values: dense around zero, then growing by an eighth */
+static long data_value(unsigned int i, bool *last)
+{
+	static long v;
+
+	if (i == 0)
+		v = 0;
+	else if (v < 4096)
+		v++;
+	else
+		v += v / 8;
+
+	*last = (v > 2000000000L / 16);
+	return (i & 1) ? -v : v;
+}
+
+#define MISMATCH(what, in, ref, new) \
+	do { \
+		pr_err("accton_pmbus_conv: %s(0x%lx): %ld before, %ld now\n", \
+			   what, (long)(in), (long)(ref), (long)(new)); \
+		errors++; \
+	} while (0)
+
+static int check(void)
+{
+	int errors = 0, s, e, d, c;
+	unsigned int reg, i;
+	bool last = false;
+
+	for (reg = 0; reg <= 0xffff; reg++) {
+		for (s = 0; s < ARRAY_SIZE(trunc_scales); s++) {
+			if (ref_psu_linear11(reg, trunc_scales[s]) !=
+				pmbus_conv_linear_trunc(pmbus_conv_linear11_mant(reg),
+										pmbus_conv_linear11_exp(reg), trunc_scales[s]))
+				MISMATCH("psu_linear11", reg, ref_psu_linear11(reg, trunc_scales[s]), 0);
+			for (e = 0; e < 32; e++) {
+				if (ref_psu_linear16(reg, e, trunc_scales[s]) !=
+					pmbus_conv_linear_trunc(reg, pmbus_conv_vout_exp(e), trunc_scales[s]))
+					MISMATCH("psu_linear16", reg, ref_psu_linear16(reg, e, trunc_scales[s]), e);
+			}
+		}
+
+		for (d = 0; d < ARRAY_SIZE(floor_digits); d++) {
+			long ref = ref_reg2data_linear(reg, false, 0, floor_digits[d]);
+			long new = new_reg2data_linear(reg, false, 0, floor_digits[d]);
+
+			if (ref != new)
+				MISMATCH("reg2data_linear11", reg, ref, new);
+
+			for (c = 0; c < ARRAY_SIZE(direct_coef); c++) {
+				struct pmbus_conv_direct conv;
+
+				pmbus_conv_direct_init(&conv, direct_coef[c][0], direct_coef[c][1],
+									   direct_coef[c][2], floor_digits[d]);
+				ref = ref_reg2data_direct(reg, direct_coef[c][0], direct_coef[c][1],
+										  direct_coef[c][2], floor_digits[d]);
+				new = pmbus_conv_direct2data(&conv, reg);
+				if (ref != new)
+					MISMATCH("reg2data_direct", reg, ref, new);
+			}
+		}
+
+		for (e = -16; e < 16; e++) {
+			long ref = ref_reg2data_linear(reg, true, e, 3);
+			long new = new_reg2data_linear(reg, true, e, 3);
+
+			if (ref != new)
+				MISMATCH("reg2data_linear16", reg, ref, new);
+		}
+
+		if (errors > 16)
+			return errors;
+	}
+
+	for (i = 0; !last; i++) {
+		long val = data_value(i, &last);
+
+		for (d = 0; d < ARRAY_SIZE(floor_digits); d++) {
+			u16 ref = ref_data2reg_linear(val, false, 0, floor_digits[d]);
+			u16 new = new_data2reg_linear(val, false, 0, floor_digits[d]);
+
+			if (ref != new)
+				MISMATCH("data2reg_linear11", val, ref, new);
+
+			for (c = 0; c < ARRAY_SIZE(direct_coef); c++) {
+				struct pmbus_conv_direct conv;
+
+				pmbus_conv_direct_init(&conv, direct_coef[c][0], direct_coef[c][1],
+									   direct_coef[c][2], floor_digits[d]);
+				ref = ref_data2reg_direct(val, direct_coef[c][0], direct_coef[c][1],
+										  direct_coef[c][2], floor_digits[d]);
+				new = pmbus_conv_data2direct(&conv, val);
+				if (ref != new)
+					MISMATCH("data2reg_direct", val, ref, new);
+			}
+		}
+
+		for (e = -16; e < 16; e++) {
+			if (ref_data2reg_linear(val, true, e, 3) != new_data2reg_linear(val, true, e, 3))
+				MISMATCH("data2reg_linear16", val, ref_data2reg_linear(val, true, e, 3),
+						 new_data2reg_linear(val, true, e, 3));
+		}
+
+		if (errors > 16)
+			return errors;
+	}
+
+	return errors;
+}
+
+/* ns per conversion of 'expr' over every register value */
+#define TIME_REGS(expr) \
+	({ \
+		ktime_t __start = ktime_get(); \
+		unsigned int __r, reg; \
+		for (__r = 0; __r < rounds; __r++) \
+			for (reg = 0; reg <= 0xffff; reg++) \
+				sink += (expr); \
+		div64_s64(ktime_to_ns(ktime_sub(ktime_get(), __start)), \
+				  (s64)rounds * 0x10000); \
+	})
+
+static void report(const char *name, s64 before, s64 now)
+{
+	pr_info("accton_pmbus_conv: %-18s %4lld ns before, %4lld ns now\n", name, before, now);
+}
+
+static void timing(void)
+{
+	struct pmbus_conv_direct conv;
+
+	pmbus_conv_direct_init(&conv, 9274, -3000, -1, 3);
+
+	report("psu_linear11",
+		   TIME_REGS(ref_psu_linear11(reg, 1000)),
+		   TIME_REGS(pmbus_conv_linear_trunc(pmbus_conv_linear11_mant(reg),
+											 pmbus_conv_linear11_exp(reg), 1000)));
+	report("psu_linear16",
+		   TIME_REGS(ref_psu_linear16(reg, 0x17, 1000)),
+		   TIME_REGS(pmbus_conv_linear_trunc(reg, pmbus_conv_vout_exp(0x17), 1000)));
+	report("reg2data_linear11",
+		   TIME_REGS(ref_reg2data_linear(reg, false, 0, 3)),
+		   TIME_REGS(new_reg2data_linear(reg, false, 0, 3)));
+	report("reg2data_direct",
+		   TIME_REGS(ref_reg2data_direct(reg, 9274, -3000, -1, 3)),
+		   TIME_REGS(pmbus_conv_direct2data(&conv, reg)));
+	report("data2reg_linear11",
+		   TIME_REGS(ref_data2reg_linear((long)reg * 37, false, 0, 3)),
+		   TIME_REGS(new_data2reg_linear((long)reg * 37, false, 0, 3)));
+}
+
+static int __init accton_pmbus_conv_bench_init(void)
+{
+	int errors = check();
+
+	if (errors) {
+		pr_err("accton_pmbus_conv: %d conversion(s) differ\n", errors);
+		return -EINVAL;
+	}
+
+	pr_info("accton_pmbus_conv: all conversions agree\n");
+	if (rounds) {
+		timing();
+	}
+
+	/* Nothing to keep loaded */
+	return -EAGAIN;
+}
+
+module_init(accton_pmbus_conv_bench_init);
+
+MODULE_AUTHOR("Brandon Chuang <brandon_chuang@accton.com.tw>");
+MODULE_DESCRIPTION("accton PMBus conversion check and micro benchmark");
+MODULE_LICENSE("GPL");
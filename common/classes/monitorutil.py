@@ -0,0 +1,188 @@
+#!/usr/bin/env python
+#
+# Copyright (C) 2018 Accton Technology Corporation
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+# ------------------------------------------------------------------
+# HISTORY:
+#    mm/dd/yyyy (A.D.)
+#    10/14/2026: Shared scheduler for the platform monitor
+# ------------------------------------------------------------------
+
+try:
+    import os
+    import glob
+    import time
+    import select
+    import logging
+except ImportError as e:
+    raise ImportError('%s - required module not found' % str(e))
+
+
+class SysfsCache(object):
+    """sysfs nodes read at most once per tick.
+
+    Every node is opened once and re-read in place with lseek/read.  A
+    path may hold a glob (hwmon*/), it is resolved when the node is
+    opened.  Values are kept until new_tick(), so every monitor task of
+    a tick sees the same reading at the cost of one read."""
+
+    def __init__(self):
+        self._fds = {}
+        self._values = {}
+
+    def new_tick(self):
+        self._values.clear()
+
+    def invalidate(self, path):
+        """Forget the value of the current tick, e.g. after a write"""
+        self._values.pop(path, None)
+
+    def fd(self, path):
+        """The descriptor of 'path', opened on first use"""
+        fd = self._fds.get(path)
+        if fd is not None:
+            return fd
+
+        for filename in glob.glob(path):
+            try:
+                fd = os.open(filename, os.O_RDONLY)
+            except OSError as e:
+                logging.error('GET. unable to open file: %s', str(e))
+                return None
+            self._fds[path] = fd
+            return fd
+
+        logging.debug('GET. no such node: %s', path)
+        return None
+
+    def read(self, path):
+        """The stripped content of 'path', None if it cannot be read"""
+        if path in self._values:
+            return self._values[path]
+
+        content = None
+        fd = self.fd(path)
+        if fd is not None:
+            try:
+                os.lseek(fd, 0, os.SEEK_SET)
+                content = os.read(fd, 64).rstrip()
+            except OSError as e:
+                logging.debug('GET. unable to read file. device_path:%s, %s', path, str(e))
+                self.close(path)
+
+        self._values[path] = content
+        return content
+
+    def close(self, path=None):
+        paths = [path] if path is not None else self._fds.keys()
+        for p in paths:
+            fd = self._fds.pop(p, None)
+            if fd is not None:
+                try:
+                    os.close(fd)
+                except OSError:
+                    pass
+            self._values.pop(p, None)
+
+
+class MonitorScheduler(object):
+    """Runs every registered monitor task on its own period in one process.
+
+    Tasks that are due together share a tick, and so share the reads of
+    the SysfsCache.  Nodes passed as 'notify' are poll()ed between ticks:
+    a driver that sysfs_notify()s one of them runs its tasks right away
+    instead of at their next period."""
+
+    def __init__(self, cache):
+        self.cache = cache
+        self._tasks = []
+        self._watch = {}    # fd -> (path, tasks woken by it)
+        self._poll = select.poll()
+
+    def register(self, name, period, func, notify=()):
+        task = {'name': name, 'period': period, 'func': func, 'next': 0}
+        self._tasks.append(task)
+
+        for path in notify:
+            self._add_watch(path, [task])
+
+        return task
+
+    def _add_watch(self, path, tasks):
+        fd = self.cache.fd(path)
+        if fd is None:
+            return
+        if fd not in self._watch:
+            self._watch[fd] = (path, [])
+            self._poll.register(fd, select.POLLPRI | select.POLLERR)
+        self._watch[fd][1].extend(tasks)
+
+    def _run(self, task):
+        try:
+            task['func']()
+        except Exception as e:
+            logging.error('%s failed: %s', task['name'], str(e))
+
+    def run_once(self):
+        now = time.time()
+        due = [t for t in self._tasks if t['next'] <= now]
+        if due:
+            self.cache.new_tick()
+            for task in due:
+                self._run(task)
+                task['next'] += task['period']
+                if task['next'] <= now:
+                    # late by more than a period, do not try to catch up
+                    task['next'] = now + task['period']
+
+        if not self._tasks:
+            return
+
+        timeout = max(0, min(t['next'] for t in self._tasks) - time.time())
+        try:
+            events = self._poll.poll(timeout * 1000)
+        except select.error:
+            return
+
+        woken = []
+        notified = []
+        for fd, event in events:
+            if fd not in self._watch:
+                continue
+            if event & select.POLLNVAL:
+                # the cache dropped the node after a read error, watch
+                # the fd it opens in its place
+                self._poll.unregister(fd)
+                path, tasks = self._watch.pop(fd)
+                self._add_watch(path, tasks)
+                continue
+            path, tasks = self._watch[fd]
+            notified.append(path)
+            for task in tasks:
+                if task not in woken:
+                    woken.append(task)
+
+        if notified:
+            self.cache.new_tick()
+            for task in woken:
+                self._run(task)
+            # a read after the event is what re-arms the notification
+            for path in notified:
+                self.cache.read(path)
+
+    def run(self):
+        while True:
+            self.run_once()
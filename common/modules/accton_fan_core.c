@@ -0,0 +1,1387 @@
+/*
+ * Common fan CPLD driver core for accton platforms
+ *
+ * Copyright (C)  Brandon Chuang <brandon_chuang@accton.com.tw>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+/*
+ * The as7312/as7326/as7712/as7716/as7726 fan drivers only carry a
+ * struct fan_core_platform: where the fan board CPLD keeps its
+ * registers, which optional attributes the board has and which lm75s
+ * make up sys_temp.  The sysfs ABI, register cache, block reads and the
+ * lm75 lookup are implemented once here.
+ *
+ * fan_ctrl_* is an optional closed loop in place of the platform
+ * monitor scripts.  Userspace loads the level table of its thermal
+ * policy and sets fan_ctrl_enable; a delayed work then moves between
+ * levels on sys_temp with the table's hysteresis, runs the fans at
+ * fan_ctrl_fault_duty while a fan or sensor is missing or faulty, and
+ * writes the duty cycle only when it changes.
+ *
+ * The loop runs every fan_ctrl_interval ms.  With fan_ctrl_max_interval
+ * above that, the period doubles on each tick that sys_temp stays within
+ * fan_ctrl_deadband of the previous tick and of no threshold of the level,
+ * up to fan_ctrl_max_interval, and falls back to fan_ctrl_interval as soon
+ * as the temperature moves, nears a threshold, changes level or a fault
+ * shows.  fan_ctrl_cur_interval is the period in use.
+ *
+ * fanN_fault and fanN_present are sysfs_notify()ed when an update
+ * sees them change, so a monitor can poll() them.  Updates run on reads
+ * and on each tick of the control loop.
+ */
+
+#include <linux/module.h>
+#include <linux/jiffies.h>
+#include <linux/i2c.h>
+#include <linux/hwmon.h>
+#include <linux/hwmon-sysfs.h>
+#include <linux/err.h>
+#include <linux/mutex.h>
+#include <linux/sysfs.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+#include <linux/workqueue.h>
+#include "accton_fan_core.h"
+#include "accton_i2c_stats.h"
+#include "accton_telemetry.h"
+
+#define FAN_CORE_UPDATE_INTERVAL		(HZ + HZ / 2)
+#define FAN_CORE_MAX_UPDATE_INTERVAL	60000	/* ms */
+#define FAN_CORE_BLOCK_READ_MAX_FAILS	3		/* in a row, before byte reads only */
+
+#define FAN_DUTY_CYCLE_REG_MASK			0xF
+#define FAN_MAX_DUTY_CYCLE				100
+#define FAN_REG_VAL_TO_SPEED_RPM_STEP	100
+
+#define THERMAL_SENSORS_DRIVER			"lm75"
+#define LM75_REG_TEMP					0x00
+#define MAX_LM75_CLIENTS				8
+
+#define FAN_CTRL_MAX_LEVELS				8
+#define FAN_CTRL_DEFAULT_INTERVAL		500		/* ms */
+#define FAN_CTRL_MIN_INTERVAL			100
+#define FAN_CTRL_MAX_INTERVAL			60000
+#define FAN_CTRL_DEFAULT_DEADBAND		1000	/* milli-degrees */
+
+/* The first FAN_CORE_NUM_REGS entries are also the index in reg_val[] */
+enum sysfs_fan_attributes {
+	FAN_PRESENT_REG,
+	FAN_DIRECTION_REG,
+	FAN_DUTY_CYCLE_PERCENTAGE, /* Only one CPLD register to control duty cycle for all fans */
+	FAN1_FRONT_SPEED_RPM,
+	FAN2_FRONT_SPEED_RPM,
+	FAN3_FRONT_SPEED_RPM,
+	FAN4_FRONT_SPEED_RPM,
+	FAN5_FRONT_SPEED_RPM,
+	FAN6_FRONT_SPEED_RPM,
+	FAN1_REAR_SPEED_RPM,
+	FAN2_REAR_SPEED_RPM,
+	FAN3_REAR_SPEED_RPM,
+	FAN4_REAR_SPEED_RPM,
+	FAN5_REAR_SPEED_RPM,
+	FAN6_REAR_SPEED_RPM,
+	FAN_CORE_NUM_REGS,
+	FAN1_DIRECTION = FAN_CORE_NUM_REGS,
+	FAN2_DIRECTION,
+	FAN3_DIRECTION,
+	FAN4_DIRECTION,
+	FAN5_DIRECTION,
+	FAN6_DIRECTION,
+	FAN1_PRESENT,
+	FAN2_PRESENT,
+	FAN3_PRESENT,
+	FAN4_PRESENT,
+	FAN5_PRESENT,
+	FAN6_PRESENT,
+	FAN1_FAULT,
+	FAN2_FAULT,
+	FAN3_FAULT,
+	FAN4_FAULT,
+	FAN5_FAULT,
+	FAN6_FAULT,
+	FAN_PWM_ENABLE,
+	FAN_SYS_TEMP,
+	FAN_CTRL_ENABLE,
+	FAN_CTRL_POLICY_F2B,
+	FAN_CTRL_POLICY_B2F,
+	FAN_CTRL_FAULT_DUTY,
+	FAN_CTRL_INTERVAL,
+	FAN_CTRL_LEVEL,
+	FAN_CTRL_MAX_INTERVAL_MS,
+	FAN_CTRL_DEADBAND,
+	FAN_CTRL_CUR_INTERVAL,
+	FAN_LAST_UPDATE_MS,
+	FAN_UPDATE_INTERVAL_MS,
+	FAN_VALID
+};
+
+/* Runs of consecutive registers, each read with one block read */
+struct fan_reg_run {
+	u8	start;	/* Index in reg_val[] */
+	u8	len;
+};
+
+/* One level of a control policy: its duty cycle, the sys_temp below
+ * which to drop to the previous level and above which to go to the next
+ */
+struct fan_ctrl_level {
+	int	duty;
+	int	down;
+	int	up;
+};
+
+struct fan_ctrl_policy {
+	struct fan_ctrl_level	level[FAN_CTRL_MAX_LEVELS];
+	int						num_levels;
+};
+
+enum fan_ctrl_dir {
+	FAN_CTRL_F2B,	/* also boards without a direction register */
+	FAN_CTRL_B2F,	/* falls back to the F2B table if empty */
+	FAN_CTRL_NUM_DIRS
+};
+
+/* LM75 clients summed into sys_temp.  They are looked up once on the
+ * i2c bus and kept, with a reference, until one of them is unbound or
+ * another lm75 binds.  The temperature is read through the cached client.
+ */
+struct lm75_lookup {
+	const struct fan_core_platform	*plat;
+	struct i2c_client				*clients[MAX_LM75_CLIENTS];
+	int								num;
+};
+
+/* Each client has this additional data
+ */
+struct fan_core_data {
+	struct i2c_client				*client;
+	struct device					*hwmon_dev;
+	struct mutex					update_lock;
+	const struct fan_core_platform	*plat;
+	char							valid;			/* != 0 if registers are valid */
+	unsigned long					last_updated;	/* In jiffies */
+	unsigned long					update_interval;	/* In jiffies */
+	u8								reg[FAN_CORE_NUM_REGS];		/* CPLD register of each value */
+	u8								reg_val[FAN_CORE_NUM_REGS];	/* Register value */
+	struct fan_reg_run				runs[FAN_CORE_NUM_REGS];
+	int								num_runs;
+	struct i2c_stats				*stats;
+	struct accton_tlm				*tlm;
+	u8								block_read;		/* != 0 if the CPLD answers block reads */
+	u8								block_fails;	/* Block reads in a row that only bytes answered */
+	u8								enable;
+	int								duty_reg_val;	/* Duty cycle register last written, -1 if unknown */
+	bool							edges_valid;	/* != 0 once fault/present_mask are set */
+	u8								fault_mask;		/* Bit per fan, as of the last update */
+	u8								present_mask;
+
+	struct mutex					lm75_lock;
+	struct lm75_lookup				lm75;
+	bool							lm75_valid;
+	unsigned int					lm75_gen;		/* Bumped on each invalidation */
+	struct notifier_block			lm75_nb;
+
+	struct mutex					ctrl_lock;
+	struct delayed_work				ctrl_work;
+	struct fan_ctrl_policy			ctrl_policy[FAN_CTRL_NUM_DIRS];
+	bool							ctrl_enable;
+	int								ctrl_level;
+	int								ctrl_duty;		/* Last duty cycle written, -1 if none */
+	int								ctrl_fault_duty;
+	unsigned int					ctrl_interval;	/* ms */
+	unsigned int					ctrl_max_interval;	/* ms, == ctrl_interval when not adaptive */
+	unsigned int					ctrl_cur_interval;	/* ms, between the two */
+	int								ctrl_deadband;	/* milli-degrees */
+	int								ctrl_last_temp;	/* sys_temp of the previous tick */
+	bool							ctrl_last_valid;
+};
+
+static int fan_core_read_value(struct i2c_client *client, u8 reg)
+{
+	struct fan_core_data *data = i2c_get_clientdata(client);
+
+	return i2c_stats_read_byte_data(data->stats, client, reg);
+}
+
+static int fan_core_write_value(struct i2c_client *client, u8 reg, u8 value)
+{
+	struct fan_core_data *data = i2c_get_clientdata(client);
+
+	return i2c_stats_write_byte_data(data->stats, client, reg, value);
+}
+
+/* fan utility functions
+ */
+static u32 reg_val_to_duty_cycle(u8 reg_val)
+{
+	reg_val &= FAN_DUTY_CYCLE_REG_MASK;
+	return ((u32)(reg_val+1) * 625 + 75)/ 100;
+}
+
+static u8 duty_cycle_to_reg_val(u8 duty_cycle)
+{
+	return ((u32)duty_cycle * 100 / 625) - 1;
+}
+
+static u32 reg_val_to_speed_rpm(u8 reg_val)
+{
+	return (u32)reg_val * FAN_REG_VAL_TO_SPEED_RPM_STEP;
+}
+
+static u8 reg_val_to_direction(u8 reg_val, int id)
+{
+	return (reg_val & (1 << id)) ? 1 : 0;
+}
+
+static u8 reg_val_to_is_present(u8 reg_val, int id)
+{
+	return (reg_val & (1 << id)) ? 0 : 1;
+}
+
+static u8 is_fan_fault(struct fan_core_data *data, int id)
+{
+	/* Check if the speed of front or rear fan is ZERO
+	 */
+	return !(reg_val_to_speed_rpm(data->reg_val[FAN1_FRONT_SPEED_RPM + id]) &&
+			 reg_val_to_speed_rpm(data->reg_val[FAN1_REAR_SPEED_RPM + id]));
+}
+
+/* Fan id of a per fan attribute, -1 for the others */
+static int fan_core_attr_fan(int index)
+{
+	if (index >= FAN1_FRONT_SPEED_RPM && index <= FAN6_FRONT_SPEED_RPM)
+		return index - FAN1_FRONT_SPEED_RPM;
+	if (index >= FAN1_REAR_SPEED_RPM && index <= FAN6_REAR_SPEED_RPM)
+		return index - FAN1_REAR_SPEED_RPM;
+	if (index >= FAN1_DIRECTION && index <= FAN6_DIRECTION)
+		return index - FAN1_DIRECTION;
+	if (index >= FAN1_PRESENT && index <= FAN6_PRESENT)
+		return index - FAN1_PRESENT;
+	if (index >= FAN1_FAULT && index <= FAN6_FAULT)
+		return index - FAN1_FAULT;
+
+	return -1;
+}
+
+/* Build the register map and its runs from the platform table.  Values
+ * the board does not have are left out of the runs and never read.
+ */
+static void fan_core_init_regs(struct fan_core_data *data)
+{
+	const struct fan_core_platform *plat = data->plat;
+	int i, prev = -1;
+
+	data->reg[FAN_PRESENT_REG] = plat->present_reg;
+	data->reg[FAN_DIRECTION_REG] = (plat->direction_reg >= 0) ? plat->direction_reg : 0;
+	data->reg[FAN_DUTY_CYCLE_PERCENTAGE] = plat->duty_reg;
+	for (i = 0; i < FAN_CORE_MAX_FANS; i++) {
+		data->reg[FAN1_FRONT_SPEED_RPM + i] = plat->front_speed_reg + i;
+		data->reg[FAN1_REAR_SPEED_RPM + i] = plat->rear_speed_reg + i;
+	}
+
+	for (i = 0; i < FAN_CORE_NUM_REGS; i++) {
+		if (i == FAN_DIRECTION_REG && plat->direction_reg < 0)
+			continue;
+		if (fan_core_attr_fan(i) >= plat->num_fans)
+			continue;
+
+		if (prev >= 0 && prev == i - 1 && data->reg[i] == data->reg[prev] + 1 &&
+			data->runs[data->num_runs - 1].len < I2C_SMBUS_BLOCK_MAX) {
+			data->runs[data->num_runs - 1].len++;
+		}
+		else {
+			data->runs[data->num_runs].start = i;
+			data->runs[data->num_runs].len   = 1;
+			data->num_runs++;
+		}
+		prev = i;
+	}
+}
+
+/* Read every run into reg_val[], one block read per run when the CPLD
+ * supports it, else one byte at a time
+ */
+static int fan_core_read_regs(struct i2c_client *client, struct fan_core_data *data)
+{
+	int i, j, status;
+
+	for (i = 0; i < data->num_runs; i++) {
+		const struct fan_reg_run *run = &data->runs[i];
+
+		if (data->block_read && run->len > 1) {
+			status = i2c_stats_read_i2c_block_data(data->stats, client, data->reg[run->start],
+												   run->len, &data->reg_val[run->start]);
+			if (status == run->len) {
+				data->block_fails = 0;
+				continue;
+			}
+
+			dev_dbg(&client->dev, "block reg %d, err %d\n", data->reg[run->start], status);
+		}
+
+		for (j = run->start; j < run->start + run->len; j++) {
+			status = fan_core_read_value(client, data->reg[j]);
+
+			if (status < 0) {
+				data->valid = 0;
+				dev_dbg(&client->dev, "reg %d, err %d\n", data->reg[j], status);
+				return status;
+			}
+			else {
+				data->reg_val[j] = status;
+			}
+		}
+
+		/* The bytes came back where the block read did not.  One miss can
+		 * be a transient NACK, stop trying it only when it keeps missing.
+		 */
+		if (data->block_read && run->len > 1 &&
+			++data->block_fails >= FAN_CORE_BLOCK_READ_MAX_FAILS) {
+			dev_info(&client->dev, "block reads keep failing, using byte reads\n");
+			data->block_read = 0;
+		}
+	}
+
+	return 0;
+}
+
+/* Caller holds update_lock.  Returns the fans whose fault or present
+ * state changed since the previous update.
+ */
+static void fan_core_update_edges(struct fan_core_data *data, u8 *fault_changed,
+								  u8 *present_changed)
+{
+	u8 fault = 0, present = 0;
+	int i;
+
+	for (i = 0; i < data->plat->num_fans; i++) {
+		if (is_fan_fault(data, i))
+			fault |= BIT(i);
+		if (reg_val_to_is_present(data->reg_val[FAN_PRESENT_REG], i))
+			present |= BIT(i);
+	}
+
+	if (data->edges_valid) {
+		*fault_changed   = fault ^ data->fault_mask;
+		*present_changed = present ^ data->present_mask;
+	}
+
+	data->fault_mask   = fault;
+	data->present_mask = present;
+	data->edges_valid  = 1;
+}
+
+/* Caller holds update_lock.  Sent out by the telemetry module only if
+ * a value differs from the previous update.
+ */
+static void fan_core_publish(struct fan_core_data *data)
+{
+	struct accton_tlm_value v[1 + FAN_CORE_MAX_FANS * 4];
+	int i, n = 0;
+
+	v[n].name = "fan_duty_cycle_percentage";
+	v[n].index = 0;
+	v[n++].data = reg_val_to_duty_cycle(data->reg_val[FAN_DUTY_CYCLE_PERCENTAGE]);
+
+	for (i = 0; i < data->plat->num_fans; i++) {
+		v[n].name = "front_speed_rpm";
+		v[n].index = i + 1;
+		v[n++].data = reg_val_to_speed_rpm(data->reg_val[FAN1_FRONT_SPEED_RPM + i]);
+		v[n].name = "rear_speed_rpm";
+		v[n].index = i + 1;
+		v[n++].data = reg_val_to_speed_rpm(data->reg_val[FAN1_REAR_SPEED_RPM + i]);
+		v[n].name = "fault";
+		v[n].index = i + 1;
+		v[n++].data = !!(data->fault_mask & BIT(i));
+		v[n].name = "present";
+		v[n].index = i + 1;
+		v[n++].data = !!(data->present_mask & BIT(i));
+	}
+
+	accton_tlm_publish(data->tlm, v, n, NULL, 0);
+}
+
+/* Wake up pollers of the attributes of the fans that changed */
+static void fan_core_notify_edges(struct device *dev, u8 fault_changed, u8 present_changed)
+{
+	char name[20];
+	int i;
+
+	for (i = 0; i < FAN_CORE_MAX_FANS; i++) {
+		if (fault_changed & BIT(i)) {
+			snprintf(name, sizeof(name), "fan%d_fault", i + 1);
+			sysfs_notify(&dev->kobj, NULL, name);
+			snprintf(name, sizeof(name), "fan%d_fault", i + 11);
+			sysfs_notify(&dev->kobj, NULL, name);
+		}
+		if (present_changed & BIT(i)) {
+			snprintf(name, sizeof(name), "fan%d_present", i + 1);
+			sysfs_notify(&dev->kobj, NULL, name);
+		}
+	}
+}
+
+static struct fan_core_data *fan_core_update_device(struct device *dev)
+{
+	struct i2c_client *client = to_i2c_client(dev);
+	struct fan_core_data *data = i2c_get_clientdata(client);
+	u8 fault_changed = 0, present_changed = 0;
+
+	mutex_lock(&data->update_lock);
+
+	if (time_after(jiffies, data->last_updated + data->update_interval) ||
+		!data->valid) {
+		i2c_stats_cache(data->stats, false);
+		dev_dbg(&client->dev, "Starting %s update\n", data->plat->name);
+		data->valid = 0;
+
+		/* Update fan data
+		 */
+		if (fan_core_read_regs(client, data) < 0) {
+			mutex_unlock(&data->update_lock);
+			return data;
+		}
+
+		data->last_updated = jiffies;
+		data->valid = 1;
+
+		/* Changed behind our back, e.g. by the CPLD watchdog */
+		if (data->duty_reg_val >= 0 &&
+			(data->reg_val[FAN_DUTY_CYCLE_PERCENTAGE] & FAN_DUTY_CYCLE_REG_MASK) != data->duty_reg_val) {
+			data->duty_reg_val = -1;
+		}
+
+		fan_core_update_edges(data, &fault_changed, &present_changed);
+		fan_core_publish(data);
+	}
+	else {
+		i2c_stats_cache(data->stats, true);
+	}
+
+	mutex_unlock(&data->update_lock);
+
+	if (fault_changed || present_changed) {
+		fan_core_notify_edges(dev, fault_changed, present_changed);
+	}
+
+	return data;
+}
+
+static ssize_t fan_show_value(struct device *dev, struct device_attribute *da,
+							  char *buf)
+{
+	struct sensor_device_attribute *attr = to_sensor_dev_attr(da);
+	struct fan_core_data *data = fan_core_update_device(dev);
+	ssize_t ret = 0;
+
+	if (data->valid) {
+		switch (attr->index) {
+		case FAN_DUTY_CYCLE_PERCENTAGE:
+			ret = sprintf(buf, "%u\n", reg_val_to_duty_cycle(data->reg_val[FAN_DUTY_CYCLE_PERCENTAGE]));
+			break;
+		case FAN1_FRONT_SPEED_RPM ... FAN6_FRONT_SPEED_RPM:
+		case FAN1_REAR_SPEED_RPM ... FAN6_REAR_SPEED_RPM:
+			ret = sprintf(buf, "%u\n", reg_val_to_speed_rpm(data->reg_val[attr->index]));
+			break;
+		case FAN1_PRESENT ... FAN6_PRESENT:
+			ret = sprintf(buf, "%d\n",
+						  reg_val_to_is_present(data->reg_val[FAN_PRESENT_REG],
+												attr->index - FAN1_PRESENT));
+			break;
+		case FAN1_FAULT ... FAN6_FAULT:
+			ret = sprintf(buf, "%d\n", is_fan_fault(data, attr->index - FAN1_FAULT));
+			break;
+		case FAN1_DIRECTION ... FAN6_DIRECTION:
+			ret = sprintf(buf, "%d\n",
+						  reg_val_to_direction(data->reg_val[FAN_DIRECTION_REG],
+											   attr->index - FAN1_DIRECTION));
+			break;
+		default:
+			break;
+		}
+	}
+
+	return ret;
+}
+
+/* Writes that would not change the register are dropped */
+static int fan_core_write_duty_cycle(struct i2c_client *client, int value)
+{
+	struct fan_core_data *data = i2c_get_clientdata(client);
+	u8 reg_val = duty_cycle_to_reg_val(value);
+	int status = 0;
+
+	mutex_lock(&data->update_lock);
+
+	if (data->duty_reg_val == (reg_val & FAN_DUTY_CYCLE_REG_MASK)) {
+		goto exit;
+	}
+
+	fan_core_write_value(client, data->plat->watchdog_reg, 0); /* Disable fan speed watch dog */
+	status = fan_core_write_value(client, data->plat->duty_reg, reg_val);
+	if (status < 0) {
+		data->duty_reg_val = -1;
+		goto exit;
+	}
+
+	data->duty_reg_val = reg_val & FAN_DUTY_CYCLE_REG_MASK;
+	data->reg_val[FAN_DUTY_CYCLE_PERCENTAGE] = reg_val;
+
+exit:
+	mutex_unlock(&data->update_lock);
+	return status;
+}
+
+static ssize_t set_duty_cycle(struct device *dev, struct device_attribute *da,
+							  const char *buf, size_t count)
+{
+	struct i2c_client *client = to_i2c_client(dev);
+	struct fan_core_data *data = i2c_get_clientdata(client);
+	int error, value;
+
+	error = kstrtoint(buf, 10, &value);
+	if (error)
+		return error;
+
+	if (value < 0)
+		return -EINVAL;
+
+	if (data->ctrl_enable)
+		return -EBUSY;
+
+	if (value > FAN_MAX_DUTY_CYCLE) {
+		if (!data->plat->clamp_duty)
+			return -EINVAL;
+		value = FAN_MAX_DUTY_CYCLE;
+	}
+
+	fan_core_write_duty_cycle(client, value);
+	return count;
+}
+
+static ssize_t get_enable(struct device *dev, struct device_attribute *da,
+						  char *buf)
+{
+	struct fan_core_data *data = i2c_get_clientdata(to_i2c_client(dev));
+
+	return sprintf(buf, "%u\n", data->enable);
+}
+
+static ssize_t set_enable(struct device *dev, struct device_attribute *da,
+						  const char *buf, size_t count)
+{
+	struct i2c_client *client = to_i2c_client(dev);
+	struct fan_core_data *data = i2c_get_clientdata(client);
+	int error, value;
+
+	error = kstrtoint(buf, 10, &value);
+	if (error)
+		return error;
+
+	if (value < 0 || value > 1)
+		return -EINVAL;
+
+	if (value == 0 && data->ctrl_enable)
+		return -EBUSY;
+
+	/* Manual control off: full speed */
+	data->enable = value;
+	if (value == 0) {
+		fan_core_write_duty_cycle(client, FAN_MAX_DUTY_CYCLE);
+	}
+
+	return count;
+}
+
+static bool lm75_addr_matched(const struct fan_core_platform *plat, unsigned short addr)
+{
+	int i;
+
+	if (!plat->thermal_addrs)
+		return 1;
+
+	for (i = 0; i < plat->num_thermal_addrs; i++) {
+		if (addr == plat->thermal_addrs[i])
+			return 1;
+	}
+	return 0;
+}
+
+static int _find_lm75_device(struct device *dev, void *data)
+{
+	struct lm75_lookup *lookup = data;
+	struct i2c_client *client;
+
+	if (!dev->driver || strcmp(dev->driver->name, THERMAL_SENSORS_DRIVER) != 0) {
+		return 0;
+	}
+
+	client = i2c_verify_client(dev);
+	if (!client || !lm75_addr_matched(lookup->plat, client->addr)) {
+		return 0;
+	}
+
+	if (lookup->num == MAX_LM75_CLIENTS) {
+		return -ENOSPC;
+	}
+
+	get_device(dev);
+	lookup->clients[lookup->num++] = client;
+	return 0;
+}
+
+static void lm75_put_clients(struct lm75_lookup *lookup)
+{
+	while (lookup->num > 0) {
+		put_device(&lookup->clients[--lookup->num]->dev);
+	}
+}
+
+/* Caller holds lm75_lock */
+static void lm75_invalidate_cache(struct fan_core_data *data)
+{
+	lm75_put_clients(&data->lm75);
+	data->lm75_valid = 0;
+	data->lm75_gen++;
+}
+
+/* Caller holds lm75_lock */
+static bool lm75_is_cached(struct fan_core_data *data, struct device *dev)
+{
+	int i;
+
+	for (i = 0; i < data->lm75.num; i++) {
+		if (&data->lm75.clients[i]->dev == dev)
+			return 1;
+	}
+	return 0;
+}
+
+static int lm75_bus_notify(struct notifier_block *nb, unsigned long action,
+						   void *ptr)
+{
+	struct fan_core_data *data = container_of(nb, struct fan_core_data, lm75_nb);
+	struct device *dev = ptr;
+
+	mutex_lock(&data->lm75_lock);
+	switch (action) {
+	case BUS_NOTIFY_BOUND_DRIVER:
+		if (data->lm75_valid && dev->driver &&
+			strcmp(dev->driver->name, THERMAL_SENSORS_DRIVER) == 0) {
+			lm75_invalidate_cache(data);
+		}
+		break;
+	case BUS_NOTIFY_UNBIND_DRIVER:
+	case BUS_NOTIFY_DEL_DEVICE:
+		if (lm75_is_cached(data, dev)) {
+			lm75_invalidate_cache(data);
+		}
+		break;
+	default:
+		break;
+	}
+	mutex_unlock(&data->lm75_lock);
+
+	return NOTIFY_DONE;
+}
+
+/* Caller holds lm75_lock.  It is dropped around the bus walk:
+ * i2c_for_each_dev() takes the i2c core lock, which is also held while
+ * clients are removed and lm75_bus_notify() runs.
+ */
+static void lm75_lookup_clients(struct fan_core_data *data)
+{
+	struct lm75_lookup lookup = { .plat = data->plat, .num = 0 };
+	unsigned int gen;
+
+	while (!data->lm75_valid) {
+		gen = data->lm75_gen;
+		mutex_unlock(&data->lm75_lock);
+		i2c_for_each_dev(&lookup, _find_lm75_device);
+		mutex_lock(&data->lm75_lock);
+
+		if (gen == data->lm75_gen) {
+			data->lm75 = lookup;
+			data->lm75_valid = 1;
+		}
+		else {
+			/* A sensor came or went during the walk */
+			lm75_put_clients(&lookup);
+		}
+	}
+}
+
+static int lm75_read_temp(struct i2c_client *client, int *miniCelsius)
+{
+	int status;
+
+	status = i2c_smbus_read_word_swapped(client, LM75_REG_TEMP);
+	if (status < 0) {
+		return status;
+	}
+
+	/* 9 bit resolution, as the lm75 driver sets up an lm75 */
+	*miniCelsius = ((s16)status >> 7) * 500;
+	return 0;
+}
+
+/* Sum of the temperatures of the platform's lm75 devices in mini-Celsius,
+ * -ENODEV if one of them can not be read
+ */
+static int fan_core_sys_temp(struct fan_core_data *data, int *system_temp)
+{
+	int i, miniCelsius, sensors_found = 0;
+
+	*system_temp = 0;
+
+	mutex_lock(&data->lm75_lock);
+	lm75_lookup_clients(data);
+	for (i = 0; i < data->lm75.num; i++) {
+		if (lm75_read_temp(data->lm75.clients[i], &miniCelsius) == 0) {
+			*system_temp += miniCelsius;
+			sensors_found++;
+		}
+	}
+	mutex_unlock(&data->lm75_lock);
+
+	if (sensors_found != data->plat->num_thermal_sensors) {
+		dev_dbg(&data->client->dev, "only %d of %d temps are found\n",
+				sensors_found, data->plat->num_thermal_sensors);
+		return -ENODEV;
+	}
+
+	return 0;
+}
+
+static ssize_t get_sys_temp(struct device *dev, struct device_attribute *da,
+							char *buf)
+{
+	struct fan_core_data *data = i2c_get_clientdata(to_i2c_client(dev));
+	int system_temp;
+
+	if (fan_core_sys_temp(data, &system_temp) < 0) {
+		system_temp = data->plat->sys_temp_missing;
+	}
+
+	return sprintf(buf, "%d\n", system_temp);
+}
+
+/* Level for temp, stepping from the current one through the hysteresis
+ * thresholds as the platform monitors do, without a poll period per step
+ */
+static int fan_ctrl_next_level(const struct fan_ctrl_policy *policy, int level, int temp)
+{
+	int i;
+
+	if (level >= policy->num_levels)
+		level = 0;
+
+	for (i = 0; i < policy->num_levels; i++) {
+		if (level < policy->num_levels - 1 && temp > policy->level[level].up)
+			level++;
+		else if (level > 0 && temp < policy->level[level].down)
+			level--;
+		else
+			break;
+	}
+
+	return level;
+}
+
+/* Caller holds ctrl_lock.  The period until the next tick: back to
+ * ctrl_interval on any sign of change, else twice the current one.
+ */
+static unsigned int fan_ctrl_next_interval(struct fan_core_data *data,
+										   const struct fan_ctrl_policy *policy,
+										   int level, int temp, bool moved)
+{
+	const struct fan_ctrl_level *l = &policy->level[level];
+	int band = data->ctrl_deadband;
+	unsigned int next;
+
+	if (data->ctrl_max_interval <= data->ctrl_interval) {
+		return data->ctrl_interval;
+	}
+
+	if (moved || !data->ctrl_last_valid || abs(temp - data->ctrl_last_temp) > band ||
+		(level < policy->num_levels - 1 && temp > l->up - band) ||
+		(level > 0 && temp < l->down + band)) {
+		return data->ctrl_interval;
+	}
+
+	next = max(data->ctrl_cur_interval, data->ctrl_interval) * 2;
+	return min(next, data->ctrl_max_interval);
+}
+
+static void fan_ctrl_work(struct work_struct *work)
+{
+	struct fan_core_data *data = container_of(to_delayed_work(work),
+											  struct fan_core_data, ctrl_work);
+	const struct fan_core_platform *plat = data->plat;
+	const struct fan_ctrl_policy *policy;
+	enum fan_ctrl_dir dir = FAN_CTRL_F2B;
+	bool fault = false;
+	int i, temp, duty, level;
+
+	fan_core_update_device(&data->client->dev);
+	if (data->valid) {
+		for (i = 0; i < plat->num_fans; i++) {
+			if (!reg_val_to_is_present(data->reg_val[FAN_PRESENT_REG], i) ||
+				is_fan_fault(data, i)) {
+				fault = true;
+			}
+		}
+
+		if (plat->direction_reg >= 0 &&
+			reg_val_to_direction(data->reg_val[FAN_DIRECTION_REG], 0) != plat->f2b_direction) {
+			dir = FAN_CTRL_B2F;
+		}
+	}
+	else {
+		fault = true;
+	}
+
+	if (fan_core_sys_temp(data, &temp) < 0) {
+		fault = true;
+	}
+
+	mutex_lock(&data->ctrl_lock);
+	if (!data->ctrl_enable) {
+		mutex_unlock(&data->ctrl_lock);
+		return;
+	}
+
+	policy = &data->ctrl_policy[dir];
+	if (!policy->num_levels) {
+		policy = &data->ctrl_policy[FAN_CTRL_F2B];
+	}
+
+	level = data->ctrl_level;
+	if (fault) {
+		duty = data->ctrl_fault_duty;
+	}
+	else {
+		data->ctrl_level = fan_ctrl_next_level(policy, data->ctrl_level, temp);
+		duty = policy->level[data->ctrl_level].duty;
+	}
+
+	if (duty != data->ctrl_duty) {
+		dev_dbg(&data->client->dev, "duty cycle %d -> %d, temp %d%s\n",
+				data->ctrl_duty, duty, temp, fault ? ", fault" : "");
+		data->ctrl_duty = (fan_core_write_duty_cycle(data->client, duty) < 0) ? -1 : duty;
+	}
+
+	data->ctrl_cur_interval = fan_ctrl_next_interval(data, policy, data->ctrl_level, temp,
+													 fault || level != data->ctrl_level);
+	data->ctrl_last_temp = temp;
+	data->ctrl_last_valid = !fault;
+
+	schedule_delayed_work(&data->ctrl_work, msecs_to_jiffies(data->ctrl_cur_interval));
+	mutex_unlock(&data->ctrl_lock);
+}
+
+/* Levels as "duty down up" triples, separated by white space or ';' */
+static int fan_ctrl_parse_policy(const char *buf, struct fan_ctrl_policy *policy)
+{
+	struct fan_ctrl_level *level;
+	int len;
+
+	memset(policy, 0, sizeof(*policy));
+
+	for (;;) {
+		buf = skip_spaces(buf);
+		if (*buf == ';') {
+			buf++;
+			continue;
+		}
+		if (!*buf)
+			break;
+
+		if (policy->num_levels == FAN_CTRL_MAX_LEVELS)
+			return -EINVAL;
+
+		level = &policy->level[policy->num_levels];
+		if (sscanf(buf, "%d %d %d%n", &level->duty, &level->down, &level->up, &len) != 3)
+			return -EINVAL;
+		if (level->duty < 0 || level->duty > FAN_MAX_DUTY_CYCLE)
+			return -EINVAL;
+
+		policy->num_levels++;
+		buf += len;
+	}
+
+	return 0;
+}
+
+/* Age and interval of the register cache, and whether the last update
+ * got through.  The age is -1 while the cache is not valid.  Reading
+ * them never touches the CPLD.
+ */
+static ssize_t fan_cache_show(struct device *dev, struct device_attribute *da,
+							  char *buf)
+{
+	struct sensor_device_attribute *attr = to_sensor_dev_attr(da);
+	struct fan_core_data *data = i2c_get_clientdata(to_i2c_client(dev));
+	ssize_t ret = 0;
+
+	mutex_lock(&data->update_lock);
+	switch (attr->index) {
+	case FAN_LAST_UPDATE_MS:
+		if (!data->valid) {
+			ret = sprintf(buf, "-1\n");
+			break;
+		}
+		ret = sprintf(buf, "%u\n", jiffies_to_msecs(jiffies - data->last_updated));
+		break;
+	case FAN_UPDATE_INTERVAL_MS:
+		ret = sprintf(buf, "%u\n", jiffies_to_msecs(data->update_interval));
+		break;
+	case FAN_VALID:
+		ret = sprintf(buf, "%d\n", data->valid ? 1 : 0);
+		break;
+	default:
+		break;
+	}
+	mutex_unlock(&data->update_lock);
+
+	return ret;
+}
+
+static ssize_t fan_cache_store(struct device *dev, struct device_attribute *da,
+							   const char *buf, size_t count)
+{
+	struct fan_core_data *data = i2c_get_clientdata(to_i2c_client(dev));
+	unsigned int value;
+	int error;
+
+	error = kstrtouint(buf, 10, &value);
+	if (error)
+		return error;
+
+	if (value > FAN_CORE_MAX_UPDATE_INTERVAL)
+		return -EINVAL;
+
+	mutex_lock(&data->update_lock);
+	data->update_interval = msecs_to_jiffies(value);
+	mutex_unlock(&data->update_lock);
+
+	return count;
+}
+
+static ssize_t fan_ctrl_show(struct device *dev, struct device_attribute *da,
+							 char *buf)
+{
+	struct sensor_device_attribute *attr = to_sensor_dev_attr(da);
+	struct fan_core_data *data = i2c_get_clientdata(to_i2c_client(dev));
+	const struct fan_ctrl_policy *policy;
+	ssize_t ret = 0;
+	int i;
+
+	mutex_lock(&data->ctrl_lock);
+	switch (attr->index) {
+	case FAN_CTRL_ENABLE:
+		ret = sprintf(buf, "%d\n", data->ctrl_enable);
+		break;
+	case FAN_CTRL_POLICY_F2B:
+	case FAN_CTRL_POLICY_B2F:
+		policy = &data->ctrl_policy[attr->index == FAN_CTRL_POLICY_F2B ?
+									FAN_CTRL_F2B : FAN_CTRL_B2F];
+		for (i = 0; i < policy->num_levels; i++) {
+			ret += scnprintf(buf + ret, PAGE_SIZE - ret, "%d %d %d\n",
+							 policy->level[i].duty, policy->level[i].down,
+							 policy->level[i].up);
+		}
+		break;
+	case FAN_CTRL_FAULT_DUTY:
+		ret = sprintf(buf, "%d\n", data->ctrl_fault_duty);
+		break;
+	case FAN_CTRL_INTERVAL:
+		ret = sprintf(buf, "%u\n", data->ctrl_interval);
+		break;
+	case FAN_CTRL_LEVEL:
+		ret = sprintf(buf, "%d\n", data->ctrl_enable ? data->ctrl_level : -1);
+		break;
+	case FAN_CTRL_MAX_INTERVAL_MS:
+		ret = sprintf(buf, "%u\n", data->ctrl_max_interval);
+		break;
+	case FAN_CTRL_DEADBAND:
+		ret = sprintf(buf, "%d\n", data->ctrl_deadband);
+		break;
+	case FAN_CTRL_CUR_INTERVAL:
+		ret = sprintf(buf, "%u\n", data->ctrl_enable ? data->ctrl_cur_interval : 0);
+		break;
+	default:
+		break;
+	}
+	mutex_unlock(&data->ctrl_lock);
+
+	return ret;
+}
+
+static ssize_t fan_ctrl_store(struct device *dev, struct device_attribute *da,
+							  const char *buf, size_t count)
+{
+	struct sensor_device_attribute *attr = to_sensor_dev_attr(da);
+	struct fan_core_data *data = i2c_get_clientdata(to_i2c_client(dev));
+	struct fan_ctrl_policy policy;
+	int error, value = 0;
+
+	if (attr->index == FAN_CTRL_POLICY_F2B || attr->index == FAN_CTRL_POLICY_B2F) {
+		error = fan_ctrl_parse_policy(buf, &policy);
+	}
+	else {
+		error = kstrtoint(buf, 10, &value);
+	}
+	if (error)
+		return error;
+
+	mutex_lock(&data->ctrl_lock);
+	switch (attr->index) {
+	case FAN_CTRL_ENABLE:
+		if (value < 0 || value > 1) {
+			error = -EINVAL;
+			break;
+		}
+		if (value && !data->ctrl_policy[FAN_CTRL_F2B].num_levels) {
+			error = -EINVAL;	/* no policy loaded */
+			break;
+		}
+
+		if (value && !data->ctrl_enable) {
+			data->ctrl_level = 0;
+			data->ctrl_duty  = -1;
+			data->ctrl_last_valid = 0;
+			schedule_delayed_work(&data->ctrl_work, 0);
+		}
+		else if (!value) {
+			/* A run in progress sees the flag and does not requeue */
+			cancel_delayed_work(&data->ctrl_work);
+		}
+		data->ctrl_enable = value;
+		break;
+	case FAN_CTRL_POLICY_F2B:
+		if (!policy.num_levels && data->ctrl_enable) {
+			error = -EBUSY;
+			break;
+		}
+		data->ctrl_policy[FAN_CTRL_F2B] = policy;
+		data->ctrl_level = 0;
+		break;
+	case FAN_CTRL_POLICY_B2F:
+		data->ctrl_policy[FAN_CTRL_B2F] = policy;
+		data->ctrl_level = 0;
+		break;
+	case FAN_CTRL_FAULT_DUTY:
+		if (value < 0 || value > FAN_MAX_DUTY_CYCLE) {
+			error = -EINVAL;
+			break;
+		}
+		data->ctrl_fault_duty = value;
+		break;
+	case FAN_CTRL_INTERVAL:
+		if (value < FAN_CTRL_MIN_INTERVAL || value > FAN_CTRL_MAX_INTERVAL) {
+			error = -EINVAL;
+			break;
+		}
+		data->ctrl_interval = value;
+		if (data->ctrl_max_interval < value) {
+			data->ctrl_max_interval = value;
+		}
+		break;
+	case FAN_CTRL_MAX_INTERVAL_MS:
+		if (value < data->ctrl_interval || value > FAN_CTRL_MAX_INTERVAL) {
+			error = -EINVAL;
+			break;
+		}
+		data->ctrl_max_interval = value;
+		/* The next tick may be a long way off, start over from now */
+		if (data->ctrl_enable) {
+			mod_delayed_work(system_wq, &data->ctrl_work, 0);
+		}
+		break;
+	case FAN_CTRL_DEADBAND:
+		if (value < 0) {
+			error = -EINVAL;
+			break;
+		}
+		data->ctrl_deadband = value;
+		break;
+	default:
+		error = -EINVAL;
+		break;
+	}
+	mutex_unlock(&data->ctrl_lock);
+
+	return error ? error : count;
+}
+
+/* Define attributes
+ */
+#define DECLARE_FAN_FAULT_SENSOR_DEV_ATTR(index, index2) \
+	static SENSOR_DEVICE_ATTR(fan##index##_fault, S_IRUGO, fan_show_value, NULL, FAN##index##_FAULT);\
+	static SENSOR_DEVICE_ATTR(fan##index2##_fault, S_IRUGO, fan_show_value, NULL, FAN##index##_FAULT)
+#define DECLARE_FAN_FAULT_ATTR(index, index2)	&sensor_dev_attr_fan##index##_fault.dev_attr.attr, \
+												&sensor_dev_attr_fan##index2##_fault.dev_attr.attr
+
+#define DECLARE_FAN_DIRECTION_SENSOR_DEV_ATTR(index) \
+	static SENSOR_DEVICE_ATTR(fan##index##_direction, S_IRUGO, fan_show_value, NULL, FAN##index##_DIRECTION)
+#define DECLARE_FAN_DIRECTION_ATTR(index)	&sensor_dev_attr_fan##index##_direction.dev_attr.attr
+
+#define DECLARE_FAN_PRESENT_SENSOR_DEV_ATTR(index) \
+	static SENSOR_DEVICE_ATTR(fan##index##_present, S_IRUGO, fan_show_value, NULL, FAN##index##_PRESENT)
+#define DECLARE_FAN_PRESENT_ATTR(index)		&sensor_dev_attr_fan##index##_present.dev_attr.attr
+
+#define DECLARE_FAN_SPEED_RPM_SENSOR_DEV_ATTR(index, index2) \
+	static SENSOR_DEVICE_ATTR(fan##index##_front_speed_rpm, S_IRUGO, fan_show_value, NULL, FAN##index##_FRONT_SPEED_RPM);\
+	static SENSOR_DEVICE_ATTR(fan##index##_rear_speed_rpm, S_IRUGO, fan_show_value, NULL, FAN##index##_REAR_SPEED_RPM);\
+	static SENSOR_DEVICE_ATTR(fan##index##_input, S_IRUGO, fan_show_value, NULL, FAN##index##_FRONT_SPEED_RPM);\
+	static SENSOR_DEVICE_ATTR(fan##index2##_input, S_IRUGO, fan_show_value, NULL, FAN##index##_REAR_SPEED_RPM)
+#define DECLARE_FAN_SPEED_RPM_ATTR(index, index2)	&sensor_dev_attr_fan##index##_front_speed_rpm.dev_attr.attr, \
+													&sensor_dev_attr_fan##index##_rear_speed_rpm.dev_attr.attr, \
+													&sensor_dev_attr_fan##index##_input.dev_attr.attr, \
+													&sensor_dev_attr_fan##index2##_input.dev_attr.attr
+
+/* Up to 6 fans, the platform hides the ones it does not have */
+DECLARE_FAN_FAULT_SENSOR_DEV_ATTR(1,11);
+DECLARE_FAN_FAULT_SENSOR_DEV_ATTR(2,12);
+DECLARE_FAN_FAULT_SENSOR_DEV_ATTR(3,13);
+DECLARE_FAN_FAULT_SENSOR_DEV_ATTR(4,14);
+DECLARE_FAN_FAULT_SENSOR_DEV_ATTR(5,15);
+DECLARE_FAN_FAULT_SENSOR_DEV_ATTR(6,16);
+DECLARE_FAN_SPEED_RPM_SENSOR_DEV_ATTR(1,11);
+DECLARE_FAN_SPEED_RPM_SENSOR_DEV_ATTR(2,12);
+DECLARE_FAN_SPEED_RPM_SENSOR_DEV_ATTR(3,13);
+DECLARE_FAN_SPEED_RPM_SENSOR_DEV_ATTR(4,14);
+DECLARE_FAN_SPEED_RPM_SENSOR_DEV_ATTR(5,15);
+DECLARE_FAN_SPEED_RPM_SENSOR_DEV_ATTR(6,16);
+DECLARE_FAN_PRESENT_SENSOR_DEV_ATTR(1);
+DECLARE_FAN_PRESENT_SENSOR_DEV_ATTR(2);
+DECLARE_FAN_PRESENT_SENSOR_DEV_ATTR(3);
+DECLARE_FAN_PRESENT_SENSOR_DEV_ATTR(4);
+DECLARE_FAN_PRESENT_SENSOR_DEV_ATTR(5);
+DECLARE_FAN_PRESENT_SENSOR_DEV_ATTR(6);
+DECLARE_FAN_DIRECTION_SENSOR_DEV_ATTR(1);
+DECLARE_FAN_DIRECTION_SENSOR_DEV_ATTR(2);
+DECLARE_FAN_DIRECTION_SENSOR_DEV_ATTR(3);
+DECLARE_FAN_DIRECTION_SENSOR_DEV_ATTR(4);
+DECLARE_FAN_DIRECTION_SENSOR_DEV_ATTR(5);
+DECLARE_FAN_DIRECTION_SENSOR_DEV_ATTR(6);
+/* 1 fan duty cycle attribute for all fans, pwm1 is the same register */
+static SENSOR_DEVICE_ATTR(fan_duty_cycle_percentage, S_IWUSR | S_IRUGO, fan_show_value, set_duty_cycle, FAN_DUTY_CYCLE_PERCENTAGE);
+static SENSOR_DEVICE_ATTR(pwm1, S_IWUSR | S_IRUGO, fan_show_value, set_duty_cycle, FAN_DUTY_CYCLE_PERCENTAGE);
+static SENSOR_DEVICE_ATTR(pwm1_enable, S_IWUSR | S_IRUGO, get_enable, set_enable, FAN_PWM_ENABLE);
+/* System temperature for fancontrol */
+static SENSOR_DEVICE_ATTR(sys_temp, S_IRUGO, get_sys_temp, NULL, FAN_SYS_TEMP);
+/* In-kernel control loop */
+static SENSOR_DEVICE_ATTR(fan_ctrl_enable, S_IWUSR | S_IRUGO, fan_ctrl_show, fan_ctrl_store, FAN_CTRL_ENABLE);
+static SENSOR_DEVICE_ATTR(fan_ctrl_policy_f2b, S_IWUSR | S_IRUGO, fan_ctrl_show, fan_ctrl_store, FAN_CTRL_POLICY_F2B);
+static SENSOR_DEVICE_ATTR(fan_ctrl_policy_b2f, S_IWUSR | S_IRUGO, fan_ctrl_show, fan_ctrl_store, FAN_CTRL_POLICY_B2F);
+static SENSOR_DEVICE_ATTR(fan_ctrl_fault_duty, S_IWUSR | S_IRUGO, fan_ctrl_show, fan_ctrl_store, FAN_CTRL_FAULT_DUTY);
+static SENSOR_DEVICE_ATTR(fan_ctrl_interval, S_IWUSR | S_IRUGO, fan_ctrl_show, fan_ctrl_store, FAN_CTRL_INTERVAL);
+static SENSOR_DEVICE_ATTR(fan_ctrl_level, S_IRUGO, fan_ctrl_show, NULL, FAN_CTRL_LEVEL);
+static SENSOR_DEVICE_ATTR(fan_ctrl_max_interval, S_IWUSR | S_IRUGO, fan_ctrl_show, fan_ctrl_store, FAN_CTRL_MAX_INTERVAL_MS);
+static SENSOR_DEVICE_ATTR(fan_ctrl_deadband, S_IWUSR | S_IRUGO, fan_ctrl_show, fan_ctrl_store, FAN_CTRL_DEADBAND);
+static SENSOR_DEVICE_ATTR(fan_ctrl_cur_interval, S_IRUGO, fan_ctrl_show, NULL, FAN_CTRL_CUR_INTERVAL);
+/* Register cache */
+static SENSOR_DEVICE_ATTR(last_update_ms, S_IRUGO, fan_cache_show, NULL, FAN_LAST_UPDATE_MS);
+static SENSOR_DEVICE_ATTR(update_interval_ms, S_IWUSR | S_IRUGO, fan_cache_show, fan_cache_store, FAN_UPDATE_INTERVAL_MS);
+static SENSOR_DEVICE_ATTR(valid, S_IRUGO, fan_cache_show, NULL, FAN_VALID);
+
+static struct attribute *fan_core_attributes[] = {
+	/* fan related attributes */
+	DECLARE_FAN_FAULT_ATTR(1,11),
+	DECLARE_FAN_FAULT_ATTR(2,12),
+	DECLARE_FAN_FAULT_ATTR(3,13),
+	DECLARE_FAN_FAULT_ATTR(4,14),
+	DECLARE_FAN_FAULT_ATTR(5,15),
+	DECLARE_FAN_FAULT_ATTR(6,16),
+	DECLARE_FAN_SPEED_RPM_ATTR(1,11),
+	DECLARE_FAN_SPEED_RPM_ATTR(2,12),
+	DECLARE_FAN_SPEED_RPM_ATTR(3,13),
+	DECLARE_FAN_SPEED_RPM_ATTR(4,14),
+	DECLARE_FAN_SPEED_RPM_ATTR(5,15),
+	DECLARE_FAN_SPEED_RPM_ATTR(6,16),
+	DECLARE_FAN_PRESENT_ATTR(1),
+	DECLARE_FAN_PRESENT_ATTR(2),
+	DECLARE_FAN_PRESENT_ATTR(3),
+	DECLARE_FAN_PRESENT_ATTR(4),
+	DECLARE_FAN_PRESENT_ATTR(5),
+	DECLARE_FAN_PRESENT_ATTR(6),
+	DECLARE_FAN_DIRECTION_ATTR(1),
+	DECLARE_FAN_DIRECTION_ATTR(2),
+	DECLARE_FAN_DIRECTION_ATTR(3),
+	DECLARE_FAN_DIRECTION_ATTR(4),
+	DECLARE_FAN_DIRECTION_ATTR(5),
+	DECLARE_FAN_DIRECTION_ATTR(6),
+	&sensor_dev_attr_fan_duty_cycle_percentage.dev_attr.attr,
+	&sensor_dev_attr_pwm1.dev_attr.attr,
+	&sensor_dev_attr_pwm1_enable.dev_attr.attr,
+	&sensor_dev_attr_sys_temp.dev_attr.attr,
+	&sensor_dev_attr_fan_ctrl_enable.dev_attr.attr,
+	&sensor_dev_attr_fan_ctrl_policy_f2b.dev_attr.attr,
+	&sensor_dev_attr_fan_ctrl_policy_b2f.dev_attr.attr,
+	&sensor_dev_attr_fan_ctrl_fault_duty.dev_attr.attr,
+	&sensor_dev_attr_fan_ctrl_interval.dev_attr.attr,
+	&sensor_dev_attr_fan_ctrl_level.dev_attr.attr,
+	&sensor_dev_attr_fan_ctrl_max_interval.dev_attr.attr,
+	&sensor_dev_attr_fan_ctrl_deadband.dev_attr.attr,
+	&sensor_dev_attr_fan_ctrl_cur_interval.dev_attr.attr,
+	&sensor_dev_attr_last_update_ms.dev_attr.attr,
+	&sensor_dev_attr_update_interval_ms.dev_attr.attr,
+	&sensor_dev_attr_valid.dev_attr.attr,
+	NULL
+};
+
+static umode_t fan_core_attr_visible(struct kobject *kobj, struct attribute *a, int n)
+{
+	struct device *dev = container_of(kobj, struct device, kobj);
+	struct fan_core_data *data = i2c_get_clientdata(to_i2c_client(dev));
+	const struct fan_core_platform *plat = data->plat;
+	struct device_attribute *da = container_of(a, struct device_attribute, attr);
+	int index = to_sensor_dev_attr(da)->index;
+
+	if (a == &sensor_dev_attr_pwm1.dev_attr.attr || index == FAN_PWM_ENABLE) {
+		return plat->pwm_attrs ? a->mode : 0;
+	}
+
+	if (((index >= FAN1_DIRECTION && index <= FAN6_DIRECTION) || index == FAN_CTRL_POLICY_B2F) &&
+		plat->direction_reg < 0) {
+		return 0;
+	}
+
+	if (fan_core_attr_fan(index) >= plat->num_fans) {
+		return 0;
+	}
+
+	return a->mode;
+}
+
+static const struct attribute_group fan_core_group = {
+	.attrs		= fan_core_attributes,
+	.is_visible	= fan_core_attr_visible,
+};
+
+int fan_core_probe(struct i2c_client *client, const struct fan_core_platform *plat)
+{
+	struct fan_core_data *data;
+	int status;
+
+	if (!i2c_check_functionality(client->adapter, I2C_FUNC_SMBUS_BYTE_DATA)) {
+		status = -EIO;
+		goto exit;
+	}
+
+	if (plat->num_fans > FAN_CORE_MAX_FANS) {
+		status = -EINVAL;
+		goto exit;
+	}
+
+	data = kzalloc(sizeof(struct fan_core_data), GFP_KERNEL);
+	if (!data) {
+		status = -ENOMEM;
+		goto exit;
+	}
+
+	data->client = client;
+	data->plat = plat;
+	fan_core_init_regs(data);
+	data->block_read = i2c_check_functionality(client->adapter,
+											   I2C_FUNC_SMBUS_READ_I2C_BLOCK);
+	data->stats = i2c_stats_register(&client->dev);
+	data->tlm = accton_tlm_register(&client->dev, ACCTON_TLM_KIND_FAN);
+	i2c_set_clientdata(client, data);
+	mutex_init(&data->update_lock);
+	mutex_init(&data->lm75_lock);
+	mutex_init(&data->ctrl_lock);
+	INIT_DELAYED_WORK(&data->ctrl_work, fan_ctrl_work);
+	data->update_interval = FAN_CORE_UPDATE_INTERVAL;
+	data->duty_reg_val = -1;
+	data->ctrl_duty = -1;
+	data->ctrl_fault_duty = FAN_MAX_DUTY_CYCLE;
+	data->ctrl_interval = FAN_CTRL_DEFAULT_INTERVAL;
+	data->ctrl_max_interval = FAN_CTRL_DEFAULT_INTERVAL;
+	data->ctrl_cur_interval = FAN_CTRL_DEFAULT_INTERVAL;
+	data->ctrl_deadband = FAN_CTRL_DEFAULT_DEADBAND;
+
+	data->lm75_nb.notifier_call = lm75_bus_notify;
+	status = bus_register_notifier(&i2c_bus_type, &data->lm75_nb);
+	if (status) {
+		goto exit_free;
+	}
+
+	dev_info(&client->dev, "chip found\n");
+
+	/* Register sysfs hooks */
+	status = sysfs_create_group(&client->dev.kobj, &fan_core_group);
+	if (status) {
+		goto exit_notifier;
+	}
+
+	data->hwmon_dev = hwmon_device_register(&client->dev);
+	if (IS_ERR(data->hwmon_dev)) {
+		status = PTR_ERR(data->hwmon_dev);
+		goto exit_remove;
+	}
+
+	dev_info(&client->dev, "%s: fan '%s'\n",
+			 dev_name(data->hwmon_dev), client->name);
+
+	return 0;
+
+exit_remove:
+	sysfs_remove_group(&client->dev.kobj, &fan_core_group);
+exit_notifier:
+	bus_unregister_notifier(&i2c_bus_type, &data->lm75_nb);
+exit_free:
+	accton_tlm_unregister(data->tlm);
+	i2c_stats_unregister(data->stats);
+	kfree(data);
+exit:
+
+	return status;
+}
+EXPORT_SYMBOL(fan_core_probe);
+
+int fan_core_remove(struct i2c_client *client)
+{
+	struct fan_core_data *data = i2c_get_clientdata(client);
+
+	hwmon_device_unregister(data->hwmon_dev);
+	sysfs_remove_group(&client->dev.kobj, &fan_core_group);
+
+	mutex_lock(&data->ctrl_lock);
+	data->ctrl_enable = 0;
+	mutex_unlock(&data->ctrl_lock);
+	cancel_delayed_work_sync(&data->ctrl_work);
+
+	bus_unregister_notifier(&i2c_bus_type, &data->lm75_nb);
+
+	mutex_lock(&data->lm75_lock);
+	lm75_invalidate_cache(data);
+	mutex_unlock(&data->lm75_lock);
+
+	accton_tlm_unregister(data->tlm);
+	i2c_stats_unregister(data->stats);
+	kfree(data);
+
+	return 0;
+}
+EXPORT_SYMBOL(fan_core_remove);
+
+MODULE_AUTHOR("Brandon Chuang <brandon_chuang@accton.com.tw>");
+MODULE_DESCRIPTION("accton fan driver core");
+MODULE_LICENSE("GPL");
@@ -0,0 +1,59 @@
+/*
+ * Common fan CPLD driver core for accton platforms
+ *
+ * Copyright (C)  Brandon Chuang <brandon_chuang@accton.com.tw>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#ifndef __ACCTON_FAN_CORE_H__
+#define __ACCTON_FAN_CORE_H__
+
+#include <linux/types.h>
+#include <linux/i2c.h>
+
+#define FAN_CORE_MAX_FANS	6	/* one bit per fan in the present/direction regs */
+
+/*
+ * Register layout of a fan board CPLD.  Every supported board has one
+ * duty cycle register for all fans and a front and a rear tachometer
+ * per fan, fan 1 first.  Present is active low.
+ */
+struct fan_core_platform {
+	const char	*name;
+	int			num_fans;			/* up to FAN_CORE_MAX_FANS */
+
+	u8			present_reg;
+	int			direction_reg;		/* <0 if the board has none, fanN_direction is hidden */
+	u8			f2b_direction;		/* fanN_direction of an F2B fan */
+	u8			duty_reg;			/* low 4 bits, 6.25% per step */
+	u8			front_speed_reg;	/* 100 rpm per count */
+	u8			rear_speed_reg;
+	u8			watchdog_reg;		/* written 0 before each duty cycle write */
+
+	bool		pwm_attrs;			/* pwm1 and pwm1_enable for fancontrol */
+	bool		clamp_duty;			/* store above 100%: clamp if set, else -EINVAL */
+
+	/* sys_temp sums num_thermal_sensors lm75s */
+	int						num_thermal_sensors;
+	const unsigned short	*thermal_addrs;		/* NULL for any lm75 client */
+	int						num_thermal_addrs;
+	int						sys_temp_missing;	/* reported while a sensor is missing */
+};
+
+int fan_core_probe(struct i2c_client *client, const struct fan_core_platform *plat);
+int fan_core_remove(struct i2c_client *client);
+
+#endif /* __ACCTON_FAN_CORE_H__ */
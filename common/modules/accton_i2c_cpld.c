@@ -33,7 +33,14 @@
 #include <linux/jiffies.h>
 #include <linux/mutex.h>
 #include <linux/delay.h>
-#include <linux/list.h>
+#include <linux/srcu.h>
+#include <linux/workqueue.h>
+#include <linux/kobject.h>
+#include <linux/spinlock.h>
+#include <linux/bitops.h>
+#include "accton_i2c_stats.h"
+#include "accton_sfp_core.h"
+#include "accton_trace.h"
 
 
 #define MAX_PORT_NUM				    64
@@ -45,6 +52,28 @@
 #define I2C_ADDR_CPLD3  0x64
 #define CPLD_ADDRS {I2C_ADDR_CPLD1, I2C_ADDR_CPLD2, I2C_ADDR_CPLD3}
 
+/*
+ * Transceiver presence is polled in the background and changes are
+ * pushed to userspace: sysfs_notify() on module_present_all and on each
+ * module_present_<n> that changed, plus a KOBJ_CHANGE uevent with
+ * PRESENT_CHANGED/PRESENT port masks (bit0 = port 1, set = present).
+ * Userspace can then sleep in poll() instead of re-reading
+ * module_present_all.  Only models with one present bank per CPLD.
+ */
+static unsigned int present_poll_ms = 200;
+module_param(present_poll_ms, uint, S_IRUGO);
+MODULE_PARM_DESC(present_poll_ms, "transceiver presence poll interval in ms, 0 disables");
+
+/*
+ * Per-port attributes are served from a shadow copy of the CPLD
+ * registers.  Registers the driver writes (reset, lp_mode, tx_disable)
+ * are owned and cached until the next write; status registers
+ * (present, rx_los, tx_fault) are re-read once older than cache_ttl_ms.
+ */
+static unsigned int cache_ttl_ms = 100;
+module_param(cache_ttl_ms, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(cache_ttl_ms, "lifetime of cached CPLD status registers in ms, 0 disables");
+
 
 /*
  * Number of additional attribute pointers to allocate
@@ -114,20 +143,34 @@ struct cpld_data {
     struct attribute_group group;
 
     enum models model;
+    const struct model_spec *spec;
     struct cpld_sensor *sensors;
     struct mutex update_lock;
-    bool valid;
-    unsigned long last_updated;	/* in jiffies */
+    struct i2c_stats *stats;
+
+    spinlock_t shadow_lock;
+    u8   shadow[256];                   /* last value read or written */
+    unsigned long shadow_updated[256];  /* in jiffies */
+    DECLARE_BITMAP(shadow_valid, 256);
+    DECLARE_BITMAP(shadow_owned, 256);  /* only changed by our writes */
 
     int  attr_index;
     u16  sfp_num;
     u8   sfp_types;
     struct model_attrs *cmn_attr;
+
+    struct i2c_client *client;
+    struct delayed_work present_work;
+    int  present_reg;       /* first present register, -1 if none */
+    u64  present;           /* bit0:port1, last polled value */
+    bool present_valid;
 };
 
+#define CPLD_CLIENT_MAX_ADDR    0x80    /* 7-bit addresses */
+
 struct cpld_client_node {
     struct i2c_client *client;
-    struct list_head   list;
+    struct mutex       lock;    /* held across one transaction */
 };
 
 
@@ -149,6 +192,35 @@ struct model_attrs {
     struct attrs **portly;
 };
 
+/* Where one port's bit lives: CPLD address, register and mask */
+struct port_desc {
+    u8 cpld_addr;
+    u8 reg;
+    u8 mask;
+};
+
+#define PORT_DESC(_addr, _reg, _bit) \
+    { .cpld_addr = (_addr), .reg = (_reg), .mask = 1 << (_bit) }
+/* Port n of a bank laid out 8 ports per register from _reg on */
+#define PORT_DESC_BANK(_addr, _reg, n) \
+    PORT_DESC(_addr, (_reg) + (n)/8, (n)%8)
+#define PORT_DESC_BANK8(_addr, _reg, n) \
+    PORT_DESC_BANK(_addr, _reg, (n)+0), PORT_DESC_BANK(_addr, _reg, (n)+1), \
+    PORT_DESC_BANK(_addr, _reg, (n)+2), PORT_DESC_BANK(_addr, _reg, (n)+3), \
+    PORT_DESC_BANK(_addr, _reg, (n)+4), PORT_DESC_BANK(_addr, _reg, (n)+5), \
+    PORT_DESC_BANK(_addr, _reg, (n)+6), PORT_DESC_BANK(_addr, _reg, (n)+7)
+
+/*
+ * Per model port layout.  present is a per-port table for models whose
+ * presence bits are spread over several CPLDs; NULL when they are one
+ * bank on this CPLD and module_present_all reads that bank directly.
+ */
+struct model_spec {
+    u16 sfp_num;
+    u8  sfp_types;
+    const struct port_desc *present;
+};
+
 
 static ssize_t show_bit(struct device *dev,
                         struct device_attribute *devattr, char *buf);
@@ -158,10 +230,13 @@ static ssize_t set_1bit(struct device *dev, struct device_attribute *da,
                         const char *buf, size_t count);
 static ssize_t set_byte(struct device *dev, struct device_attribute *da,
                         const char *buf, size_t count);
+static ssize_t set_bits_all(struct device *dev, struct device_attribute *da,
+                            const char *buf, size_t count);
 static ssize_t access(struct device *dev, struct device_attribute *da,
                       const char *buf, size_t count);
 
 int accton_i2c_cpld_read(u8 cpld_addr, u8 reg);
+int accton_i2c_cpld_read_cached(unsigned short cpld_addr, u8 reg);
 int accton_i2c_cpld_write(unsigned short cpld_addr, u8 reg, u8 value);
 
 
@@ -248,72 +323,83 @@ struct model_attrs models_attr[NUM_MODEL] = {
     {.cmn = as7712_cmn_list, .portly=as7712_port_list},
     {.cmn = as7712_cmn_list, .portly=as7712_port_list}, /*7716's as 7712*/
     {.cmn = as7816_cmn_list, .portly=as7816_port_list},
-    {.cmn = as7312_cmn_list, .portly=as7816_port_list},
+    {.cmn = as7312_cmn_list, .portly=NULL},
     {.cmn = plain_cmn_list,  .portly=NULL},
 };
 
-static LIST_HEAD(cpld_client_list);
-static struct mutex	 list_lock;
+static const struct port_desc as7312_present[54] = {
+    /* 1-24 on CPLD2, 25-48 on CPLD3 */
+    PORT_DESC_BANK8(I2C_ADDR_CPLD2, 0x09, 0),
+    PORT_DESC_BANK8(I2C_ADDR_CPLD2, 0x09, 8),
+    PORT_DESC_BANK8(I2C_ADDR_CPLD2, 0x09, 16),
+    PORT_DESC_BANK8(I2C_ADDR_CPLD3, 0x09, 0),
+    PORT_DESC_BANK8(I2C_ADDR_CPLD3, 0x09, 8),
+    PORT_DESC_BANK8(I2C_ADDR_CPLD3, 0x09, 16),
+    /* QSFP 49-52 on CPLD2, 53-54 on CPLD3 */
+    PORT_DESC(I2C_ADDR_CPLD2, 0x18, 0), PORT_DESC(I2C_ADDR_CPLD2, 0x18, 1),
+    PORT_DESC(I2C_ADDR_CPLD2, 0x18, 2), PORT_DESC(I2C_ADDR_CPLD2, 0x18, 3),
+    PORT_DESC(I2C_ADDR_CPLD3, 0x18, 0), PORT_DESC(I2C_ADDR_CPLD3, 0x18, 1),
+};
+
+static const struct model_spec models_spec[NUM_MODEL] = {
+    [AS7712_32X] = {.sfp_num = 32, .sfp_types = HAS_QSFP},
+    [AS7716_32X] = {.sfp_num = 32, .sfp_types = HAS_QSFP},
+    [AS7816_64X] = {.sfp_num = 64, .sfp_types = HAS_QSFP},
+    [AS7312_54X] = {.sfp_num = 54, .sfp_types = HAS_QSFP|HAS_SFP,
+                    .present = as7312_present},
+    [PLAIN_CPLD] = {.sfp_num = 0},
+};
+
+/*
+ * CPLD clients indexed by I2C address.  The exported accessors look the
+ * client up under SRCU and hold only that CPLD's mutex across the bus
+ * transaction, so CPLDs on different buses are accessed concurrently.
+ * list_lock only orders add/remove.
+ */
+static struct cpld_client_node __rcu *cpld_clients[CPLD_CLIENT_MAX_ADDR];
+static struct mutex     list_lock;
+DEFINE_STATIC_SRCU(cpld_client_srcu);
 /* Addresses scanned for accton_i2c_cpld
  */
 static const unsigned short normal_i2c[] = { I2C_CLIENT_END };
 
-static int get_sfp_spec(int model, u16 *num, u8 *types)
+/*Assume the bits for ports are listed in-a-row.*/
+static int get_reg_bit(u8 reg_start, int port,
+                       u8 *reg ,u8 *mask)
 {
-    switch (model) {
-    case AS7712_32X:
-    case AS7716_32X:
-        *num = 32;
-        *types = HAS_QSFP;
-        break;
-    case AS7816_64X:
-        *num = 64;
-        *types = HAS_QSFP;
-        break;        
-    case AS7312_54X:
-        *num = 54;
-        *types = HAS_QSFP|HAS_SFP;        
-    default:
-        *types = 0;
-        *num = 0;
-        break;        
-    }
+    *reg = reg_start + ((port)/8);
+    *mask = 1 << ((port)%8);
 
     return 0;
 }
 
-static int get_present_reg(int model, u8 port, u8 *cpld_addr, u8 *reg, u8 *num)
+static void cpld_shadow_store(struct cpld_data *data, u8 reg, u8 value)
 {
-    u8 cpld_address[] = CPLD_ADDRS;
-    
-    switch (model) {
-    case AS7312_54X:
-        if (port < 48) {
-            *cpld_addr = cpld_address[1 + port/24];
-            *reg = 0x09 + (port%24)/8;
-            *num = 8;
-        }
-        else
-        {
-            *reg = 0x18;
-            *num = 4;
-            *cpld_addr = ( port < 52)? cpld_address[1]: cpld_address[2];
-        }
-        break;
-    default:
-        return -EINVAL;      
-    }
+    unsigned long flags;
+
+    spin_lock_irqsave(&data->shadow_lock, flags);
+    data->shadow[reg] = value;
+    data->shadow_updated[reg] = jiffies;
+    set_bit(reg, data->shadow_valid);
+    spin_unlock_irqrestore(&data->shadow_lock, flags);
 }
-        
 
-/*Assume the bits for ports are listed in-a-row.*/
-static int get_reg_bit(u8 reg_start, int port,
-                       u8 *reg ,u8 *mask)
+/* Cached register value, -1 if it has to be read from the CPLD */
+static int cpld_shadow_get(struct cpld_data *data, u8 reg)
 {
-    *reg = reg_start + ((port)/8);
-    *mask = 1 << ((port)%8);
+    unsigned long flags;
+    int value = -1;
+
+    spin_lock_irqsave(&data->shadow_lock, flags);
+    if (test_bit(reg, data->shadow_valid)) {
+        if (test_bit(reg, data->shadow_owned) ||
+            (cache_ttl_ms && time_before(jiffies, data->shadow_updated[reg] +
+                                         msecs_to_jiffies(cache_ttl_ms))))
+            value = data->shadow[reg];
+    }
+    spin_unlock_irqrestore(&data->shadow_lock, flags);
 
-    return 0;
+    return value;
 }
 
 static int cpld_write_internal(
@@ -321,10 +407,13 @@ static int cpld_write_internal(
 {
     int status = 0, retry = I2C_RW_RETRY_COUNT;
 
+    struct cpld_data *data = i2c_get_clientdata(client);
+
     while (retry) {
-        status = i2c_smbus_write_byte_data(client, reg, value);
+        status = i2c_stats_write_byte_data(data->stats, client, reg, value);
         if (unlikely(status < 0)) {
             msleep(I2C_RW_RETRY_INTERVAL);
+            i2c_stats_retry(data->stats);
             retry--;
             continue;
         }
@@ -332,6 +421,9 @@ static int cpld_write_internal(
         break;
     }
 
+    if (status >= 0)
+        cpld_shadow_store(data, reg, value);
+
     return status;
 }
 
@@ -339,10 +431,13 @@ static int cpld_read_internal(struct i2c_client *client, u8 reg)
 {
     int status = 0, retry = I2C_RW_RETRY_COUNT;
 
+    struct cpld_data *data = i2c_get_clientdata(client);
+
     while (retry) {
-        status = i2c_smbus_read_byte_data(client, reg);
+        status = i2c_stats_read_byte_data(data->stats, client, reg);
         if (unlikely(status < 0)) {
             msleep(I2C_RW_RETRY_INTERVAL);
+            i2c_stats_retry(data->stats);
             retry--;
             continue;
         }
@@ -350,9 +445,67 @@ static int cpld_read_internal(struct i2c_client *client, u8 reg)
         break;
     }
 
+    if (status >= 0)
+        cpld_shadow_store(data, reg, status);
+
     return status;
 }
 
+static int cpld_read_cached(struct i2c_client *client, u8 reg)
+{
+    struct cpld_data *data = i2c_get_clientdata(client);
+    int value = cpld_shadow_get(data, reg);
+
+    i2c_stats_cache(data->stats, value >= 0);
+    if (value >= 0)
+        return value;
+
+    return cpld_read_internal(client, reg);
+}
+
+
+/*
+ * Read len consecutive registers, in a single I2C block read when the
+ * adapter supports it, register by register otherwise.
+ */
+static int cpld_read_block_internal(struct i2c_client *client, u8 reg,
+                                    u8 len, u8 *values)
+{
+    struct cpld_data *data = i2c_get_clientdata(client);
+    int status = 0, retry = I2C_RW_RETRY_COUNT, i;
+
+    if (!i2c_check_functionality(client->adapter,
+                                 I2C_FUNC_SMBUS_READ_I2C_BLOCK)) {
+        for (i = 0; i < len; i++) {
+            status = cpld_read_internal(client, reg + i);
+            if (unlikely(status < 0))
+                return status;
+
+            values[i] = status;
+        }
+        return len;
+    }
+
+    while (retry) {
+        status = i2c_stats_read_i2c_block_data(data->stats, client, reg, len, values);
+        if (unlikely(status < 0)) {
+            msleep(I2C_RW_RETRY_INTERVAL);
+            i2c_stats_retry(data->stats);
+            retry--;
+            continue;
+        }
+
+        break;
+    }
+
+    if (unlikely(status >= 0 && status != len))
+        return -EIO;
+
+    for (i = 0; status >= 0 && i < len; i++)
+        cpld_shadow_store(data, reg + i, values[i]);
+
+    return status;
+}
 
 /*Turn a numberic array into string with " " between each element.
  * e.g., {0x11, 0x33, 0xff, 0xf1}  => "11 33 ff f1" 
@@ -379,35 +532,35 @@ static ssize_t show_presnet_all_distinct(struct device *dev,
 {
     struct i2c_client *client = to_i2c_client(dev);
     struct cpld_data *data = i2c_get_clientdata(client);
-    u8 i, value, reg;
-    u8 cpld_addr, num;
-    u8 _value[8];    
-    u64 *values = (u64 *)_value;
-    
-    values = 0;
+    const struct port_desc *d = data->spec->present;
+    u8 values[(MAX_PORT_NUM+7)/8] = {0};
+    int i, status = 0, key, last = -1;
+
     mutex_lock(&data->update_lock);
-    while(i < data->sfp_num)
-    {
-        get_present_reg(data->model, i, &cpld_addr, &reg, &num);
-        if(cpld_addr == client->addr)
-           value = cpld_read_internal(client, reg);    
-        else           
-           value = accton_i2c_cpld_read(cpld_addr, reg);
-           
-        if (unlikely(value < 0)) {
-            goto exit;
-        }        
+    for (i = 0; i < data->sfp_num; i++, d++) {
+        /* Neighbouring ports mostly share a register, read it once */
+        key = (d->cpld_addr << 8) | d->reg;
+        if (key != last) {
+            if (d->cpld_addr == client->addr)
+                status = cpld_read_internal(client, d->reg);
+            else
+                status = accton_i2c_cpld_read(d->cpld_addr, d->reg);
+
+            if (unlikely(status < 0)) {
+                goto exit;
+            }
+            last = key;
+        }
 
-        *values |= (value&((1<<(num))-1)) << i;
-        i += num; 
+        if (status & d->mask)
+            values[i/8] |= 1 << (i%8);
     }
     mutex_unlock(&data->update_lock);
 
-    *values = cpu_to_le64(*values);
-    return array_stringify(buf, _value, i);
+    return array_stringify(buf, values, (data->sfp_num+7)/8);
 exit:
     mutex_unlock(&data->update_lock);
-    return value;    
+    return status;
 }
 
 static ssize_t show_presnet_all(struct device *dev,
@@ -416,25 +569,21 @@ static ssize_t show_presnet_all(struct device *dev,
     struct i2c_client *client = to_i2c_client(dev);
     struct cpld_data *data = i2c_get_clientdata(client);
     struct cpld_sensor *sensor = to_cpld_sensor(devattr);
-    u8 i, values[MAX_RESP_LENGTH/8];
+    u8 num = (data->sfp_num+7)/8, values[(MAX_PORT_NUM+7)/8];
+    int status;
 
-    if (sensor->reg < 0) {
+    if (data->spec->present) {
         return show_presnet_all_distinct(dev, devattr, buf);
     }
-    
+
     mutex_lock(&data->update_lock);
-    for (i = 0; i < ((data->sfp_num+7)/8); i++) {
-        values[i] = cpld_read_internal(client, sensor->reg + i);
-        if (unlikely(values[i] < 0)) {
-            goto exit;
-        }
-    }
+    status = cpld_read_block_internal(client, sensor->reg, num, values);
     mutex_unlock(&data->update_lock);
-    return array_stringify(buf, values, i);
-    
-exit:
-    mutex_unlock(&data->update_lock);
-    return values[i];
+
+    if (unlikely(status < 0))
+        return status;
+
+    return array_stringify(buf, values, num);
 }
 
 static ssize_t show_bit(struct device *dev,
@@ -446,7 +595,11 @@ static ssize_t show_bit(struct device *dev,
     struct cpld_sensor *sensor = to_cpld_sensor(devattr);
 
     mutex_lock(&data->update_lock);
-    value = cpld_read_internal(client, sensor->reg);
+    value = cpld_read_cached(client, sensor->reg);
+    if (unlikely(value < 0)) {
+        mutex_unlock(&data->update_lock);
+        return value;
+    }
     value = value & sensor->mask;
     if (sensor->invert)
         value = !value;
@@ -472,8 +625,9 @@ static ssize_t set_1bit(struct device *dev, struct device_attribute *devattr,
     reg = sensor->reg;
     cpld_bit = sensor->mask;
     mutex_lock(&data->update_lock);
-    value = cpld_read_internal(client, reg);
-    if (unlikely(status < 0)) {
+    value = cpld_read_cached(client, reg);
+    if (unlikely(value < 0)) {
+        status = value;
         goto exit;
     }
 
@@ -499,6 +653,63 @@ exit:
     return status;
 }
 
+/*
+ * <name>_all: "<value> [<change mask>]" in hex, bit0 = port 1, 1 has the
+ * same meaning as writing 1 to <name>_<n>.  Only ports set in the change
+ * mask (default all) are touched, with one write per CPLD register and
+ * no read when every port of the register changes.
+ */
+static ssize_t set_bits_all(struct device *dev, struct device_attribute *devattr,
+                            const char *buf, size_t count)
+{
+    struct i2c_client *client = to_i2c_client(dev);
+    struct cpld_data *data = i2c_get_clientdata(client);
+    struct cpld_sensor *sensor = to_cpld_sensor(devattr);
+    u64 value, change = ~0ULL, ports;
+    int i, status = 0;
+    u8 v, cm;
+
+    if (sscanf(buf, "%llx %llx", &value, &change) < 1) {
+        return -EINVAL;
+    }
+
+    ports = (data->sfp_num < 64) ? (1ULL << data->sfp_num) - 1 : ~0ULL;
+    if (value & ~ports) {
+        return -EINVAL;
+    }
+    change &= ports;
+
+    if (sensor->invert)
+        value = ~value;
+
+    mutex_lock(&data->update_lock);
+    for (i = 0; i < (data->sfp_num+7)/8; i++) {
+        cm = change >> (i*8);
+        v = value >> (i*8);
+        if (!cm)
+            continue;
+
+        if (cm != 0xff) {
+            status = cpld_read_cached(client, sensor->reg + i);
+            if (unlikely(status < 0)) {
+                goto exit;
+            }
+            v = (status & ~cm) | (v & cm);
+        }
+
+        status = cpld_write_internal(client, sensor->reg + i, v);
+        if (unlikely(status < 0)) {
+            goto exit;
+        }
+    }
+    mutex_unlock(&data->update_lock);
+    return count;
+
+exit:
+    mutex_unlock(&data->update_lock);
+    return status;
+}
+
 static ssize_t set_byte(struct device *dev, struct device_attribute *da,
                         const char *buf, size_t count)
 {
@@ -534,47 +745,131 @@ exit:
     return status;
 }
 
+/* Start of the module_present_all bank, -1 when presence is not in one bank */
+static int get_present_all_reg(struct model_attrs *m)
+{
+    int i;
+
+    for (i = 0; m->cmn && m->cmn[i]; i++) {
+        if (m->cmn[i]->base == &common_attrs[CMN_PRESENT_ALL])
+            return m->cmn[i]->reg;
+    }
+
+    return -1;
+}
+
+static void present_notify(struct i2c_client *client, struct cpld_data *data,
+                           u64 present, u64 changed)
+{
+    char name[NAME_SIZE+1], env_changed[40], env_present[40];
+    char *envp[] = { env_changed, env_present, NULL };
+    int i;
+
+    for (i = 0; i < data->sfp_num; i++) {
+        if (!(changed & (1ULL << i)))
+            continue;
+
+        snprintf(name, NAME_SIZE, "%s_%d", portly_attrs[SFP_PRESENT].name, i+1);
+        sysfs_notify(&client->dev.kobj, NULL, name);
+    }
+    sysfs_notify(&client->dev.kobj, NULL, common_attrs[CMN_PRESENT_ALL].name);
+
+    snprintf(env_changed, sizeof(env_changed), "PRESENT_CHANGED=%llx", changed);
+    snprintf(env_present, sizeof(env_present), "PRESENT=%llx", present);
+    kobject_uevent_env(&client->dev.kobj, KOBJ_CHANGE, envp);
+}
+
+static void present_work_handler(struct work_struct *work)
+{
+    struct cpld_data *data = container_of(to_delayed_work(work),
+                                          struct cpld_data, present_work);
+    u8 num = (data->sfp_num+7)/8, values[(MAX_PORT_NUM+7)/8];
+    void (*present_update)(unsigned short, u8, u8);
+    u64 present = 0;
+    int i, status;
+
+    mutex_lock(&data->update_lock);
+    status = cpld_read_block_internal(data->client, data->present_reg, num, values);
+    mutex_unlock(&data->update_lock);
+
+    /* Lets accton_sfp_core, if loaded, see a swap between its own reads */
+    present_update = symbol_get(sfp_core_present_update);
+    if (present_update) {
+        for (i = 0; status >= 0 && i < num; i++)
+            present_update(data->client->addr, data->present_reg + i, values[i]);
+        symbol_put(sfp_core_present_update);
+    }
+
+    for (i = 0; status >= 0 && i < num; i++)
+        present |= (u64)(u8)~values[i] << (i*8);    /* active low */
+
+    if (status >= 0) {
+        if (data->sfp_num < 64)
+            present &= (1ULL << data->sfp_num) - 1;
+
+        if (data->present_valid && present != data->present)
+            present_notify(data->client, data, present, present ^ data->present);
+
+        data->present = present;
+        data->present_valid = true;
+    }
+
+    schedule_delayed_work(&data->present_work, msecs_to_jiffies(present_poll_ms));
+}
+
 static void accton_i2c_cpld_add_client(struct i2c_client *client)
 {
-    struct cpld_client_node *node =
-        kzalloc(sizeof(struct cpld_client_node), GFP_KERNEL);
+    struct cpld_client_node *node;
+
+    if (client->addr >= CPLD_CLIENT_MAX_ADDR) {
+        return;
+    }
 
+    node = kzalloc(sizeof(struct cpld_client_node), GFP_KERNEL);
     if (!node) {
-        dev_dbg(&client->dev, "Can't allocate cpld_client_node (0x%x)\n",
-                client->addr);
+        dev_dbg(&client->dev, "Can't allocate cpld_client_node (0x%x)\n", client->addr);
         return;
     }
+
     node->client = client;
+    mutex_init(&node->lock);
 
     mutex_lock(&list_lock);
-    list_add(&node->list, &cpld_client_list);
+    if (rcu_access_pointer(cpld_clients[client->addr])) {
+        /* Same address on another bus, the first one keeps the slot */
+        mutex_unlock(&list_lock);
+        dev_warn(&client->dev, "cpld 0x%x already registered\n", client->addr);
+        kfree(node);
+        return;
+    }
+    rcu_assign_pointer(cpld_clients[client->addr], node);
     mutex_unlock(&list_lock);
 }
 
 static void accton_i2c_cpld_remove_client(struct i2c_client *client)
 {
-    struct list_head		*list_node = NULL;
-    struct cpld_client_node *cpld_node = NULL;
-    int found = 0;
-
-    mutex_lock(&list_lock);
+    struct cpld_client_node *node = NULL;
 
-    list_for_each(list_node, &cpld_client_list)
-    {
-        cpld_node = list_entry(list_node, struct cpld_client_node, list);
-
-        if (cpld_node->client == client) {
-            found = 1;
-            break;
-        }
+    if (client->addr >= CPLD_CLIENT_MAX_ADDR) {
+        return;
     }
 
-    if (found) {
-        list_del(list_node);
-        kfree(cpld_node);
+    mutex_lock(&list_lock);
+    node = rcu_dereference_protected(cpld_clients[client->addr],
+                                     lockdep_is_held(&list_lock));
+    if (node && node->client == client) {
+        RCU_INIT_POINTER(cpld_clients[client->addr], NULL);
+    }
+    else {
+        node = NULL;
     }
-
     mutex_unlock(&list_lock);
+
+    if (node) {
+        /* Wait for accessors still using this client */
+        synchronize_srcu(&cpld_client_srcu);
+        kfree(node);
+    }
 }
 
 static int cpld_add_attribute(struct cpld_data *data, struct attribute *attr)
@@ -699,6 +994,17 @@ static int add_attributes_portly(struct cpld_data *data, struct attrs **pa)
             {
                 return -ENOMEM;
             }
+            if (b->set == set_1bit)
+                set_bit(reg, data->shadow_owned);
+        }
+
+        if (b->set == set_1bit) {
+            snprintf(name, NAME_SIZE, "%s_all", b->name);
+            if (add_sensor(data, name, a->reg, 0, invert,
+                           true, S_IWUSR, NULL, set_bits_all) == NULL)
+            {
+                return -ENOMEM;
+            }
         }
     }
     return 0;
@@ -740,13 +1046,21 @@ static int accton_i2c_cpld_probe(struct i2c_client *client,
 
     data->model = dev_id->driver_data;
     data->cmn_attr = &models_attr[data->model];
-    get_sfp_spec(data->model, &data->sfp_num, &data->sfp_types);
+    data->spec = &models_spec[data->model];
+    data->sfp_num = data->spec->sfp_num;
+    data->sfp_types = data->spec->sfp_types;
 
     i2c_set_clientdata(client, data);
     mutex_init(&data->update_lock);
+    spin_lock_init(&data->shadow_lock);
     data->dev = dev;
+    data->client = client;
+    data->present_reg = data->sfp_num ? get_present_all_reg(data->cmn_attr) : -1;
+    INIT_DELAYED_WORK(&data->present_work, present_work_handler);
     dev_info(dev, "chip found\n");
 
+    data->stats = i2c_stats_register(dev);
+
     status = add_attributes(client, data);
     if (status)
         goto out_kfree;
@@ -774,6 +1088,10 @@ static int accton_i2c_cpld_probe(struct i2c_client *client,
     }
 
     accton_i2c_cpld_add_client(client);
+
+    if (present_poll_ms && data->present_reg >= 0)
+        schedule_delayed_work(&data->present_work, 0);
+
     dev_info(dev, "%s: cpld '%s'\n",
              dev_name(data->hwmon_dev), client->name);
 
@@ -782,6 +1100,7 @@ exit_remove:
     sysfs_remove_group(&client->dev.kobj, &data->group);
 out_kfree:
     kfree(data->group.attrs);
+    i2c_stats_unregister(data->stats);
     return status;
 
 }
@@ -790,57 +1109,108 @@ static int accton_i2c_cpld_remove(struct i2c_client *client)
 {
     struct cpld_data *data = i2c_get_clientdata(client);
 
+    cancel_delayed_work_sync(&data->present_work);
     hwmon_device_unregister(data->hwmon_dev);
     sysfs_remove_group(&client->dev.kobj, &data->group);
     kfree(data->group.attrs);
     accton_i2c_cpld_remove_client(client);
+    i2c_stats_unregister(data->stats);
     return 0;
 }
 
 int accton_i2c_cpld_read(u8 cpld_addr, u8 reg)
 {
-    struct list_head   *list_node = NULL;
-    struct cpld_client_node *cpld_node = NULL;
-    int ret = -EPERM;
+    struct cpld_client_node *node;
+    ktime_t start = accton_trace_cpld_start();
+    int ret = -EPERM, idx;
 
-    mutex_lock(&list_lock);
+    if (cpld_addr >= CPLD_CLIENT_MAX_ADDR) {
+        return ret;
+    }
 
-    list_for_each(list_node, &cpld_client_list)
-    {
-        cpld_node = list_entry(list_node, struct cpld_client_node, list);
+    idx = srcu_read_lock(&cpld_client_srcu);
+    node = srcu_dereference(cpld_clients[cpld_addr], &cpld_client_srcu);
+    if (node) {
+        struct cpld_data *data = i2c_get_clientdata(node->client);
 
-        if (cpld_node->client->addr == cpld_addr) {
-            ret = i2c_smbus_read_byte_data(cpld_node->client, reg);
-            break;
-        }
+        mutex_lock(&node->lock);
+        ret = i2c_stats_read_byte_data(data->stats, node->client, reg);
+        if (ret >= 0)
+            cpld_shadow_store(data, reg, ret);
+        mutex_unlock(&node->lock);
     }
+    srcu_read_unlock(&cpld_client_srcu, idx);
 
-    mutex_unlock(&list_lock);
-
+    if (accton_trace_started(start)) {
+        trace_accton_cpld_read(cpld_addr, reg, (ret >= 0) ? ret : 0,
+                               accton_trace_duration(start), ret);
+    }
     return ret;
 }
 EXPORT_SYMBOL(accton_i2c_cpld_read);
 
-int accton_i2c_cpld_write(unsigned short cpld_addr, u8 reg, u8 value)
+/*
+ * Like accton_i2c_cpld_read(), but served from the shadow copy while it
+ * is younger than cache_ttl_ms.  For status registers other drivers
+ * poll, e.g. PSU present/power good.
+ */
+int accton_i2c_cpld_read_cached(unsigned short cpld_addr, u8 reg)
 {
-    struct list_head   *list_node = NULL;
-    struct cpld_client_node *cpld_node = NULL;
-    int ret = -EIO;
+    struct cpld_client_node *node;
+    int ret = -EPERM, idx;
 
-    mutex_lock(&list_lock);
-
-    list_for_each(list_node, &cpld_client_list)
-    {
-        cpld_node = list_entry(list_node, struct cpld_client_node, list);
+    if (cpld_addr >= CPLD_CLIENT_MAX_ADDR) {
+        return ret;
+    }
 
-        if (cpld_node->client->addr == cpld_addr) {
-            ret = i2c_smbus_write_byte_data(cpld_node->client, reg, value);
-            break;
+    idx = srcu_read_lock(&cpld_client_srcu);
+    node = srcu_dereference(cpld_clients[cpld_addr], &cpld_client_srcu);
+    if (node) {
+        struct cpld_data *data = i2c_get_clientdata(node->client);
+
+        ret = cpld_shadow_get(data, reg);
+        i2c_stats_cache(data->stats, ret >= 0);
+        if (ret < 0) {
+            mutex_lock(&node->lock);
+            ret = i2c_stats_read_byte_data(data->stats, node->client, reg);
+            if (ret >= 0)
+                cpld_shadow_store(data, reg, ret);
+            mutex_unlock(&node->lock);
         }
     }
+    srcu_read_unlock(&cpld_client_srcu, idx);
 
-    mutex_unlock(&list_lock);
+    return ret;
+}
+EXPORT_SYMBOL(accton_i2c_cpld_read_cached);
+
+int accton_i2c_cpld_write(unsigned short cpld_addr, u8 reg, u8 value)
+{
+    struct cpld_client_node *node;
+    ktime_t start = accton_trace_cpld_start();
+    int ret = -EIO, idx;
 
+    if (cpld_addr >= CPLD_CLIENT_MAX_ADDR) {
+        return ret;
+    }
+
+    idx = srcu_read_lock(&cpld_client_srcu);
+    node = srcu_dereference(cpld_clients[cpld_addr], &cpld_client_srcu);
+    if (node) {
+        struct cpld_data *data = i2c_get_clientdata(node->client);
+
+        mutex_lock(&node->lock);
+        ret = i2c_stats_write_byte_data(data->stats, node->client, reg, value);
+        if (ret >= 0)
+            cpld_shadow_store(data, reg, value);
+        mutex_unlock(&node->lock);
+    }
+    srcu_read_unlock(&cpld_client_srcu, idx);
+
+    if (accton_trace_started(start)) {
+        trace_accton_cpld_write(cpld_addr, reg, value,
+                                accton_trace_duration(start), ret);
+    }
     return ret;
 }
 EXPORT_SYMBOL(accton_i2c_cpld_write);
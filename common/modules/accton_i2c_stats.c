@@ -0,0 +1,1182 @@
+/*
+ * Per device I2C transaction statistics for accton platform drivers
+ *
+ * Copyright (C) 2018 Accton Technology Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+/*
+ * The SFP, optoe, CPLD, fan and PSU drivers issue their bus calls
+ * through the wrappers of accton_i2c_stats.h.  Each registered device
+ * gets /sys/kernel/debug/accton/<device>/ with
+ *
+ *   transactions, bytes, errors	bus calls, payload bytes moved, failed calls
+ *   retries						calls repeated after a failure
+ *   cache_hits, cache_misses		reads served from / missed by the driver's cache
+ *   latency						log2 histogram of the bus call time, in us
+ *   reset							write anything to clear all of the above
+ *
+ * and /sys/kernel/debug/accton/breakers lists the circuit breaker of
+ * each bus that has had a failure: root adapter, up or down, current
+ * run of failures and times opened.  /sys/kernel/debug/accton/sched
+ * has, per root adapter and class, the transactions scheduled and
+ * their average and worst wait for the bus in us, and
+ * /sys/kernel/debug/accton/segments the mux segment each one has
+ * isolated, if any, and how often that happened.
+ *
+ * The tracepoints of accton_trace.h live here as well.
+ */
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/ktime.h>
+#include <linux/err.h>
+#include <linux/slab.h>
+#include <linux/list.h>
+#include <linux/mutex.h>
+#include <linux/delay.h>
+#include <linux/workqueue.h>
+#include <linux/wait.h>
+#include <linux/sched.h>
+#include <linux/spinlock.h>
+#include <linux/atomic.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/fs.h>
+#include <linux/version.h>
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4,7,0)
+#include <linux/i2c-mux.h>
+#endif
+#include "accton_i2c_stats.h"
+
+#define CREATE_TRACE_POINTS
+#include "accton_trace.h"
+
+EXPORT_TRACEPOINT_SYMBOL(accton_eeprom_read);
+EXPORT_TRACEPOINT_SYMBOL(accton_eeprom_write);
+EXPORT_TRACEPOINT_SYMBOL(accton_cpld_read);
+EXPORT_TRACEPOINT_SYMBOL(accton_cpld_write);
+EXPORT_TRACEPOINT_SYMBOL(accton_psu_update);
+
+#define I2C_STATS_ROOT		"accton"
+
+struct i2c_stats {
+	struct dentry	*dir;
+	spinlock_t		lock;
+
+	enum i2c_sched_class	class;	/* of the reads */
+	struct i2c_sched	   *sched;	/* of the bus, found on first use */
+
+	u64				transactions;
+	u64				bytes;
+	u64				errors;
+	u64				retries;
+	u64				cache_hits;
+	u64				cache_misses;
+
+	u64				latency_max;	/* us */
+	u64				latency_sum;	/* us */
+	u64				latency[I2C_STATS_BUCKETS];
+};
+
+static struct dentry *i2c_stats_root;
+
+static unsigned int breaker_threshold = 16;
+module_param(breaker_threshold, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(breaker_threshold, "consecutive failed accesses that take a bus down, 0 never does");
+
+static unsigned int breaker_probe_ms = 1000;
+module_param(breaker_probe_ms, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(breaker_probe_ms, "interval of the probe of a bus that is down");
+
+/* One per root adapter, created on its first call and kept */
+struct i2c_breaker {
+	struct list_head	list;
+	int					root_nr;
+	unsigned int		failures;	/* failed accesses in a row */
+	u64					trips;
+	bool				open;
+
+	/*
+	 * The read the probe repeats: the last one that succeeded on the
+	 * bus, the last one that failed until one has.
+	 */
+	bool				probe_good;
+	int					probe_nr;
+	unsigned short		probe_addr;
+	unsigned short		probe_flags;
+	u8					probe_reg;
+	struct delayed_work	probe_work;
+};
+
+static LIST_HEAD(i2c_breakers);
+static DEFINE_SPINLOCK(i2c_breaker_lock);
+
+/* Breakers with failures, so a success on a bus without any is cheap */
+static atomic_t i2c_breakers_failing = ATOMIC_INIT(0);
+
+static bool sched_enable = true;
+module_param(sched_enable, bool, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(sched_enable, "order the transactions of each bus by class");
+
+static unsigned int sched_bulk_chunk = 32;
+module_param(sched_bulk_chunk, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(sched_bulk_chunk, "largest bulk read in bytes, 0 leaves them to the driver");
+
+static unsigned int sched_starve_limit = 8;
+module_param(sched_starve_limit, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(sched_starve_limit, "transactions a waiting class lets go ahead before it goes first, 0 never");
+
+static unsigned int segment_threshold = 8;
+module_param(segment_threshold, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(segment_threshold, "timeouts of one mux segment, net of the others', that isolate it, 0 never does");
+
+static unsigned int segment_probe_ms = 1000;
+module_param(segment_probe_ms, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(segment_probe_ms, "first interval of the probe of an isolated segment");
+
+/* One per root adapter, kept once created */
+struct i2c_sched {
+	struct list_head	list;
+	int					root_nr;
+
+	spinlock_t			lock;
+	wait_queue_head_t	wq;
+	struct task_struct *owner;			/* of the transaction on the bus */
+	unsigned int		waiting[I2C_SCHED_CLASSES];
+	unsigned int		passed[I2C_SCHED_CLASSES];	/* went ahead of a waiter */
+
+	u64					count[I2C_SCHED_CLASSES];
+	u64					wait_sum[I2C_SCHED_CLASSES];	/* us */
+	u64					wait_max[I2C_SCHED_CLASSES];	/* us */
+
+	/* hung segment detection and recovery */
+	unsigned int		timeouts;		/* in a row, on any segment */
+	int					suspect_nr;		/* segment that timed out the most of them */
+	unsigned short		suspect_addr;
+	unsigned int		suspect_count;	/* its timeouts less the other segments' */
+	int					hung_nr;		/* isolated segment, -1 if none */
+	unsigned int		probes;			/* since it was isolated */
+	u64					isolations;
+	struct delayed_work	recover_work;
+};
+
+static LIST_HEAD(i2c_scheds);
+static DEFINE_MUTEX(i2c_sched_list_lock);
+
+void i2c_stats_end(struct i2c_stats *st, ktime_t start, int status, unsigned int bytes)
+{
+	unsigned long flags;
+	s64 us;
+	int bucket;
+
+	if (!st) {
+		return;
+	}
+
+	us = ktime_us_delta(ktime_get(), start);
+	if (us < 0) {
+		us = 0;
+	}
+	bucket = min_t(int, fls64(us), I2C_STATS_BUCKETS - 1);
+
+	spin_lock_irqsave(&st->lock, flags);
+	st->transactions++;
+	if (status < 0) {
+		st->errors++;
+	}
+	else {
+		st->bytes += bytes;
+	}
+	st->latency[bucket]++;
+	st->latency_sum += us;
+	if (us > st->latency_max) {
+		st->latency_max = us;
+	}
+	spin_unlock_irqrestore(&st->lock, flags);
+}
+EXPORT_SYMBOL(i2c_stats_end);
+
+void i2c_stats_retry(struct i2c_stats *st)
+{
+	unsigned long flags;
+
+	if (!st) {
+		return;
+	}
+
+	spin_lock_irqsave(&st->lock, flags);
+	st->retries++;
+	spin_unlock_irqrestore(&st->lock, flags);
+}
+EXPORT_SYMBOL(i2c_stats_retry);
+
+void i2c_stats_cache(struct i2c_stats *st, bool hit)
+{
+	unsigned long flags;
+
+	if (!st) {
+		return;
+	}
+
+	spin_lock_irqsave(&st->lock, flags);
+	if (hit) {
+		st->cache_hits++;
+	}
+	else {
+		st->cache_misses++;
+	}
+	spin_unlock_irqrestore(&st->lock, flags);
+}
+EXPORT_SYMBOL(i2c_stats_cache);
+
+static int i2c_root_nr(struct i2c_adapter *adap)
+{
+	struct i2c_adapter *parent;
+
+	while ((parent = i2c_parent_is_i2c_adapter(adap)) != NULL) {
+		adap = parent;
+	}
+
+	return i2c_adapter_id(adap);
+}
+
+/* Called with i2c_breaker_lock held */
+static struct i2c_breaker *i2c_breaker_find(int root_nr)
+{
+	struct i2c_breaker *b;
+
+	list_for_each_entry(b, &i2c_breakers, list) {
+		if (b->root_nr == root_nr) {
+			return b;
+		}
+	}
+
+	return NULL;
+}
+
+static void i2c_breaker_probe(struct work_struct *work)
+{
+	struct i2c_breaker *b = container_of(to_delayed_work(work),
+										 struct i2c_breaker, probe_work);
+	union i2c_smbus_data data;
+	struct i2c_adapter *adap;
+	unsigned long flags;
+	int status = -ENODEV;
+	bool closed;
+
+	adap = i2c_get_adapter(b->probe_nr);
+	if (adap) {
+		status = i2c_smbus_xfer(adap, b->probe_addr, b->probe_flags, I2C_SMBUS_READ,
+								b->probe_reg, I2C_SMBUS_BYTE_DATA, &data);
+		i2c_put_adapter(adap);
+	}
+
+	spin_lock_irqsave(&i2c_breaker_lock, flags);
+	closed = !b->open;	/* by a call that succeeded meanwhile */
+	if (!closed && (status >= 0 || !adap)) {
+		/* There is nothing left to probe once the adapter is gone */
+		b->open = false;
+		b->failures = 0;
+		atomic_dec(&i2c_breakers_failing);
+	}
+	spin_unlock_irqrestore(&i2c_breaker_lock, flags);
+
+	if (closed) {
+		return;
+	}
+
+	if (!adap) {
+		pr_info("accton_i2c_stats: i2c-%d is gone, not probed again\n", b->probe_nr);
+	}
+	else if (status >= 0) {
+		pr_info("accton_i2c_stats: i2c-%d is back\n", b->root_nr);
+	}
+	else {
+		schedule_delayed_work(&b->probe_work, msecs_to_jiffies(breaker_probe_ms));
+	}
+}
+
+static bool i2c_segment_down(struct i2c_adapter *adap);
+
+bool i2c_bus_down(struct i2c_adapter *adap)
+{
+	struct i2c_breaker *b;
+	unsigned long flags;
+	bool down = false;
+
+	spin_lock_irqsave(&i2c_breaker_lock, flags);
+	b = i2c_breaker_find(i2c_root_nr(adap));
+	if (b) {
+		down = b->open;
+	}
+	spin_unlock_irqrestore(&i2c_breaker_lock, flags);
+
+	return down || i2c_segment_down(adap);
+}
+EXPORT_SYMBOL(i2c_bus_down);
+
+/*
+ * Called with i2c_breaker_lock held, which is dropped and taken again
+ * for the allocation.  NULL only if that failed.
+ */
+static struct i2c_breaker *i2c_breaker_get(int root_nr, unsigned long *flags)
+{
+	struct i2c_breaker *b, *new;
+
+	b = i2c_breaker_find(root_nr);
+	if (b) {
+		return b;
+	}
+
+	spin_unlock_irqrestore(&i2c_breaker_lock, *flags);
+	new = kzalloc(sizeof(*new), GFP_KERNEL);
+	spin_lock_irqsave(&i2c_breaker_lock, *flags);
+
+	/* someone else may have added it meanwhile */
+	b = i2c_breaker_find(root_nr);
+	if (!b && new) {
+		b = new;
+		new = NULL;
+		b->root_nr = root_nr;
+		INIT_DELAYED_WORK(&b->probe_work, i2c_breaker_probe);
+		list_add_tail(&b->list, &i2c_breakers);
+	}
+	kfree(new);
+
+	return b;
+}
+
+static void i2c_breaker_set_probe(struct i2c_breaker *b,
+			const struct i2c_client *client, u8 reg, bool good)
+{
+	b->probe_good = good;
+	b->probe_nr = i2c_adapter_id(client->adapter);
+	b->probe_addr = client->addr;
+	b->probe_flags = client->flags;
+	b->probe_reg = reg;
+}
+
+/* Called with i2c_breaker_lock held.  Returns true if it was open. */
+static bool i2c_breaker_close(struct i2c_breaker *b)
+{
+	bool closed = b->open;
+
+	if (b->failures) {
+		atomic_dec(&i2c_breakers_failing);
+	}
+	b->open = false;
+	b->failures = 0;
+
+	return closed;
+}
+
+/* Any access that succeeds on the bus closes its breaker */
+static void i2c_breaker_reset(int root_nr, u16 addr)
+{
+	struct i2c_breaker *b;
+	unsigned long flags;
+	bool closed = false;
+
+	if (!atomic_read(&i2c_breakers_failing)) {
+		return;
+	}
+
+	spin_lock_irqsave(&i2c_breaker_lock, flags);
+	b = i2c_breaker_find(root_nr);
+	if (b) {
+		closed = i2c_breaker_close(b);
+	}
+	spin_unlock_irqrestore(&i2c_breaker_lock, flags);
+
+	if (closed) {
+		pr_info("accton_i2c_stats: i2c-%d is back, 0x%02x answered\n",
+				root_nr, addr);
+	}
+}
+
+/* A read that succeeded through i2c_retry_* also becomes the probe */
+static void i2c_breaker_ok(const struct i2c_client *client, u8 reg)
+{
+	int root_nr = i2c_root_nr(client->adapter);
+	struct i2c_breaker *b;
+	unsigned long flags;
+	bool closed = false;
+
+	spin_lock_irqsave(&i2c_breaker_lock, flags);
+	b = i2c_breaker_get(root_nr, &flags);
+	if (b) {
+		closed = i2c_breaker_close(b);
+		i2c_breaker_set_probe(b, client, reg, true);
+	}
+	spin_unlock_irqrestore(&i2c_breaker_lock, flags);
+
+	if (closed) {
+		pr_info("accton_i2c_stats: i2c-%d is back, 0x%02x answered\n",
+				root_nr, client->addr);
+	}
+}
+
+/* Called once per failed access.  Returns true if it opened the breaker. */
+static bool i2c_breaker_fail(const struct i2c_client *client, u8 reg)
+{
+	int root_nr = i2c_root_nr(client->adapter);
+	struct i2c_breaker *b;
+	unsigned long flags;
+	unsigned short probe_addr = 0;
+	bool tripped = false;
+
+	spin_lock_irqsave(&i2c_breaker_lock, flags);
+	b = i2c_breaker_get(root_nr, &flags);
+	if (b && !b->open) {
+		if (b->failures++ == 0) {
+			atomic_inc(&i2c_breakers_failing);
+		}
+		if (!b->probe_good) {
+			i2c_breaker_set_probe(b, client, reg, false);
+		}
+
+		if (breaker_threshold && b->failures >= breaker_threshold) {
+			b->open = true;
+			b->trips++;
+			probe_addr = b->probe_addr;
+			tripped = true;
+		}
+	}
+	spin_unlock_irqrestore(&i2c_breaker_lock, flags);
+
+	if (tripped) {
+		pr_warn("accton_i2c_stats: i2c-%d down after %u failed accesses, probing 0x%02x\n",
+				root_nr, breaker_threshold, probe_addr);
+		schedule_delayed_work(&b->probe_work, msecs_to_jiffies(breaker_probe_ms));
+	}
+
+	return tripped;
+}
+
+static s32 i2c_retry_byte_data(struct i2c_stats *st, const struct i2c_retry_policy *p,
+			const struct i2c_client *client, bool write, u8 command, u8 value)
+{
+	ktime_t start;
+	unsigned int delay = p->min_us;
+	bool bus_error = false;
+	s32 status;
+
+	if (i2c_bus_down(client->adapter)) {
+		return -EHOSTDOWN;
+	}
+
+	/*
+	 * The access counts as one failure toward the breaker once its
+	 * deadline is over, not one per attempt.
+	 */
+	start = ktime_get();
+	for (;;) {
+		if (write) {
+			status = i2c_stats_write_byte_data(st, client, command, value);
+		}
+		else {
+			status = i2c_stats_read_byte_data(st, client, command);
+		}
+
+		if (status >= 0) {
+			i2c_breaker_ok(client, command);
+			return status;
+		}
+
+		/* An isolated segment is not a failure of the whole bus */
+		if (status == -EHOSTDOWN) {
+			return status;
+		}
+
+		/* A NACK only says this device is absent or busy, the bus works */
+		if (status != -ENXIO) {
+			bus_error = true;
+		}
+
+		if (ktime_us_delta(ktime_get(), start) + delay > p->deadline_us) {
+			break;
+		}
+
+		usleep_range(delay, delay + delay / 2);
+		i2c_stats_retry(st);
+		delay = min(delay * 2, p->max_us);
+
+		/* opened meanwhile by another access */
+		if (i2c_bus_down(client->adapter)) {
+			return -EHOSTDOWN;
+		}
+	}
+
+	if (bus_error && i2c_breaker_fail(client, command)) {
+		return -EHOSTDOWN;
+	}
+
+	return status;
+}
+
+s32 i2c_retry_read_byte_data(struct i2c_stats *st, const struct i2c_retry_policy *p,
+			const struct i2c_client *client, u8 command)
+{
+	return i2c_retry_byte_data(st, p, client, false, command, 0);
+}
+EXPORT_SYMBOL(i2c_retry_read_byte_data);
+
+s32 i2c_retry_write_byte_data(struct i2c_stats *st, const struct i2c_retry_policy *p,
+			const struct i2c_client *client, u8 command, u8 value)
+{
+	return i2c_retry_byte_data(st, p, client, true, command, value);
+}
+EXPORT_SYMBOL(i2c_retry_write_byte_data);
+
+void i2c_stats_set_class(struct i2c_stats *st, enum i2c_sched_class class)
+{
+	if (st && class < I2C_SCHED_CLASSES) {
+		st->class = class;
+	}
+}
+EXPORT_SYMBOL(i2c_stats_set_class);
+
+size_t i2c_sched_chunk(struct i2c_stats *st, size_t count)
+{
+	unsigned int chunk = sched_bulk_chunk;
+
+	if (!st || st->class != I2C_SCHED_BULK || !sched_enable || !chunk) {
+		return count;
+	}
+
+	return min_t(size_t, count, chunk);
+}
+EXPORT_SYMBOL(i2c_sched_chunk);
+
+/*
+ * Returns 1 once the pca954x that owns 'seg' is found.  The channel is
+ * switched off through the mux's own deselect, which keeps the channel
+ * the driver has cached in step with the chip, so the next call on the
+ * segment selects it again.  A mux without one (no idle disconnect)
+ * keeps the channel on; the calls on it are refused until the probe
+ * passes.  Older kernels have no i2c_mux_core to look this up.
+ */
+static int i2c_segment_deselect(struct device *dev, void *seg)
+{
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4,7,0)
+	struct i2c_client *client = i2c_verify_client(dev);
+	struct i2c_mux_core *muxc;
+	int i;
+
+	if (!client || !dev->driver || strcmp(dev->driver->name, "pca954x")) {
+		return 0;
+	}
+
+	muxc = i2c_get_clientdata(client);
+	for (i = 0; muxc && i < muxc->num_adapters; i++) {
+		if (muxc->adapter[i] != seg) {
+			continue;
+		}
+
+		/* pca954x adds its channels in order, so i is the chan_id */
+		if (muxc->deselect) {
+			i2c_lock_bus(seg, I2C_LOCK_ROOT_ADAPTER);
+			muxc->deselect(muxc, i);
+			i2c_unlock_bus(seg, I2C_LOCK_ROOT_ADAPTER);
+		}
+		return 1;
+	}
+#endif
+	return 0;
+}
+
+/* Clocks out whatever holds SDA low, then takes the segment off its mux */
+static void i2c_segment_release(struct i2c_sched *s, struct i2c_adapter *seg)
+{
+	struct i2c_adapter *root, *parent;
+
+	root = i2c_get_adapter(s->root_nr);
+	if (root) {
+		if (root->bus_recovery_info) {
+			/* i2c_lock_adapter() is gone since 4.19 */
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4,7,0)
+			i2c_lock_bus(root, I2C_LOCK_ROOT_ADAPTER);
+			i2c_recover_bus(root);
+			i2c_unlock_bus(root, I2C_LOCK_ROOT_ADAPTER);
+#else
+			i2c_lock_adapter(root);
+			i2c_recover_bus(root);
+			i2c_unlock_adapter(root);
+#endif
+		}
+		i2c_put_adapter(root);
+	}
+
+	parent = i2c_parent_is_i2c_adapter(seg);
+	if (parent) {
+		device_for_each_child(&parent->dev, seg, i2c_segment_deselect);
+	}
+}
+
+static void i2c_segment_recover(struct work_struct *work)
+{
+	struct i2c_sched *s = container_of(to_delayed_work(work),
+									   struct i2c_sched, recover_work);
+	union i2c_smbus_data data;
+	struct i2c_adapter *seg;
+	unsigned int shift;
+	int status;
+
+	seg = i2c_get_adapter(s->hung_nr);
+	if (!seg) {
+		/* its mux is gone */
+		status = 0;
+		goto reenable;
+	}
+
+	if (s->probes) {
+		/*
+		 * Selects the channel again.  Only a reply proves the segment
+		 * works: a NACK is also what a segment still cut off gives.
+		 */
+		status = i2c_smbus_xfer(seg, s->suspect_addr, 0, I2C_SMBUS_READ,
+								0, I2C_SMBUS_BYTE_DATA, &data);
+		if (status >= 0) {
+			i2c_put_adapter(seg);
+			goto reenable;
+		}
+	}
+
+	i2c_segment_release(s, seg);
+	i2c_put_adapter(seg);
+
+	shift = min(s->probes, 5U);
+	s->probes++;
+	schedule_delayed_work(&s->recover_work, msecs_to_jiffies(segment_probe_ms << shift));
+	return;
+
+reenable:
+	pr_info("accton_i2c_stats: i2c-%d back on i2c-%d after %u probes\n",
+			s->hung_nr, s->root_nr, s->probes);
+	spin_lock_irq(&s->lock);
+	s->hung_nr = -1;
+	s->timeouts = 0;
+	s->suspect_count = 0;
+	spin_unlock_irq(&s->lock);
+}
+
+/* The errors of a bus that is held low rather than of a device that is absent */
+static bool i2c_segment_timeout(int status)
+{
+	return status == -ETIMEDOUT || status == -EAGAIN ||
+		   status == -EBUSY || status == -EIO;
+}
+
+/*
+ * Called with s->lock held after every call on the root adapter.
+ * Returns true if the suspect segment has to be isolated.
+ *
+ * A segment held low makes the calls on every other segment time out
+ * too, so the first timeout of a run may well be a bystander's.  The
+ * suspect is the segment that keeps timing out: its count goes up with
+ * each of its timeouts and down with another segment's, which takes
+ * over once the count is back to zero.  It is isolated when the count
+ * reaches segment_threshold, that is its timeouts outnumber those of
+ * the other segments by that many within one run.
+ */
+static bool i2c_segment_account(struct i2c_sched *s, struct i2c_adapter *adap,
+								u16 addr, int status)
+{
+	int nr = i2c_adapter_id(adap);
+
+	if (status >= 0 || status == -ENXIO) {
+		s->timeouts = 0;
+		s->suspect_count = 0;
+		return false;
+	}
+
+	if (!i2c_segment_timeout(status) || s->hung_nr >= 0) {
+		return false;
+	}
+
+	s->timeouts++;
+	if (s->suspect_count == 0) {
+		s->suspect_nr = nr;
+	}
+	if (nr == s->suspect_nr) {
+		s->suspect_addr = addr;
+		s->suspect_count++;
+	}
+	else {
+		s->suspect_count--;
+	}
+
+	/* A device straight on the root adapter is left to the breaker */
+	if (!segment_threshold || s->suspect_count < segment_threshold ||
+		s->suspect_nr == s->root_nr) {
+		return false;
+	}
+
+	s->hung_nr = s->suspect_nr;
+	s->probes = 0;
+	s->isolations++;
+	return true;
+}
+
+static bool i2c_segment_down(struct i2c_adapter *adap)
+{
+	int root_nr = i2c_root_nr(adap);
+	struct i2c_sched *s;
+	bool down = false;
+
+	mutex_lock(&i2c_sched_list_lock);
+	list_for_each_entry(s, &i2c_scheds, list) {
+		if (s->root_nr == root_nr) {
+			down = (ACCESS_ONCE(s->hung_nr) == i2c_adapter_id(adap));
+			break;
+		}
+	}
+	mutex_unlock(&i2c_sched_list_lock);
+
+	return down;
+}
+
+static struct i2c_sched *i2c_sched_get(struct i2c_adapter *adap)
+{
+	int root_nr = i2c_root_nr(adap);
+	struct i2c_sched *s;
+
+	mutex_lock(&i2c_sched_list_lock);
+	list_for_each_entry(s, &i2c_scheds, list) {
+		if (s->root_nr == root_nr) {
+			goto exit;
+		}
+	}
+
+	s = kzalloc(sizeof(*s), GFP_KERNEL);
+	if (s) {
+		s->root_nr = root_nr;
+		s->suspect_nr = -1;
+		s->hung_nr = -1;
+		spin_lock_init(&s->lock);
+		init_waitqueue_head(&s->wq);
+		INIT_DELAYED_WORK(&s->recover_work, i2c_segment_recover);
+		list_add_tail(&s->list, &i2c_scheds);
+	}
+
+exit:
+	mutex_unlock(&i2c_sched_list_lock);
+	return s;
+}
+
+/* Called with s->lock held */
+static bool i2c_sched_starved(struct i2c_sched *s, enum i2c_sched_class class)
+{
+	unsigned int limit = sched_starve_limit;
+
+	return limit && s->waiting[class] && s->passed[class] >= limit;
+}
+
+/* Called with s->lock held */
+static bool i2c_sched_may_run(struct i2c_sched *s, enum i2c_sched_class class)
+{
+	int i;
+
+	if (s->owner) {
+		return false;
+	}
+
+	if (i2c_sched_starved(s, class)) {
+		return true;
+	}
+
+	for (i = 0; i < I2C_SCHED_CLASSES; i++) {
+		if (i < class && s->waiting[i]) {
+			return false;
+		}
+		if (i > class && i2c_sched_starved(s, i)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/*
+ * Returns the scheduler to hand to i2c_sched_exit() once the transaction
+ * is done, NULL if there is none and ERR_PTR(-EHOSTDOWN) if the segment
+ * of 'adap' is isolated and the transaction must not be started.
+ */
+struct i2c_sched *i2c_sched_enter(struct i2c_stats *st, struct i2c_adapter *adap, bool write,
+			int class)
+{
+	struct i2c_sched *s;
+	ktime_t start;
+	s64 us;
+	int i;
+
+	if (!st) {
+		return NULL;
+	}
+
+	/* A device stays on its bus, so look the scheduler up once */
+	s = ACCESS_ONCE(st->sched);
+	if (!s || s->root_nr != i2c_root_nr(adap)) {
+		s = i2c_sched_get(adap);
+		if (!s) {
+			return NULL;
+		}
+		st->sched = s;
+	}
+
+	if (ACCESS_ONCE(s->hung_nr) == i2c_adapter_id(adap)) {
+		return ERR_PTR(-EHOSTDOWN);
+	}
+
+	if (!sched_enable) {
+		return s;
+	}
+	if (class < 0 || class >= I2C_SCHED_CLASSES) {
+		class = write ? I2C_SCHED_CONTROL : st->class;
+	}
+
+	start = ktime_get();
+	spin_lock_irq(&s->lock);
+	s->waiting[class]++;
+	wait_event_lock_irq(s->wq, i2c_sched_may_run(s, class), s->lock);
+	s->waiting[class]--;
+	s->owner = current;
+
+	s->passed[class] = 0;
+	for (i = class + 1; i < I2C_SCHED_CLASSES; i++) {
+		if (s->waiting[i]) {
+			s->passed[i]++;
+		}
+	}
+
+	us = ktime_us_delta(ktime_get(), start);
+	s->count[class]++;
+	s->wait_sum[class] += us;
+	if (us > s->wait_max[class]) {
+		s->wait_max[class] = us;
+	}
+	spin_unlock_irq(&s->lock);
+
+	return s;
+}
+EXPORT_SYMBOL(i2c_sched_enter);
+
+void i2c_sched_exit(struct i2c_sched *s, struct i2c_adapter *adap, u16 addr, int status)
+{
+	bool owner, isolate;
+
+	if (IS_ERR_OR_NULL(s)) {
+		return;
+	}
+
+	spin_lock_irq(&s->lock);
+	/* not the owner if scheduling was turned off while on the bus */
+	owner = (s->owner == current);
+	if (owner) {
+		s->owner = NULL;
+	}
+	isolate = i2c_segment_account(s, adap, addr, status);
+	spin_unlock_irq(&s->lock);
+
+	if (status >= 0) {
+		i2c_breaker_reset(s->root_nr, addr);
+	}
+
+	if (owner) {
+		wake_up_all(&s->wq);
+	}
+
+	if (isolate) {
+		pr_warn("accton_i2c_stats: i2c-%d hangs i2c-%d, isolated after %u timeouts at 0x%02x\n",
+				s->hung_nr, s->root_nr, s->timeouts, s->suspect_addr);
+		schedule_delayed_work(&s->recover_work, 0);
+	}
+}
+EXPORT_SYMBOL(i2c_sched_exit);
+
+static int i2c_sched_show(struct seq_file *seq, void *unused)
+{
+	static const char * const names[I2C_SCHED_CLASSES] = {
+		"control", "health", "bulk"
+	};
+	struct i2c_sched *s;
+	int i;
+
+	mutex_lock(&i2c_sched_list_lock);
+	list_for_each_entry(s, &i2c_scheds, list) {
+		spin_lock_irq(&s->lock);
+		for (i = 0; i < I2C_SCHED_CLASSES; i++) {
+			seq_printf(seq, "i2c-%d %-8s count %llu wait_avg %llu wait_max %llu\n",
+					   s->root_nr, names[i], s->count[i],
+					   s->count[i] ? div64_u64(s->wait_sum[i], s->count[i]) : 0,
+					   s->wait_max[i]);
+		}
+		spin_unlock_irq(&s->lock);
+	}
+	mutex_unlock(&i2c_sched_list_lock);
+
+	return 0;
+}
+
+static int i2c_sched_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, i2c_sched_show, NULL);
+}
+
+static const struct file_operations i2c_sched_fops = {
+	.owner   = THIS_MODULE,
+	.open	 = i2c_sched_open,
+	.read	 = seq_read,
+	.llseek  = seq_lseek,
+	.release = single_release,
+};
+
+static int i2c_segments_show(struct seq_file *seq, void *unused)
+{
+	struct i2c_sched *s;
+
+	mutex_lock(&i2c_sched_list_lock);
+	list_for_each_entry(s, &i2c_scheds, list) {
+		spin_lock_irq(&s->lock);
+		if (s->hung_nr >= 0) {
+			seq_printf(seq, "i2c-%d isolated i2c-%d probes %u isolations %llu\n",
+					   s->root_nr, s->hung_nr, s->probes, s->isolations);
+		}
+		else {
+			seq_printf(seq, "i2c-%d ok timeouts %u isolations %llu\n",
+					   s->root_nr, s->timeouts, s->isolations);
+		}
+		spin_unlock_irq(&s->lock);
+	}
+	mutex_unlock(&i2c_sched_list_lock);
+
+	return 0;
+}
+
+static int i2c_segments_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, i2c_segments_show, NULL);
+}
+
+static const struct file_operations i2c_segments_fops = {
+	.owner   = THIS_MODULE,
+	.open	 = i2c_segments_open,
+	.read	 = seq_read,
+	.llseek  = seq_lseek,
+	.release = single_release,
+};
+
+static int i2c_breakers_show(struct seq_file *s, void *unused)
+{
+	struct i2c_breaker *b;
+	unsigned long flags;
+
+	spin_lock_irqsave(&i2c_breaker_lock, flags);
+	list_for_each_entry(b, &i2c_breakers, list) {
+		seq_printf(s, "i2c-%d %s failures %u trips %llu\n", b->root_nr,
+				   b->open ? "down" : "up", b->failures, b->trips);
+	}
+	spin_unlock_irqrestore(&i2c_breaker_lock, flags);
+
+	return 0;
+}
+
+static int i2c_breakers_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, i2c_breakers_show, NULL);
+}
+
+static const struct file_operations i2c_breakers_fops = {
+	.owner   = THIS_MODULE,
+	.open	 = i2c_breakers_open,
+	.read	 = seq_read,
+	.llseek  = seq_lseek,
+	.release = single_release,
+};
+
+static int i2c_stats_latency_show(struct seq_file *s, void *unused)
+{
+	struct i2c_stats *st = s->private;
+	u64 latency[I2C_STATS_BUCKETS];
+	u64 count, sum, max;
+	unsigned long flags;
+	int i, last = 0;
+
+	spin_lock_irqsave(&st->lock, flags);
+	memcpy(latency, st->latency, sizeof(latency));
+	count = st->transactions;
+	sum = st->latency_sum;
+	max = st->latency_max;
+	spin_unlock_irqrestore(&st->lock, flags);
+
+	for (i = 0; i < I2C_STATS_BUCKETS; i++) {
+		if (latency[i]) {
+			last = i;
+		}
+	}
+
+	seq_printf(s, "%8s -> %-8s : count\n", "usecs", "");
+	for (i = 0; i <= last; i++) {
+		u64 low = i ? (1ULL << (i - 1)) : 0;
+
+		if (i == I2C_STATS_BUCKETS - 1) {
+			seq_printf(s, "%8llu -> %-8s : %llu\n", low, "", latency[i]);
+		}
+		else {
+			seq_printf(s, "%8llu -> %-8llu : %llu\n", low, (1ULL << i) - 1, latency[i]);
+		}
+	}
+
+	seq_printf(s, "avg %llu us, max %llu us\n",
+			   count ? div64_u64(sum, count) : 0, max);
+	return 0;
+}
+
+static int i2c_stats_latency_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, i2c_stats_latency_show, inode->i_private);
+}
+
+static const struct file_operations i2c_stats_latency_fops = {
+	.owner   = THIS_MODULE,
+	.open	 = i2c_stats_latency_open,
+	.read	 = seq_read,
+	.llseek  = seq_lseek,
+	.release = single_release,
+};
+
+static ssize_t i2c_stats_reset_write(struct file *file, const char __user *buf,
+			size_t count, loff_t *ppos)
+{
+	struct i2c_stats *st = file->private_data;
+	unsigned long flags;
+
+	spin_lock_irqsave(&st->lock, flags);
+	st->transactions = 0;
+	st->bytes = 0;
+	st->errors = 0;
+	st->retries = 0;
+	st->cache_hits = 0;
+	st->cache_misses = 0;
+	st->latency_max = 0;
+	st->latency_sum = 0;
+	memset(st->latency, 0, sizeof(st->latency));
+	spin_unlock_irqrestore(&st->lock, flags);
+
+	return count;
+}
+
+static const struct file_operations i2c_stats_reset_fops = {
+	.owner = THIS_MODULE,
+	.open  = simple_open,
+	.write = i2c_stats_reset_write,
+};
+
+/*
+ * Statistics are a debugging aid: without debugfs nothing can be read
+ * back but the device is still scheduled.  NULL is returned if there is
+ * no memory, and the driver simply runs uncounted and unscheduled.
+ */
+struct i2c_stats *i2c_stats_register(struct device *dev)
+{
+	struct i2c_stats *st;
+
+	st = kzalloc(sizeof(struct i2c_stats), GFP_KERNEL);
+	if (!st) {
+		return NULL;
+	}
+
+	spin_lock_init(&st->lock);
+	st->class = I2C_SCHED_HEALTH;
+
+	if (IS_ERR_OR_NULL(i2c_stats_root)) {
+		return st;
+	}
+
+	st->dir = debugfs_create_dir(dev_name(dev), i2c_stats_root);
+	if (IS_ERR_OR_NULL(st->dir)) {
+		st->dir = NULL;
+		return st;
+	}
+
+	debugfs_create_u64("transactions", S_IRUGO, st->dir, &st->transactions);
+	debugfs_create_u64("bytes", S_IRUGO, st->dir, &st->bytes);
+	debugfs_create_u64("errors", S_IRUGO, st->dir, &st->errors);
+	debugfs_create_u64("retries", S_IRUGO, st->dir, &st->retries);
+	debugfs_create_u64("cache_hits", S_IRUGO, st->dir, &st->cache_hits);
+	debugfs_create_u64("cache_misses", S_IRUGO, st->dir, &st->cache_misses);
+	debugfs_create_file("latency", S_IRUGO, st->dir, st, &i2c_stats_latency_fops);
+	debugfs_create_file("reset", S_IWUSR, st->dir, st, &i2c_stats_reset_fops);
+
+	return st;
+}
+EXPORT_SYMBOL(i2c_stats_register);
+
+void i2c_stats_unregister(struct i2c_stats *st)
+{
+	if (!st) {
+		return;
+	}
+
+	if (st->dir) {
+		debugfs_remove_recursive(st->dir);
+	}
+	kfree(st);
+}
+EXPORT_SYMBOL(i2c_stats_unregister);
+
+static int __init i2c_stats_init(void)
+{
+	/* Without debugfs the drivers still load, they just count nothing */
+	i2c_stats_root = debugfs_create_dir(I2C_STATS_ROOT, NULL);
+	if (!IS_ERR_OR_NULL(i2c_stats_root)) {
+		debugfs_create_file("breakers", S_IRUGO, i2c_stats_root, NULL, &i2c_breakers_fops);
+		debugfs_create_file("sched", S_IRUGO, i2c_stats_root, NULL, &i2c_sched_fops);
+		debugfs_create_file("segments", S_IRUGO, i2c_stats_root, NULL, &i2c_segments_fops);
+	}
+	return 0;
+}
+
+static void __exit i2c_stats_exit(void)
+{
+	struct i2c_breaker *b, *next;
+	struct i2c_sched *s, *snext;
+
+	if (!IS_ERR_OR_NULL(i2c_stats_root)) {
+		debugfs_remove_recursive(i2c_stats_root);
+	}
+
+	/* No driver is left to take a breaker */
+	list_for_each_entry_safe(b, next, &i2c_breakers, list) {
+		cancel_delayed_work_sync(&b->probe_work);
+		list_del(&b->list);
+		kfree(b);
+	}
+
+	list_for_each_entry_safe(s, snext, &i2c_scheds, list) {
+		cancel_delayed_work_sync(&s->recover_work);
+		list_del(&s->list);
+		kfree(s);
+	}
+}
+
+module_init(i2c_stats_init);
+module_exit(i2c_stats_exit);
+
+MODULE_AUTHOR("Brandon Chuang <brandon_chuang@accton.com.tw>");
+MODULE_DESCRIPTION("accton I2C transaction statistics, retry policy and tracepoints");
+MODULE_LICENSE("GPL");
@@ -0,0 +1,311 @@
+/*
+ * Per device I2C transaction statistics for accton platform drivers
+ *
+ * Copyright (C) 2018 Accton Technology Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#ifndef __ACCTON_I2C_STATS_H__
+#define __ACCTON_I2C_STATS_H__
+
+#include <linux/types.h>
+#include <linux/err.h>
+#include <linux/ktime.h>
+#include <linux/i2c.h>
+
+/* log2 of the latency in us: bucket 0 is < 1us, bucket n is [2^(n-1), 2^n) */
+#define I2C_STATS_BUCKETS	21
+
+struct i2c_stats;
+
+/*
+ * A NULL struct i2c_stats is valid everywhere and counts nothing, so a
+ * driver does not have to care whether registration failed.
+ */
+struct i2c_stats *i2c_stats_register(struct device *dev);
+void i2c_stats_unregister(struct i2c_stats *st);
+
+/*
+ * Bus scheduling.  Every call below waits its turn on the root adapter
+ * of its bus: a transaction starts only when none of a more urgent
+ * class is waiting, so a control write waits for at most the one that
+ * is on the bus already instead of the whole queue of an EEPROM sweep.
+ * By default writes are I2C_SCHED_CONTROL and reads are of the class of
+ * their i2c_stats (I2C_SCHED_HEALTH unless set); the *_class calls give
+ * the class of one transaction instead.  Bulk reads should also be cut
+ * to i2c_sched_chunk() bytes so that they yield often.  A class that
+ * more urgent transactions went ahead of sched_starve_limit times in a
+ * row goes first the next time, so a busy bus still moves bulk traffic.
+ * /sys/kernel/debug/accton/sched has the wait of each class per bus.
+ *
+ * Hung segments.  A device stuck in the middle of a transfer holds SDA
+ * low and, through its pca954x channel, takes every other segment of
+ * the root adapter down with it.  When one segment keeps timing out,
+ * segment_threshold times more than the other segments of the root
+ * adapter since the last call that got through, its mux channel is
+ * isolated: calls on that segment fail at once with -EHOSTDOWN, the
+ * root adapter gets its 9 clock recovery if it has one and the channel
+ * is switched off.  A background probe of the device then re-enables
+ * the segment once it answers, after segment_probe_ms and twice as long
+ * each time up to 32 times that.  /sys/kernel/debug/accton/segments
+ * has what is isolated per root adapter.
+ */
+enum i2c_sched_class {
+	I2C_SCHED_CONTROL,		/* tx_disable, reset, fan duty */
+	I2C_SCHED_HEALTH,		/* presence, fan, PSU and thermal polling */
+	I2C_SCHED_BULK,			/* EEPROM contents */
+	I2C_SCHED_CLASSES
+};
+
+#define I2C_SCHED_DEFAULT	(-1)
+
+struct i2c_sched;
+
+void i2c_stats_set_class(struct i2c_stats *st, enum i2c_sched_class class);
+size_t i2c_sched_chunk(struct i2c_stats *st, size_t count);
+struct i2c_sched *i2c_sched_enter(struct i2c_stats *st, struct i2c_adapter *adap, bool write,
+			int class);
+void i2c_sched_exit(struct i2c_sched *s, struct i2c_adapter *adap, u16 addr, int status);
+
+void i2c_stats_end(struct i2c_stats *st, ktime_t start, int status, unsigned int bytes);
+void i2c_stats_retry(struct i2c_stats *st);
+void i2c_stats_cache(struct i2c_stats *st, bool hit);
+
+static inline ktime_t i2c_stats_begin(struct i2c_stats *st)
+{
+	return st ? ktime_get() : ktime_set(0, 0);
+}
+
+/*
+ * The SMBus/I2C calls of linux/i2c.h, accounted to 'st' and scheduled in
+ * 'class', I2C_SCHED_DEFAULT for the class of the call as above
+ */
+
+static inline s32 i2c_stats_read_byte_data_class(struct i2c_stats *st, int class,
+			const struct i2c_client *client, u8 command)
+{
+	struct i2c_sched *s = i2c_sched_enter(st, client->adapter, false, class);
+	ktime_t start;
+	s32 status;
+
+	if (IS_ERR(s)) {
+		return PTR_ERR(s);
+	}
+
+	start = i2c_stats_begin(st);
+	status = i2c_smbus_read_byte_data(client, command);
+
+	i2c_stats_end(st, start, status, 1);
+	i2c_sched_exit(s, client->adapter, client->addr, status);
+	return status;
+}
+
+static inline s32 i2c_stats_write_byte_data_class(struct i2c_stats *st, int class,
+			const struct i2c_client *client, u8 command, u8 value)
+{
+	struct i2c_sched *s = i2c_sched_enter(st, client->adapter, true, class);
+	ktime_t start;
+	s32 status;
+
+	if (IS_ERR(s)) {
+		return PTR_ERR(s);
+	}
+
+	start = i2c_stats_begin(st);
+	status = i2c_smbus_write_byte_data(client, command, value);
+
+	i2c_stats_end(st, start, status, 1);
+	i2c_sched_exit(s, client->adapter, client->addr, status);
+	return status;
+}
+
+static inline s32 i2c_stats_read_word_data_class(struct i2c_stats *st, int class,
+			const struct i2c_client *client, u8 command)
+{
+	struct i2c_sched *s = i2c_sched_enter(st, client->adapter, false, class);
+	ktime_t start;
+	s32 status;
+
+	if (IS_ERR(s)) {
+		return PTR_ERR(s);
+	}
+
+	start = i2c_stats_begin(st);
+	status = i2c_smbus_read_word_data(client, command);
+
+	i2c_stats_end(st, start, status, 2);
+	i2c_sched_exit(s, client->adapter, client->addr, status);
+	return status;
+}
+
+static inline s32 i2c_stats_write_word_data_class(struct i2c_stats *st, int class,
+			const struct i2c_client *client, u8 command, u16 value)
+{
+	struct i2c_sched *s = i2c_sched_enter(st, client->adapter, true, class);
+	ktime_t start;
+	s32 status;
+
+	if (IS_ERR(s)) {
+		return PTR_ERR(s);
+	}
+
+	start = i2c_stats_begin(st);
+	status = i2c_smbus_write_word_data(client, command, value);
+
+	i2c_stats_end(st, start, status, 2);
+	i2c_sched_exit(s, client->adapter, client->addr, status);
+	return status;
+}
+
+static inline s32 i2c_stats_read_i2c_block_data_class(struct i2c_stats *st, int class,
+			const struct i2c_client *client, u8 command, u8 length, u8 *values)
+{
+	struct i2c_sched *s = i2c_sched_enter(st, client->adapter, false, class);
+	ktime_t start;
+	s32 status;
+
+	if (IS_ERR(s)) {
+		return PTR_ERR(s);
+	}
+
+	start = i2c_stats_begin(st);
+	status = i2c_smbus_read_i2c_block_data(client, command, length, values);
+
+	i2c_stats_end(st, start, status, (status > 0) ? status : 0);
+	i2c_sched_exit(s, client->adapter, client->addr, status);
+	return status;
+}
+
+static inline s32 i2c_stats_write_i2c_block_data_class(struct i2c_stats *st, int class,
+			const struct i2c_client *client, u8 command, u8 length, const u8 *values)
+{
+	struct i2c_sched *s = i2c_sched_enter(st, client->adapter, true, class);
+	ktime_t start;
+	s32 status;
+
+	if (IS_ERR(s)) {
+		return PTR_ERR(s);
+	}
+
+	start = i2c_stats_begin(st);
+	status = i2c_smbus_write_i2c_block_data(client, command, length, values);
+
+	i2c_stats_end(st, start, status, length);
+	i2c_sched_exit(s, client->adapter, client->addr, status);
+	return status;
+}
+
+static inline int i2c_stats_transfer_class(struct i2c_stats *st, int class,
+			struct i2c_adapter *adap, struct i2c_msg *msgs, int num)
+{
+	struct i2c_sched *s = i2c_sched_enter(st, adap, !(msgs[num - 1].flags & I2C_M_RD), class);
+	ktime_t start;
+	int status, err;
+	unsigned int i, bytes = 0;
+
+	if (IS_ERR(s)) {
+		return PTR_ERR(s);
+	}
+
+	start = i2c_stats_begin(st);
+	status = i2c_transfer(adap, msgs, num);
+
+	for (i = 0; status == num && i < num; i++) {
+		bytes += msgs[i].len;
+	}
+
+	err = (status == num) ? 0 : ((status < 0) ? status : -EIO);
+	i2c_stats_end(st, start, err ? -EIO : 0, bytes);
+	i2c_sched_exit(s, adap, msgs[0].addr, err);
+	return status;
+}
+
+/* The same in the class of the i2c_stats, or control for a write */
+
+static inline s32 i2c_stats_read_byte_data(struct i2c_stats *st,
+			const struct i2c_client *client, u8 command)
+{
+	return i2c_stats_read_byte_data_class(st, I2C_SCHED_DEFAULT, client, command);
+}
+
+static inline s32 i2c_stats_write_byte_data(struct i2c_stats *st,
+			const struct i2c_client *client, u8 command, u8 value)
+{
+	return i2c_stats_write_byte_data_class(st, I2C_SCHED_DEFAULT, client, command, value);
+}
+
+static inline s32 i2c_stats_read_word_data(struct i2c_stats *st,
+			const struct i2c_client *client, u8 command)
+{
+	return i2c_stats_read_word_data_class(st, I2C_SCHED_DEFAULT, client, command);
+}
+
+static inline s32 i2c_stats_write_word_data(struct i2c_stats *st,
+			const struct i2c_client *client, u8 command, u16 value)
+{
+	return i2c_stats_write_word_data_class(st, I2C_SCHED_DEFAULT, client, command, value);
+}
+
+static inline s32 i2c_stats_read_i2c_block_data(struct i2c_stats *st,
+			const struct i2c_client *client, u8 command, u8 length, u8 *values)
+{
+	return i2c_stats_read_i2c_block_data_class(st, I2C_SCHED_DEFAULT, client, command,
+											   length, values);
+}
+
+static inline s32 i2c_stats_write_i2c_block_data(struct i2c_stats *st,
+			const struct i2c_client *client, u8 command, u8 length, const u8 *values)
+{
+	return i2c_stats_write_i2c_block_data_class(st, I2C_SCHED_DEFAULT, client, command,
+												length, values);
+}
+
+static inline int i2c_stats_transfer(struct i2c_stats *st, struct i2c_adapter *adap,
+			struct i2c_msg *msgs, int num)
+{
+	return i2c_stats_transfer_class(st, I2C_SCHED_DEFAULT, adap, msgs, num);
+}
+
+/*
+ * Retry policy and per bus circuit breaker.  A failed call is repeated
+ * after min_us, then twice as long each time up to max_us, as long as
+ * the next attempt still starts within deadline_us of the first.  An
+ * i2c_retry_* call that is still failing at its deadline counts once.
+ * breaker_threshold such calls in a row on the root adapter of a bus
+ * open its breaker: every i2c_retry_* call then fails at once with
+ * -EHOSTDOWN, and a background probe reads the last device that
+ * answered through i2c_retry_* every breaker_probe_ms until it does
+ * again.  A NACK is an absent device, not a failure of the bus.  Any
+ * call above with an i2c_stats that succeeds on the bus closes the
+ * breaker and resets the count.
+ */
+struct i2c_retry_policy {
+	unsigned int	min_us;
+	unsigned int	max_us;
+	unsigned int	deadline_us;
+};
+
+#define I2C_RETRY_POLICY_DEFAULT	{ .min_us = 200, .max_us = 3200, .deadline_us = 20000 }
+
+s32 i2c_retry_read_byte_data(struct i2c_stats *st, const struct i2c_retry_policy *p,
+			const struct i2c_client *client, u8 command);
+s32 i2c_retry_write_byte_data(struct i2c_stats *st, const struct i2c_retry_policy *p,
+			const struct i2c_client *client, u8 command, u8 value);
+
+/* true while the breaker of the bus of 'adap' is open or its segment is isolated */
+bool i2c_bus_down(struct i2c_adapter *adap);
+
+#endif /* __ACCTON_I2C_STATS_H__ */
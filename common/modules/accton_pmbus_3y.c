@@ -33,6 +33,8 @@
 #include <linux/jiffies.h>
 #include <linux/i2c/pmbus.h>
 #include "pmbus.h"
+#include "accton_pmbus_conv.h"
+#include "accton_trace.h"
 
 
 enum chips {
@@ -65,6 +67,8 @@ enum chips {
 
 #define PMBUS_NAME_SIZE		24
 
+#define PMBUS_PAGE_UNKNOWN	0xff
+
 struct pmbus_sensor {
     struct pmbus_sensor *next;
     char name[PMBUS_NAME_SIZE];	/* sysfs sensor name */
@@ -106,6 +110,8 @@ struct pmbus_data {
     /* linear mode: exponent for output voltages */
 
     const struct pmbus_driver_info *info;
+    struct pmbus_conv_direct direct[PSC_NUM_CLASSES];
+    /* direct mode: info->m, b and R scaled to each class' unit */
 
     int max_attributes;
     int num_attributes;
@@ -125,7 +131,7 @@ struct pmbus_data {
     u8 status[PB_NUM_STATUS_REG];
     u8 status_register;
 
-    u8 currpage;
+    u8 currpage;	/* PAGE last selected, PMBUS_PAGE_UNKNOWN if not known */
     bool linear_16;
 };
 
@@ -141,12 +147,29 @@ int _pmbus_set_page(struct i2c_client *client, u8 page)
     if (page != data->currpage) {
         rv = i2c_smbus_write_byte_data(client, PMBUS_PAGE, page);
         newpage = i2c_smbus_read_byte_data(client, PMBUS_PAGE);
-        if (newpage != page)
+        if (newpage != page) {
             rv = -EIO;
-        else
+            data->currpage = PMBUS_PAGE_UNKNOWN;
+        } else {
             data->currpage = page;
+        }
     }
-    return 0;
+    return rv;
+}
+
+/*
+ * Select 'page' before a paged access.  Single page chips never get a
+ * PAGE write, and the select is skipped while the page is still the
+ * current one, so a batch of reads on one page costs a single select.
+ */
+static int pmbus_select_page(struct i2c_client *client, int page)
+{
+    struct pmbus_data *data = i2c_get_clientdata(client);
+
+    if (page < 0 || !data->info || data->info->pages <= 1)
+        return 0;
+
+    return _pmbus_set_page(client, page);
 }
 
 /*
@@ -164,8 +187,12 @@ static int _pmbus_write_byte(struct i2c_client *client, int page, u8 value)
         if (status != -ENODATA)
             return status;
     }
-    /*Ignore page*/
-    return i2c_smbus_write_byte(client, value);;
+
+    status = pmbus_select_page(client, page);
+    if (status < 0)
+        return status;
+
+    return i2c_smbus_write_byte(client, value);
 }
 
 /*
@@ -175,9 +202,15 @@ static int _pmbus_write_byte(struct i2c_client *client, int page, u8 value)
 static int _pmbus_write_word_data(struct i2c_client *client, int page, int reg,
                                   u16 word)
 {
+    int rv;
+
     if (reg >= PMBUS_VIRT_BASE)
         return -ENXIO;
-    /*Ignore page*/
+
+    rv = pmbus_select_page(client, page);
+    if (rv < 0)
+        return rv;
+
     return i2c_smbus_write_word_data(client, reg, word);
 }
 
@@ -187,8 +220,13 @@ static int _pmbus_write_word_data(struct i2c_client *client, int page, int reg,
  */
 static int _pmbus_read_word_data(struct i2c_client *client, int page, int reg)
 {
-    /*Ignore page*/
-    return i2c_smbus_read_word_data(client, reg);;
+    int rv;
+
+    rv = pmbus_select_page(client, page);
+    if (rv < 0)
+        return rv;
+
+    return i2c_smbus_read_word_data(client, reg);
 }
 
 /*
@@ -197,10 +235,15 @@ static int _pmbus_read_word_data(struct i2c_client *client, int page, int reg)
  */
 static int _pmbus_read_byte_data(struct i2c_client *client, int page, int reg)
 {
+    int rv;
+
     if (reg >= PMBUS_VIRT_BASE)
         return -ENXIO;
 
-    /*Ignore page*/
+    rv = pmbus_select_page(client, page);
+    if (rv < 0)
+        return rv;
+
     return i2c_smbus_read_byte_data(client, reg);
 }
 
@@ -242,18 +285,27 @@ static bool pmbus_check_register(struct i2c_client *client,
     return rv >= 0;
 }
 
+/*
+ * Status registers of each page, with the STATUS_WORD bits that point at
+ * them.  A status register is only read while one of its bits is set.
+ */
 static struct _pmbus_status {
     u32 func;
     u16 base;
     u16 reg;
+    u16 summary;
 } pmbus_status[] = {
-    { PMBUS_HAVE_STATUS_VOUT, PB_STATUS_VOUT_BASE, PMBUS_STATUS_VOUT },
-    { PMBUS_HAVE_STATUS_IOUT, PB_STATUS_IOUT_BASE, PMBUS_STATUS_IOUT },
+    {   PMBUS_HAVE_STATUS_VOUT, PB_STATUS_VOUT_BASE, PMBUS_STATUS_VOUT,
+        PB_STATUS_VOUT | PB_STATUS_VOUT_OV
+    },
+    {   PMBUS_HAVE_STATUS_IOUT, PB_STATUS_IOUT_BASE, PMBUS_STATUS_IOUT,
+        PB_STATUS_IOUT_POUT | PB_STATUS_IOUT_OC
+    },
     {   PMBUS_HAVE_STATUS_TEMP, PB_STATUS_TEMP_BASE,
-        PMBUS_STATUS_TEMPERATURE
+        PMBUS_STATUS_TEMPERATURE, PB_STATUS_TEMPERATURE
     },
-    { PMBUS_HAVE_STATUS_FAN12, PB_STATUS_FAN_BASE, PMBUS_STATUS_FAN_12 },
-    { PMBUS_HAVE_STATUS_FAN34, PB_STATUS_FAN34_BASE, PMBUS_STATUS_FAN_34 },
+    { PMBUS_HAVE_STATUS_FAN12, PB_STATUS_FAN_BASE, PMBUS_STATUS_FAN_12, PB_STATUS_FANS },
+    { PMBUS_HAVE_STATUS_FAN34, PB_STATUS_FAN34_BASE, PMBUS_STATUS_FAN_34, PB_STATUS_FANS },
 };
 
 void _pmbus_clear_faults(struct i2c_client *client)
@@ -264,57 +316,150 @@ void _pmbus_clear_faults(struct i2c_client *client)
     for (i = 0; i < data->info->pages; i++)
         pmbus_clear_fault_page(client, i);
 }
+
+/*
+ * Read the fault summary of a page as STATUS_WORD bits.  With only
+ * STATUS_BYTE, NONE_OF_THE_ABOVE stands for any of the upper bits.
+ * If it can not be read every status register is read, as before.
+ */
+static int pmbus_read_status_summary(struct i2c_client *client, int page)
+{
+    struct pmbus_data *data = i2c_get_clientdata(client);
+    int status;
+
+    if (data->status_register == PMBUS_STATUS_WORD)
+        return _pmbus_read_word_data(client, page, PMBUS_STATUS_WORD);
+
+    status = _pmbus_read_byte_data(client, page, data->status_register);
+    if (status >= 0 && (status & PB_STATUS_NONE_ABOVE))
+        status |= 0xff00;
+    return status;
+}
+
+/*
+ * Refresh one page: its status, then its sensors, so the page is
+ * selected once for the whole batch.  A status register that can't be
+ * read keeps its last value rather than raising or clearing alarms.
+ * Returns the number of reads that failed.
+ */
+static int pmbus_update_page(struct i2c_client *client, int page)
+{
+    struct pmbus_data *data = i2c_get_clientdata(client);
+    const struct pmbus_driver_info *info = data->info;
+    struct pmbus_sensor *sensor;
+    bool fault;
+    int summary, ret, failed = 0;
+    int j;
+
+    summary = pmbus_read_status_summary(client, page);
+    fault = (summary != 0);
+    if (summary >= 0) {
+        data->status[PB_STATUS_BASE + page] = summary;
+    }
+    else {
+        /* No summary to go by, read every status register */
+        summary = 0xffff;
+        failed++;
+    }
+
+    for (j = 0; j < ARRAY_SIZE(pmbus_status); j++) {
+        struct _pmbus_status *s = &pmbus_status[j];
+
+        if (!(info->func[page] & s->func))
+            continue;
+        ret = (summary & s->summary) ?
+              _pmbus_read_byte_data(client, page, s->reg) : 0;
+        if (ret < 0)
+            failed++;
+        else
+            data->status[s->base + page] = ret;
+    }
+
+    if (page == 0) {
+        if (info->func[0] & PMBUS_HAVE_STATUS_INPUT) {
+            ret = (summary & (PB_STATUS_INPUT | PB_STATUS_VIN_UV)) ?
+                  _pmbus_read_byte_data(client, 0, PMBUS_STATUS_INPUT) : 0;
+            if (ret < 0)
+                failed++;
+            else
+                data->status[PB_STATUS_INPUT_BASE] = ret;
+        }
+
+        if (info->func[0] & PMBUS_HAVE_STATUS_VMON) {
+            ret = _pmbus_read_byte_data(client, 0, PMBUS_VIRT_STATUS_VMON);
+            if (ret < 0)
+                failed++;
+            else
+                data->status[PB_STATUS_VMON_BASE] = ret;
+        }
+    }
+
+    for (sensor = data->sensors; sensor; sensor = sensor->next) {
+        if (sensor->page != page)
+            continue;
+        if (!data->valid || sensor->update) {
+            sensor->data
+                = _pmbus_read_word_data(client,
+                                        sensor->page,
+                                        sensor->reg);
+            if (sensor->data < 0) {
+                fault = true;
+                failed++;
+            }
+        }
+    }
+
+    /* Nothing latched on this page, no need to clear it */
+    if (fault)
+        pmbus_clear_fault_page(client, page);
+
+    return failed;
+}
+
 static struct pmbus_data *pmbus_update_device(struct device *dev)
 {
     struct i2c_client *client = to_i2c_client(dev->parent);
     struct pmbus_data *data = i2c_get_clientdata(client);
     const struct pmbus_driver_info *info = data->info;
-    struct pmbus_sensor *sensor;
 
     mutex_lock(&data->update_lock);
     if (time_after(jiffies, data->last_updated + HZ) || !data->valid) {
-        int i, j;
-
-        for (i = 0; i < info->pages; i++) {
-            data->status[PB_STATUS_BASE + i]
-                = _pmbus_read_byte_data(client, i,
-                                        data->status_register);
-            for (j = 0; j < ARRAY_SIZE(pmbus_status); j++) {
-                struct _pmbus_status *s = &pmbus_status[j];
-
-                if (!(info->func[i] & s->func))
-                    continue;
-                data->status[s->base + i]
-                    = _pmbus_read_byte_data(client, i,
-                                            s->reg);
-            }
-        }
+        int first = (data->currpage < info->pages) ? data->currpage : 0;
+        ktime_t start = accton_trace_psu_start();
+        int i, failed = 0;
 
-        if (info->func[0] & PMBUS_HAVE_STATUS_INPUT)
-            data->status[PB_STATUS_INPUT_BASE]
-                = _pmbus_read_byte_data(client, 0,
-                                        PMBUS_STATUS_INPUT);
-
-        if (info->func[0] & PMBUS_HAVE_STATUS_VMON)
-            data->status[PB_STATUS_VMON_BASE]
-                = _pmbus_read_byte_data(client, 0,
-                                        PMBUS_VIRT_STATUS_VMON);
-
-        for (sensor = data->sensors; sensor; sensor = sensor->next) {
-            if (!data->valid || sensor->update)
-                sensor->data
-                    = _pmbus_read_word_data(client,
-                                            sensor->page,
-                                            sensor->reg);
-        }
-        _pmbus_clear_faults(client);
+        /* Start with the page that is still selected */
+        for (i = 0; i < info->pages; i++)
+            failed += pmbus_update_page(client, (first + i) % info->pages);
         data->last_updated = jiffies;
         data->valid = 1;
+
+        if (accton_trace_started(start))
+            trace_accton_psu_update(&client->dev, BIT(info->pages) - 1,
+                                    accton_trace_duration(start), failed);
     }
     mutex_unlock(&data->update_lock);
     return data;
 }
 
+/* Fans are in units, power in micro- and everything else in milli-units */
+static int pmbus_class_digits(enum pmbus_sensor_classes class)
+{
+    switch (class) {
+    case PSC_FAN:
+        return 0;
+    case PSC_POWER:
+        return 6;
+    default:
+        return 3;
+    }
+}
+
+static long pmbus_class_scale(enum pmbus_sensor_classes class)
+{
+    return pmbus_conv_pow10[pmbus_class_digits(class)];
+}
+
 /*
  * Convert linear sensor values to milli- or micro-units
  * depending on sensor type.
@@ -322,37 +467,18 @@ static struct pmbus_data *pmbus_update_device(struct device *dev)
 static long pmbus_reg2data_linear(struct pmbus_data *data,
                                   struct pmbus_sensor *sensor)
 {
-    s16 exponent;
-    s32 mantissa;
-    long val;
+    u16 reg = sensor->data;
 
     /* LINEAR16 */
     if ( data->linear_16 &&
             sensor->class == PSC_VOLTAGE_OUT) {
-        exponent = data->exponent[sensor->page];
-        mantissa = (u16) sensor->data;
-    } else
-    {   /* LINEAR11 */
-        exponent = ((s16)sensor->data) >> 11;
-        mantissa = ((s16)((sensor->data & 0x7ff) << 5)) >> 5;
+        return pmbus_conv_linear_floor(reg, data->exponent[sensor->page], 1000L);
     }
 
-    val = mantissa;
-
-    /* scale result to milli-units for all sensors except fans */
-    if (sensor->class != PSC_FAN)
-        val = val * 1000L;
-
-    /* scale result to micro-units for power sensors */
-    if (sensor->class == PSC_POWER)
-        val = val * 1000L;
-
-    if (exponent >= 0)
-        val <<= exponent;
-    else
-        val >>= -exponent;
-
-    return val;
+    /* LINEAR11 */
+    return pmbus_conv_linear_floor(pmbus_conv_linear11_mant(reg),
+                                   pmbus_conv_linear11_exp(reg),
+                                   pmbus_class_scale(sensor->class));
 }
 
 /*
@@ -362,40 +488,7 @@ static long pmbus_reg2data_linear(struct pmbus_data *data,
 static long pmbus_reg2data_direct(struct pmbus_data *data,
                                   struct pmbus_sensor *sensor)
 {
-    long val = (s16) sensor->data;
-    long m, b, R;
-
-    m = data->info->m[sensor->class];
-    b = data->info->b[sensor->class];
-    R = data->info->R[sensor->class];
-
-    if (m == 0)
-        return 0;
-
-    /* X = 1/m * (Y * 10^-R - b) */
-    R = -R;
-    /* scale result to milli-units for everything but fans */
-    if (sensor->class != PSC_FAN) {
-        R += 3;
-        b *= 1000;
-    }
-
-    /* scale result to micro-units for power sensors */
-    if (sensor->class == PSC_POWER) {
-        R += 3;
-        b *= 1000;
-    }
-
-    while (R > 0) {
-        val *= 10;
-        R--;
-    }
-    while (R < 0) {
-        val = DIV_ROUND_CLOSEST(val, 10);
-        R++;
-    }
-
-    return (val - b) / m;
+    return pmbus_conv_direct2data(&data->direct[sensor->class], (s16) sensor->data);
 }
 
 /*
@@ -432,41 +525,21 @@ static long pmbus_reg2data(struct pmbus_data *data, struct pmbus_sensor *sensor)
     return val;
 }
 
-#define MAX_MANTISSA	(1023 * 1000)
-#define MIN_MANTISSA	(511 * 1000)
-
 static u16 pmbus_data2reg_linear(struct pmbus_data *data,
                                  struct pmbus_sensor *sensor, long val)
 {
-    s16 exponent = 0, mantissa;
-    bool negative = false;
-
-    /* simple case */
-    if (val == 0)
-        return 0;
-
     if (data->linear_16 &&
             sensor->class == PSC_VOLTAGE_OUT) {
-        /* LINEAR16 does not support negative voltages */
-        if (val < 0)
-            return 0;
-
         /*
          * For a static exponents, we don't have a choice
          * but to adjust the value to it.
          */
-        if (data->exponent[sensor->page] < 0)
-            val <<= -data->exponent[sensor->page];
-        else
-            val >>= data->exponent[sensor->page];
-        val = DIV_ROUND_CLOSEST(val, 1000);
-        return val & 0xffff;
+        return pmbus_conv_data2linear16(val, data->exponent[sensor->page]);
     }
 
-    if (val < 0) {
-        negative = true;
-        val = -val;
-    }
+    /* simple case */
+    if (val == 0)
+        return 0;
 
     /* Power is in uW. Convert to mW before converting. */
     if (sensor->class == PSC_POWER)
@@ -479,64 +552,13 @@ static u16 pmbus_data2reg_linear(struct pmbus_data *data,
     if (sensor->class == PSC_FAN)
         val = val * 1000;
 
-    /* Reduce large mantissa until it fits into 10 bit */
-    while (val >= MAX_MANTISSA && exponent < 15) {
-        exponent++;
-        val >>= 1;
-    }
-    /* Increase small mantissa to improve precision */
-    while (val < MIN_MANTISSA && exponent > -15) {
-        exponent--;
-        val <<= 1;
-    }
-
-    /* Convert mantissa from milli-units to units */
-    mantissa = DIV_ROUND_CLOSEST(val, 1000);
-
-    /* Ensure that resulting number is within range */
-    if (mantissa > 0x3ff)
-        mantissa = 0x3ff;
-
-    /* restore sign */
-    if (negative)
-        mantissa = -mantissa;
-
-    /* Convert to 5 bit exponent, 11 bit mantissa */
-    return (mantissa & 0x7ff) | ((exponent << 11) & 0xf800);
+    return pmbus_conv_data2linear11(val);
 }
 
 static u16 pmbus_data2reg_direct(struct pmbus_data *data,
                                  struct pmbus_sensor *sensor, long val)
 {
-    long m, b, R;
-
-    m = data->info->m[sensor->class];
-    b = data->info->b[sensor->class];
-    R = data->info->R[sensor->class];
-
-    /* Power is in uW. Adjust R and b. */
-    if (sensor->class == PSC_POWER) {
-        R -= 3;
-        b *= 1000;
-    }
-
-    /* Calculate Y = (m * X + b) * 10^R */
-    if (sensor->class != PSC_FAN) {
-        R -= 3;		/* Adjust R and b for data in milli-units */
-        b *= 1000;
-    }
-    val = val * m + b;
-
-    while (R > 0) {
-        val *= 10;
-        R--;
-    }
-    while (R < 0) {
-        val = DIV_ROUND_CLOSEST(val, 10);
-        R++;
-    }
-
-    return val;
+    return pmbus_conv_data2direct(&data->direct[sensor->class], val);
 }
 
 static u16 pmbus_data2reg_vid(struct pmbus_data *data,
@@ -1638,6 +1660,7 @@ static int pmbus_init_common(struct i2c_client *client, struct pmbus_data *data,
      * to use PMBUS_STATUS_WORD instead if that is the case.
      * Bail out if both registers are not supported.
      */
+    data->status_register = PMBUS_STATUS_WORD;
     if(0) { /*Skip this for the i2c access may fail if PSU is not powered.*/
         data->status_register = PMBUS_STATUS_BYTE;
         ret = i2c_smbus_read_byte_data(client, PMBUS_STATUS_BYTE);
@@ -1680,7 +1703,7 @@ int _pmbus_do_probe(struct i2c_client *client, const struct i2c_device_id *id,
 {
     struct device *dev = &client->dev;
     struct pmbus_data *data;
-    int ret;
+    int ret, i;
 
     if (!info)
         return -ENODEV;
@@ -1697,6 +1720,7 @@ int _pmbus_do_probe(struct i2c_client *client, const struct i2c_device_id *id,
     i2c_set_clientdata(client, data);
     mutex_init(&data->update_lock);
     data->dev = dev;
+    data->currpage = PMBUS_PAGE_UNKNOWN;
 
     if (limited_models(id))
     {
@@ -1714,6 +1738,9 @@ int _pmbus_do_probe(struct i2c_client *client, const struct i2c_device_id *id,
     }
 
     data->info = info;
+    for (i = 0; i < PSC_NUM_CLASSES; i++)
+        pmbus_conv_direct_init(&data->direct[i], info->m[i], info->b[i],
+                               info->R[i], pmbus_class_digits(i));
 
     ret = pmbus_init_common(client, data, info);
     if (ret < 0)
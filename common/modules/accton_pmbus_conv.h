@@ -0,0 +1,222 @@
+/*
+ * PMBus LINEAR11, LINEAR16 and DIRECT conversions for accton PSU drivers
+ *
+ * Copyright (C) 2018 Accton Technology Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+/*
+ * Rounding, which is what each driver returned before these were
+ * shared, bit for bit:
+ *
+ *   pmbus_conv_linear_trunc()	toward zero (the PSU core's sysfs values)
+ *   pmbus_conv_linear_floor()	toward minus infinity (the hwmon PMBus core)
+ *   pmbus_conv_direct2data()	10^-R one digit at a time, each to the
+ *								closest, then the 1/m toward zero
+ *   pmbus_conv_data2*()		to the closest
+ *
+ * No divisions but for DIRECT's m and 10^-R: exponents are sign
+ * extended with shifts and powers of two are shifts as well.
+ */
+
+#ifndef __ACCTON_PMBUS_CONV_H__
+#define __ACCTON_PMBUS_CONV_H__
+
+#include <linux/types.h>
+#include <linux/kernel.h>
+#include <linux/bitops.h>
+
+#define PMBUS_CONV_MAX_MANTISSA		(1023 * 1000)
+#define PMBUS_CONV_MIN_MANTISSA		(511 * 1000)
+#define PMBUS_CONV_MAX_EXPONENT		15
+
+/* Two's complement value of the low 'bits' of 'value' */
+static inline int pmbus_conv_sext(unsigned int value, int bits)
+{
+	return (int)(value << (32 - bits)) >> (32 - bits);
+}
+
+/* LINEAR11: 5 bit exponent, 11 bit mantissa */
+static inline int pmbus_conv_linear11_exp(u16 reg)
+{
+	return pmbus_conv_sext(reg >> 11, 5);
+}
+
+static inline int pmbus_conv_linear11_mant(u16 reg)
+{
+	return pmbus_conv_sext(reg & 0x7ff, 11);
+}
+
+/* LINEAR16: the exponent is in the low 5 bits of VOUT_MODE */
+static inline int pmbus_conv_vout_exp(u8 vout_mode)
+{
+	return pmbus_conv_sext(vout_mode & 0x1f, 5);
+}
+
+/* mantissa * 2^exponent * scale, rounded toward zero */
+static inline int pmbus_conv_linear_trunc(int mantissa, int exponent, int scale)
+{
+	int val;
+
+	if (exponent >= 0) {
+		return (mantissa << exponent) * scale;
+	}
+
+	val = mantissa * scale;
+	return (val >= 0) ? (val >> -exponent) : -((-val) >> -exponent);
+}
+
+/* mantissa * scale * 2^exponent, rounded toward minus infinity */
+static inline long pmbus_conv_linear_floor(long mantissa, int exponent, long scale)
+{
+	long val = mantissa * scale;
+
+	return (exponent >= 0) ? (val << exponent) : (val >> -exponent);
+}
+
+/*
+ * A value in milli-units as LINEAR11.  The mantissa is made as large as
+ * it fits for the best precision, so 0 comes out with exponent -15:
+ * check for it first to get 0x0000.
+ */
+static inline u16 pmbus_conv_data2linear11(long val)
+{
+	bool negative = false;
+	int exponent = 0, shift;
+	s16 mantissa;
+
+	if (val < 0) {
+		negative = true;
+		val = -val;
+	}
+
+	if (val >= PMBUS_CONV_MAX_MANTISSA) {
+		/* fls(MAX_MANTISSA) == 20, one more shift at most after that */
+		shift = max(fls_long(val) - 20, 0);
+		if ((val >> shift) >= PMBUS_CONV_MAX_MANTISSA) {
+			shift++;
+		}
+		exponent = min(shift, PMBUS_CONV_MAX_EXPONENT);
+		val >>= exponent;
+	}
+	else if (val < PMBUS_CONV_MIN_MANTISSA) {
+		/* fls(MIN_MANTISSA) == 19 */
+		shift = 19 - fls_long(val);
+		if ((val << shift) < PMBUS_CONV_MIN_MANTISSA) {
+			shift++;
+		}
+		shift = min(shift, PMBUS_CONV_MAX_EXPONENT);
+		exponent = -shift;
+		val <<= shift;
+	}
+
+	mantissa = DIV_ROUND_CLOSEST(val, 1000);
+	if (mantissa > 0x3ff) {
+		mantissa = 0x3ff;
+	}
+	if (negative) {
+		mantissa = -mantissa;
+	}
+
+	return (mantissa & 0x7ff) | ((exponent << 11) & 0xf800);
+}
+
+/* A value in milli-units as LINEAR16 with the given VOUT_MODE exponent */
+static inline u16 pmbus_conv_data2linear16(long val, int exponent)
+{
+	/* LINEAR16 does not support negative voltages */
+	if (val <= 0) {
+		return 0;
+	}
+
+	if (exponent < 0) {
+		val <<= -exponent;
+	}
+	else {
+		val >>= exponent;
+	}
+
+	return DIV_ROUND_CLOSEST(val, 1000) & 0xffff;
+}
+
+/*
+ * DIRECT coefficients of one sensor class, prepared once: X = (Y * 10^R - b) / m
+ * with b and R already adjusted to the unit of X.
+ */
+struct pmbus_conv_direct {
+	long	m;
+	long	b;
+	int		R;
+};
+
+static const long pmbus_conv_pow10[] = {
+	1L, 10L, 100L, 1000L, 10000L, 100000L, 1000000L, 10000000L,
+	100000000L, 1000000000L
+};
+
+/*
+ * m, b, R as the PSU specifies them.  digits is the unit of the value:
+ * 0 for units, 3 for milli- and 6 for micro-units.
+ */
+static inline void pmbus_conv_direct_init(struct pmbus_conv_direct *c, int m, int b,
+										  int R, int digits)
+{
+	int i;
+
+	c->m = m;
+	c->b = b;
+	for (i = 0; i < digits; i += 3) {
+		c->b *= 1000;
+	}
+	c->R = -R + digits;
+}
+
+static inline long pmbus_conv_scale10(long val, int R)
+{
+	if (R > 0) {
+		if (R < ARRAY_SIZE(pmbus_conv_pow10)) {
+			return val * pmbus_conv_pow10[R];
+		}
+		while (R > 0) {
+			val *= 10;
+			R--;
+		}
+	}
+
+	/* Rounded digit by digit: that is what the values always were */
+	while (R < 0) {
+		val = DIV_ROUND_CLOSEST(val, 10);
+		R++;
+	}
+
+	return val;
+}
+
+static inline long pmbus_conv_direct2data(const struct pmbus_conv_direct *c, s16 reg)
+{
+	if (c->m == 0) {
+		return 0;
+	}
+
+	return (pmbus_conv_scale10(reg, c->R) - c->b) / c->m;
+}
+
+static inline u16 pmbus_conv_data2direct(const struct pmbus_conv_direct *c, long val)
+{
+	return pmbus_conv_scale10(val * c->m + c->b, -c->R);
+}
+
+#endif /* __ACCTON_PMBUS_CONV_H__ */
@@ -0,0 +1,657 @@
+/*
+ * Common PMBus power supply driver core for accton platforms
+ *
+ * Copyright (C)  Brandon Chuang <brandon_chuang@accton.com.tw>
+ *
+ * Based on ad7414.c
+ * Copyright 2006 Stefan Roese <sr at denx.de>, DENX Software Engineering
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+/*
+ * The PSU drivers (ym2651y, cpr_4011_4mxx and their per-platform
+ * variants) only carry a struct pmbus_psu_model: the PMBus commands they
+ * read, how each sysfs value is derived from them and their attribute
+ * group.  Register access with retries and PEC, the static/live cache
+ * and value conversion are implemented once here.
+ */
+
+#include <linux/module.h>
+#include <linux/jiffies.h>
+#include <linux/i2c.h>
+#include <linux/hwmon.h>
+#include <linux/hwmon-sysfs.h>
+#include <linux/err.h>
+#include <linux/mutex.h>
+#include <linux/sysfs.h>
+#include <linux/slab.h>
+#include <linux/delay.h>
+#include "accton_pmbus_psu.h"
+#include "accton_i2c_stats.h"
+#include "accton_telemetry.h"
+#include "accton_trace.h"
+
+#define PMBUS_PSU_UPDATE_INTERVAL	(HZ + HZ / 2)
+#define PMBUS_PSU_MAX_UPDATE_INTERVAL	60000	/* ms */
+
+enum pmbus_psu_cache_attributes {
+	PMBUS_PSU_LAST_UPDATE_MS,
+	PMBUS_PSU_UPDATE_INTERVAL_MS,
+	PMBUS_PSU_VALID
+};
+
+/* Each client has this additional data
+ */
+struct pmbus_psu_data {
+	struct device					*hwmon_dev;
+	struct mutex					update_lock;
+	const struct pmbus_psu_model	*model;
+	unsigned long					static_regs;	/* Bitmap of the model's static regs */
+	unsigned long					live_regs;		/* Bitmap of the others */
+	char							answering;		/* !=0 if the last live read succeeded */
+	char							static_valid;	/* !=0 if the static regs are valid */
+	unsigned long					valid;			/* Bitmap of regs read at least once */
+	unsigned long					failed;			/* Bitmap of regs whose last read failed */
+	unsigned long					updated[PMBUS_PSU_MAX_REGS];	/* In jiffies */
+	unsigned long					last_updated;	/* Last live read, in jiffies */
+	unsigned long					update_interval;	/* In jiffies */
+	u16								word[PMBUS_PSU_MAX_REGS];		/* Byte and word regs */
+	u8								block[PMBUS_PSU_MAX_REGS][PMBUS_PSU_BLOCK_MAX + 1];
+	struct i2c_stats				*stats;
+	struct accton_tlm				*tlm;
+};
+
+static int pmbus_psu_read_block(struct i2c_client *client, struct i2c_stats *st,
+								u8 command, u8 *data, int data_len)
+{
+	int result = i2c_stats_read_i2c_block_data(st, client, command, data_len, data);
+
+	if (unlikely(result < 0))
+		goto abort;
+	if (unlikely(result != data_len)) {
+		result = -EIO;
+		goto abort;
+	}
+
+abort:
+	return result;
+}
+
+/* Returns the byte/word value, or the number of bytes read into 'block' */
+static int pmbus_psu_read_reg(struct i2c_client *client, struct pmbus_psu_data *data,
+							  const struct pmbus_psu_reg *r, u8 *block)
+{
+	const struct pmbus_psu_model *model = data->model;
+	int status, retry;
+	u8 count;
+
+	for (retry = 0; ; retry++) {
+		switch (r->type) {
+		case PMBUS_PSU_BYTE:
+			status = i2c_stats_read_byte_data(data->stats, client, r->cmd);
+			break;
+		case PMBUS_PSU_WORD:
+			status = i2c_stats_read_word_data(data->stats, client, r->cmd);
+			break;
+		case PMBUS_PSU_BLOCK:
+			status = pmbus_psu_read_block(client, data->stats, r->cmd, block, r->len);
+			break;
+		case PMBUS_PSU_BLOCK_COUNTED:
+			/* Read first byte to determine the length of data */
+			status = pmbus_psu_read_block(client, data->stats, r->cmd, &count, 1);
+			if (status >= 0) {
+				status = pmbus_psu_read_block(client, data->stats, r->cmd, block,
+											  min_t(int, count + 1, r->len));
+			}
+			break;
+		default:
+			return -EINVAL;
+		}
+
+		if (status >= 0 || retry >= model->retry_count) {
+			break;
+		}
+
+		msleep(model->retry_interval);
+		i2c_stats_retry(data->stats);
+	}
+
+	return status;
+}
+
+static bool pmbus_psu_gated(const struct pmbus_psu_model *model, int i)
+{
+	const struct pmbus_psu_reg *r = &model->regs[i];
+
+	return model->gate_reg >= 0 && i != model->gate_reg &&
+		   r->type == PMBUS_PSU_WORD && !r->is_static;
+}
+
+/* Caller holds update_lock */
+static int pmbus_psu_read_one(struct i2c_client *client, struct pmbus_psu_data *data, int i)
+{
+	const struct pmbus_psu_model *model = data->model;
+	const struct pmbus_psu_reg *r = &model->regs[i];
+	u8 block[PMBUS_PSU_BLOCK_MAX + 1] = {0};
+	int status;
+
+	status = pmbus_psu_read_reg(client, data, r, block);
+
+	data->updated[i] = jiffies;
+	set_bit(i, &data->valid);
+	if (!r->is_static) {
+		data->last_updated = jiffies;
+	}
+
+	if (status < 0) {
+		dev_dbg(&client->dev, "reg %d, err %d\n", r->cmd, status);
+		set_bit(i, &data->failed);
+
+		/* A PSU that stops answering may be swapped */
+		if (!r->is_static) {
+			data->answering = 0;
+			data->static_valid = 0;
+		}
+
+		if (model->on_error == PMBUS_PSU_ERR_ZERO) {
+			data->word[i] = 0;
+			data->block[i][0] = '\0';
+		}
+
+		return status;
+	}
+
+	clear_bit(i, &data->failed);
+
+	if (r->type == PMBUS_PSU_BLOCK || r->type == PMBUS_PSU_BLOCK_COUNTED) {
+		memcpy(data->block[i], block, status);
+		data->block[i][status] = '\0';
+		return 0;
+	}
+
+	if (i == model->status_reg) {
+		/* Back to power good after a failure, it may be another unit */
+		if ((data->word[i] & model->power_good_fail) &&
+			!(status & model->power_good_fail)) {
+			data->static_valid = 0;
+		}
+	}
+
+	/* Eliminates false values while the gate reading is 0 */
+	if (pmbus_psu_gated(model, i) && data->word[model->gate_reg] == 0) {
+		status = 0;
+	}
+
+	if (!r->is_static) {
+		data->answering = 1;
+	}
+
+	data->word[i] = status;
+	return 0;
+}
+
+/* Caller holds update_lock */
+static void pmbus_psu_refresh(struct i2c_client *client, struct pmbus_psu_data *data,
+							  int i, bool force)
+{
+	if (!force && test_bit(i, &data->valid) &&
+		time_before(jiffies, data->updated[i] + data->update_interval)) {
+		i2c_stats_cache(data->stats, true);
+		return;
+	}
+
+	i2c_stats_cache(data->stats, false);
+	pmbus_psu_read_one(client, data, i);
+}
+
+/* Caller holds update_lock.  Refreshes the live registers in 'regs' whose
+ * copy is stale, or all of them with 'force', then the static ones if
+ * any is asked for and they are not valid.
+ */
+static void pmbus_psu_update_regs(struct i2c_client *client, struct pmbus_psu_data *data,
+								  unsigned long regs, bool force)
+{
+	const struct pmbus_psu_model *model = data->model;
+	ktime_t start = accton_trace_psu_start();
+	unsigned long live, asked = regs;
+	int i;
+
+	/* Static registers are only read from a PSU that answers */
+	if ((regs & data->static_regs) && !data->static_valid && model->status_reg >= 0) {
+		regs |= BIT(model->status_reg);
+	}
+
+	live = regs & data->live_regs;
+
+	/* The gate goes first, the others are filtered by it */
+	if (model->gate_reg >= 0 && (live & BIT(model->gate_reg))) {
+		pmbus_psu_refresh(client, data, model->gate_reg, force);
+		live &= ~BIT(model->gate_reg);
+	}
+
+	for (i = 0; i < model->num_regs; i++) {
+		if (live & BIT(i)) {
+			pmbus_psu_refresh(client, data, i, force);
+		}
+	}
+
+	if ((regs & data->static_regs) && !data->static_valid &&
+		(data->answering || model->status_reg < 0)) {
+		dev_dbg(&client->dev, "Reading %s identity\n", model->name);
+		data->static_valid = 1;
+
+		for (i = 0; i < model->num_regs; i++) {
+			if (!(data->static_regs & BIT(i))) {
+				continue;
+			}
+
+			if (pmbus_psu_read_one(client, data, i) < 0) {
+				data->static_valid = 0;
+			}
+		}
+	}
+
+	if (accton_trace_started(start)) {
+		trace_accton_psu_update(&client->dev, asked, accton_trace_duration(start),
+								hweight_long(data->failed & asked));
+	}
+}
+
+static unsigned long pmbus_psu_value_regs(const struct pmbus_psu_model *model,
+										  const struct pmbus_psu_value *v)
+{
+	unsigned long regs = BIT(v->reg);
+
+	if (v->fmt == PMBUS_PSU_LINEAR16) {
+		regs |= BIT(v->arg);
+	}
+
+	if (pmbus_psu_gated(model, v->reg)) {
+		regs |= BIT(model->gate_reg);
+	}
+
+	return regs;
+}
+
+/* Caller holds update_lock.  The number a value shows, -ENODATA if
+ * it shows nothing or a string.
+ */
+static int pmbus_psu_number(struct pmbus_psu_data *data, const struct pmbus_psu_value *v,
+							long *val)
+{
+	const struct pmbus_psu_model *model = data->model;
+	unsigned long regs = pmbus_psu_value_regs(model, v);
+	u16 value = data->word[v->reg];
+
+	if (model->on_error == PMBUS_PSU_ERR_EMPTY &&
+		((data->failed & regs) || (regs & ~data->valid))) {
+		return -ENODATA;
+	}
+
+	switch (v->fmt) {
+	case PMBUS_PSU_RAW:
+		*val = value;
+		return 0;
+	case PMBUS_PSU_LINEAR11:
+		*val = pmbus_psu_linear11(value, v->scale);
+		return 0;
+	case PMBUS_PSU_LINEAR16:
+		*val = pmbus_psu_linear16(value, data->word[v->arg], v->scale);
+		return 0;
+	case PMBUS_PSU_BIT:
+		*val = (value >> v->arg) & 0x1;
+		return 0;
+	case PMBUS_PSU_BIT_LOW:
+		*val = !((value >> v->arg) & 0x1);
+		return 0;
+	default:
+		break;
+	}
+
+	return -ENODATA;
+}
+
+/* Caller holds update_lock */
+static ssize_t pmbus_psu_format(struct pmbus_psu_data *data, const struct pmbus_psu_value *v,
+								char *buf)
+{
+	const struct pmbus_psu_model *model = data->model;
+	unsigned long regs = pmbus_psu_value_regs(model, v);
+	long val;
+
+	if (v->fmt == PMBUS_PSU_STRING) {
+		if (model->on_error == PMBUS_PSU_ERR_EMPTY &&
+			((data->failed & regs) || (regs & ~data->valid))) {
+			return 0;
+		}
+		return sprintf(buf, "%s\n", data->block[v->reg] + v->arg);
+	}
+
+	if (pmbus_psu_number(data, v, &val) < 0) {
+		return 0;
+	}
+
+	return sprintf(buf, "%ld\n", val);
+}
+
+/* Caller holds update_lock.  Every live value of the group, named as
+ * its attribute, to the telemetry module.
+ */
+static void pmbus_psu_publish(struct pmbus_psu_data *data)
+{
+	const struct pmbus_psu_model *model = data->model;
+	struct accton_tlm_value tv[ACCTON_TLM_MAX_VALUES];
+	struct attribute **attrs;
+	int n = 0;
+	long val;
+
+	if (!data->tlm) {
+		return;
+	}
+
+	for (attrs = model->group->attrs; *attrs && n < ARRAY_SIZE(tv); attrs++) {
+		struct device_attribute *dattr = container_of(*attrs, struct device_attribute, attr);
+		const struct pmbus_psu_value *v;
+
+		if (dattr->show != pmbus_psu_show) {
+			continue;
+		}
+
+		v = &model->values[to_sensor_dev_attr(dattr)->index];
+		if (pmbus_psu_value_regs(model, v) & data->static_regs) {
+			continue;
+		}
+
+		if (pmbus_psu_number(data, v, &val) == 0) {
+			tv[n].name = (*attrs)->name;
+			tv[n].index = 0;
+			tv[n++].data = val;
+		}
+	}
+
+	accton_tlm_publish(data->tlm, tv, n, NULL, 0);
+}
+
+ssize_t pmbus_psu_show(struct device *dev, struct device_attribute *da, char *buf)
+{
+	struct sensor_device_attribute *attr = to_sensor_dev_attr(da);
+	struct i2c_client *client = to_i2c_client(dev);
+	struct pmbus_psu_data *data = i2c_get_clientdata(client);
+	const struct pmbus_psu_value *v = &data->model->values[attr->index];
+	ssize_t len;
+
+	mutex_lock(&data->update_lock);
+	pmbus_psu_update_regs(client, data, pmbus_psu_value_regs(data->model, v), false);
+	pmbus_psu_publish(data);
+	len = pmbus_psu_format(data, v, buf);
+	mutex_unlock(&data->update_lock);
+
+	return len;
+}
+EXPORT_SYMBOL(pmbus_psu_show);
+
+ssize_t pmbus_psu_store(struct device *dev, struct device_attribute *da,
+						const char *buf, size_t count)
+{
+	struct sensor_device_attribute *attr = to_sensor_dev_attr(da);
+	struct i2c_client *client = to_i2c_client(dev);
+	struct pmbus_psu_data *data = i2c_get_clientdata(client);
+	const struct pmbus_psu_value *v = &data->model->values[attr->index];
+	long value;
+	int status;
+
+	if (!v->max) {
+		return -EPERM;
+	}
+
+	status = kstrtol(buf, 10, &value);
+	if (status) {
+		return status;
+	}
+
+	if (value < 0 || value > v->max) {
+		return -EINVAL;
+	}
+
+	mutex_lock(&data->update_lock);
+	status = i2c_stats_write_word_data(data->stats, client, data->model->regs[v->reg].cmd, value);
+	if (status >= 0) {
+		data->word[v->reg] = value;
+	}
+	mutex_unlock(&data->update_lock);
+
+	return (status < 0) ? status : count;
+}
+EXPORT_SYMBOL(pmbus_psu_store);
+
+/* Every live attribute of the group read in one locked pass, for readers
+ * that need the values to belong together
+ */
+ssize_t pmbus_psu_show_snapshot(struct device *dev, struct device_attribute *da,
+								char *buf)
+{
+	struct i2c_client *client = to_i2c_client(dev);
+	struct pmbus_psu_data *data = i2c_get_clientdata(client);
+	const struct pmbus_psu_model *model = data->model;
+	struct attribute **attrs;
+	char value[32];
+	ssize_t len = 0;
+
+	mutex_lock(&data->update_lock);
+	pmbus_psu_update_regs(client, data, data->live_regs, true);
+	pmbus_psu_publish(data);
+
+	for (attrs = model->group->attrs; *attrs; attrs++) {
+		struct device_attribute *dattr = container_of(*attrs, struct device_attribute, attr);
+		const struct pmbus_psu_value *v;
+
+		if (dattr->show != pmbus_psu_show) {
+			continue;
+		}
+
+		v = &model->values[to_sensor_dev_attr(dattr)->index];
+		if (pmbus_psu_value_regs(model, v) & data->static_regs) {
+			continue;
+		}
+
+		if (pmbus_psu_format(data, v, value) > 0) {
+			len += scnprintf(buf + len, PAGE_SIZE - len, "%s %s", (*attrs)->name, value);
+		}
+	}
+	mutex_unlock(&data->update_lock);
+
+	return len;
+}
+EXPORT_SYMBOL(pmbus_psu_show_snapshot);
+
+/* Age and interval of the live register cache, and whether the last
+ * read of each live register got through.  The age is -1 while valid
+ * reads 0.  Reading them never touches the PSU.  Created by the core
+ * for every model.
+ */
+static ssize_t pmbus_psu_cache_show(struct device *dev, struct device_attribute *da,
+									char *buf)
+{
+	struct sensor_device_attribute *attr = to_sensor_dev_attr(da);
+	struct pmbus_psu_data *data = i2c_get_clientdata(to_i2c_client(dev));
+	ssize_t ret = 0;
+
+	mutex_lock(&data->update_lock);
+	switch (attr->index) {
+	case PMBUS_PSU_LAST_UPDATE_MS:
+		if (!data->answering || (data->failed & data->live_regs)) {
+			ret = sprintf(buf, "-1\n");
+			break;
+		}
+		ret = sprintf(buf, "%u\n", jiffies_to_msecs(jiffies - data->last_updated));
+		break;
+	case PMBUS_PSU_UPDATE_INTERVAL_MS:
+		ret = sprintf(buf, "%u\n", jiffies_to_msecs(data->update_interval));
+		break;
+	case PMBUS_PSU_VALID:
+		ret = sprintf(buf, "%d\n", data->answering && !(data->failed & data->live_regs));
+		break;
+	default:
+		break;
+	}
+	mutex_unlock(&data->update_lock);
+
+	return ret;
+}
+
+static ssize_t pmbus_psu_cache_store(struct device *dev, struct device_attribute *da,
+									 const char *buf, size_t count)
+{
+	struct pmbus_psu_data *data = i2c_get_clientdata(to_i2c_client(dev));
+	unsigned int value;
+	int status;
+
+	status = kstrtouint(buf, 10, &value);
+	if (status) {
+		return status;
+	}
+
+	if (value > PMBUS_PSU_MAX_UPDATE_INTERVAL) {
+		return -EINVAL;
+	}
+
+	mutex_lock(&data->update_lock);
+	data->update_interval = msecs_to_jiffies(value);
+	mutex_unlock(&data->update_lock);
+
+	return count;
+}
+
+static SENSOR_DEVICE_ATTR(last_update_ms, S_IRUGO, pmbus_psu_cache_show, NULL, PMBUS_PSU_LAST_UPDATE_MS);
+static SENSOR_DEVICE_ATTR(update_interval_ms, S_IWUSR | S_IRUGO, pmbus_psu_cache_show,
+						  pmbus_psu_cache_store, PMBUS_PSU_UPDATE_INTERVAL_MS);
+static SENSOR_DEVICE_ATTR(valid, S_IRUGO, pmbus_psu_cache_show, NULL, PMBUS_PSU_VALID);
+
+static struct attribute *pmbus_psu_cache_attributes[] = {
+	&sensor_dev_attr_last_update_ms.dev_attr.attr,
+	&sensor_dev_attr_update_interval_ms.dev_attr.attr,
+	&sensor_dev_attr_valid.dev_attr.attr,
+	NULL
+};
+
+static const struct attribute_group pmbus_psu_cache_group = {
+	.attrs = pmbus_psu_cache_attributes,
+};
+
+int pmbus_psu_probe(struct i2c_client *client, const struct pmbus_psu_model *model)
+{
+	struct pmbus_psu_data *data;
+	u32 funcs = I2C_FUNC_SMBUS_BYTE_DATA | I2C_FUNC_SMBUS_WORD_DATA;
+	int i, status;
+
+	if (model->num_regs > PMBUS_PSU_MAX_REGS) {
+		return -EINVAL;
+	}
+
+	for (i = 0; i < model->num_regs; i++) {
+		if (model->regs[i].type == PMBUS_PSU_BLOCK ||
+			model->regs[i].type == PMBUS_PSU_BLOCK_COUNTED) {
+			funcs |= I2C_FUNC_SMBUS_I2C_BLOCK;
+		}
+	}
+
+	if (!i2c_check_functionality(client->adapter, funcs)) {
+		status = -EIO;
+		goto exit;
+	}
+
+	data = kzalloc(sizeof(struct pmbus_psu_data), GFP_KERNEL);
+	if (!data) {
+		status = -ENOMEM;
+		goto exit;
+	}
+
+	data->model = model;
+	data->update_interval = PMBUS_PSU_UPDATE_INTERVAL;
+	for (i = 0; i < model->num_regs; i++) {
+		if (model->regs[i].is_static) {
+			data->static_regs |= BIT(i);
+		}
+		else {
+			data->live_regs |= BIT(i);
+		}
+	}
+
+	if (model->pec && i2c_check_functionality(client->adapter, I2C_FUNC_SMBUS_PEC)) {
+		client->flags |= I2C_CLIENT_PEC;
+	}
+
+	data->stats = i2c_stats_register(&client->dev);
+	data->tlm = accton_tlm_register(&client->dev, ACCTON_TLM_KIND_PSU);
+	i2c_set_clientdata(client, data);
+	mutex_init(&data->update_lock);
+
+	dev_info(&client->dev, "chip found\n");
+
+	/* Register sysfs hooks */
+	status = sysfs_create_group(&client->dev.kobj, model->group);
+	if (status) {
+		goto exit_free;
+	}
+
+	status = sysfs_create_group(&client->dev.kobj, &pmbus_psu_cache_group);
+	if (status) {
+		goto exit_remove;
+	}
+
+	data->hwmon_dev = hwmon_device_register(&client->dev);
+	if (IS_ERR(data->hwmon_dev)) {
+		status = PTR_ERR(data->hwmon_dev);
+		goto exit_remove_cache;
+	}
+
+	dev_info(&client->dev, "%s: psu '%s'\n",
+			 dev_name(data->hwmon_dev), client->name);
+
+	return 0;
+
+exit_remove_cache:
+	sysfs_remove_group(&client->dev.kobj, &pmbus_psu_cache_group);
+exit_remove:
+	sysfs_remove_group(&client->dev.kobj, model->group);
+exit_free:
+	accton_tlm_unregister(data->tlm);
+	i2c_stats_unregister(data->stats);
+	kfree(data);
+exit:
+
+	return status;
+}
+EXPORT_SYMBOL(pmbus_psu_probe);
+
+int pmbus_psu_remove(struct i2c_client *client)
+{
+	struct pmbus_psu_data *data = i2c_get_clientdata(client);
+
+	hwmon_device_unregister(data->hwmon_dev);
+	sysfs_remove_group(&client->dev.kobj, &pmbus_psu_cache_group);
+	sysfs_remove_group(&client->dev.kobj, data->model->group);
+	accton_tlm_unregister(data->tlm);
+	i2c_stats_unregister(data->stats);
+	kfree(data);
+
+	return 0;
+}
+EXPORT_SYMBOL(pmbus_psu_remove);
+
+MODULE_AUTHOR("Brandon Chuang <brandon_chuang@accton.com.tw>");
+MODULE_DESCRIPTION("accton PMBus psu driver core");
+MODULE_LICENSE("GPL");
@@ -0,0 +1,136 @@
+/*
+ * Common PMBus power supply driver core for accton platforms
+ *
+ * Copyright (C)  Brandon Chuang <brandon_chuang@accton.com.tw>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#ifndef __ACCTON_PMBUS_PSU_H__
+#define __ACCTON_PMBUS_PSU_H__
+
+#include <linux/types.h>
+#include <linux/i2c.h>
+#include <linux/device.h>
+#include <linux/sysfs.h>
+#include "accton_pmbus_conv.h"
+
+#define PMBUS_PSU_MAX_REGS		32	/* register bitmaps are unsigned long */
+#define PMBUS_PSU_BLOCK_MAX		32
+
+/* How a register is read */
+enum pmbus_psu_reg_type {
+	PMBUS_PSU_BYTE,
+	PMBUS_PSU_WORD,
+	PMBUS_PSU_BLOCK,		/* I2C block read of 'len' bytes */
+	PMBUS_PSU_BLOCK_COUNTED	/* count byte first, then count + 1 bytes up to 'len' */
+};
+
+/*
+ * One PMBus command of a model.  Static registers (identity, ratings)
+ * are read once a PSU answers and kept until it stops answering or
+ * comes back to power good; live ones are refreshed per register when
+ * a reader needs them and their copy is older than the update interval.
+ */
+struct pmbus_psu_reg {
+	u8		cmd;
+	u8		type;
+	u8		len;
+	bool	is_static;
+};
+
+/* How a sysfs value is derived from its register */
+enum pmbus_psu_fmt {
+	PMBUS_PSU_RAW,			/* register value */
+	PMBUS_PSU_LINEAR11,		/* LINEAR11 times 'scale' */
+	PMBUS_PSU_LINEAR16,		/* mantissa here, exponent in VOUT_MODE register 'arg' */
+	PMBUS_PSU_BIT,			/* bit 'arg' of the register */
+	PMBUS_PSU_BIT_LOW,		/* 1 while bit 'arg' is clear */
+	PMBUS_PSU_STRING		/* block as text, from byte 'arg' on */
+};
+
+struct pmbus_psu_value {
+	u8		reg;		/* index in the model's regs[] */
+	u8		fmt;
+	u8		arg;
+	int		scale;
+	int		max;		/* writable values: largest input accepted */
+};
+
+/* What a value shows while a register it needs can not be read */
+enum pmbus_psu_on_error {
+	PMBUS_PSU_ERR_ZERO,		/* the register reads as 0 */
+	PMBUS_PSU_ERR_KEEP,		/* the last good value */
+	PMBUS_PSU_ERR_EMPTY		/* nothing */
+};
+
+struct pmbus_psu_model {
+	const char						*name;
+	const struct pmbus_psu_reg		*regs;
+	int								num_regs;
+	const struct pmbus_psu_value	*values;	/* by sensor attribute index */
+	int								num_values;
+	const struct attribute_group	*group;
+
+	int		status_reg;			/* STATUS_WORD in regs[], <0 if not read */
+	u16		power_good_fail;	/* STATUS_WORD bits set while power is not good */
+	int		gate_reg;			/* while this word reads 0 so do the others, <0 if unused */
+	u8		on_error;
+	bool	pec;				/* use PEC if the adapter can */
+	int		retry_count;		/* extra attempts per read */
+	int		retry_interval;		/* ms */
+};
+
+/* Table helpers for the model drivers */
+#define PMBUS_PSU_REG(_cmd, _type, _len, _static) \
+	{ .cmd = (_cmd), .type = (_type), .len = (_len), .is_static = (_static) }
+#define PMBUS_PSU_BYTE_REG(_cmd, _static)	PMBUS_PSU_REG(_cmd, PMBUS_PSU_BYTE, 1, _static)
+#define PMBUS_PSU_WORD_REG(_cmd, _static)	PMBUS_PSU_REG(_cmd, PMBUS_PSU_WORD, 2, _static)
+#define PMBUS_PSU_BLOCK_REG(_cmd, _len)		PMBUS_PSU_REG(_cmd, PMBUS_PSU_BLOCK, _len, true)
+#define PMBUS_PSU_COUNTED_REG(_cmd, _len)	PMBUS_PSU_REG(_cmd, PMBUS_PSU_BLOCK_COUNTED, _len, true)
+
+#define PMBUS_PSU_VALUE(_reg, _fmt, _arg, _scale) \
+	{ .reg = (_reg), .fmt = (_fmt), .arg = (_arg), .scale = (_scale) }
+#define PMBUS_PSU_LINEAR(_reg, _scale)		PMBUS_PSU_VALUE(_reg, PMBUS_PSU_LINEAR11, 0, _scale)
+#define PMBUS_PSU_VOUT(_reg, _mode_reg)		PMBUS_PSU_VALUE(_reg, PMBUS_PSU_LINEAR16, _mode_reg, 1000)
+#define PMBUS_PSU_FLAG(_reg, _bit)			PMBUS_PSU_VALUE(_reg, PMBUS_PSU_BIT, _bit, 1)
+#define PMBUS_PSU_FLAG_LOW(_reg, _bit)		PMBUS_PSU_VALUE(_reg, PMBUS_PSU_BIT_LOW, _bit, 1)
+#define PMBUS_PSU_STR(_reg, _skip)			PMBUS_PSU_VALUE(_reg, PMBUS_PSU_STRING, _skip, 1)
+#define PMBUS_PSU_DUTY(_reg, _max) \
+	{ .reg = (_reg), .fmt = PMBUS_PSU_LINEAR11, .scale = 1, .max = (_max) }
+
+/* PMBus LINEAR11: 5 bit exponent, 11 bit mantissa, both two's complement */
+static inline int pmbus_psu_linear11(u16 value, int scale)
+{
+	return pmbus_conv_linear_trunc(pmbus_conv_linear11_mant(value),
+								   pmbus_conv_linear11_exp(value), scale);
+}
+
+/* PMBus LINEAR16: unsigned mantissa, exponent in the low 5 bits of VOUT_MODE */
+static inline int pmbus_psu_linear16(u16 value, u8 vout_mode, int scale)
+{
+	return pmbus_conv_linear_trunc(value, pmbus_conv_vout_exp(vout_mode), scale);
+}
+
+ssize_t pmbus_psu_show(struct device *dev, struct device_attribute *da, char *buf);
+ssize_t pmbus_psu_store(struct device *dev, struct device_attribute *da,
+						const char *buf, size_t count);
+ssize_t pmbus_psu_show_snapshot(struct device *dev, struct device_attribute *da,
+								char *buf);
+
+int pmbus_psu_probe(struct i2c_client *client, const struct pmbus_psu_model *model);
+int pmbus_psu_remove(struct i2c_client *client);
+
+#endif /* __ACCTON_PMBUS_PSU_H__ */
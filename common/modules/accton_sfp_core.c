@@ -0,0 +1,2876 @@
+/*
+ * Common SFP/QSFP transceiver driver core for accton platforms
+ *
+ * Copyright (C)  Brandon Chuang <brandon_chuang@accton.com.tw>
+ *
+ * Based on ad7414.c
+ * Copyright 2006 Stefan Roese <sr at denx.de>, DENX Software Engineering
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+/*
+ * The per-platform sfp drivers only carry their i2c_device_id table and
+ * a struct sfp_core_platform describing where each port's sideband
+ * signals live in the CPLDs.  Everything else (EEPROM access with
+ * SFF-8436/8472 paging, retries, presence, tx/rx status, reset and the
+ * sysfs interface) is implemented once here.
+ *
+ * A platform with many ports can instead hand all of them over at once
+ * to sfp_core_chassis_probe(), see the end of this file.
+ */
+
+#include <linux/module.h>
+#include <linux/jiffies.h>
+#include <linux/ktime.h>
+#include <linux/i2c.h>
+#include <linux/hwmon-sysfs.h>
+#include <linux/err.h>
+#include <linux/mutex.h>
+#include <linux/spinlock.h>
+#include <linux/sysfs.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+#include <linux/delay.h>
+#include <linux/list.h>
+#include <linux/vmalloc.h>
+#include <linux/workqueue.h>
+#include "accton_sfp_core.h"
+#include "accton_i2c_stats.h"
+#include "accton_telemetry.h"
+#include "accton_trace.h"
+
+#define DEBUG_MODE 0
+
+#if (DEBUG_MODE == 1)
+	#define DEBUG_PRINT(fmt, args...)										 \
+		printk (KERN_INFO "%s:%s[%d]: " fmt "\r\n", __FILE__, __FUNCTION__, __LINE__, ##args)
+#else
+	#define DEBUG_PRINT(fmt, args...)
+#endif
+
+#define EEPROM_NAME				"sfp_eeprom"
+#define BIT_INDEX(i)			(1ULL << (i))
+
+#define SFP_EEPROM_A0_I2C_ADDR (0xA0 >> 1)
+
+#define SFF8024_PHYSICAL_DEVICE_ID_ADDR		0x0
+#define SFF8024_DEVICE_ID_SFP				0x3
+#define SFF8024_DEVICE_ID_QSFP				0xC
+#define SFF8024_DEVICE_ID_QSFP_PLUS			0xD
+#define SFF8024_DEVICE_ID_QSFP28			0x11
+
+#define SFF8472_10G_ETH_COMPLIANCE_ADDR		0x3
+#define SFF8472_10G_BASE_MASK				0xF0
+
+#define SFF8436_RX_LOS_ADDR					3
+#define SFF8436_TX_FAULT_ADDR				4
+#define SFF8436_TX_DISABLE_ADDR				86
+
+/*
+ * status_snapshot of a QSFP port: the interrupt flags, bytes 3~14
+ * (LOS, fault, module and lane alarms), followed by the control block,
+ * bytes 86~99, each read in one transaction.
+ */
+#define SFF8436_STATUS_ADDR					2
+#define SFF8436_DATA_NOT_READY				0x01
+#define SFF8436_FLAGS_ADDR					3
+#define SFF8436_FLAGS_LEN					12
+#define SFF8436_CONTROL_ADDR				86
+#define SFF8436_CONTROL_LEN					14
+#define QSFP_SNAPSHOT_SIZE					(SFF8436_FLAGS_LEN + SFF8436_CONTROL_LEN)
+
+/* fundamental unit of addressing for SFF_8472/SFF_8436 */
+#define SFF_8436_PAGE_SIZE 128
+/*
+ * The current 8436 (QSFP) spec provides for only 4 supported
+ * pages (pages 0-3).
+ * This driver is prepared to support more, but needs a register in the
+ * EEPROM to indicate how many pages are supported before it is safe
+ * to implement more pages in the driver.
+ */
+#define SFF_8436_SPECED_PAGES 4
+#define SFF_8436_EEPROM_SIZE ((1 + SFF_8436_SPECED_PAGES) * SFF_8436_PAGE_SIZE)
+#define SFF_8436_EEPROM_UNPAGED_SIZE (2 * SFF_8436_PAGE_SIZE)
+/*
+ * The current 8472 (SFP) spec provides for only 3 supported
+ * pages (pages 0-2).
+ * This driver is prepared to support more, but needs a register in the
+ * EEPROM to indicate how many pages are supported before it is safe
+ * to implement more pages in the driver.
+ */
+#define SFF_8472_SPECED_PAGES 3
+#define SFF_8472_EEPROM_SIZE ((3 + SFF_8472_SPECED_PAGES) * SFF_8436_PAGE_SIZE)
+#define SFF_8472_EEPROM_UNPAGED_SIZE (4 * SFF_8436_PAGE_SIZE)
+
+/* a few constants to find our way around the EEPROM */
+#define SFF_8436_PAGE_SELECT_REG   0x7F
+#define SFF_8436_PAGEABLE_REG 0x02
+#define SFF_8436_NOT_PAGEABLE (1<<2)
+#define SFF_8472_PAGEABLE_REG 0x40
+#define SFF_8472_PAGEABLE (1<<4)
+
+/*
+ * This parameter is to help this driver avoid blocking other drivers out
+ * of I2C for potentially troublesome amounts of time. With a 100 kHz I2C
+ * clock, one 256 byte read takes about 1/43 second which is excessive;
+ * but the 1/170 second it takes at 400 kHz may be quite reasonable; and
+ * at 1 MHz (Fm+) a 1/430 second delay could easily be invisible.
+ *
+ * This value is forced to be a power of two so that writes align on pages.
+ */
+static unsigned io_limit = SFF_8436_PAGE_SIZE;
+
+/*
+ * specs often allow 5 msec for a page write, sometimes 20 msec;
+ * it's important to recover from write timeouts.
+ */
+static unsigned write_timeout = 25;
+
+/*
+ * Retry backoff.  A module that NACKs is usually busy with an internal
+ * write cycle and answers again within a few hundred usec, so start
+ * short and double up to SFP_RETRY_MAX_US rather than sleeping whole
+ * ticks (10 msec at HZ=100) or the platform retry_interval per attempt.
+ */
+#define SFP_RETRY_MIN_US	20
+#define SFP_RETRY_MAX_US	5000
+
+struct sfp_backoff {
+	ktime_t		start;
+	s64			budget_us;
+	unsigned	delay_us;
+};
+
+/*
+ * Static EEPROM area kept from the last scan: A0h 0-255 of an SFP, upper
+ * page 00h (128-255) of a QSFP.  The area only changes with the module,
+ * so reads inside it are answered from memory until a change of the
+ * present bit is seen, or the module is reset or written.
+ */
+#define SFP_STATIC_SIZE		256
+
+static bool scan_cache = 1;
+module_param(scan_cache, bool, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(scan_cache, "serve EEPROM reads from the copy taken by scan, 0 disables");
+
+typedef enum qsfp_opcode {
+	QSFP_READ_OP = 0,
+	QSFP_WRITE_OP = 1
+} qsfp_opcode_e;
+
+/*
+ * list of valid port types
+ * note OOM_PORT_TYPE_NOT_PRESENT to indicate no
+ * module is present in this port
+ */
+typedef enum oom_driver_port_type_e {
+	OOM_DRIVER_PORT_TYPE_INVALID,
+	OOM_DRIVER_PORT_TYPE_NOT_PRESENT,
+	OOM_DRIVER_PORT_TYPE_SFP,
+	OOM_DRIVER_PORT_TYPE_SFP_PLUS,
+	OOM_DRIVER_PORT_TYPE_QSFP,
+	OOM_DRIVER_PORT_TYPE_QSFP_PLUS,
+	OOM_DRIVER_PORT_TYPE_QSFP28
+} oom_driver_port_type_t;
+
+enum sfp_sysfs_attributes {
+	PRESENT,
+	PRESENT_ALL,
+	PORT_NUMBER,
+	PORT_TYPE,
+	TX_FAULT,
+	TX_FAULT1,
+	TX_FAULT2,
+	TX_FAULT3,
+	TX_FAULT4,
+	TX_DISABLE,
+	TX_DISABLE1,
+	TX_DISABLE2,
+	TX_DISABLE3,
+	TX_DISABLE4,
+	RX_LOS,
+	RX_LOS1,
+	RX_LOS2,
+	RX_LOS3,
+	RX_LOS4,
+	RX_LOS_ALL,
+	PORT_RESET,
+	LAST_UPDATE_MS,
+	UPDATE_INTERVAL_MS,
+	STATUS_VALID,
+	TX_DISABLE_ALL,		/* SFP_CORE_COMPAT_TX_DISABLE_ALL */
+	MOD_RST				/* SFP_CORE_COMPAT_MOD_RST */
+};
+
+/* Each client has this additional data
+ */
+struct sfp_msa_data {
+	char			valid;			/* !=0 if registers are valid */
+	unsigned long	last_updated;	/* In jiffies */
+	u64				status[3];		/* bit0:port0, bit1:port1 and so on */
+									/* index 0 => tx_fail
+											 1 => tx_disable
+											 2 => rx_loss */
+};
+
+struct qsfp_data {
+	char			valid;			/* !=0 if registers are valid */
+	unsigned long	last_updated;	/* In jiffies */
+	u8				status[3];		/* bit0:lane0, bit1:lane1 and so on */
+									/* index 0 => rx_loss
+											 1 => tx_disable
+											 2 => tx_fail */
+	u8				flags[SFF8436_FLAGS_LEN];		/* bytes 3~14 */
+	u8				control[SFF8436_CONTROL_LEN];	/* bytes 86~99 */
+	char			primed;			/* stale latched flags cleared */
+	unsigned int	primed_gen;		/* present_gen they were cleared in */
+};
+
+struct sfp_port_data {
+	struct mutex		   update_lock;
+	const struct sfp_core_platform *plat;
+	const struct sfp_core_port	   *desc;	/* plat->ports[port] */
+	int					   port;		/* CPLD port index */
+	oom_driver_port_type_t port_type;
+	char				   port_type_valid;
+	unsigned int		   port_type_gen;	/* present_gen port_type was read in */
+	u8					   identifier;		/* SFF-8024 byte 0 */
+	u8					   compliance;		/* SFF-8472 byte 3, SFP only */
+	u64					   present;		/* present status, bit0:port0, bit1:port1 and so on */
+
+	struct sfp_msa_data		msa;
+	struct qsfp_data		qsfp;
+	unsigned long			update_interval;	/* of msa/qsfp, in jiffies */
+
+	struct i2c_client	  *client;
+	struct i2c_client	  *ddm_client;	/* dummy client instance for 0xA2, SFP only */
+	struct bin_attribute	eeprom;
+	struct i2c_stats	   *stats;		/* shared with ddm_client */
+	struct accton_tlm	   *tlm;
+
+	int use_smbus;
+	u8 *writebuf;
+	unsigned write_max;
+
+	struct list_head		list;		/* sfp_ports */
+	struct sfp_port_data   *scan_next;	/* next port on the same root bus */
+	unsigned int			static_gen;	/* bumped on every invalidation */
+	unsigned int			present_gen;	/* bumped on removal and reset */
+	unsigned int			present_flips;	/* of the present bit, last seen */
+	char					static_valid;
+	u8						static_buf[SFP_STATIC_SIZE];
+};
+
+static LIST_HEAD(sfp_ports);
+static DEFINE_MUTEX(sfp_ports_lock);
+
+/* Caller holds update_lock */
+static void sfp_static_invalidate(struct sfp_port_data *data)
+{
+	data->static_valid = 0;
+	data->static_gen++;
+}
+
+/* Caller holds update_lock, the module was found absent or was reset */
+static void sfp_present_invalidate(struct sfp_port_data *data)
+{
+	data->present_gen++;
+	sfp_static_invalidate(data);
+}
+
+#define CPLD_PORT_TO_FRONT_PORT(port)  (port+1)
+
+static ssize_t sfp_port_read_write(struct sfp_port_data *port_data,
+		char *buf, loff_t off, size_t len, qsfp_opcode_e opcode);
+
+/*-------------------------------------------------------------------------*/
+/* CPLD side band signals */
+
+static const struct sfp_cpld_bit *sfp_port_signal(const struct sfp_core_port *desc,
+			size_t signal)
+{
+	return (const struct sfp_cpld_bit *)((const char *)desc + signal);
+}
+
+#define SFP_SIGNAL(member)	offsetof(struct sfp_core_port, member)
+
+/* Default and upper bound of a port's tx/rx status cache lifetime */
+#define SFP_STATUS_UPDATE_INTERVAL		(HZ + HZ / 2)
+#define SFP_STATUS_MAX_UPDATE_INTERVAL	60000	/* ms */
+
+/*
+ * Presence registers are shared by up to 8 ports and get read by every
+ * port's EEPROM and status path, so keep the last value of each one for
+ * a short while.  A sweep over all ports then costs one CPLD read per
+ * register and empty cages are refused without touching their bus.
+ */
+#define SFP_PRESENT_CACHE_SIZE	16
+#define SFP_PRESENT_CACHE_AGE	(HZ / 10)
+
+struct sfp_present_reg {
+	unsigned short	cpld_addr;		/* 0 = unused entry */
+	u8				reg;
+	u8				value;
+	unsigned long	last_updated;	/* In jiffies */
+	unsigned int	flips[8];		/* changes of each bit seen so far */
+};
+
+static DEFINE_SPINLOCK(sfp_present_lock);
+static struct sfp_present_reg sfp_present_cache[SFP_PRESENT_CACHE_SIZE];
+
+static struct sfp_present_reg *sfp_present_cache_find(const struct sfp_cpld_bit *b)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(sfp_present_cache); i++) {
+		struct sfp_present_reg *e = &sfp_present_cache[i];
+
+		if (!e->cpld_addr ||
+			(e->cpld_addr == b->cpld_addr && e->reg == b->reg)) {
+			return e;
+		}
+	}
+
+	return NULL;
+}
+
+static void sfp_present_cache_store(const struct sfp_cpld_bit *b, u8 value)
+{
+	struct sfp_present_reg *e;
+	int i;
+
+	spin_lock(&sfp_present_lock);
+	e = sfp_present_cache_find(b);
+	if (e) {
+		for (i = 0; e->cpld_addr && i < 8; i++) {
+			if ((e->value ^ value) & (1 << i)) {
+				e->flips[i]++;
+			}
+		}
+
+		e->cpld_addr = b->cpld_addr;
+		e->reg = b->reg;
+		e->value = value;
+		e->last_updated = jiffies;
+	}
+	spin_unlock(&sfp_present_lock);
+}
+
+/* Changes of the bit b seen by any reader of its register */
+static unsigned int sfp_present_flips(const struct sfp_cpld_bit *b)
+{
+	struct sfp_present_reg *e;
+	unsigned int flips = 0;
+
+	spin_lock(&sfp_present_lock);
+	e = sfp_present_cache_find(b);
+	if (e && e->cpld_addr) {
+		flips = e->flips[b->bit];
+	}
+	spin_unlock(&sfp_present_lock);
+
+	return flips;
+}
+
+/*
+ * Caller holds update_lock.  A module that went away or came back since
+ * the caches were filled, seen by whichever path read its present bit
+ * (sfp_is_present, sfp_is_present_all, the CPLD presence worker), is not
+ * the module they were filled from.
+ */
+static void sfp_present_sync(struct sfp_port_data *data)
+{
+	unsigned int flips = sfp_present_flips(&data->desc->present);
+
+	if (flips != data->present_flips) {
+		data->present_flips = flips;
+		sfp_present_invalidate(data);
+	}
+}
+
+/*
+ * For the presence workers of the CPLD drivers, which don't go through
+ * the port's accessors: 'value' was just read from presence register
+ * 'reg' of the CPLD at 'cpld_addr'.
+ */
+void sfp_core_present_update(unsigned short cpld_addr, u8 reg, u8 value)
+{
+	struct sfp_cpld_bit b = SFP_CPLD_BIT(cpld_addr, reg, 0);
+
+	sfp_present_cache_store(&b, value);
+}
+EXPORT_SYMBOL(sfp_core_present_update);
+
+/* Register holding b, from the cache if it is younger than max_age */
+static int sfp_read_present_reg(struct sfp_port_data *data,
+			const struct sfp_cpld_bit *b, unsigned long max_age)
+{
+	struct sfp_present_reg *e;
+	int val = -1;
+
+	if (max_age) {
+		spin_lock(&sfp_present_lock);
+		e = sfp_present_cache_find(b);
+		if (e && e->cpld_addr &&
+			time_before(jiffies, e->last_updated + max_age)) {
+			val = e->value;
+		}
+		spin_unlock(&sfp_present_lock);
+
+		if (val >= 0) {
+			return val;
+		}
+	}
+
+	val = data->plat->cpld_read(b->cpld_addr, b->reg);
+	if (val >= 0) {
+		sfp_present_cache_store(b, val);
+	}
+
+	return val;
+}
+
+/*
+ * Collect one signal of every port into a bitmap, bit set when the CPLD
+ * bit is set.  Ports are laid out 8 per register in the tables, so each
+ * register is read once no matter how many ports share it.
+ */
+static int sfp_read_cpld_bitmap(const struct sfp_core_platform *plat,
+			struct device *dev, size_t signal, u64 *bitmap)
+{
+	unsigned short last_addr = 0;
+	int last_reg = -1;
+	int i, val = 0;
+
+	*bitmap = 0;
+
+	for (i = 0; i < plat->num_ports; i++) {
+		const struct sfp_cpld_bit *b = sfp_port_signal(&plat->ports[i], signal);
+
+		if (!b->cpld_addr) {
+			continue;
+		}
+
+		if (b->cpld_addr != last_addr || b->reg != last_reg) {
+			val = plat->cpld_read(b->cpld_addr, b->reg);
+			if (unlikely(val < 0)) {
+				dev_dbg(dev, "cpld(0x%x) reg(0x%x) err %d\n",
+						b->cpld_addr, b->reg, val);
+				return val;
+			}
+
+			last_addr = b->cpld_addr;
+			last_reg  = b->reg;
+
+			if (signal == SFP_SIGNAL(present)) {
+				sfp_present_cache_store(b, val);
+			}
+		}
+
+		if (val & (1 << b->bit)) {
+			*bitmap |= BIT_INDEX(i);
+		}
+	}
+
+	return 0;
+}
+
+/* Bitmap of the ports that have this signal wired */
+static u64 sfp_cpld_bitmap_mask(const struct sfp_core_platform *plat, size_t signal)
+{
+	u64 mask = 0;
+	int i;
+
+	for (i = 0; i < plat->num_ports; i++) {
+		if (sfp_port_signal(&plat->ports[i], signal)->cpld_addr) {
+			mask |= BIT_INDEX(i);
+		}
+	}
+
+	return mask;
+}
+
+static int sfp_update_cpld_bit(struct sfp_port_data *data,
+			const struct sfp_cpld_bit *b, int set)
+{
+	int val;
+
+	val = data->plat->cpld_read(b->cpld_addr, b->reg);
+	if (unlikely(val < 0)) {
+		return val;
+	}
+
+	if (set) {
+		val |= (1 << b->bit);
+	}
+	else {
+		val &= ~(1 << b->bit);
+	}
+
+	DEBUG_PRINT("write cpld(0x%x) reg(0x%x) value(0x%x)", b->cpld_addr, b->reg, val);
+	return data->plat->cpld_write(b->cpld_addr, b->reg, val);
+}
+
+static ssize_t show_port_number(struct device *dev, struct device_attribute *da,
+			 char *buf)
+{
+	struct i2c_client *client = to_i2c_client(dev);
+	struct sfp_port_data *data = i2c_get_clientdata(client);
+	return sprintf(buf, "%d\n", CPLD_PORT_TO_FRONT_PORT(data->port));
+}
+
+static struct sfp_port_data *sfp_update_present(struct i2c_client *client)
+{
+	struct sfp_port_data *data = i2c_get_clientdata(client);
+	u64 absent = 0;
+	int status;
+
+	DEBUG_PRINT("Starting sfp present status update");
+	mutex_lock(&data->update_lock);
+
+	/* Present is active low */
+	status = sfp_read_cpld_bitmap(data->plat, &client->dev, SFP_SIGNAL(present), &absent);
+	if (status == 0) {
+		struct accton_tlm_value v;
+
+		data->present = ~absent & sfp_cpld_bitmap_mask(data->plat, SFP_SIGNAL(present));
+		sfp_present_sync(data);
+
+		/* Of this port only, the others have a source of their own */
+		v.name  = "present";
+		v.index = CPLD_PORT_TO_FRONT_PORT(data->port);
+		v.data  = !!(data->present & BIT_INDEX(data->port));
+		accton_tlm_publish(data->tlm, &v, 1, NULL, 0);
+	}
+
+	DEBUG_PRINT("Present status = 0x%llx", data->present);
+	mutex_unlock(&data->update_lock);
+	return (status < 0) ? ERR_PTR(status) : data;
+}
+
+/* Only the register holding this port's bit is read, max_age 0 forces a read */
+static int sfp_port_present(struct sfp_port_data *data, unsigned long max_age)
+{
+	const struct sfp_cpld_bit *b = &data->desc->present;
+	int status;
+
+	status = sfp_read_present_reg(data, b, max_age);
+	if (unlikely(status < 0)) {
+		dev_dbg(&data->client->dev, "cpld(0x%x) reg(0x%x) err %d\n",
+				b->cpld_addr, b->reg, status);
+		return status;
+	}
+
+	return (status & (1 << b->bit)) ? 0 : 1;
+}
+
+static int sfp_is_port_present(struct i2c_client *client, int port)
+{
+	return sfp_port_present(i2c_get_clientdata(client), SFP_PRESENT_CACHE_AGE);
+}
+
+static void sfp_backoff_init(struct sfp_backoff *bo, s64 budget_us)
+{
+	bo->start = ktime_get();
+	bo->budget_us = budget_us;
+	bo->delay_us = SFP_RETRY_MIN_US;
+}
+
+/*
+ * Called after a failed module access.  Returns 0 once it is time for
+ * the next attempt, -ENXIO if the module has been pulled in the meantime,
+ * -EHOSTDOWN if its bus segment has been isolated and -ETIMEDOUT when
+ * the retry budget is spent.
+ */
+static int sfp_backoff_wait(struct sfp_port_data *data, struct sfp_backoff *bo)
+{
+	s64 elapsed;
+
+	if (sfp_port_present(data, 0) == 0) {
+		return -ENXIO;
+	}
+
+	if (i2c_bus_down(data->client->adapter)) {
+		return -EHOSTDOWN;
+	}
+
+	elapsed = ktime_us_delta(ktime_get(), bo->start);
+	if (elapsed >= bo->budget_us) {
+		return -ETIMEDOUT;
+	}
+
+	usleep_range(bo->delay_us, bo->delay_us + bo->delay_us / 2);
+	i2c_stats_retry(data->stats);
+
+	if (bo->delay_us < SFP_RETRY_MAX_US) {
+		bo->delay_us = min_t(unsigned, bo->delay_us * 2, SFP_RETRY_MAX_US);
+	}
+
+	return 0;
+}
+
+/* "xx xx ..." one byte per 8 ports, port 1 in bit 0 of the first byte */
+static ssize_t sfp_show_bitmap(char *buf, u64 bitmap, int num_ports)
+{
+	ssize_t len = 0;
+	int i, nbytes = (num_ports + 7) / 8;
+
+	if (num_ports < SFP_CORE_MAX_PORTS) {
+		bitmap &= BIT_INDEX(num_ports) - 1;
+	}
+
+	for (i = 0; i < nbytes; i++) {
+		len += sprintf(buf + len, (i == 0) ? "%.2x" : " %.2x",
+					   (u8)(bitmap >> (i * 8)));
+	}
+
+	return len + sprintf(buf + len, "\n");
+}
+
+static ssize_t show_present(struct device *dev, struct device_attribute *da,
+			 char *buf)
+{
+	struct sensor_device_attribute *attr = to_sensor_dev_attr(da);
+	struct i2c_client *client = to_i2c_client(dev);
+
+	if (PRESENT_ALL == attr->index) {
+		struct sfp_port_data *data = sfp_update_present(client);
+
+		if (IS_ERR(data)) {
+			return PTR_ERR(data);
+		}
+
+		/* Return values 1 -> num_ports in order */
+		return sfp_show_bitmap(buf, data->present, data->plat->num_ports);
+	}
+	else {
+		struct sfp_port_data *data = i2c_get_clientdata(client);
+		int present = sfp_is_port_present(client, data->port);
+
+		if (IS_ERR_VALUE(present)) {
+			return present;
+		}
+
+		/* PRESENT */
+		return sprintf(buf, "%d\n", present);
+	}
+}
+
+static ssize_t show_port_reset(struct device *dev, struct device_attribute *da,
+			 char *buf)
+{
+	struct i2c_client *client = to_i2c_client(dev);
+	struct sfp_port_data *data = i2c_get_clientdata(client);
+	const struct sfp_cpld_bit *b = &data->desc->reset;
+	int status;
+
+	status = data->plat->cpld_read(b->cpld_addr, b->reg);
+	if (unlikely(status < 0)) {
+		return status;
+	}
+
+	/* CPLD defined 0 is reset state, 1 is normal state */
+	return sprintf(buf, "%d\n", (status & (1 << b->bit)) ? 0 : 1);
+}
+
+static ssize_t sfp_set_port_reset(struct device *dev, struct device_attribute *da,
+			const char *buf, size_t count)
+{
+	struct i2c_client *client = to_i2c_client(dev);
+	struct sfp_port_data *data = i2c_get_clientdata(client);
+	long is_reset;
+	int status;
+
+	status = kstrtol(buf, 10, &is_reset);
+	if (status) {
+		return status;
+	}
+
+	/* is_reset: 0 is not reset. 1 is reset. */
+	mutex_lock(&data->update_lock);
+	status = sfp_update_cpld_bit(data, &data->desc->reset, !is_reset);
+	sfp_present_invalidate(data);
+	mutex_unlock(&data->update_lock);
+
+	return (status < 0) ? status : count;
+}
+
+/* sfp_mod_rst of the old as7312 driver: the raw CPLD bit, 0 is reset */
+static ssize_t show_mod_rst(struct device *dev, struct device_attribute *da,
+			 char *buf)
+{
+	struct i2c_client *client = to_i2c_client(dev);
+	struct sfp_port_data *data = i2c_get_clientdata(client);
+	const struct sfp_cpld_bit *b = &data->desc->reset;
+	int status;
+
+	status = data->plat->cpld_read(b->cpld_addr, b->reg);
+	if (unlikely(status < 0)) {
+		return status;
+	}
+
+	return sprintf(buf, "%d\n", (status & (1 << b->bit)) ? 1 : 0);
+}
+
+static ssize_t set_mod_rst(struct device *dev, struct device_attribute *da,
+			const char *buf, size_t count)
+{
+	struct i2c_client *client = to_i2c_client(dev);
+	struct sfp_port_data *data = i2c_get_clientdata(client);
+	long value;
+	int status;
+
+	status = kstrtol(buf, 10, &value);
+	if (status) {
+		return status;
+	}
+
+	mutex_lock(&data->update_lock);
+	status = sfp_update_cpld_bit(data, &data->desc->reset, !!value);
+	sfp_present_invalidate(data);
+	mutex_unlock(&data->update_lock);
+
+	return (status < 0) ? status : count;
+}
+
+static struct sfp_port_data *sfp_update_tx_rx_status(struct device *dev)
+{
+	struct i2c_client *client = to_i2c_client(dev);
+	struct sfp_port_data *data = i2c_get_clientdata(client);
+	size_t signals[] = { SFP_SIGNAL(tx_fault), SFP_SIGNAL(tx_disable),
+						 SFP_SIGNAL(rx_los) };
+	int i, status = 0;
+
+	if (time_before(jiffies, data->msa.last_updated + data->update_interval) && data->msa.valid) {
+		return data;
+	}
+
+	DEBUG_PRINT("Starting sfp tx rx status update");
+	mutex_lock(&data->update_lock);
+	data->msa.valid = 0;
+	memset(data->msa.status, 0, sizeof(data->msa.status));
+
+	for (i = 0; i < ARRAY_SIZE(signals); i++) {
+		status = sfp_read_cpld_bitmap(data->plat, dev, signals[i], &data->msa.status[i]);
+		if (unlikely(status < 0)) {
+			goto exit;
+		}
+	}
+
+	data->msa.valid = 1;
+	data->msa.last_updated = jiffies;
+
+exit:
+	mutex_unlock(&data->update_lock);
+	return (status < 0) ? ERR_PTR(status) : data;
+}
+
+/*-------------------------------------------------------------------------*/
+/* Plain module access, used for the control/status bytes */
+
+/* Same worst case as the old fixed retry_count x retry_interval loop */
+static s64 sfp_retry_budget_us(struct sfp_port_data *data)
+{
+	return (s64)data->plat->retry_count * data->plat->retry_interval * USEC_PER_MSEC;
+}
+
+static ssize_t sfp_eeprom_read(struct sfp_port_data *data, struct i2c_client *client,
+			u8 command, u8 *buf, int data_len)
+{
+	struct sfp_backoff bo;
+	ktime_t start;
+	int status, err;
+
+	if (data_len > I2C_SMBUS_BLOCK_MAX) {
+		data_len = I2C_SMBUS_BLOCK_MAX;
+	}
+
+	/* Empty cage, don't bother the bus */
+	if (sfp_port_present(data, SFP_PRESENT_CACHE_AGE) == 0) {
+		return -ENXIO;
+	}
+
+	start = accton_trace_eeprom_start();
+	sfp_backoff_init(&bo, sfp_retry_budget_us(data));
+	while (1) {
+		status = i2c_stats_read_i2c_block_data_class(data->stats, I2C_SCHED_CONTROL,
+													 client, command, data_len, buf);
+		if (likely(status >= 0)) {
+			break;
+		}
+
+		err = sfp_backoff_wait(data, &bo);
+		if (err == -ENXIO || err == -EHOSTDOWN) {
+			status = err;
+			break;
+		}
+		if (err) {
+			break;
+		}
+	}
+
+	if (unlikely(status >= 0 && status != data_len)) {
+		status = -EIO;
+	}
+
+	if (accton_trace_started(start)) {
+		trace_accton_eeprom_read(&client->dev, 0, command, data_len,
+								 accton_trace_duration(start), status);
+	}
+	return status;
+}
+
+static ssize_t sfp_eeprom_write(struct sfp_port_data *data, struct i2c_client *client,
+			u8 command, const char *buf, int data_len)
+{
+	struct sfp_backoff bo;
+	ktime_t start;
+	int status, err;
+
+	if (data_len > I2C_SMBUS_BLOCK_MAX) {
+		data_len = I2C_SMBUS_BLOCK_MAX;
+	}
+
+	/* Empty cage, don't bother the bus */
+	if (sfp_port_present(data, SFP_PRESENT_CACHE_AGE) == 0) {
+		return -ENXIO;
+	}
+
+	start = accton_trace_eeprom_start();
+	sfp_backoff_init(&bo, sfp_retry_budget_us(data));
+	while (1) {
+		status = i2c_stats_write_i2c_block_data(data->stats, client, command,
+												data_len, buf);
+		if (likely(status >= 0)) {
+			break;
+		}
+
+		err = sfp_backoff_wait(data, &bo);
+		if (err == -ENXIO || err == -EHOSTDOWN) {
+			status = err;
+			break;
+		}
+		if (err) {
+			break;
+		}
+	}
+
+	if (likely(status >= 0)) {
+		status = data_len;
+	}
+
+	if (accton_trace_started(start)) {
+		trace_accton_eeprom_write(&client->dev, 0, command, data_len,
+								  accton_trace_duration(start), status);
+	}
+	return status;
+}
+
+/*
+ * The identifier and compliance bytes cannot change while the module stays
+ * in, so port_type is read once per insertion (or reset).
+ */
+static struct sfp_port_data *sfp_update_port_type(struct device *dev)
+{
+	struct i2c_client *client = to_i2c_client(dev);
+	struct sfp_port_data *data = i2c_get_clientdata(client);
+	u8 buf = 0;
+	int status;
+
+	mutex_lock(&data->update_lock);
+	sfp_present_sync(data);
+
+	if (data->port_type_valid && data->port_type_gen == data->present_gen) {
+		i2c_stats_cache(data->stats, 1);
+		goto exit;
+	}
+
+	i2c_stats_cache(data->stats, 0);
+	data->port_type_valid = 0;
+
+	status = sfp_eeprom_read(data, client, SFF8024_PHYSICAL_DEVICE_ID_ADDR, &buf, sizeof(buf));
+	if (status < 0) {
+		data->port_type = OOM_DRIVER_PORT_TYPE_INVALID;
+		goto exit;
+	}
+
+	data->identifier = buf;
+
+	if (data->desc->type == SFP_CORE_PORT_SFP) {
+		if (buf != SFF8024_DEVICE_ID_SFP) {
+			data->port_type = OOM_DRIVER_PORT_TYPE_INVALID;
+			goto cache;
+		}
+
+		status = sfp_eeprom_read(data, client, SFF8472_10G_ETH_COMPLIANCE_ADDR, &buf, sizeof(buf));
+		if (status < 0) {
+			data->port_type = OOM_DRIVER_PORT_TYPE_INVALID;
+			goto exit;
+		}
+
+		DEBUG_PRINT("sfp port type (0x3) data = (0x%x)", buf);
+		data->compliance = buf;
+		data->port_type = buf & SFF8472_10G_BASE_MASK ? OOM_DRIVER_PORT_TYPE_SFP_PLUS : OOM_DRIVER_PORT_TYPE_SFP;
+		goto cache;
+	}
+
+	DEBUG_PRINT("qsfp port type (0x0) buf = (0x%x)", buf);
+	switch (buf) {
+	case SFF8024_DEVICE_ID_QSFP:
+		data->port_type = OOM_DRIVER_PORT_TYPE_QSFP;
+		break;
+	case SFF8024_DEVICE_ID_QSFP_PLUS:
+		data->port_type = OOM_DRIVER_PORT_TYPE_QSFP_PLUS;
+		break;
+	case SFF8024_DEVICE_ID_QSFP28:
+		data->port_type = OOM_DRIVER_PORT_TYPE_QSFP28;
+		break;
+	default:
+		data->port_type = OOM_DRIVER_PORT_TYPE_INVALID;
+		break;
+	}
+
+cache:
+	data->port_type_valid = 1;
+	data->port_type_gen = data->present_gen;
+
+exit:
+	mutex_unlock(&data->update_lock);
+	return data;
+}
+
+static ssize_t show_port_type(struct device *dev, struct device_attribute *da,
+			 char *buf)
+{
+	struct i2c_client *client = to_i2c_client(dev);
+	struct sfp_port_data *data = i2c_get_clientdata(client);
+	int present;
+
+	present = sfp_is_port_present(client, data->port);
+	if (IS_ERR_VALUE(present)) {
+		return present;
+	}
+
+	if (!present) {
+		mutex_lock(&data->update_lock);
+		sfp_present_invalidate(data);
+		mutex_unlock(&data->update_lock);
+		return sprintf(buf, "%d\n", OOM_DRIVER_PORT_TYPE_NOT_PRESENT);
+	}
+
+	sfp_update_port_type(dev);
+	return sprintf(buf, "%d\n", data->port_type);
+}
+
+static struct sfp_port_data *qsfp_update_tx_rx_status(struct device *dev)
+{
+	struct i2c_client *client = to_i2c_client(dev);
+	struct sfp_port_data *data = i2c_get_clientdata(client);
+	u8 *flags = data->qsfp.flags;
+	int status = -1;
+
+	if (time_before(jiffies, data->qsfp.last_updated + data->update_interval) && data->qsfp.valid) {
+		return data;
+	}
+
+	DEBUG_PRINT("Starting sfp tx rx status update");
+	mutex_lock(&data->update_lock);
+	sfp_present_sync(data);
+	data->qsfp.valid = 0;
+	memset(data->qsfp.status, 0, sizeof(data->qsfp.status));
+
+	/*
+	 * The flags are latched and clear on read, so each read reports
+	 * what happened since the one before.  Only a module's first read
+	 * would report what latched before it was being watched: clear
+	 * those and let the flags settle, once per module.
+	 */
+	if (!data->qsfp.primed || data->qsfp.primed_gen != data->present_gen) {
+		status = sfp_eeprom_read(data, client, SFF8436_FLAGS_ADDR, flags, SFF8436_FLAGS_LEN);
+		if (unlikely(status < 0)) {
+			goto exit;
+		}
+		msleep(200);
+
+		data->qsfp.primed = 1;
+		data->qsfp.primed_gen = data->present_gen;
+	}
+
+	/*
+	 * Read actual flags and the control block.  They can't be one
+	 * transaction, bytes 3~99 are more than an SMBus block.
+	 */
+	status = sfp_eeprom_read(data, client, SFF8436_FLAGS_ADDR, flags, SFF8436_FLAGS_LEN);
+	if (unlikely(status < 0)) {
+		goto exit;
+	}
+
+	status = sfp_eeprom_read(data, client, SFF8436_CONTROL_ADDR, data->qsfp.control,
+							 SFF8436_CONTROL_LEN);
+	if (unlikely(status < 0)) {
+		goto exit;
+	}
+
+	DEBUG_PRINT("qsfp rx_los(0x%x) tx_fault(0x%x) tx_disable(0x%x)",
+				flags[SFF8436_RX_LOS_ADDR - SFF8436_FLAGS_ADDR],
+				flags[SFF8436_TX_FAULT_ADDR - SFF8436_FLAGS_ADDR], data->qsfp.control[0]);
+	data->qsfp.status[0] = flags[SFF8436_RX_LOS_ADDR - SFF8436_FLAGS_ADDR] & 0xF;
+	data->qsfp.status[1] = data->qsfp.control[SFF8436_TX_DISABLE_ADDR - SFF8436_CONTROL_ADDR] & 0xF;
+	data->qsfp.status[2] = flags[SFF8436_TX_FAULT_ADDR - SFF8436_FLAGS_ADDR] & 0xF;
+
+	data->qsfp.valid = 1;
+	data->qsfp.last_updated = jiffies;
+
+exit:
+	mutex_unlock(&data->update_lock);
+	return (status < 0) ? ERR_PTR(status) : data;
+}
+
+static ssize_t qsfp_show_tx_rx_status(struct device *dev, struct device_attribute *da,
+			 char *buf)
+{
+	int present;
+	u8 val = 0;
+	struct sensor_device_attribute *attr = to_sensor_dev_attr(da);
+	struct i2c_client *client = to_i2c_client(dev);
+	struct sfp_port_data *data = i2c_get_clientdata(client);
+
+	present = sfp_is_port_present(client, data->port);
+	if (IS_ERR_VALUE(present)) {
+		return present;
+	}
+
+	if (present == 0) {
+		/* port is not present */
+		return -ENXIO;
+	}
+
+	data = qsfp_update_tx_rx_status(dev);
+	if (IS_ERR(data)) {
+		return PTR_ERR(data);
+	}
+
+	switch (attr->index) {
+	case TX_FAULT:
+		val = !!(data->qsfp.status[2] & 0xF);
+		break;
+	case TX_FAULT1:
+	case TX_FAULT2:
+	case TX_FAULT3:
+	case TX_FAULT4:
+		val = !!(data->qsfp.status[2] & BIT_INDEX(attr->index - TX_FAULT1));
+		break;
+	case TX_DISABLE:
+		val = data->qsfp.status[1] & 0xF;
+		break;
+	case TX_DISABLE_ALL:
+		val = ((data->qsfp.status[1] & 0xF) == 0xF) ? 1 : 0;
+		break;
+	case TX_DISABLE1:
+	case TX_DISABLE2:
+	case TX_DISABLE3:
+	case TX_DISABLE4:
+		val = !!(data->qsfp.status[1] & BIT_INDEX(attr->index - TX_DISABLE1));
+		break;
+	case RX_LOS:
+		val = !!(data->qsfp.status[0] & 0xF);
+		break;
+	case RX_LOS1:
+	case RX_LOS2:
+	case RX_LOS3:
+	case RX_LOS4:
+		val = !!(data->qsfp.status[0] & BIT_INDEX(attr->index - RX_LOS1));
+		break;
+	default:
+		break;
+	}
+
+	return sprintf(buf, "%d\n", val);
+}
+
+static ssize_t qsfp_show_snapshot(struct file *filp, struct kobject *kobj,
+		struct bin_attribute *attr, char *buf, loff_t off, size_t count)
+{
+	struct device *dev = container_of(kobj, struct device, kobj);
+	struct i2c_client *client = to_i2c_client(dev);
+	struct sfp_port_data *data = i2c_get_clientdata(client);
+	u8 snapshot[QSFP_SNAPSHOT_SIZE];
+	int present;
+
+	if (off >= QSFP_SNAPSHOT_SIZE) {
+		return 0;
+	}
+	if (off + count > QSFP_SNAPSHOT_SIZE) {
+		count = QSFP_SNAPSHOT_SIZE - off;
+	}
+
+	present = sfp_is_port_present(client, data->port);
+	if (IS_ERR_VALUE(present)) {
+		return present;
+	}
+
+	if (present == 0) {
+		/* port is not present */
+		return -ENXIO;
+	}
+
+	data = qsfp_update_tx_rx_status(dev);
+	if (IS_ERR(data)) {
+		return PTR_ERR(data);
+	}
+
+	mutex_lock(&data->update_lock);
+	memcpy(snapshot, data->qsfp.flags, SFF8436_FLAGS_LEN);
+	memcpy(snapshot + SFF8436_FLAGS_LEN, data->qsfp.control, SFF8436_CONTROL_LEN);
+	mutex_unlock(&data->update_lock);
+
+	memcpy(buf, snapshot + off, count);
+	return count;
+}
+
+static struct bin_attribute qsfp_snapshot_attr = {
+	.attr = {
+		.name = "status_snapshot",
+		.mode = S_IRUGO,
+	},
+	.size = QSFP_SNAPSHOT_SIZE,
+	.read = qsfp_show_snapshot,
+};
+
+static ssize_t qsfp_set_tx_disable(struct device *dev, struct device_attribute *da,
+			const char *buf, size_t count)
+{
+	long disable;
+	int status;
+	struct sensor_device_attribute *attr = to_sensor_dev_attr(da);
+	struct i2c_client *client = to_i2c_client(dev);
+	struct sfp_port_data *data = i2c_get_clientdata(client);
+
+	status = sfp_is_port_present(client, data->port);
+	if (IS_ERR_VALUE(status)) {
+		return status;
+	}
+
+	if (!status) {
+		/* port is not present */
+		return -ENXIO;
+	}
+
+	status = kstrtol(buf, 10, &disable);
+	if (status) {
+		return status;
+	}
+
+	data = qsfp_update_tx_rx_status(dev);
+	if (IS_ERR(data)) {
+		return PTR_ERR(data);
+	}
+
+	mutex_lock(&data->update_lock);
+
+	if (attr->index == TX_DISABLE || attr->index == TX_DISABLE_ALL) {
+		if (disable) {
+			data->qsfp.status[1] |= 0xF;
+		}
+		else {
+			data->qsfp.status[1] &= ~0xF;
+		}
+	}
+	else {/* TX_DISABLE1 ~ TX_DISABLE4*/
+		if (disable) {
+			data->qsfp.status[1] |= (1 << (attr->index - TX_DISABLE1));
+		}
+		else {
+			data->qsfp.status[1] &= ~(1 << (attr->index - TX_DISABLE1));
+		}
+	}
+
+	DEBUG_PRINT("index = (%d), status = (0x%x)", attr->index, data->qsfp.status[1]);
+	status = sfp_eeprom_write(data, data->client, SFF8436_TX_DISABLE_ADDR, &data->qsfp.status[1], sizeof(data->qsfp.status[1]));
+	if (unlikely(status < 0)) {
+		count = status;
+	}
+	else {
+		data->qsfp.control[SFF8436_TX_DISABLE_ADDR - SFF8436_CONTROL_ADDR] = data->qsfp.status[1];
+	}
+
+	mutex_unlock(&data->update_lock);
+	return count;
+}
+
+static ssize_t sfp_show_tx_rx_status(struct device *dev, struct device_attribute *da,
+			 char *buf)
+{
+	u8 val = 0, index = 0;
+	struct sensor_device_attribute *attr = to_sensor_dev_attr(da);
+	struct i2c_client *client = to_i2c_client(dev);
+	struct sfp_port_data *data = i2c_get_clientdata(client);
+
+	if (data->desc->type == SFP_CORE_PORT_QSFP) {
+		return qsfp_show_tx_rx_status(dev, da, buf);
+	}
+
+	data = sfp_update_tx_rx_status(dev);
+	if (IS_ERR(data)) {
+		return PTR_ERR(data);
+	}
+
+	if (attr->index == RX_LOS_ALL) {
+		/* Return values 1 -> last port with rx_los wired, in order */
+		u64 mask = sfp_cpld_bitmap_mask(data->plat, SFP_SIGNAL(rx_los));
+		return sfp_show_bitmap(buf, data->msa.status[2], fls64(mask));
+	}
+
+	switch (attr->index) {
+	case TX_FAULT:
+		index = 0;
+		break;
+	case TX_DISABLE:
+		index = 1;
+		break;
+	case RX_LOS:
+		index = 2;
+		break;
+	default:
+		return 0;
+	}
+
+	val = (data->msa.status[index] & BIT_INDEX(data->port)) ? 1 : 0;
+	return sprintf(buf, "%d\n", val);
+}
+
+static ssize_t sfp_set_tx_disable(struct device *dev, struct device_attribute *da,
+			const char *buf, size_t count)
+{
+	struct i2c_client *client = to_i2c_client(dev);
+	struct sfp_port_data *data = i2c_get_clientdata(client);
+	long disable;
+	int status;
+
+	if (data->desc->type == SFP_CORE_PORT_QSFP) {
+		return qsfp_set_tx_disable(dev, da, buf, count);
+	}
+
+	status = kstrtol(buf, 10, &disable);
+	if (status) {
+		return status;
+	}
+
+	mutex_lock(&data->update_lock);
+
+	status = sfp_update_cpld_bit(data, &data->desc->tx_disable, disable);
+	if (status == 0) {
+		/* Update tx_disable status */
+		if (disable) {
+			data->msa.status[1] |= BIT_INDEX(data->port);
+		}
+		else {
+			data->msa.status[1] &= ~BIT_INDEX(data->port);
+		}
+	}
+
+	mutex_unlock(&data->update_lock);
+	return (status < 0) ? status : count;
+}
+
+/*
+ * Age, lifetime and validity of the tx/rx status cache: the CPLD bitmaps
+ * on SFP ports, the lane registers of the module on QSFP ports.  The age
+ * is -1 while the cache is not valid.
+ */
+static ssize_t sfp_show_cache(struct device *dev, struct device_attribute *da,
+			 char *buf)
+{
+	struct sensor_device_attribute *attr = to_sensor_dev_attr(da);
+	struct sfp_port_data *data = i2c_get_clientdata(to_i2c_client(dev));
+	unsigned long last_updated;
+	char valid;
+	ssize_t ret = 0;
+
+	mutex_lock(&data->update_lock);
+	if (data->desc->type == SFP_CORE_PORT_QSFP) {
+		last_updated = data->qsfp.last_updated;
+		valid = data->qsfp.valid;
+	}
+	else {
+		last_updated = data->msa.last_updated;
+		valid = data->msa.valid;
+	}
+
+	switch (attr->index) {
+	case LAST_UPDATE_MS:
+		if (!valid) {
+			ret = sprintf(buf, "-1\n");
+			break;
+		}
+		ret = sprintf(buf, "%u\n", jiffies_to_msecs(jiffies - last_updated));
+		break;
+	case UPDATE_INTERVAL_MS:
+		ret = sprintf(buf, "%u\n", jiffies_to_msecs(data->update_interval));
+		break;
+	case STATUS_VALID:
+		ret = sprintf(buf, "%d\n", valid ? 1 : 0);
+		break;
+	default:
+		break;
+	}
+	mutex_unlock(&data->update_lock);
+
+	return ret;
+}
+
+static ssize_t sfp_set_update_interval(struct device *dev, struct device_attribute *da,
+			const char *buf, size_t count)
+{
+	struct sfp_port_data *data = i2c_get_clientdata(to_i2c_client(dev));
+	unsigned int value;
+	int status;
+
+	status = kstrtouint(buf, 10, &value);
+	if (status) {
+		return status;
+	}
+
+	if (value > SFP_STATUS_MAX_UPDATE_INTERVAL) {
+		return -EINVAL;
+	}
+
+	mutex_lock(&data->update_lock);
+	data->update_interval = msecs_to_jiffies(value);
+	mutex_unlock(&data->update_lock);
+
+	return count;
+}
+
+/* SFP/QSFP common attributes for sysfs */
+static SENSOR_DEVICE_ATTR(sfp_port_number, S_IRUGO, show_port_number, NULL, PORT_NUMBER);
+static SENSOR_DEVICE_ATTR(sfp_port_type, S_IRUGO, show_port_type, NULL, PORT_TYPE);
+static SENSOR_DEVICE_ATTR(sfp_is_present,  S_IRUGO, show_present, NULL, PRESENT);
+static SENSOR_DEVICE_ATTR(sfp_is_present_all,  S_IRUGO, show_present, NULL, PRESENT_ALL);
+static SENSOR_DEVICE_ATTR(sfp_port_reset, S_IWUSR | S_IRUGO, show_port_reset, sfp_set_port_reset, PORT_RESET);
+static SENSOR_DEVICE_ATTR(sfp_rx_los,  S_IRUGO, sfp_show_tx_rx_status, NULL, RX_LOS);
+static SENSOR_DEVICE_ATTR(sfp_tx_disable,  S_IWUSR | S_IRUGO, sfp_show_tx_rx_status, sfp_set_tx_disable, TX_DISABLE);
+static SENSOR_DEVICE_ATTR(sfp_tx_fault,	 S_IRUGO, sfp_show_tx_rx_status, NULL, TX_FAULT);
+static SENSOR_DEVICE_ATTR(sfp_tx_disable_all, S_IWUSR | S_IRUGO, sfp_show_tx_rx_status, qsfp_set_tx_disable, TX_DISABLE_ALL);
+static SENSOR_DEVICE_ATTR(sfp_mod_rst, S_IWUSR | S_IRUGO, show_mod_rst, set_mod_rst, MOD_RST);
+static SENSOR_DEVICE_ATTR(last_update_ms, S_IRUGO, sfp_show_cache, NULL, LAST_UPDATE_MS);
+static SENSOR_DEVICE_ATTR(update_interval_ms, S_IWUSR | S_IRUGO, sfp_show_cache, sfp_set_update_interval, UPDATE_INTERVAL_MS);
+static SENSOR_DEVICE_ATTR(valid, S_IRUGO, sfp_show_cache, NULL, STATUS_VALID);
+
+/* SFP attributes for sysfs */
+static SENSOR_DEVICE_ATTR(sfp_rx_los_all,  S_IRUGO, sfp_show_tx_rx_status, NULL, RX_LOS_ALL);
+
+/* QSFP attributes for sysfs */
+static SENSOR_DEVICE_ATTR(sfp_rx_los1, S_IRUGO, qsfp_show_tx_rx_status, NULL, RX_LOS1);
+static SENSOR_DEVICE_ATTR(sfp_rx_los2, S_IRUGO, qsfp_show_tx_rx_status, NULL, RX_LOS2);
+static SENSOR_DEVICE_ATTR(sfp_rx_los3, S_IRUGO, qsfp_show_tx_rx_status, NULL, RX_LOS3);
+static SENSOR_DEVICE_ATTR(sfp_rx_los4, S_IRUGO, qsfp_show_tx_rx_status, NULL, RX_LOS4);
+static SENSOR_DEVICE_ATTR(sfp_tx_disable1, S_IWUSR | S_IRUGO, qsfp_show_tx_rx_status, qsfp_set_tx_disable, TX_DISABLE1);
+static SENSOR_DEVICE_ATTR(sfp_tx_disable2, S_IWUSR | S_IRUGO, qsfp_show_tx_rx_status, qsfp_set_tx_disable, TX_DISABLE2);
+static SENSOR_DEVICE_ATTR(sfp_tx_disable3, S_IWUSR | S_IRUGO, qsfp_show_tx_rx_status, qsfp_set_tx_disable, TX_DISABLE3);
+static SENSOR_DEVICE_ATTR(sfp_tx_disable4, S_IWUSR | S_IRUGO, qsfp_show_tx_rx_status, qsfp_set_tx_disable, TX_DISABLE4);
+static SENSOR_DEVICE_ATTR(sfp_tx_fault1, S_IRUGO, qsfp_show_tx_rx_status, NULL, TX_FAULT1);
+static SENSOR_DEVICE_ATTR(sfp_tx_fault2, S_IRUGO, qsfp_show_tx_rx_status, NULL, TX_FAULT2);
+static SENSOR_DEVICE_ATTR(sfp_tx_fault3, S_IRUGO, qsfp_show_tx_rx_status, NULL, TX_FAULT3);
+static SENSOR_DEVICE_ATTR(sfp_tx_fault4, S_IRUGO, qsfp_show_tx_rx_status, NULL, TX_FAULT4);
+
+static struct attribute *sfp_attributes[] = {
+	&sensor_dev_attr_sfp_port_number.dev_attr.attr,
+	&sensor_dev_attr_sfp_port_type.dev_attr.attr,
+	&sensor_dev_attr_sfp_is_present.dev_attr.attr,
+	&sensor_dev_attr_sfp_is_present_all.dev_attr.attr,
+	&sensor_dev_attr_sfp_port_reset.dev_attr.attr,
+	&sensor_dev_attr_sfp_rx_los.dev_attr.attr,
+	&sensor_dev_attr_sfp_tx_disable.dev_attr.attr,
+	&sensor_dev_attr_sfp_tx_fault.dev_attr.attr,
+	&sensor_dev_attr_sfp_tx_disable_all.dev_attr.attr,
+	&sensor_dev_attr_sfp_mod_rst.dev_attr.attr,
+	&sensor_dev_attr_last_update_ms.dev_attr.attr,
+	&sensor_dev_attr_update_interval_ms.dev_attr.attr,
+	&sensor_dev_attr_valid.dev_attr.attr,
+	&sensor_dev_attr_sfp_rx_los_all.dev_attr.attr,
+	&sensor_dev_attr_sfp_rx_los1.dev_attr.attr,
+	&sensor_dev_attr_sfp_rx_los2.dev_attr.attr,
+	&sensor_dev_attr_sfp_rx_los3.dev_attr.attr,
+	&sensor_dev_attr_sfp_rx_los4.dev_attr.attr,
+	&sensor_dev_attr_sfp_tx_disable1.dev_attr.attr,
+	&sensor_dev_attr_sfp_tx_disable2.dev_attr.attr,
+	&sensor_dev_attr_sfp_tx_disable3.dev_attr.attr,
+	&sensor_dev_attr_sfp_tx_disable4.dev_attr.attr,
+	&sensor_dev_attr_sfp_tx_fault1.dev_attr.attr,
+	&sensor_dev_attr_sfp_tx_fault2.dev_attr.attr,
+	&sensor_dev_attr_sfp_tx_fault3.dev_attr.attr,
+	&sensor_dev_attr_sfp_tx_fault4.dev_attr.attr,
+	NULL
+};
+
+/*
+ * Hide what the port cannot do: the per lane attributes on SFP ports,
+ * and any attribute whose CPLD signal is not wired on this platform.
+ * The names a platform had before the core are kept by its compat flags.
+ */
+static umode_t sfp_attr_is_visible(struct kobject *kobj, struct attribute *a, int n)
+{
+	struct device *dev = container_of(kobj, struct device, kobj);
+	struct sfp_port_data *data = i2c_get_clientdata(to_i2c_client(dev));
+	struct sensor_device_attribute *attr;
+	int qsfp = (data->desc->type == SFP_CORE_PORT_QSFP);
+
+	attr = to_sensor_dev_attr(container_of(a, struct device_attribute, attr));
+
+	switch (attr->index) {
+	case PORT_RESET:
+		return (data->desc->reset.cpld_addr &&
+				!(data->plat->compat & SFP_CORE_COMPAT_MOD_RST)) ? a->mode : 0;
+	case MOD_RST:
+		return (data->desc->reset.cpld_addr &&
+				(data->plat->compat & SFP_CORE_COMPAT_MOD_RST)) ? a->mode : 0;
+	case TX_DISABLE_ALL:
+		return (qsfp && (data->plat->compat & SFP_CORE_COMPAT_TX_DISABLE_ALL)) ? a->mode : 0;
+	case TX_DISABLE:
+		return (qsfp || data->desc->tx_disable.cpld_addr) ? a->mode : 0;
+	case TX_FAULT:
+		return (qsfp || data->desc->tx_fault.cpld_addr) ? a->mode : 0;
+	case RX_LOS:
+		return (qsfp || data->desc->rx_los.cpld_addr) ? a->mode : 0;
+	case RX_LOS_ALL:
+		return (!qsfp && data->desc->rx_los.cpld_addr) ? a->mode : 0;
+	case TX_FAULT1 ... TX_FAULT4:
+	case TX_DISABLE1 ... TX_DISABLE4:
+	case RX_LOS1 ... RX_LOS4:
+		return qsfp ? a->mode : 0;
+	default:
+		return a->mode;
+	}
+}
+
+static const struct attribute_group sfp_group = {
+	.attrs		= sfp_attributes,
+	.is_visible	= sfp_attr_is_visible,
+};
+
+/*-------------------------------------------------------------------------*/
+/*
+ * This routine computes the addressing information to be used for
+ * a given r/w request.
+ *
+ * Task is to calculate the client (0 = i2c addr 50, 1 = i2c addr 51),
+ * the page, and the offset.
+ *
+ * Handles both SFP and QSFP.
+ *     For SFP, offset 0-255 are on client[0], >255 is on client[1]
+ *     Offset 256-383 are on the lower half of client[1]
+ *     Pages are accessible on the upper half of client[1].
+ *     Offset >383 are in 128 byte pages mapped into the upper half
+ *
+ *     For QSFP, all offsets are on client[0]
+ *     offset 0-127 are on the lower half of client[0] (no paging)
+ *     Pages are accessible on the upper half of client[1].
+ *     Offset >127 are in 128 byte pages mapped into the upper half
+ *
+ *     Callers must not read/write beyond the end of a client or a page
+ *     without recomputing the client/page.  Hence offset (within page)
+ *     plus length must be less than or equal to 128.  (Note that this
+ *     routine does not have access to the length of the call, hence
+ *     cannot do the validity check.)
+ *
+ * Offset within Lower Page 00h and Upper Page 00h are not recomputed
+ */
+static uint8_t sff_8436_translate_offset(struct sfp_port_data *port_data,
+		loff_t *offset, struct i2c_client **client)
+{
+	unsigned page = 0;
+
+	*client = port_data->client;
+
+	/* if SFP style, offset > 255, shift to i2c addr 0x51 */
+	if (port_data->desc->type == SFP_CORE_PORT_SFP) {
+		if (*offset > 255) {
+			/* like QSFP, but shifted to client[1] */
+			*client = port_data->ddm_client;
+			*offset -= 256;
+		}
+	}
+
+	/*
+	 * if offset is in the range 0-128...
+	 * page doesn't matter (using lower half), return 0.
+	 * offset is already correct (don't add 128 to get to paged area)
+	 */
+	if (*offset < SFF_8436_PAGE_SIZE)
+		return page;
+
+	/* note, page will always be positive since *offset >= 128 */
+	page = (*offset >> 7)-1;
+	/* 0x80 places the offset in the top half, offset is last 7 bits */
+	*offset = SFF_8436_PAGE_SIZE + (*offset & 0x7f);
+
+	return page;  /* note also returning client and offset */
+}
+
+static ssize_t sff_8436_eeprom_read(struct sfp_port_data *port_data,
+		    struct i2c_client *client, int class,
+		    char *buf, unsigned offset, size_t count)
+{
+	struct i2c_msg msg[2];
+	u8 msgbuf[2];
+	struct sfp_backoff bo;
+	int status, i;
+
+	memset(msg, 0, sizeof(msg));
+
+	/* Short enough not to hold off a fan or PSU poll of the same bus */
+	count = i2c_sched_chunk(port_data->stats, count);
+
+	switch (port_data->use_smbus) {
+	case I2C_SMBUS_I2C_BLOCK_DATA:
+		/*smaller eeproms can work given some SMBus extension calls */
+		if (count > I2C_SMBUS_BLOCK_MAX)
+			count = I2C_SMBUS_BLOCK_MAX;
+		break;
+	case I2C_SMBUS_WORD_DATA:
+		/* Check for odd length transaction */
+		count = (count == 1) ? 1 : 2;
+		break;
+	case I2C_SMBUS_BYTE_DATA:
+		count = 1;
+		break;
+	default:
+		/*
+		 * When we have a better choice than SMBus calls, use a
+		 * combined I2C message. Write address; then read up to
+		 * io_limit data bytes.  msgbuf is u8 and will cast to our
+		 * needs.
+		 */
+		i = 0;
+		msgbuf[i++] = offset;
+
+		msg[0].addr = client->addr;
+		msg[0].buf = msgbuf;
+		msg[0].len = i;
+
+		msg[1].addr = client->addr;
+		msg[1].flags = I2C_M_RD;
+		msg[1].buf = buf;
+		msg[1].len = count;
+	}
+
+	/*
+	 * Reads fail if the previous write didn't complete yet. We may
+	 * loop a few times until this one succeeds, waiting at least
+	 * long enough for one entire page write to work.
+	 */
+	sfp_backoff_init(&bo, write_timeout * USEC_PER_MSEC);
+	do {
+
+		switch (port_data->use_smbus) {
+		case I2C_SMBUS_I2C_BLOCK_DATA:
+			status = i2c_stats_read_i2c_block_data_class(port_data->stats,
+					class, client, offset, count, buf);
+			break;
+		case I2C_SMBUS_WORD_DATA:
+			status = i2c_stats_read_word_data_class(port_data->stats,
+					class, client, offset);
+			if (status >= 0) {
+				buf[0] = status & 0xff;
+				if (count == 2)
+					buf[1] = status >> 8;
+				status = count;
+			}
+			break;
+		case I2C_SMBUS_BYTE_DATA:
+			status = i2c_stats_read_byte_data_class(port_data->stats,
+					class, client, offset);
+			if (status >= 0) {
+				buf[0] = status;
+				status = count;
+			}
+			break;
+		default:
+			status = i2c_stats_transfer_class(port_data->stats,
+					class, client->adapter, msg, 2);
+			if (status == 2)
+				status = count;
+		}
+
+		dev_dbg(&client->dev, "eeprom read %zu@%d --> %d (%ld)\n",
+				count, offset, status, jiffies);
+
+		if (status == count)  /* happy path */
+			return count;
+
+		if (status == -ENXIO) /* no module present */
+			return status;
+
+		status = sfp_backoff_wait(port_data, &bo);
+	} while (status == 0);
+
+	return status;
+}
+
+static ssize_t sff_8436_eeprom_write(struct sfp_port_data *port_data,
+				struct i2c_client *client, int class,
+				const char *buf,
+				unsigned offset, size_t count)
+{
+	struct i2c_msg msg;
+	ssize_t status;
+	struct sfp_backoff bo;
+	unsigned next_page_start;
+	int i = 0;
+
+	/* write max is at most a page
+	 * (In this driver, write_max is actually one byte!)
+	 */
+	if (count > port_data->write_max)
+		count = port_data->write_max;
+
+	/* shorten count if necessary to avoid crossing page boundary */
+	next_page_start = roundup(offset + 1, SFF_8436_PAGE_SIZE);
+	if (offset + count > next_page_start)
+		count = next_page_start - offset;
+
+	switch (port_data->use_smbus) {
+	case I2C_SMBUS_I2C_BLOCK_DATA:
+		/*smaller eeproms can work given some SMBus extension calls */
+		if (count > I2C_SMBUS_BLOCK_MAX)
+			count = I2C_SMBUS_BLOCK_MAX;
+		break;
+	case I2C_SMBUS_WORD_DATA:
+		/* Check for odd length transaction */
+		count = (count == 1) ? 1 : 2;
+		break;
+	case I2C_SMBUS_BYTE_DATA:
+		count = 1;
+		break;
+	default:
+		/* If we'll use I2C calls for I/O, set up the message */
+		msg.addr = client->addr;
+		msg.flags = 0;
+
+		/* msg.buf is u8 and casts will mask the values */
+		msg.buf = port_data->writebuf;
+
+		msg.buf[i++] = offset;
+		memcpy(&msg.buf[i], buf, count);
+		msg.len = i + count;
+		break;
+	}
+
+	/*
+	 * Reads fail if the previous write didn't complete yet. We may
+	 * loop a few times until this one succeeds, waiting at least
+	 * long enough for one entire page write to work.
+	 */
+	sfp_backoff_init(&bo, write_timeout * USEC_PER_MSEC);
+	do {
+
+		switch (port_data->use_smbus) {
+		case I2C_SMBUS_I2C_BLOCK_DATA:
+			status = i2c_stats_write_i2c_block_data_class(port_data->stats,
+						class, client, offset, count, buf);
+			if (status == 0)
+				status = count;
+			break;
+		case I2C_SMBUS_WORD_DATA:
+			if (count == 2) {
+				status = i2c_stats_write_word_data_class(port_data->stats,
+					class, client, offset, (u16)((buf[0])|(buf[1] << 8)));
+			} else {
+				/* count = 1 */
+				status = i2c_stats_write_byte_data_class(port_data->stats,
+					class, client, offset, buf[0]);
+			}
+			if (status == 0)
+				status = count;
+			break;
+		case I2C_SMBUS_BYTE_DATA:
+			status = i2c_stats_write_byte_data_class(port_data->stats,
+						class, client, offset, buf[0]);
+			if (status == 0)
+				status = count;
+			break;
+		default:
+			status = i2c_stats_transfer_class(port_data->stats,
+					class, client->adapter, &msg, 1);
+			if (status == 1)
+				status = count;
+			break;
+		}
+
+		dev_dbg(&client->dev, "eeprom write %zu@%d --> %ld (%lu)\n",
+				count, offset, (long int) status, jiffies);
+
+		if (status == count)
+			return count;
+
+		if (status == -ENXIO) /* no module present */
+			return status;
+
+		status = sfp_backoff_wait(port_data, &bo);
+	} while (status == 0);
+
+	return status;
+}
+
+/*
+ * Scheduling class of an eeprom file read.  The lower page of a QSFP and
+ * the A2h diagnostics of an SFP are status and DOM, which go ahead of
+ * EEPROM sweeps.  Everything else is EEPROM contents.
+ */
+static int sff_8436_read_class(struct sfp_port_data *port_data,
+		struct i2c_client *client, u8 page, unsigned int offset, size_t count)
+{
+	if (page == 0 && offset + count <= SFF_8436_PAGE_SIZE &&
+		(port_data->desc->type == SFP_CORE_PORT_QSFP || client == port_data->ddm_client)) {
+		return I2C_SCHED_CONTROL;
+	}
+
+	return I2C_SCHED_BULK;
+}
+
+static ssize_t sff_8436_eeprom_update_client(struct sfp_port_data *port_data,
+				char *buf, loff_t off,
+				size_t count, qsfp_opcode_e opcode)
+{
+	struct i2c_client *client;
+	ssize_t retval = 0;
+	u8 page = 0;
+	loff_t phy_offset = off;
+	unsigned int offset;
+	size_t len = count;
+	ktime_t start = accton_trace_eeprom_start();
+	int ret = 0;
+	int class, page_class;
+
+	page = sff_8436_translate_offset(port_data, &phy_offset, &client);
+	offset = phy_offset;
+
+	/* The page selects of a sweep go in the sweep's class */
+	if (opcode == QSFP_READ_OP) {
+		class = sff_8436_read_class(port_data, client, page, offset, count);
+		page_class = class;
+	}
+	else {
+		class = I2C_SCHED_DEFAULT;
+		page_class = I2C_SCHED_DEFAULT;
+	}
+
+	dev_dbg(&client->dev,
+			"sff_8436_eeprom_update_client off %lld  page:%d phy_offset:%lld, count:%ld, opcode:%d\n",
+			off, page, phy_offset, (long int) count, opcode);
+	if (page > 0) {
+		ret = sff_8436_eeprom_write(port_data, client, page_class, &page,
+			SFF_8436_PAGE_SELECT_REG, 1);
+		if (ret < 0) {
+			dev_dbg(&client->dev,
+				"Write page register for page %d failed ret:%d!\n",
+					page, ret);
+			retval = ret;
+			goto exit;
+		}
+	}
+
+	while (count) {
+		ssize_t	status;
+
+		if (opcode == QSFP_READ_OP) {
+			status =  sff_8436_eeprom_read(port_data, client, class,
+				buf, phy_offset, count);
+		} else {
+			status =  sff_8436_eeprom_write(port_data, client, class,
+				buf, phy_offset, count);
+		}
+		if (status <= 0) {
+			if (retval == 0)
+				retval = status;
+			break;
+		}
+		buf += status;
+		phy_offset += status;
+		count -= status;
+		retval += status;
+	}
+
+
+	if (page > 0) {
+		/* return the page register to page 0 (why?) */
+		u8 page0 = 0;
+
+		ret = sff_8436_eeprom_write(port_data, client, page_class, &page0,
+			SFF_8436_PAGE_SELECT_REG, 1);
+		if (ret < 0) {
+			dev_err(&client->dev,
+				"Restore page register to page %d failed ret:%d!\n",
+					page0, ret);
+			retval = ret;
+		}
+	}
+
+exit:
+	if (accton_trace_started(start)) {
+		if (opcode == QSFP_READ_OP) {
+			trace_accton_eeprom_read(&client->dev, page, offset, len,
+									 accton_trace_duration(start), retval);
+		} else {
+			trace_accton_eeprom_write(&client->dev, page, offset, len,
+									  accton_trace_duration(start), retval);
+		}
+	}
+	return retval;
+}
+
+/*
+ * Figure out if this access is within the range of supported pages.
+ * Note this is called on every access because we don't know if the
+ * module has been replaced since the last call.
+ * If/when modules support more pages, this is the routine to update
+ * to validate and allow access to additional pages.
+ *
+ * Returns updated len for this access:
+ *     - entire access is legal, original len is returned.
+ *     - access begins legal but is too long, len is truncated to fit.
+ *     - initial offset exceeds supported pages, return -EINVAL
+ */
+static ssize_t sff_8436_page_legal(struct sfp_port_data *port_data,
+		loff_t off, size_t len)
+{
+	struct i2c_client *client = port_data->client;
+	u8 regval;
+	int status;
+	size_t maxlen;
+
+	if (off < 0) return -EINVAL;
+	if (port_data->desc->type == SFP_CORE_PORT_SFP) {
+		/* SFP case */
+		/* if no pages needed, we're good */
+		if ((off + len) <= SFF_8472_EEPROM_UNPAGED_SIZE) return len;
+		/* if offset exceeds possible pages, we're not good */
+		if (off >= SFF_8472_EEPROM_SIZE) return -EINVAL;
+		/* in between, are pages supported? */
+		status = sff_8436_eeprom_read(port_data, client, I2C_SCHED_CONTROL, &regval,
+				SFF_8472_PAGEABLE_REG, 1);
+		if (status < 0) return status;  /* error out (no module?) */
+		if (regval & SFF_8472_PAGEABLE) {
+			/* Pages supported, trim len to the end of pages */
+			maxlen = SFF_8472_EEPROM_SIZE - off;
+		} else {
+			/* pages not supported, trim len to unpaged size */
+			maxlen = SFF_8472_EEPROM_UNPAGED_SIZE - off;
+		}
+		len = (len > maxlen) ? maxlen : len;
+		dev_dbg(&client->dev,
+			"page_legal, SFP, off %lld len %ld\n",
+			off, (long int) len);
+	}
+	else {
+		/* QSFP case */
+		/* if no pages needed, we're good */
+		if ((off + len) <= SFF_8436_EEPROM_UNPAGED_SIZE) return len;
+		/* if offset exceeds possible pages, we're not good */
+		if (off >= SFF_8436_EEPROM_SIZE) return -EINVAL;
+		/* in between, are pages supported? */
+		status = sff_8436_eeprom_read(port_data, client, I2C_SCHED_CONTROL, &regval,
+				SFF_8436_PAGEABLE_REG, 1);
+		if (status < 0) return status;  /* error out (no module?) */
+		if (regval & SFF_8436_NOT_PAGEABLE) {
+			/* pages not supported, trim len to unpaged size */
+			maxlen = SFF_8436_EEPROM_UNPAGED_SIZE - off;
+		} else {
+			/* Pages supported, trim len to the end of pages */
+			maxlen = SFF_8436_EEPROM_SIZE - off;
+		}
+		len = (len > maxlen) ? maxlen : len;
+		dev_dbg(&client->dev,
+			"page_legal, QSFP, off %lld len %ld\n",
+			off, (long int) len);
+	}
+	return len;
+}
+
+static ssize_t sfp_port_read_write(struct sfp_port_data *port_data,
+		char *buf, loff_t off, size_t len, qsfp_opcode_e opcode)
+{
+	struct i2c_client *client = port_data->client;
+	int chunk;
+	int status = 0;
+	ssize_t retval, legal_len;
+	size_t pending_len = 0, chunk_len = 0;
+	loff_t chunk_offset = 0, chunk_start_offset = 0;
+
+	if (unlikely(!len))
+		return len;
+
+	/*
+	 * Read data from chip, protecting against concurrent updates
+	 * from this host, but not from other I2C masters.
+	 */
+	mutex_lock(&port_data->update_lock);
+
+	/*
+	 * Confirm this access fits within the device suppored addr range
+	 */
+	legal_len = sff_8436_page_legal(port_data, off, len);
+	if (legal_len < 0) {
+		status = legal_len;
+		goto err;
+	}
+	len = legal_len;
+
+	/*
+	 * For each (128 byte) chunk involved in this request, issue a
+	 * separate call to sff_eeprom_update_client(), to
+	 * ensure that each access recalculates the client/page
+	 * and writes the page register as needed.
+	 * Note that chunk to page mapping is confusing, is different for
+	 * QSFP and SFP, and never needs to be done.  Don't try!
+	 */
+	pending_len = len; /* amount remaining to transfer */
+	retval = 0;  /* amount transferred */
+	for (chunk = off >> 7; chunk <= (off + len - 1) >> 7; chunk++) {
+
+		/*
+		 * Compute the offset and number of bytes to be read/write
+		 *
+		 * 1. start at offset 0 (within the chunk), and read/write
+		 *    the entire chunk
+		 * 2. start at offset 0 (within the chunk) and read/write less
+		 *    than entire chunk
+		 * 3. start at an offset not equal to 0 and read/write the rest
+		 *    of the chunk
+		 * 4. start at an offset not equal to 0 and read/write less than
+		 *    (end of chunk - offset)
+		 */
+		chunk_start_offset = chunk * SFF_8436_PAGE_SIZE;
+
+		if (chunk_start_offset < off) {
+			chunk_offset = off;
+			if ((off + pending_len) < (chunk_start_offset +
+					SFF_8436_PAGE_SIZE))
+				chunk_len = pending_len;
+			else
+				chunk_len = (chunk+1)*SFF_8436_PAGE_SIZE - off;
+		} else {
+			chunk_offset = chunk_start_offset;
+			if (pending_len > SFF_8436_PAGE_SIZE)
+				chunk_len = SFF_8436_PAGE_SIZE;
+			else
+				chunk_len = pending_len;
+		}
+
+		dev_dbg(&client->dev,
+			"sff_r/w: off %lld, len %ld, chunk_start_offset %lld, chunk_offset %lld, chunk_len %ld, pending_len %ld\n",
+			off, (long int) len, chunk_start_offset, chunk_offset,
+			(long int) chunk_len, (long int) pending_len);
+
+		/*
+		 * note: chunk_offset is from the start of the EEPROM,
+		 * not the start of the chunk
+		 */
+		status = sff_8436_eeprom_update_client(port_data, buf,
+				chunk_offset, chunk_len, opcode);
+		if (status != chunk_len) {
+			/* This is another 'no device present' path */
+			dev_dbg(&client->dev,
+	"sff_8436_update_client for chunk %d chunk_offset %lld chunk_len %ld failed %d!\n",
+				chunk, chunk_offset, (long int) chunk_len, status);
+			if (status >= 0)
+				status = -EIO;
+			goto err;
+		}
+		buf += status;
+		pending_len -= status;
+		retval += status;
+	}
+	mutex_unlock(&port_data->update_lock);
+
+	return retval;
+
+err:
+	mutex_unlock(&port_data->update_lock);
+
+	return status;
+}
+
+/*-------------------------------------------------------------------------*/
+/* Static EEPROM copy and bulk scan */
+
+static loff_t sfp_static_offset(struct sfp_port_data *data)
+{
+	return (data->desc->type == SFP_CORE_PORT_SFP) ? 0 : SFF_8436_PAGE_SIZE;
+}
+
+static size_t sfp_static_len(struct sfp_port_data *data)
+{
+	return SFP_STATIC_SIZE - sfp_static_offset(data);
+}
+
+/* Returns count if the whole range was served from the copy, 0 otherwise */
+static ssize_t sfp_static_read(struct sfp_port_data *data, char *buf,
+		loff_t off, size_t count)
+{
+	loff_t start = sfp_static_offset(data);
+	ssize_t ret = 0;
+
+	if (!scan_cache || off < start || off + count > SFP_STATIC_SIZE)
+		return 0;
+
+	/* Looks at the present bit, so that a swap is noticed by the sync */
+	if (sfp_port_present(data, SFP_PRESENT_CACHE_AGE) != 1)
+		return 0;
+
+	mutex_lock(&data->update_lock);
+	sfp_present_sync(data);
+	if (data->static_valid) {
+		memcpy(buf, data->static_buf + off, count);
+		ret = count;
+	}
+	mutex_unlock(&data->update_lock);
+
+	i2c_stats_cache(data->stats, ret != 0);
+
+	return ret;
+}
+
+static void sfp_scan_port(struct sfp_port_data *data)
+{
+	loff_t off = sfp_static_offset(data);
+	size_t len = sfp_static_len(data);
+	u8 buf[SFP_STATIC_SIZE];
+	unsigned int gen;
+	ssize_t status;
+
+	mutex_lock(&data->update_lock);
+	sfp_present_sync(data);
+	gen = data->static_gen;
+	mutex_unlock(&data->update_lock);
+
+	if (sfp_port_present(data, SFP_PRESENT_CACHE_AGE) != 1) {
+		mutex_lock(&data->update_lock);
+		sfp_present_invalidate(data);
+		mutex_unlock(&data->update_lock);
+		return;
+	}
+
+	status = sfp_port_read_write(data, buf, off, len, QSFP_READ_OP);
+
+	mutex_lock(&data->update_lock);
+	/* Don't publish a copy that a write or reset raced with */
+	if (status == len && gen == data->static_gen) {
+		memcpy(data->static_buf + off, buf, len);
+		data->static_valid = 1;
+	}
+	mutex_unlock(&data->update_lock);
+}
+
+struct sfp_scan_group {
+	struct work_struct		work;
+	struct i2c_adapter	   *root;
+	struct sfp_port_data   *ports;
+};
+
+static void sfp_scan_work(struct work_struct *work)
+{
+	struct sfp_scan_group *g = container_of(work, struct sfp_scan_group, work);
+	struct sfp_port_data *data;
+
+	for (data = g->ports; data; data = data->scan_next)
+		sfp_scan_port(data);
+}
+
+static struct i2c_adapter *sfp_root_adapter(struct i2c_adapter *adap)
+{
+	struct i2c_adapter *parent;
+
+	while ((parent = i2c_parent_is_i2c_adapter(adap)) != NULL)
+		adap = parent;
+
+	return adap;
+}
+
+/*
+ * Read the static EEPROM area of every present module.  Ports behind
+ * different root adapters don't share a bus, so each root gets its own
+ * worker and the trees are walked concurrently; ports behind one root
+ * are read in turn since their mux channels can't be open together.
+ */
+static int sfp_scan_all(void)
+{
+	struct sfp_scan_group *groups;
+	struct sfp_port_data *data;
+	struct i2c_adapter *root;
+	int i, num = 0, ngroups = 0;
+
+	mutex_lock(&sfp_ports_lock);
+
+	list_for_each_entry(data, &sfp_ports, list)
+		num++;
+
+	groups = kcalloc(num ? num : 1, sizeof(*groups), GFP_KERNEL);
+	if (!groups) {
+		mutex_unlock(&sfp_ports_lock);
+		return -ENOMEM;
+	}
+
+	list_for_each_entry(data, &sfp_ports, list) {
+		root = sfp_root_adapter(data->client->adapter);
+
+		for (i = 0; i < ngroups && groups[i].root != root; i++)
+			;
+
+		if (i == ngroups) {
+			groups[i].root = root;
+			INIT_WORK(&groups[i].work, sfp_scan_work);
+			ngroups++;
+		}
+
+		data->scan_next = groups[i].ports;
+		groups[i].ports = data;
+	}
+
+	for (i = 0; i < ngroups; i++)
+		queue_work(system_unbound_wq, &groups[i].work);
+
+	for (i = 0; i < ngroups; i++)
+		flush_work(&groups[i].work);
+
+	mutex_unlock(&sfp_ports_lock);
+	kfree(groups);
+	return 0;
+}
+
+/* Any write to /sys/module/accton_sfp_core/parameters/scan runs a scan */
+static int sfp_scan_set(const char *val, const struct kernel_param *kp)
+{
+	return sfp_scan_all();
+}
+
+static const struct kernel_param_ops sfp_scan_ops = {
+	.set = sfp_scan_set,
+};
+module_param_cb(scan, &sfp_scan_ops, NULL, S_IWUSR);
+MODULE_PARM_DESC(scan, "write to read the static EEPROM area of all present modules");
+
+/*-------------------------------------------------------------------------*/
+/* Group reset */
+
+/* SFF-8679 t_reset, the shortest ResetL pulse a module must accept */
+static unsigned int reset_hold_us = 10;
+module_param(reset_hold_us, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(reset_hold_us, "time the reset_ports group is held in reset, in us");
+
+/* Ports of the last group reset not seen ready yet, under sfp_ports_lock */
+static u64 reset_pending;
+
+/* One CPLD register holding reset bits of the group */
+struct sfp_reset_reg {
+	const struct sfp_core_platform *plat;
+	struct device  *dev;			/* first port of the register, for messages */
+	unsigned short	cpld_addr;
+	u8				reg;
+	u8				mask;
+	int				asserted;
+};
+
+/* Same format as sfp_is_present_all: "ff ff 0f", ports 0~7 first */
+static int sfp_parse_bitmap(const char *val, u64 *bitmap)
+{
+	unsigned int byte;
+	int i = 0, n;
+
+	*bitmap = 0;
+	while (*(val = skip_spaces(val))) {
+		if (i >= SFP_CORE_MAX_PORTS / 8 || sscanf(val, "%2x%n", &byte, &n) != 1)
+			return -EINVAL;
+
+		*bitmap |= (u64)byte << (i * 8);
+		val += n;
+		i++;
+	}
+
+	return i ? 0 : -EINVAL;
+}
+
+/*
+ * Put all the ports of bitmap in reset together: one read-modify-write
+ * per CPLD register to assert, one reset_hold_us wait, one more write
+ * per register to release them.
+ */
+static int sfp_reset_group(u64 bitmap)
+{
+	struct sfp_reset_reg *regs;
+	struct sfp_port_data *data;
+	const struct sfp_cpld_bit *b;
+	int i, val, num = 0, nregs = 0, status = 0;
+
+	mutex_lock(&sfp_ports_lock);
+
+	list_for_each_entry(data, &sfp_ports, list)
+		num++;
+
+	regs = kcalloc(num ? num : 1, sizeof(*regs), GFP_KERNEL);
+	if (!regs) {
+		mutex_unlock(&sfp_ports_lock);
+		return -ENOMEM;
+	}
+
+	list_for_each_entry(data, &sfp_ports, list) {
+		b = &data->desc->reset;
+		if (!(bitmap & BIT_INDEX(data->port)) || !b->cpld_addr)
+			continue;
+
+		for (i = 0; i < nregs; i++) {
+			if (regs[i].plat == data->plat && regs[i].cpld_addr == b->cpld_addr &&
+				regs[i].reg == b->reg)
+				break;
+		}
+
+		if (i == nregs) {
+			regs[i].plat = data->plat;
+			regs[i].dev = &data->client->dev;
+			regs[i].cpld_addr = b->cpld_addr;
+			regs[i].reg = b->reg;
+			nregs++;
+		}
+
+		regs[i].mask |= 1 << b->bit;
+	}
+
+	/* CPLD defined 0 is reset state, 1 is normal state */
+	for (i = 0; i < nregs; i++) {
+		val = regs[i].plat->cpld_read(regs[i].cpld_addr, regs[i].reg);
+		if (val >= 0)
+			val = regs[i].plat->cpld_write(regs[i].cpld_addr, regs[i].reg, val & ~regs[i].mask);
+		if (val < 0) {
+			status = val;
+			break;
+		}
+		regs[i].asserted = 1;
+	}
+
+	/* usleep_range() is hrtimer based, HZ does not round the hold up */
+	if (nregs)
+		usleep_range(reset_hold_us, reset_hold_us + reset_hold_us / 2 + 1);
+
+	for (i = 0; i < nregs; i++) {
+		if (!regs[i].asserted)
+			continue;
+
+		val = regs[i].plat->cpld_read(regs[i].cpld_addr, regs[i].reg);
+		if (val >= 0)
+			val = regs[i].plat->cpld_write(regs[i].cpld_addr, regs[i].reg, val | regs[i].mask);
+		if (val < 0) {
+			dev_err(regs[i].dev, "unable to release reset, cpld(0x%x) reg(0x%x) err %d\n",
+					regs[i].cpld_addr, regs[i].reg, val);
+			status = val;
+		}
+	}
+
+	list_for_each_entry(data, &sfp_ports, list) {
+		if (!(bitmap & BIT_INDEX(data->port)) || !data->desc->reset.cpld_addr)
+			continue;
+
+		mutex_lock(&data->update_lock);
+		sfp_present_invalidate(data);
+		mutex_unlock(&data->update_lock);
+		reset_pending |= BIT_INDEX(data->port);
+	}
+
+	mutex_unlock(&sfp_ports_lock);
+	kfree(regs);
+	return status;
+}
+
+/*
+ * A module out of reset is ready once a QSFP clears Data_Not_Ready and an
+ * SFP answers at all.  An empty cage has nothing to wait for.
+ */
+static int sfp_port_ready(struct sfp_port_data *data)
+{
+	int qsfp = (data->desc->type == SFP_CORE_PORT_QSFP);
+	int status;
+
+	status = sfp_port_present(data, SFP_PRESENT_CACHE_AGE);
+	if (status <= 0) {
+		return (status == 0);
+	}
+
+	/* A single try, the caller polls */
+	status = i2c_stats_read_byte_data_class(data->stats, I2C_SCHED_CONTROL, data->client,
+				qsfp ? SFF8436_STATUS_ADDR : SFF8024_PHYSICAL_DEVICE_ID_ADDR);
+	if (status < 0) {
+		return 0;
+	}
+
+	return qsfp ? !(status & SFF8436_DATA_NOT_READY) : 1;
+}
+
+/* echo "ff ff ff ff" > /sys/module/accton_sfp_core/parameters/reset_ports */
+static int sfp_reset_ports_set(const char *val, const struct kernel_param *kp)
+{
+	u64 bitmap;
+	int status;
+
+	status = sfp_parse_bitmap(val, &bitmap);
+	if (status) {
+		return status;
+	}
+
+	return sfp_reset_group(bitmap);
+}
+
+static const struct kernel_param_ops sfp_reset_ports_ops = {
+	.set = sfp_reset_ports_set,
+};
+module_param_cb(reset_ports, &sfp_reset_ports_ops, NULL, S_IWUSR);
+MODULE_PARM_DESC(reset_ports, "write a port bitmap to reset those ports at once");
+
+/* 1 once every module of the last reset_ports group is ready */
+static int sfp_init_done_get(char *buffer, const struct kernel_param *kp)
+{
+	struct sfp_port_data *data;
+	int done;
+
+	mutex_lock(&sfp_ports_lock);
+
+	list_for_each_entry(data, &sfp_ports, list) {
+		if ((reset_pending & BIT_INDEX(data->port)) && sfp_port_ready(data))
+			reset_pending &= ~BIT_INDEX(data->port);
+	}
+	done = !reset_pending;
+
+	mutex_unlock(&sfp_ports_lock);
+
+	return sprintf(buffer, "%d", done);
+}
+
+static const struct kernel_param_ops sfp_init_done_ops = {
+	.get = sfp_init_done_get,
+};
+module_param_cb(init_done, &sfp_init_done_ops, NULL, S_IRUGO);
+MODULE_PARM_DESC(init_done, "1 once every module of the last reset_ports group is ready");
+
+static ssize_t sfp_bin_read_write(struct kobject *kobj, char *buf,
+		loff_t off, size_t count, qsfp_opcode_e opcode)
+{
+	int present;
+	struct sfp_port_data *data;
+	DEBUG_PRINT("offset = (%d), count = (%d)", off, count);
+
+	data = dev_get_drvdata(container_of(kobj, struct device, kobj));
+	present = sfp_is_port_present(data->client, data->port);
+	if (IS_ERR_VALUE(present)) {
+		return present;
+	}
+
+	if (present == 0) {
+		/* port is not present */
+		mutex_lock(&data->update_lock);
+		sfp_present_invalidate(data);
+		mutex_unlock(&data->update_lock);
+		return -ENODEV;
+	}
+
+	if (opcode == QSFP_READ_OP) {
+		ssize_t cached = sfp_static_read(data, buf, off, count);
+
+		if (cached)
+			return cached;
+	}
+	else {
+		mutex_lock(&data->update_lock);
+		sfp_static_invalidate(data);
+		mutex_unlock(&data->update_lock);
+	}
+
+	return sfp_port_read_write(data, buf, off, count, opcode);
+}
+
+static ssize_t sfp_bin_read(struct file *filp, struct kobject *kobj,
+		struct bin_attribute *attr,
+		char *buf, loff_t off, size_t count)
+{
+	return sfp_bin_read_write(kobj, buf, off, count, QSFP_READ_OP);
+}
+
+static ssize_t sfp_bin_write(struct file *filp, struct kobject *kobj,
+				struct bin_attribute *attr,
+				char *buf, loff_t off, size_t count)
+{
+	return sfp_bin_read_write(kobj, buf, off, count, QSFP_WRITE_OP);
+}
+
+static int sfp_sysfs_eeprom_init(struct kobject *kobj, struct bin_attribute *eeprom, size_t size)
+{
+	sysfs_bin_attr_init(eeprom);
+	eeprom->attr.name = EEPROM_NAME;
+	eeprom->attr.mode = S_IWUSR | S_IRUGO;
+	eeprom->read	  = sfp_bin_read;
+	eeprom->write	  = sfp_bin_write;
+	eeprom->size	  = size;
+
+	/* Create eeprom file */
+	return sysfs_create_bin_file(kobj, eeprom);
+}
+
+static int sfp_sysfs_eeprom_cleanup(struct kobject *kobj, struct bin_attribute *eeprom)
+{
+	sysfs_remove_bin_file(kobj, eeprom);
+	return 0;
+}
+
+/*-------------------------------------------------------------------------*/
+
+/*
+ * Everything of a port but its memory, stats and telemetry source, which
+ * a chassis shares between its ports: the caller sets data->stats and
+ * data->tlm first.
+ */
+static int sfp_port_init(struct sfp_port_data *data, struct i2c_client *client,
+			const struct sfp_core_platform *plat, int port)
+{
+	int ret = 0;
+
+	data->use_smbus = 0;
+
+	/* Use I2C operations unless we're stuck with SMBus extensions. */
+	if (!i2c_check_functionality(client->adapter, I2C_FUNC_I2C)) {
+		if (i2c_check_functionality(client->adapter,
+				I2C_FUNC_SMBUS_READ_I2C_BLOCK)) {
+			data->use_smbus = I2C_SMBUS_I2C_BLOCK_DATA;
+		} else if (i2c_check_functionality(client->adapter,
+				I2C_FUNC_SMBUS_READ_WORD_DATA)) {
+			data->use_smbus = I2C_SMBUS_WORD_DATA;
+		} else if (i2c_check_functionality(client->adapter,
+				I2C_FUNC_SMBUS_READ_BYTE_DATA)) {
+			data->use_smbus = I2C_SMBUS_BYTE_DATA;
+		} else {
+			return -EPFNOSUPPORT;
+		}
+	}
+
+	if (!data->use_smbus ||
+			(i2c_check_functionality(client->adapter,
+				I2C_FUNC_SMBUS_WRITE_I2C_BLOCK)) ||
+			i2c_check_functionality(client->adapter,
+				I2C_FUNC_SMBUS_WRITE_WORD_DATA) ||
+			i2c_check_functionality(client->adapter,
+				I2C_FUNC_SMBUS_WRITE_BYTE_DATA)) {
+		/*
+		 * NOTE: AN-2079
+		 * Finisar recommends that the host implement 1 byte writes
+		 * only since this module only supports 32 byte page boundaries.
+		 * 2 byte writes are acceptable for PE and Vout changes per
+		 * Application Note AN-2071.
+		 */
+		unsigned write_max = 1;
+
+		if (write_max > io_limit)
+			write_max = io_limit;
+		if (data->use_smbus && write_max > I2C_SMBUS_BLOCK_MAX)
+			write_max = I2C_SMBUS_BLOCK_MAX;
+		data->write_max = write_max;
+
+		/* buffer (data + address at the beginning) */
+		data->writebuf = kmalloc(write_max + 2, GFP_KERNEL);
+		if (!data->writebuf) {
+			return -ENOMEM;
+		}
+	} else {
+			dev_warn(&client->dev,
+				"cannot write due to controller restrictions.");
+	}
+
+	if (data->use_smbus == I2C_SMBUS_WORD_DATA ||
+	    data->use_smbus == I2C_SMBUS_BYTE_DATA) {
+		dev_notice(&client->dev, "Falling back to %s reads, "
+			   "performance will suffer\n", data->use_smbus ==
+			   I2C_SMBUS_WORD_DATA ? "word" : "byte");
+	}
+
+	i2c_set_clientdata(client, data);
+	mutex_init(&data->update_lock);
+	data->plat	 = plat;
+	data->desc	 = &plat->ports[port];
+	data->port	 = port;
+	data->client = client;
+	data->update_interval = SFP_STATUS_UPDATE_INTERVAL;
+
+	if (data->desc->type == SFP_CORE_PORT_SFP) {
+		data->ddm_client = i2c_new_dummy(client->adapter, client->addr + 1);
+		if (!data->ddm_client) {
+			dev_err(&client->dev, "address 0x%02x unavailable\n", client->addr + 1);
+			ret = -EADDRINUSE;
+			goto exit_kfree_buf;
+		}
+	}
+
+	/* Register sysfs hooks */
+	ret = sysfs_create_group(&client->dev.kobj, &sfp_group);
+	if (ret) {
+		goto exit_ddm;
+	}
+
+	/* init eeprom */
+	ret = sfp_sysfs_eeprom_init(&client->dev.kobj, &data->eeprom,
+			(data->desc->type == SFP_CORE_PORT_SFP) ?
+			SFF_8472_EEPROM_SIZE : SFF_8436_EEPROM_SIZE);
+	if (ret) {
+		goto exit_remove;
+	}
+
+	if (data->desc->type == SFP_CORE_PORT_QSFP) {
+		ret = sysfs_create_bin_file(&client->dev.kobj, &qsfp_snapshot_attr);
+		if (ret) {
+			goto exit_eeprom;
+		}
+	}
+
+	mutex_lock(&sfp_ports_lock);
+	list_add_tail(&data->list, &sfp_ports);
+	mutex_unlock(&sfp_ports_lock);
+
+	return 0;
+
+exit_eeprom:
+	sfp_sysfs_eeprom_cleanup(&client->dev.kobj, &data->eeprom);
+exit_remove:
+	sysfs_remove_group(&client->dev.kobj, &sfp_group);
+exit_ddm:
+	if (data->ddm_client)
+		i2c_unregister_device(data->ddm_client);
+exit_kfree_buf:
+	kfree(data->writebuf);
+	return ret;
+}
+
+static void sfp_port_exit(struct sfp_port_data *data)
+{
+	struct i2c_client *client = data->client;
+
+	/* Waits for a running scan */
+	mutex_lock(&sfp_ports_lock);
+	list_del(&data->list);
+	reset_pending &= ~BIT_INDEX(data->port);
+	mutex_unlock(&sfp_ports_lock);
+
+	if (data->desc->type == SFP_CORE_PORT_QSFP) {
+		sysfs_remove_bin_file(&client->dev.kobj, &qsfp_snapshot_attr);
+	}
+	sfp_sysfs_eeprom_cleanup(&client->dev.kobj, &data->eeprom);
+	sysfs_remove_group(&client->dev.kobj, &sfp_group);
+	if (data->ddm_client)
+		i2c_unregister_device(data->ddm_client);
+	kfree(data->writebuf);
+}
+
+int sfp_core_probe(struct i2c_client *client,
+				   const struct sfp_core_platform *plat, int port)
+{
+	struct sfp_port_data *data;
+	int ret;
+
+	if (client->addr != SFP_EEPROM_A0_I2C_ADDR) {
+		return -ENODEV;
+	}
+
+	if (port < 0 || port >= plat->num_ports || port >= SFP_CORE_MAX_PORTS) {
+		return -ENXIO;
+	}
+
+	data = kzalloc(sizeof(struct sfp_port_data), GFP_KERNEL);
+	if (!data) {
+		return -ENOMEM;
+	}
+
+	data->stats = i2c_stats_register(&client->dev);
+	data->tlm	= accton_tlm_register(&client->dev, ACCTON_TLM_KIND_PRESENCE);
+	i2c_stats_set_class(data->stats, I2C_SCHED_BULK);
+
+	ret = sfp_port_init(data, client, plat, port);
+	if (ret) {
+		accton_tlm_unregister(data->tlm);
+		i2c_stats_unregister(data->stats);
+		kfree(data);
+		return ret;
+	}
+
+	dev_info(&client->dev, "%s %s '%s'\n", plat->name,
+		(data->desc->type == SFP_CORE_PORT_SFP) ? "sfp" : "qsfp", client->name);
+
+	return 0;
+}
+EXPORT_SYMBOL(sfp_core_probe);
+
+int sfp_core_remove(struct i2c_client *client)
+{
+	struct sfp_port_data *data = i2c_get_clientdata(client);
+
+	sfp_port_exit(data);
+	accton_tlm_unregister(data->tlm);
+	i2c_stats_unregister(data->stats);
+	kfree(data);
+	return 0;
+}
+EXPORT_SYMBOL(sfp_core_remove);
+
+/*-------------------------------------------------------------------------*/
+/* Chassis drivers */
+
+/* How often the worker reads presence and reset of every port */
+#define SFP_CHASSIS_REFRESH_INTERVAL	(HZ / 2)
+
+struct sfp_chassis {
+	const struct sfp_core_platform *plat;
+	struct device		   *dev;
+	struct i2c_stats	   *stats;		/* of every port */
+	struct accton_tlm	   *tlm;		/* one presence source for all */
+	struct delayed_work		refresh;
+
+	struct mutex			lock;		/* of the bitmaps */
+	char					valid;
+	unsigned long			last_updated;	/* In jiffies */
+	u64						present_mask;	/* ports with the signal wired */
+	u64						reset_mask;
+	u64						present;		/* bit0:port0 and so on */
+	u64						reset;			/* held in reset */
+
+	int						num_ports;		/* of ports[] initialised */
+	struct sfp_port_data	ports[];		/* plat->num_ports */
+};
+
+/* Both signals of every port, one CPLD read per register */
+static int sfp_chassis_update(struct sfp_chassis *ch)
+{
+	const struct sfp_core_platform *plat = ch->plat;
+	struct accton_tlm_value v[2];
+	u64 absent, released = ~0ULL, removed;
+	int i, status;
+
+	status = sfp_read_cpld_bitmap(plat, ch->dev, SFP_SIGNAL(present), &absent);
+	if (status == 0 && ch->reset_mask) {
+		status = sfp_read_cpld_bitmap(plat, ch->dev, SFP_SIGNAL(reset), &released);
+	}
+	if (status < 0) {
+		return status;
+	}
+
+	/* Both are active low */
+	mutex_lock(&ch->lock);
+	removed = ch->valid ? (ch->present & absent) : 0;
+	ch->present = ~absent & ch->present_mask;
+	ch->reset = ~released & ch->reset_mask;
+	ch->valid = 1;
+	ch->last_updated = jiffies;
+
+	v[0].name = "present";
+	v[0].index = 0;
+	v[0].data = ch->present;
+	v[1].name = "reset";
+	v[1].index = 0;
+	v[1].data = ch->reset;
+	mutex_unlock(&ch->lock);
+
+	accton_tlm_publish(ch->tlm, v, ARRAY_SIZE(v), NULL, 0);
+
+	/* What was kept of a module that went away is no longer its own */
+	for (i = 0; i < ch->num_ports; i++) {
+		if (removed & BIT_INDEX(i)) {
+			mutex_lock(&ch->ports[i].update_lock);
+			sfp_present_invalidate(&ch->ports[i]);
+			mutex_unlock(&ch->ports[i].update_lock);
+		}
+	}
+
+	return 0;
+}
+
+static void sfp_chassis_refresh(struct work_struct *work)
+{
+	struct sfp_chassis *ch = container_of(to_delayed_work(work),
+										  struct sfp_chassis, refresh);
+
+	sfp_chassis_update(ch);
+	schedule_delayed_work(&ch->refresh, SFP_CHASSIS_REFRESH_INTERVAL);
+}
+
+static ssize_t sfp_chassis_show(struct device *dev, struct device_attribute *da,
+			 char *buf)
+{
+	struct sensor_device_attribute *attr = to_sensor_dev_attr(da);
+	struct sfp_chassis *ch = dev_get_drvdata(dev);
+	u64 bitmap;
+	int status = 0;
+
+	mutex_lock(&ch->lock);
+	if (!ch->valid || time_after(jiffies, ch->last_updated + SFP_PRESENT_CACHE_AGE)) {
+		mutex_unlock(&ch->lock);
+		status = sfp_chassis_update(ch);
+		mutex_lock(&ch->lock);
+	}
+	bitmap = (attr->index == PRESENT_ALL) ? ch->present : ch->reset;
+	mutex_unlock(&ch->lock);
+
+	if (status < 0) {
+		return status;
+	}
+
+	return sfp_show_bitmap(buf, bitmap, ch->plat->num_ports);
+}
+
+/* A bitmap as sfp_is_present_all, every port in it is reset together */
+static ssize_t sfp_chassis_set_reset(struct device *dev, struct device_attribute *da,
+			const char *buf, size_t count)
+{
+	u64 bitmap;
+	int status;
+
+	status = sfp_parse_bitmap(buf, &bitmap);
+	if (status) {
+		return status;
+	}
+
+	status = sfp_reset_group(bitmap);
+	return (status < 0) ? status : count;
+}
+
+static SENSOR_DEVICE_ATTR(chassis_present_all, S_IRUGO, sfp_chassis_show, NULL, PRESENT_ALL);
+static SENSOR_DEVICE_ATTR(chassis_reset_all, S_IWUSR | S_IRUGO, sfp_chassis_show,
+			sfp_chassis_set_reset, PORT_RESET);
+
+static struct attribute *sfp_chassis_attributes[] = {
+	&sensor_dev_attr_chassis_present_all.dev_attr.attr,
+	&sensor_dev_attr_chassis_reset_all.dev_attr.attr,
+	NULL
+};
+
+static const struct attribute_group sfp_chassis_group = {
+	.attrs = sfp_chassis_attributes,
+};
+
+static void sfp_chassis_free_ports(struct sfp_chassis *ch)
+{
+	struct i2c_client *client;
+
+	while (ch->num_ports) {
+		client = ch->ports[--ch->num_ports].client;
+		sfp_port_exit(&ch->ports[ch->num_ports]);
+		i2c_unregister_device(client);
+	}
+}
+
+int sfp_core_chassis_probe(struct device *dev, const struct sfp_core_platform *plat)
+{
+	struct sfp_chassis *ch;
+	int i, ret;
+
+	if (plat->num_ports > SFP_CORE_MAX_PORTS) {
+		return -ENXIO;
+	}
+
+	/* Every bus first, so a deferred probe leaves nothing behind */
+	for (i = 0; i < plat->num_ports; i++) {
+		struct i2c_adapter *adap = i2c_get_adapter(plat->ports[i].bus);
+
+		if (!adap) {
+			dev_dbg(dev, "port %d: no i2c-%d yet\n", CPLD_PORT_TO_FRONT_PORT(i),
+					plat->ports[i].bus);
+			return -EPROBE_DEFER;
+		}
+		i2c_put_adapter(adap);
+	}
+
+	/* One block for the state of every port, 64 of them do not fit kmalloc well */
+	ch = vzalloc(sizeof(*ch) + plat->num_ports * sizeof(ch->ports[0]));
+	if (!ch) {
+		return -ENOMEM;
+	}
+
+	ch->plat = plat;
+	ch->dev	 = dev;
+	mutex_init(&ch->lock);
+	INIT_DELAYED_WORK(&ch->refresh, sfp_chassis_refresh);
+	ch->present_mask = sfp_cpld_bitmap_mask(plat, SFP_SIGNAL(present));
+	ch->reset_mask	 = sfp_cpld_bitmap_mask(plat, SFP_SIGNAL(reset));
+	ch->stats = i2c_stats_register(dev);
+	ch->tlm	  = accton_tlm_register(dev, ACCTON_TLM_KIND_PRESENCE);
+	i2c_stats_set_class(ch->stats, I2C_SCHED_BULK);
+	dev_set_drvdata(dev, ch);
+
+	for (i = 0; i < plat->num_ports; i++) {
+		struct sfp_port_data *data = &ch->ports[i];
+		struct i2c_adapter *adap;
+		struct i2c_client *client = NULL;
+
+		adap = i2c_get_adapter(plat->ports[i].bus);
+		if (adap) {
+			client = i2c_new_dummy(adap, SFP_EEPROM_A0_I2C_ADDR);
+			i2c_put_adapter(adap);
+		}
+		if (!client) {
+			dev_err(dev, "port %d: 0x%02x on i2c-%d unavailable\n",
+					CPLD_PORT_TO_FRONT_PORT(i), SFP_EEPROM_A0_I2C_ADDR, plat->ports[i].bus);
+			ret = -EADDRINUSE;
+			goto exit_ports;
+		}
+
+		/* Ports of a chassis don't publish presence, the chassis does */
+		data->stats = ch->stats;
+		ret = sfp_port_init(data, client, plat, i);
+		if (ret) {
+			i2c_unregister_device(client);
+			goto exit_ports;
+		}
+		ch->num_ports++;
+	}
+
+	ret = sysfs_create_group(&dev->kobj, &sfp_chassis_group);
+	if (ret) {
+		goto exit_ports;
+	}
+
+	schedule_delayed_work(&ch->refresh, 0);
+
+	dev_info(dev, "%s, %d ports\n", plat->name, plat->num_ports);
+	return 0;
+
+exit_ports:
+	sfp_chassis_free_ports(ch);
+	accton_tlm_unregister(ch->tlm);
+	i2c_stats_unregister(ch->stats);
+	dev_set_drvdata(dev, NULL);
+	vfree(ch);
+	return ret;
+}
+EXPORT_SYMBOL(sfp_core_chassis_probe);
+
+int sfp_core_chassis_remove(struct device *dev)
+{
+	struct sfp_chassis *ch = dev_get_drvdata(dev);
+
+	cancel_delayed_work_sync(&ch->refresh);
+	sysfs_remove_group(&dev->kobj, &sfp_chassis_group);
+	sfp_chassis_free_ports(ch);
+	accton_tlm_unregister(ch->tlm);
+	i2c_stats_unregister(ch->stats);
+	vfree(ch);
+	return 0;
+}
+EXPORT_SYMBOL(sfp_core_chassis_remove);
+
+MODULE_AUTHOR("Brandon Chuang <brandon_chuang@accton.com.tw>");
+MODULE_DESCRIPTION("accton sfp driver core");
+MODULE_LICENSE("GPL");
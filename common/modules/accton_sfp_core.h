@@ -0,0 +1,114 @@
+/*
+ * Common SFP/QSFP transceiver driver core for accton platforms
+ *
+ * Copyright (C)  Brandon Chuang <brandon_chuang@accton.com.tw>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#ifndef __ACCTON_SFP_CORE_H__
+#define __ACCTON_SFP_CORE_H__
+
+#include <linux/types.h>
+#include <linux/i2c.h>
+
+#define SFP_CORE_MAX_PORTS	64	/* port bitmaps are u64 */
+
+/*
+ * One sideband signal of a port: CPLD address, register and bit.
+ * A zero cpld_addr means the signal is not wired on this platform
+ * and the matching sysfs attribute is hidden.
+ */
+struct sfp_cpld_bit {
+	unsigned short	cpld_addr;
+	u8				reg;
+	u8				bit;
+};
+
+enum sfp_core_port_type {
+	SFP_CORE_PORT_SFP,	/* SFF-8472, tx/rx status from the CPLD */
+	SFP_CORE_PORT_QSFP	/* SFF-8436/8636, tx/rx status from the module */
+};
+
+/*
+ * Per port wiring.  CPLD polarity is the same on every supported board:
+ * present and reset are active low, tx_disable/tx_fault/rx_los are
+ * active high.
+ */
+struct sfp_core_port {
+	enum sfp_core_port_type	type;
+	struct sfp_cpld_bit		present;
+	struct sfp_cpld_bit		reset;
+	struct sfp_cpld_bit		tx_disable;
+	struct sfp_cpld_bit		tx_fault;
+	struct sfp_cpld_bit		rx_los;
+	int						bus;	/* i2c bus of the EEPROM, chassis drivers only */
+};
+
+/*
+ * sysfs names of the drivers the core replaced, kept for their platforms:
+ * sfp_tx_disable_all (all four lanes, reads 1 only if all are disabled)
+ * next to sfp_tx_disable, and sfp_mod_rst (the raw CPLD bit, 0 is held
+ * in reset) instead of sfp_port_reset.
+ */
+#define SFP_CORE_COMPAT_TX_DISABLE_ALL	(1 << 0)
+#define SFP_CORE_COMPAT_MOD_RST			(1 << 1)
+
+struct sfp_core_platform {
+	const char					*name;
+	int							num_ports;
+	const struct sfp_core_port	*ports;		/* num_ports entries */
+
+	int (*cpld_read)(unsigned short cpld_addr, u8 reg);
+	int (*cpld_write)(unsigned short cpld_addr, u8 reg, u8 value);
+
+	int	retry_count;		/* I2C retries for module access */
+	int	retry_interval;		/* ms */
+
+	unsigned int	compat;	/* SFP_CORE_COMPAT_* */
+};
+
+/* Table helpers for the platform drivers */
+#define SFP_CPLD_BIT(_addr, _reg, _bit) \
+	{ .cpld_addr = (_addr), .reg = (_reg), .bit = (_bit) }
+
+/* Port 'n' of a bank of ports laid out 8 per register from _reg on */
+#define SFP_CPLD_BANK_BIT(_addr, _reg, n) \
+	SFP_CPLD_BIT(_addr, (_reg) + (n) / 8, (n) % 8)
+
+int sfp_core_probe(struct i2c_client *client,
+				   const struct sfp_core_platform *plat, int port);
+int sfp_core_remove(struct i2c_client *client);
+
+/*
+ * Feeds a presence register read outside the core, e.g. by a CPLD
+ * presence worker, to the core's presence cache so that a module swap
+ * seen there drops what was cached from the old module.  Optional for
+ * the caller, take it with symbol_get().
+ */
+void sfp_core_present_update(unsigned short cpld_addr, u8 reg, u8 value);
+
+/*
+ * A chassis driver owns every port of the platform from one device
+ * instead of one i2c_client per port.  The EEPROM clients are created
+ * on each port's bus, so the per port sysfs files stay where they were;
+ * presence and reset of all ports are kept as bitmaps, refreshed by one
+ * worker and exported batched on 'dev'.  -EPROBE_DEFER until every bus
+ * exists, and the chassis must go before the muxes that carry them.
+ */
+int sfp_core_chassis_probe(struct device *dev, const struct sfp_core_platform *plat);
+int sfp_core_chassis_remove(struct device *dev);
+
+#endif /* __ACCTON_SFP_CORE_H__ */
@@ -0,0 +1,425 @@
+/*
+ * Generic netlink telemetry of the accton platform drivers
+ *
+ * Copyright (C) 2018 Accton Technology Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include <linux/module.h>
+#include <linux/init.h>
+#include <linux/slab.h>
+#include <linux/list.h>
+#include <linux/mutex.h>
+#include <linux/string.h>
+#include <linux/ktime.h>
+#include <linux/fs.h>
+#include <linux/mm.h>
+#include <linux/vmalloc.h>
+#include <linux/miscdevice.h>
+#include <net/genetlink.h>
+#include "accton_telemetry.h"
+
+struct accton_tlm {
+	struct list_head		list;
+	char					source[32];
+	u8						kind;
+	u32						seq;
+	u64						timestamp;
+	int						count;
+	struct accton_tlm_value	values[ACCTON_TLM_MAX_VALUES];
+	size_t					blob_len;
+	u8						blob[ACCTON_TLM_MAX_BLOB];
+	struct accton_tlm_map_slot	*slot;	/* NULL if all were taken */
+};
+
+/* Guards the list, every sample on it and the mapped region */
+static DEFINE_MUTEX(tlm_lock);
+static LIST_HEAD(tlm_sources);
+
+/* vmalloc_user() memory, so zeroed: no slot is taken at first */
+static void *tlm_map;
+
+static struct accton_tlm_map_header *tlm_map_header(void)
+{
+	return tlm_map;
+}
+
+static struct accton_tlm_map_slot *tlm_map_slot(int i)
+{
+	return tlm_map + ACCTON_TLM_MAP_SLOTS_OFFSET + i * ACCTON_TLM_MAP_SLOT_SIZE;
+}
+
+/* Called with tlm_lock held, which makes it the only writer */
+static void tlm_map_begin(struct accton_tlm_map_slot *slot)
+{
+	slot->seq++;
+	smp_wmb();
+}
+
+static void tlm_map_end(struct accton_tlm_map_slot *slot)
+{
+	smp_wmb();
+	slot->seq++;
+}
+
+/* Called with tlm_lock held */
+static void tlm_map_store(struct accton_tlm *t)
+{
+	struct accton_tlm_map_slot *slot = t->slot;
+	int i;
+
+	if (!slot) {
+		return;
+	}
+
+	tlm_map_begin(slot);
+	slot->changes = t->seq;
+	slot->timestamp = t->timestamp;
+	slot->count = t->count;
+	for (i = 0; i < t->count; i++) {
+		strncpy(slot->values[i].name, t->values[i].name, ACCTON_TLM_NAME_LEN - 1);
+		slot->values[i].index = t->values[i].index;
+		slot->values[i].data = t->values[i].data;
+	}
+	slot->blob_len = t->blob_len;
+	memcpy(slot->blob, t->blob, t->blob_len);
+	tlm_map_end(slot);
+}
+
+/* Called with tlm_lock held */
+static void tlm_map_attach(struct accton_tlm *t)
+{
+	struct accton_tlm_map_slot *slot;
+	int i;
+
+	for (i = 0; i < ACCTON_TLM_MAX_SLOTS; i++) {
+		slot = tlm_map_slot(i);
+		if (slot->kind) {
+			continue;
+		}
+
+		tlm_map_begin(slot);
+		memset((u8 *)slot + sizeof(slot->seq), 0, sizeof(*slot) - sizeof(slot->seq));
+		strlcpy(slot->source, t->source, sizeof(slot->source));
+		slot->kind = t->kind;
+		tlm_map_end(slot);
+
+		tlm_map_header()->gen++;
+		t->slot = slot;
+		return;
+	}
+
+	pr_warn_once("accton_telemetry: no slot left for %s, netlink only\n", t->source);
+}
+
+/* Called with tlm_lock held */
+static void tlm_map_detach(struct accton_tlm *t)
+{
+	if (!t->slot) {
+		return;
+	}
+
+	tlm_map_begin(t->slot);
+	t->slot->kind = 0;
+	t->slot->count = 0;
+	t->slot->blob_len = 0;
+	tlm_map_end(t->slot);
+
+	tlm_map_header()->gen++;
+	t->slot = NULL;
+}
+
+static int tlm_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	unsigned long size = vma->vm_end - vma->vm_start;
+
+	if (vma->vm_flags & VM_WRITE) {
+		return -EPERM;
+	}
+
+	if (vma->vm_pgoff + (size >> PAGE_SHIFT) > PAGE_ALIGN(ACCTON_TLM_MAP_SIZE) >> PAGE_SHIFT) {
+		return -EINVAL;
+	}
+
+	vma->vm_flags &= ~VM_MAYWRITE;
+	return remap_vmalloc_range(vma, tlm_map, vma->vm_pgoff);
+}
+
+static const struct file_operations tlm_fops = {
+	.owner	= THIS_MODULE,
+	.mmap	= tlm_mmap,
+};
+
+static struct miscdevice tlm_miscdev = {
+	.minor	= MISC_DYNAMIC_MINOR,
+	.name	= ACCTON_TLM_DEV_NAME,
+	.fops	= &tlm_fops,
+	.mode	= S_IRUGO,
+};
+
+static int tlm_dump(struct sk_buff *skb, struct netlink_callback *cb);
+
+static const struct genl_ops tlm_ops[] = {
+	{
+		.cmd	= ACCTON_TLM_CMD_GET,
+		.dumpit	= tlm_dump,
+	},
+};
+
+static const struct genl_multicast_group tlm_mcgrps[] = {
+	{ .name = ACCTON_TLM_MCGRP_NAME, },
+};
+
+static struct genl_family tlm_family = {
+	.id			= GENL_ID_GENERATE,
+	.name		= ACCTON_TLM_FAMILY_NAME,
+	.version	= ACCTON_TLM_FAMILY_VERSION,
+	.maxattr	= ACCTON_TLM_A_MAX,
+};
+
+static int tlm_fill(struct sk_buff *skb, struct accton_tlm *t, u32 portid, u32 seq,
+					int flags, u8 cmd)
+{
+	struct nlattr *nest;
+	void *hdr;
+	int i;
+
+	hdr = genlmsg_put(skb, portid, seq, &tlm_family, flags, cmd);
+	if (!hdr) {
+		return -EMSGSIZE;
+	}
+
+	if (nla_put_string(skb, ACCTON_TLM_A_SOURCE, t->source) ||
+		nla_put_u8(skb, ACCTON_TLM_A_KIND, t->kind) ||
+		nla_put_u32(skb, ACCTON_TLM_A_SEQ, t->seq) ||
+		nla_put_u64(skb, ACCTON_TLM_A_TIMESTAMP, t->timestamp)) {
+		goto nla_put_failure;
+	}
+
+	for (i = 0; i < t->count; i++) {
+		nest = nla_nest_start(skb, ACCTON_TLM_A_VALUE);
+		if (!nest) {
+			goto nla_put_failure;
+		}
+
+		if (nla_put_string(skb, ACCTON_TLM_V_NAME, t->values[i].name) ||
+			nla_put_u32(skb, ACCTON_TLM_V_INDEX, t->values[i].index) ||
+			nla_put_u64(skb, ACCTON_TLM_V_DATA, (u64)t->values[i].data)) {
+			goto nla_put_failure;
+		}
+
+		nla_nest_end(skb, nest);
+	}
+
+	if (t->blob_len && nla_put(skb, ACCTON_TLM_A_BLOB, t->blob_len, t->blob)) {
+		goto nla_put_failure;
+	}
+
+	return genlmsg_end(skb, hdr);
+
+nla_put_failure:
+	genlmsg_cancel(skb, hdr);
+	return -EMSGSIZE;
+}
+
+/* cb->args[0] is the number of sources already dumped */
+static int tlm_dump(struct sk_buff *skb, struct netlink_callback *cb)
+{
+	struct accton_tlm *t;
+	long idx = 0;
+
+	mutex_lock(&tlm_lock);
+
+	list_for_each_entry(t, &tlm_sources, list) {
+		if (idx < cb->args[0]) {
+			idx++;
+			continue;
+		}
+
+		/* Not sampled yet, nothing to report */
+		if (!t->seq) {
+			idx++;
+			continue;
+		}
+
+		if (tlm_fill(skb, t, NETLINK_CB(cb->skb).portid, cb->nlh->nlmsg_seq,
+					 NLM_F_MULTI, ACCTON_TLM_CMD_GET) < 0) {
+			break;
+		}
+		idx++;
+	}
+
+	mutex_unlock(&tlm_lock);
+
+	cb->args[0] = idx;
+	return skb->len;
+}
+
+/* Called with tlm_lock held */
+static void tlm_notify(struct accton_tlm *t)
+{
+	struct sk_buff *skb;
+
+	skb = genlmsg_new(NLMSG_GOODSIZE, GFP_KERNEL);
+	if (!skb) {
+		return;
+	}
+
+	if (tlm_fill(skb, t, 0, 0, 0, ACCTON_TLM_CMD_SAMPLE) < 0) {
+		nlmsg_free(skb);
+		return;
+	}
+
+	/* -ESRCH only says nobody listens */
+	genlmsg_multicast(&tlm_family, skb, 0, 0, GFP_KERNEL);
+}
+
+/* Values are compared one by one, the padding of the struct is garbage */
+static bool tlm_changed(const struct accton_tlm *t, const struct accton_tlm_value *values,
+						int count, const void *blob, size_t blob_len)
+{
+	int i;
+
+	if (!t->seq || t->count != count || t->blob_len != blob_len) {
+		return true;
+	}
+
+	for (i = 0; i < count; i++) {
+		if (t->values[i].name != values[i].name ||
+			t->values[i].index != values[i].index ||
+			t->values[i].data != values[i].data) {
+			return true;
+		}
+	}
+
+	return blob_len && memcmp(t->blob, blob, blob_len);
+}
+
+void accton_tlm_publish(struct accton_tlm *t, const struct accton_tlm_value *values,
+						int count, const void *blob, size_t blob_len)
+{
+	if (!t) {
+		return;
+	}
+
+	count = clamp(count, 0, ACCTON_TLM_MAX_VALUES);
+	blob_len = min_t(size_t, blob ? blob_len : 0, ACCTON_TLM_MAX_BLOB);
+
+	mutex_lock(&tlm_lock);
+
+	if (tlm_changed(t, values, count, blob, blob_len)) {
+		memcpy(t->values, values, count * sizeof(*values));
+		t->count = count;
+		memcpy(t->blob, blob, blob_len);
+		t->blob_len = blob_len;
+		t->seq++;
+		t->timestamp = ktime_to_ns(ktime_get());
+		tlm_map_store(t);
+		tlm_notify(t);
+	}
+
+	mutex_unlock(&tlm_lock);
+}
+EXPORT_SYMBOL(accton_tlm_publish);
+
+struct accton_tlm *accton_tlm_register(struct device *dev, enum accton_tlm_kind kind)
+{
+	struct accton_tlm *t;
+
+	t = kzalloc(sizeof(*t), GFP_KERNEL);
+	if (!t) {
+		return NULL;
+	}
+
+	strlcpy(t->source, dev_name(dev), sizeof(t->source));
+	t->kind = kind;
+
+	mutex_lock(&tlm_lock);
+	list_add_tail(&t->list, &tlm_sources);
+	tlm_map_attach(t);
+	mutex_unlock(&tlm_lock);
+
+	return t;
+}
+EXPORT_SYMBOL(accton_tlm_register);
+
+void accton_tlm_unregister(struct accton_tlm *t)
+{
+	if (!t) {
+		return;
+	}
+
+	mutex_lock(&tlm_lock);
+	list_del(&t->list);
+	tlm_map_detach(t);
+	mutex_unlock(&tlm_lock);
+
+	kfree(t);
+}
+EXPORT_SYMBOL(accton_tlm_unregister);
+
+static int __init accton_tlm_init(void)
+{
+	struct accton_tlm_map_header *hdr;
+	int status;
+
+	BUILD_BUG_ON(sizeof(struct accton_tlm_map_slot) > ACCTON_TLM_MAP_SLOT_SIZE);
+	BUILD_BUG_ON(sizeof(struct accton_tlm_map_header) > ACCTON_TLM_MAP_SLOTS_OFFSET);
+
+	tlm_map = vmalloc_user(PAGE_ALIGN(ACCTON_TLM_MAP_SIZE));
+	if (!tlm_map) {
+		return -ENOMEM;
+	}
+
+	hdr = tlm_map_header();
+	hdr->magic = ACCTON_TLM_MAP_MAGIC;
+	hdr->version = ACCTON_TLM_MAP_VERSION;
+	hdr->num_slots = ACCTON_TLM_MAX_SLOTS;
+	hdr->slot_size = ACCTON_TLM_MAP_SLOT_SIZE;
+	hdr->slots_offset = ACCTON_TLM_MAP_SLOTS_OFFSET;
+
+	status = genl_register_family_with_ops_groups(&tlm_family, tlm_ops, tlm_mcgrps);
+	if (status) {
+		goto exit_free;
+	}
+
+	status = misc_register(&tlm_miscdev);
+	if (status) {
+		goto exit_genl;
+	}
+
+	return 0;
+
+exit_genl:
+	genl_unregister_family(&tlm_family);
+exit_free:
+	vfree(tlm_map);
+	return status;
+}
+
+static void __exit accton_tlm_exit(void)
+{
+	misc_deregister(&tlm_miscdev);
+	genl_unregister_family(&tlm_family);
+	vfree(tlm_map);
+}
+
+module_init(accton_tlm_init);
+module_exit(accton_tlm_exit);
+
+MODULE_AUTHOR("Brandon Chuang <brandon_chuang@accton.com.tw>");
+MODULE_DESCRIPTION("accton platform telemetry over generic netlink and mmap");
+MODULE_LICENSE("GPL");
@@ -0,0 +1,167 @@
+/*
+ * Generic netlink telemetry of the accton platform drivers
+ *
+ * Copyright (C) 2018 Accton Technology Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+/*
+ * Every fan board, PSU, SFP port and optoe that registers is a source.
+ * A source keeps its last sample: a list of named values and, for
+ * EEPROM data, a blob.  When a publish changes it, the sample goes out
+ * on the "samples" multicast group of the "accton_platform" family;
+ * ACCTON_TLM_CMD_GET with NLM_F_DUMP returns the last sample of every
+ * source.
+ *
+ * One message per sample:
+ *
+ *   ACCTON_TLM_A_SOURCE		string, device name ("10-005b")
+ *   ACCTON_TLM_A_KIND			u8, enum accton_tlm_kind
+ *   ACCTON_TLM_A_SEQ			u32, changes of this source so far
+ *   ACCTON_TLM_A_TIMESTAMP		u64, ns of ktime_get() at the change
+ *   ACCTON_TLM_A_VALUE			nested, once per value:
+ *     ACCTON_TLM_V_NAME		  string, as the sysfs attribute is called
+ *     ACCTON_TLM_V_INDEX		  u32, fan or lane number, 0 if none
+ *     ACCTON_TLM_V_DATA		  u64, the s64 sysfs value
+ *   ACCTON_TLM_A_BLOB			binary, if the source has one
+ *
+ * The same samples are kept in a read-only region that /dev/accton_telemetry
+ * maps: a header at offset 0, then from slots_offset one slot of slot_size
+ * bytes per source.  A slot is rewritten in place on each change, its seq
+ * odd while that happens.  Readers copy it out and retry if seq was odd or
+ * changed in the meantime:
+ *
+ *   do {
+ *       s = slot->seq;  rmb();  copy = *slot;  rmb();
+ *   } while ((s & 1) || s != slot->seq);
+ *
+ * kind is 0 in a free slot.  The header gen changes whenever a slot is
+ * taken or freed, so a reader that indexes the slots by source only has
+ * to look at gen to know when to scan them again.
+ */
+
+#ifndef __ACCTON_TELEMETRY_H__
+#define __ACCTON_TELEMETRY_H__
+
+#include <linux/types.h>
+
+#define ACCTON_TLM_FAMILY_NAME		"accton_platform"
+#define ACCTON_TLM_FAMILY_VERSION	1
+#define ACCTON_TLM_MCGRP_NAME		"samples"
+
+enum accton_tlm_cmd {
+	ACCTON_TLM_CMD_UNSPEC,
+	ACCTON_TLM_CMD_GET,			/* dump, the last sample of each source */
+	ACCTON_TLM_CMD_SAMPLE,		/* multicast, a sample that changed */
+	__ACCTON_TLM_CMD_MAX
+};
+
+enum accton_tlm_attr {
+	ACCTON_TLM_A_UNSPEC,
+	ACCTON_TLM_A_SOURCE,
+	ACCTON_TLM_A_KIND,
+	ACCTON_TLM_A_SEQ,
+	ACCTON_TLM_A_TIMESTAMP,
+	ACCTON_TLM_A_VALUE,
+	ACCTON_TLM_A_BLOB,
+	__ACCTON_TLM_A_MAX
+};
+#define ACCTON_TLM_A_MAX	(__ACCTON_TLM_A_MAX - 1)
+
+enum accton_tlm_value_attr {
+	ACCTON_TLM_V_UNSPEC,
+	ACCTON_TLM_V_NAME,
+	ACCTON_TLM_V_INDEX,
+	ACCTON_TLM_V_DATA,
+	__ACCTON_TLM_V_MAX
+};
+#define ACCTON_TLM_V_MAX	(__ACCTON_TLM_V_MAX - 1)
+
+enum accton_tlm_kind {
+	ACCTON_TLM_KIND_FAN = 1,	/* duty cycle, rpm, fault and present per fan */
+	ACCTON_TLM_KIND_PSU,		/* every live psu_* value */
+	ACCTON_TLM_KIND_PRESENCE,	/* CPLD module present bitmap */
+	ACCTON_TLM_KIND_DOM			/* DOM bytes in the blob */
+};
+
+#define ACCTON_TLM_DEV_NAME		"accton_telemetry"
+#define ACCTON_TLM_MAP_MAGIC	0x4d4c5441	/* "ATLM" */
+#define ACCTON_TLM_MAP_VERSION	1
+
+#define ACCTON_TLM_MAX_VALUES	32
+#define ACCTON_TLM_MAX_BLOB		128
+#define ACCTON_TLM_MAX_SLOTS	256
+#define ACCTON_TLM_NAME_LEN		32
+
+struct accton_tlm_map_header {
+	__u32	magic;
+	__u32	version;
+	__u32	gen;			/* changes when a slot is taken or freed */
+	__u32	num_slots;
+	__u32	slot_size;
+	__u32	slots_offset;
+};
+
+struct accton_tlm_map_value {
+	char	name[ACCTON_TLM_NAME_LEN];
+	__u32	index;
+	__u32	reserved;
+	__s64	data;
+};
+
+struct accton_tlm_map_slot {
+	__u32	seq;			/* odd while the slot is written */
+	__u8	kind;			/* enum accton_tlm_kind, 0 when free */
+	__u8	count;			/* of values[] */
+	__u16	blob_len;
+	__u32	changes;		/* ACCTON_TLM_A_SEQ */
+	__u32	reserved;
+	__u64	timestamp;		/* ACCTON_TLM_A_TIMESTAMP */
+	char	source[ACCTON_TLM_NAME_LEN];
+	struct accton_tlm_map_value	values[ACCTON_TLM_MAX_VALUES];
+	__u8	blob[ACCTON_TLM_MAX_BLOB];
+};
+
+#define ACCTON_TLM_MAP_SLOT_SIZE	2048
+#define ACCTON_TLM_MAP_SLOTS_OFFSET	4096
+#define ACCTON_TLM_MAP_SIZE \
+	(ACCTON_TLM_MAP_SLOTS_OFFSET + ACCTON_TLM_MAX_SLOTS * ACCTON_TLM_MAP_SLOT_SIZE)
+
+#ifdef __KERNEL__
+
+#include <linux/device.h>
+
+/* name must stay valid while the source is registered */
+struct accton_tlm_value {
+	const char	*name;
+	u32			index;
+	s64			data;
+};
+
+struct accton_tlm;
+
+/*
+ * As for accton_i2c_stats.h, a NULL source (no memory at register time)
+ * makes every call a no-op.  Publish may sleep.
+ */
+struct accton_tlm *accton_tlm_register(struct device *dev, enum accton_tlm_kind kind);
+void accton_tlm_unregister(struct accton_tlm *t);
+void accton_tlm_publish(struct accton_tlm *t, const struct accton_tlm_value *values,
+						int count, const void *blob, size_t blob_len);
+
+#endif /* __KERNEL__ */
+
+#endif /* __ACCTON_TELEMETRY_H__ */
@@ -0,0 +1,208 @@
+/*
+ * Tracepoints of the accton platform drivers
+ *
+ * Copyright (C) 2018 Accton Technology Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+/*
+ * The events are created in accton_i2c_stats.c and exported from there,
+ * so every driver that fires one depends on that module.  Most already
+ * did for their bus wrappers; accton_pmbus_3y only does for these
+ * events.  Use them
+ * with e.g.
+ *
+ *   trace-cmd record -e accton
+ *   perf record -e 'accton:*' -a
+ *
+ * duration is in us.  A module that includes this header must be built
+ * with -I$(src), see the Makefiles.
+ */
+
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM accton
+
+#if !defined(_ACCTON_TRACE_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _ACCTON_TRACE_H
+
+#include <linux/types.h>
+#include <linux/device.h>
+#include <linux/tracepoint.h>
+
+/* One transceiver EEPROM access within a page, offset is on the client */
+DECLARE_EVENT_CLASS(accton_eeprom,
+
+	TP_PROTO(struct device *dev, int page, unsigned int offset, size_t len,
+			 s64 duration, ssize_t result),
+
+	TP_ARGS(dev, page, offset, len, duration, result),
+
+	TP_STRUCT__entry(
+		__string(	dev,		dev_name(dev)	)
+		__field(	int,		page			)
+		__field(	unsigned int, offset		)
+		__field(	size_t,		len				)
+		__field(	s64,		duration		)
+		__field(	ssize_t,	result			)
+	),
+
+	TP_fast_assign(
+		__assign_str(dev, dev_name(dev));
+		__entry->page		= page;
+		__entry->offset		= offset;
+		__entry->len		= len;
+		__entry->duration	= duration;
+		__entry->result		= result;
+	),
+
+	TP_printk("%s page=%d offset=%u len=%zu duration=%lld result=%zd",
+			  __get_str(dev), __entry->page, __entry->offset, __entry->len,
+			  __entry->duration, __entry->result)
+);
+
+DEFINE_EVENT(accton_eeprom, accton_eeprom_read,
+
+	TP_PROTO(struct device *dev, int page, unsigned int offset, size_t len,
+			 s64 duration, ssize_t result),
+
+	TP_ARGS(dev, page, offset, len, duration, result)
+);
+
+DEFINE_EVENT(accton_eeprom, accton_eeprom_write,
+
+	TP_PROTO(struct device *dev, int page, unsigned int offset, size_t len,
+			 s64 duration, ssize_t result),
+
+	TP_ARGS(dev, page, offset, len, duration, result)
+);
+
+/* One CPLD register access through the accton_i2c_cpld exports */
+DECLARE_EVENT_CLASS(accton_cpld,
+
+	TP_PROTO(unsigned short addr, u8 reg, u8 value, s64 duration, int result),
+
+	TP_ARGS(addr, reg, value, duration, result),
+
+	TP_STRUCT__entry(
+		__field(	unsigned short,	addr	)
+		__field(	u8,			reg			)
+		__field(	u8,			value		)
+		__field(	s64,		duration	)
+		__field(	int,		result		)
+	),
+
+	TP_fast_assign(
+		__entry->addr		= addr;
+		__entry->reg		= reg;
+		__entry->value		= value;
+		__entry->duration	= duration;
+		__entry->result		= result;
+	),
+
+	TP_printk("cpld=0x%02x reg=0x%02x value=0x%02x duration=%lld result=%d",
+			  __entry->addr, __entry->reg, __entry->value,
+			  __entry->duration, __entry->result)
+);
+
+DEFINE_EVENT(accton_cpld, accton_cpld_read,
+
+	TP_PROTO(unsigned short addr, u8 reg, u8 value, s64 duration, int result),
+
+	TP_ARGS(addr, reg, value, duration, result)
+);
+
+DEFINE_EVENT(accton_cpld, accton_cpld_write,
+
+	TP_PROTO(unsigned short addr, u8 reg, u8 value, s64 duration, int result),
+
+	TP_ARGS(addr, reg, value, duration, result)
+);
+
+/*
+ * One refresh of a PSU's cached registers: regs is the bitmap of model
+ * registers asked for (pages for the PMBus driver), result the number
+ * of them that failed.
+ */
+TRACE_EVENT(accton_psu_update,
+
+	TP_PROTO(struct device *dev, unsigned long regs, s64 duration, int result),
+
+	TP_ARGS(dev, regs, duration, result),
+
+	TP_STRUCT__entry(
+		__string(	dev,		dev_name(dev)	)
+		__field(	unsigned long, regs			)
+		__field(	s64,		duration		)
+		__field(	int,		result			)
+	),
+
+	TP_fast_assign(
+		__assign_str(dev, dev_name(dev));
+		__entry->regs		= regs;
+		__entry->duration	= duration;
+		__entry->result		= result;
+	),
+
+	TP_printk("%s regs=0x%lx duration=%lld result=%d",
+			  __get_str(dev), __entry->regs, __entry->duration, __entry->result)
+);
+
+#endif /* _ACCTON_TRACE_H */
+
+#ifndef _ACCTON_TRACE_HELPERS
+#define _ACCTON_TRACE_HELPERS
+
+#include <linux/ktime.h>
+
+/* Don't even read the clock while nobody listens */
+static inline ktime_t accton_trace_eeprom_start(void)
+{
+	return (trace_accton_eeprom_read_enabled() || trace_accton_eeprom_write_enabled()) ?
+		   ktime_get() : ktime_set(0, 0);
+}
+
+static inline ktime_t accton_trace_cpld_start(void)
+{
+	return (trace_accton_cpld_read_enabled() || trace_accton_cpld_write_enabled()) ?
+		   ktime_get() : ktime_set(0, 0);
+}
+
+static inline ktime_t accton_trace_psu_start(void)
+{
+	return trace_accton_psu_update_enabled() ? ktime_get() : ktime_set(0, 0);
+}
+
+/* False when the start helper found the events off.  Tracing may have been
+ * turned on since, but the end event would then carry a duration from 0.
+ */
+static inline bool accton_trace_started(ktime_t start)
+{
+	return ktime_to_ns(start) != 0;
+}
+
+static inline s64 accton_trace_duration(ktime_t start)
+{
+	return ktime_us_delta(ktime_get(), start);
+}
+
+#endif /* _ACCTON_TRACE_HELPERS */
+
+/* This part must be outside protection */
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE accton_trace
+#include <trace/define_trace.h>
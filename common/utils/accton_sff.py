@@ -0,0 +1,175 @@
+#!/usr/bin/env python
+#
+# Copyright (C) 2018 Accton Technology Corporation
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+# ------------------------------------------------------------------
+# HISTORY:
+#    mm/dd/yyyy (A.D.)
+#    10/14/2026: Device index and in-process EEPROM dumps of the
+#                accton_*_util.py scripts
+# ------------------------------------------------------------------
+
+"""
+Helpers of the accton_*_util.py scripts, installed next to them.
+
+The device inventory (ALL_DEVICE) is written to INDEX_DIR by install
+and removed by clean, so sff, show and set neither rebuild it nor check
+the drivers with lsmod first.  EEPROMs are read and formatted as
+'hexdump -C' does in this process, without a shell per port.
+"""
+
+try:
+    import os
+    import json
+    import logging
+except ImportError as e:
+    raise ImportError('%s - required module not found' % str(e))
+
+INDEX_DIR = '/run/accton'
+
+
+def index_path(project):
+    return os.path.join(INDEX_DIR, project + '_devices.json')
+
+
+def save_index(project, devices):
+    path = index_path(project)
+    tmp = path + '.tmp'
+    try:
+        if not os.path.isdir(INDEX_DIR):
+            os.makedirs(INDEX_DIR)
+        with open(tmp, 'w') as f:
+            json.dump(devices, f)
+        os.rename(tmp, path)
+    except (IOError, OSError) as e:
+        logging.info('Failed to write %s: %s', path, str(e))
+        return False
+    return True
+
+
+def load_index(project):
+    try:
+        with open(index_path(project)) as f:
+            return json.load(f)
+    except (IOError, OSError, ValueError):
+        return None
+
+
+def remove_index(project):
+    try:
+        os.remove(index_path(project))
+    except OSError:
+        pass
+
+
+def hexdump(data):
+    """data as 'hexdump -C' prints it, repeated lines squeezed to '*'"""
+    out = []
+    last = None
+    squeezed = False
+    for off in range(0, len(data), 16):
+        line = data[off:off + 16]
+        if line == last:
+            if not squeezed:
+                out.append('*')
+                squeezed = True
+            continue
+        last = line
+        squeezed = False
+
+        codes = [ord(c) for c in line]
+        hexs = ['%02x' % c for c in codes]
+        left = ' '.join(hexs[:8])
+        right = ' '.join(hexs[8:])
+        text = ''.join([chr(c) if 32 <= c < 127 else '.' for c in codes])
+        out.append('%08x  %-23s  %-23s  |%s|' % (off, left, right, text))
+    out.append('%08x' % len(data))
+    return '\n'.join(out)
+
+
+def read_node(path):
+    try:
+        with open(path.strip()) as f:
+            return f.read().strip()
+    except (IOError, OSError):
+        return None
+
+
+def read_eeprom(path):
+    try:
+        with open(path, 'rb') as f:
+            return f.read()
+    except (IOError, OSError) as e:
+        logging.info('Failed to read %s: %s', path, str(e))
+        return None
+
+
+def dump(node):
+    print node + ":"
+    data = read_eeprom(node)
+    if data is None:
+        print "**********device no found**********"
+        return 1
+    print hexdump(data)
+    return 0
+
+
+def parse_bitmap(value, count):
+    """Ports present in an "xx xx ..." bitmap, port 1 in bit 0 of the first byte"""
+    present = set()
+    try:
+        for i, byte in enumerate(value.split()):
+            byte = int(byte, 16)
+            for bit in range(8):
+                if byte & (1 << bit) and i * 8 + bit < count:
+                    present.add(i * 8 + bit + 1)
+    except ValueError:
+        return None
+    return present
+
+
+def present_ports(ports):
+    """
+    Front port numbers of the present modules of ports, a list of
+    (port, present node, eeprom node).  A driver with an
+    sfp_is_present_all next to sfp_is_present answers for every port
+    with one read; the others are asked port by port.
+    """
+    if ports:
+        node = ports[0][1].strip()
+        if node.endswith('sfp_is_present'):
+            value = read_node(node + '_all')
+            if value is not None:
+                present = parse_bitmap(value, len(ports))
+                if present is not None:
+                    return present
+
+    present = set()
+    for port, node, eeprom in ports:
+        # Unreadable presence: let the EEPROM read tell
+        if read_node(node) != '0':
+            present.add(port)
+    return present
+
+
+def dump_present(ports):
+    present = present_ports(ports)
+    status = 0
+    for port, node, eeprom in ports:
+        if port in present:
+            status |= dump(eeprom)
+    print "%d of %d ports present" % (len(present), len(ports))
+    return status
@@ -0,0 +1,255 @@
+#!/usr/bin/env python
+#
+# Copyright (C) 2018 Accton Technology Corporation
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+# ------------------------------------------------------------------
+# HISTORY:
+#    mm/dd/yyyy (A.D.)
+#    10/14/2026: Throughput and latency of the platform sysfs nodes
+# ------------------------------------------------------------------
+
+"""
+Usage: %(scriptName)s [options] [family ...]
+
+Reads the platform attributes of the running switch and reports, per
+attribute family, reads per second and latency percentiles.
+
+options:
+    -h | --help             : this help message
+    -d | --debug            : run with debug mode
+    -t | --time <sec>       : length of the run, default 10
+    -c | --concurrency <n>  : readers per family, default 1
+    -s | --sonic            : run as xcvrd, thermalctld and psud at once
+    -p | --pause <sec>      : pause between the sweeps of a -s agent,
+                              default 0 (back to back)
+    -l | --list             : only list the nodes of each family
+family:
+    eeprom      : transceiver EEPROMs, 256 bytes each
+    present     : module_present_all / sfp_is_present_all
+    psu         : psu_* attributes
+    fan         : fan*_input
+    thermal     : temp*_input
+    led         : LED brightness
+    (all of them by default)
+
+Without -s every reader sweeps over all the nodes of its family, each
+family on its own.  With -s the families are read the way SONiC does:
+an xcvrd that reads the presence then every EEPROM, a thermalctld on
+the fans and thermals and a psud on the PSUs, all running together.
+Run it before and after a driver upgrade on an idle switch, the
+difference of the two is the gain or the lock contention added.
+"""
+
+try:
+    import os
+    import sys, getopt
+    import glob
+    import logging
+    import threading
+    import time
+except ImportError as e:
+    raise ImportError('%s - required module not found' % str(e))
+
+VERSION = '1.0'
+
+I2C = '/sys/bus/i2c/devices/'
+PLATFORM = '/sys/devices/platform/'
+
+FAMILIES = {
+    'eeprom':  [I2C + '*/eeprom'],
+    'present': [I2C + '*/module_present_all', I2C + '*/sfp_is_present_all'],
+    'psu':     [I2C + '*/psu_*'],
+    'fan':     [I2C + '*/fan*_input', I2C + '*/hwmon/hwmon*/fan*_input',
+                PLATFORM + '*/fan*_input', PLATFORM + '*/hwmon/hwmon*/fan*_input'],
+    'thermal': [I2C + '*/hwmon/hwmon*/temp*_input', I2C + '*/temp*_input',
+                PLATFORM + '*/hwmon/hwmon*/temp*_input'],
+    'led':     ['/sys/class/leds/*/brightness'],
+}
+ORDER = ['eeprom', 'present', 'psu', 'fan', 'thermal', 'led']
+
+# What each SONiC daemon reads, in the order it reads it
+AGENTS = {
+    'xcvrd':       ['present', 'eeprom'],
+    'thermalctld': ['fan', 'thermal'],
+    'psud':        ['psu'],
+}
+
+EEPROM_SIZE = 256
+
+
+def find_nodes(family):
+    nodes = []
+    for pattern in FAMILIES[family]:
+        for path in sorted(glob.glob(pattern)):
+            real = os.path.realpath(path)
+            if real in [os.path.realpath(n) for n in nodes]:
+                continue
+            if not os.access(path, os.R_OK):
+                continue
+            # an eeprom of no size is a chip without a driver
+            if family == 'eeprom' and os.path.getsize(path) == 0:
+                continue
+            nodes.append(path)
+    return nodes
+
+
+class Stats(object):
+    """Latencies of one family, shared by its readers"""
+
+    def __init__(self, name):
+        self.name = name
+        self.lock = threading.Lock()
+        self.latencies = []
+        self.errors = 0
+
+    def add(self, latency, ok):
+        with self.lock:
+            self.latencies.append(latency)
+            if not ok:
+                self.errors += 1
+
+    def report(self, elapsed):
+        lat = sorted(self.latencies)
+        if not lat:
+            print '%-12s no reads' % self.name
+            return
+
+        def pct(p):
+            return lat[min(len(lat) - 1, int(len(lat) * p / 100.0))] * 1e6
+
+        print '%-12s reads=%-7d errors=%-5d ops/s=%-9.1f p50_us=%-8.0f p90_us=%-8.0f p99_us=%-8.0f max_us=%.0f' % (
+            self.name, len(lat), self.errors, len(lat) / elapsed,
+            pct(50), pct(90), pct(99), lat[-1] * 1e6)
+
+
+def read_node(path, size):
+    try:
+        with open(path, 'rb') as f:
+            f.read(size)
+        return True
+    except IOError as e:
+        logging.debug('unable to read %s: %s', path, str(e))
+        return False
+
+
+def sweep(nodes, family, stats):
+    size = EEPROM_SIZE if family == 'eeprom' else 64
+    for path in nodes:
+        t = time.time()
+        ok = read_node(path, size)
+        stats.add(time.time() - t, ok)
+
+
+def reader(deadline, families, nodes, stats, pause):
+    while time.time() < deadline:
+        for family in families:
+            sweep(nodes[family], family, stats[family])
+            if time.time() >= deadline:
+                return
+        if pause:
+            time.sleep(pause)
+
+
+def run(families, concurrency, duration, sonic, pause):
+    nodes = dict((f, find_nodes(f)) for f in ORDER)
+    stats = dict((f, Stats(f)) for f in ORDER)
+    threads = []
+    deadline = time.time() + duration
+
+    if sonic:
+        for agent in sorted(AGENTS):
+            own = [f for f in AGENTS[agent] if nodes[f]]
+            if not own:
+                continue
+            for i in range(concurrency):
+                threads.append(threading.Thread(name=agent, target=reader,
+                               args=(deadline, own, nodes, stats, pause)))
+        families = [f for f in ORDER if [a for a in AGENTS.values() if f in a]]
+    else:
+        for family in families:
+            if not nodes[family]:
+                continue
+            for i in range(concurrency):
+                threads.append(threading.Thread(name=family, target=reader,
+                               args=(deadline, [family], nodes, stats, 0)))
+
+    print '# %s, %d node(s), %d reader(s), %d s' % (
+        'sonic' if sonic else 'families', sum(len(nodes[f]) for f in families),
+        len(threads), duration)
+
+    start = time.time()
+    for t in threads:
+        t.daemon = True
+        t.start()
+    for t in threads:
+        t.join()
+    elapsed = time.time() - start
+
+    for family in families:
+        if nodes[family]:
+            stats[family].report(elapsed)
+
+
+def main():
+    duration = 10
+    concurrency = 1
+    sonic = False
+    pause = 0
+    list_only = False
+    usage = __doc__ % {'scriptName': sys.argv[0].split("/")[-1]}
+
+    try:
+        opts, args = getopt.getopt(sys.argv[1:], 'hdt:c:sp:l',
+                                   ['help', 'debug', 'time=', 'concurrency=',
+                                    'sonic', 'pause=', 'list'])
+    except getopt.GetoptError:
+        print usage
+        return 1
+
+    for opt, arg in opts:
+        if opt in ('-h', '--help'):
+            print usage
+            return 0
+        elif opt in ('-d', '--debug'):
+            logging.basicConfig(level=logging.DEBUG)
+        elif opt in ('-t', '--time'):
+            duration = int(arg)
+        elif opt in ('-c', '--concurrency'):
+            concurrency = int(arg)
+        elif opt in ('-s', '--sonic'):
+            sonic = True
+        elif opt in ('-p', '--pause'):
+            pause = float(arg)
+        elif opt in ('-l', '--list'):
+            list_only = True
+
+    families = args or ORDER
+    for f in families:
+        if f not in FAMILIES:
+            print usage
+            return 1
+
+    if list_only:
+        for f in families:
+            for path in find_nodes(f):
+                print '%-8s %s' % (f, path)
+        return 0
+
+    run(families, concurrency, duration, sonic, pause)
+    return 0
+
+if __name__ == '__main__':
+    sys.exit(main())
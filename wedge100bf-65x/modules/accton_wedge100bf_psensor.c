@@ -38,6 +38,8 @@
 #include <linux/slab.h>
 #include <linux/platform_device.h>
 #include <linux/tty.h>
+#include <linux/seqlock.h>
+#include <linux/workqueue.h>
 #include <asm/uaccess.h>
 
 
@@ -58,7 +60,9 @@ enum mtype {
     MTYPE_MAX,
 };
 
-#define SENSOR_DATA_UPDATE_INTERVAL     (5*HZ)
+#define SENSOR_DATA_UPDATE_INTERVAL     (5000)  /*mini-seconds*/
+#define SENSOR_DATA_UPDATE_MIN          (1000)
+#define SENSOR_DATA_UPDATE_MAX          (60000)
 #define MAX_THERMAL_COUNT (7)
 #define MAX_FAN_COUNT     (10)
 #define CHASSIS_PSU_CHAR_COUNT     (2)    /*2 for input and output.*/
@@ -95,6 +99,31 @@ enum mtype {
 #define TTY_RX_RETRY                    3
 #define TTY_CMD_MAX_LEN          (64)
 #define TTY_READ_MAX_LEN        (256)
+#define TTY_BATCH_CMD_MAX_LEN   (1024)
+#define TTY_BATCH_BUFFER_LENGTH (4096)
+#define TTY_BATCH_TIMEOUT       (3000)  /*mini-seconds*/
+#define TTY_BATCH_RETRY         2
+/* Each section of a batch response starts with its marker. The shell
+ * echoes the command line as "#""@N", so only the output matches. */
+#define TTY_BATCH_MARK          "#@"
+#define TTY_BATCH_END           TTY_BATCH_MARK"E"
+
+/*
+ * PSU registers come back as one frame, "%<n>:<2n hex digits>:<sum>",
+ * where sum is the byte sum modulo 256 of the n payload bytes. It is
+ * built on the BMC by a shell function defined once per login session.
+ * The console is in cooked mode, hence hex rather than raw bytes.
+ */
+#define TTY_FRAME_START         '%'
+#define TTY_FRAME_SEP           ':'
+#define TTY_PSU_HELPER  \
+    "psu_frame() { i2cset -y -f 7 0x70 0 $1; i2cdump -y -f -r "\
+    __stringify(PMBUS_REG_START)"-" __stringify(PMBUS_REG_END)" 7 $2 w |"\
+    " awk -v h=0123456789abcdef 'NR>1{for(i=2;i<=NF;i++)"\
+    "if(length($i)==4&&$i!=\"XXXX\")s=s $i}"\
+    "END{for(i=1;i<length(s);i+=2)c+=(index(h,substr(s,i,1))-1)*16"\
+    "+index(h,substr(s,i+1,1))-1;"\
+    "printf \"%%%d:%s:%02x\\n\",length(s)/2,s,c%256}'; }\r"
 
 #define TTY_RESP_SEPARATOR      '|'     /*For the ease to debug*/
 #define MAX_ATTR_PATTERN        (8)
@@ -162,6 +191,11 @@ struct sensor_data {
 enum sysfs_attributes_index {
     INDEX_VERSION,
     INDEX_NAME,
+    INDEX_AGE,
+    INDEX_LAST_UPDATE,
+    INDEX_UPDATE_INTERVAL,
+    INDEX_CUR_INTERVAL,
+    INDEX_VALID,
     INDEX_THRM_IN_START = 100,
     INDEX_THRM_MAX_START = 150,
     INDEX_THRM_MAX_HYST_START = 170,
@@ -184,9 +218,18 @@ struct wedge100_data {
     struct mutex	    update_lock;
     struct tty_struct   *tty;
     struct ktermios     old_ktermios;
+    struct file         *tty_fd;        /*Kept open and logged in.*/
+    bool                logged_in;
+    char                *tty_buf;
     bool			 valid[SENSOR_TYPE_MAX];
     unsigned long	 last_updated[SENSOR_TYPE_MAX];	  /* In jiffies */
-    struct sensor_data sdata;
+    struct sensor_data sdata;       /*Filled by the refresher only.*/
+    struct delayed_work refresh_work;
+    seqlock_t        snap_lock;     /*Protects the snapshot below.*/
+    struct sensor_data snap;
+    bool             snap_valid[SENSOR_TYPE_MAX];
+    unsigned long    snap_time;     /*In jiffies, 0 before the first refresh.*/
+    unsigned int     cur_interval;  /*Refresh period in use, in ms.*/
     int num_attributes;
     struct attribute_group group;
 };
@@ -198,6 +241,16 @@ typedef ssize_t (*store_func)(struct device *dev,
                               size_t count);
 static ssize_t show_name(struct device *dev, struct device_attribute *da,
                          char *buf);
+static ssize_t show_age(struct device *dev, struct device_attribute *da,
+                        char *buf);
+static ssize_t show_update_interval(struct device *dev, struct device_attribute *da,
+                                    char *buf);
+static ssize_t set_update_interval(struct device *dev, struct device_attribute *da,
+                                   const char *buf, size_t count);
+static ssize_t show_cur_interval(struct device *dev, struct device_attribute *da,
+                                 char *buf);
+static ssize_t show_valid(struct device *dev, struct device_attribute *da,
+                          char *buf);
 static ssize_t show_thermal(struct device *dev, struct device_attribute *da,
                             char *buf);
 static ssize_t show_thermal_max(struct device *dev, struct device_attribute *da,
@@ -435,19 +488,17 @@ struct sensor_set ss_w100_32x[SENSOR_TYPE_MAX] =
 
 struct sensor_set *model_ssets[SENSOR_TYPE_MAX] = {ss_w100_65x, ss_w100_32x};
 
+/*Sent together as one command line, see build_batch_cmd().*/
 static char tty_cmd[SENSOR_TYPE_MAX][TTY_CMD_MAX_LEN] = {
-    "cat /sys/bus/i2c/devices/[38]-004*/temp1_input\r\n",
-    "cat /sys/bus/i2c/devices/[38]-004*/temp1_max\r\n",
-    "cat /sys/bus/i2c/devices/[38]-004*/temp1_max_hyst\r\n",
-    "ls -v /sys/bus/i2c/devices/8-0033/fan*_input | xargs cat\r\n",
-    "ls -v /sys/bus/i2c/devices/9-0033/fan*_input | xargs cat\r\n",
-    "i2cset -y -f 7 0x70 0 2; i2cdump -y -f -r "\
-    __stringify(PMBUS_REG_START)"-" __stringify(PMBUS_REG_END)\
-    " 7 0x59 w\r\n",
-    "i2cset -y -f 7 0x70 0 1; i2cdump -y -f -r "\
-    __stringify(PMBUS_REG_START)"-" __stringify(PMBUS_REG_END)\
-    " 7 0x5a w\r\n",
+    "cat /sys/bus/i2c/devices/[38]-004*/temp1_input",
+    "cat /sys/bus/i2c/devices/[38]-004*/temp1_max",
+    "cat /sys/bus/i2c/devices/[38]-004*/temp1_max_hyst",
+    "ls -v /sys/bus/i2c/devices/8-0033/fan*_input | xargs cat",
+    "ls -v /sys/bus/i2c/devices/9-0033/fan*_input | xargs cat",
+    "psu_frame 2 0x59",
+    "psu_frame 1 0x5a",
 };
+static char tty_batch_cmd[TTY_BATCH_CMD_MAX_LEN];
 
 static struct wedge100_data *wedge_data = NULL;
 
@@ -457,6 +508,26 @@ static int model_id = MTYPE_BF100_65X;
 module_param(model_id, uint, S_IRUGO);
 MODULE_PARM_DESC(model_id, "Default is BF100_65X.");
 
+/* How often the BMC is polled, in ms. */
+static unsigned int update_interval = SENSOR_DATA_UPDATE_INTERVAL;
+module_param(update_interval, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(update_interval, "Sensor refresh interval in ms, default 5000.");
+
+/*
+ * While every reading is valid and no temperature moved by more than
+ * update_deadband since the last refresh, the refresh period doubles, up
+ * to update_max_interval.  The BMC runs the fans itself, so the host copy
+ * only has to follow the temperatures.  0 or anything not above
+ * update_interval keeps the period fixed.
+ */
+static unsigned int update_max_interval;
+module_param(update_max_interval, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(update_max_interval, "Longest sensor refresh interval in ms, default 0 (fixed).");
+
+static unsigned int update_deadband = 1000;
+module_param(update_deadband, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(update_deadband, "Temperature change in milli-degrees that resets the refresh interval, default 1000.");
+
 static int _tty_wait(struct file *tty_fd, int mdelay) {
     msleep(mdelay);
     return 0;
@@ -680,59 +751,120 @@ static int _tty_login(struct file *tty_fd, char* buf, size_t max_size)
     return -EAGAIN;
 }
 
-static int
-bmc_transaction(char *cmd, char* resp, int max)
+/*Read until 'marker' shows up, the buffer is full or time is out.*/
+static int _tty_rx_until(struct file *tty_fd, char *buf, int max_len,
+                         const char *marker, u32 mtimeout)
 {
-    u32  i;
-    struct file *tty_fd = NULL;
-    char *buf;
-    int buf_size = MAXIMUM_TTY_BUFFER_LENGTH;
-    int ret = 0;
+    unsigned long deadline = jiffies + msecs_to_jiffies(mtimeout);
+    mm_segment_t old_fs;
+    int rc, len = 0;
 
-    if(!cmd || !resp)
+    if (tty_fd == NULL)
         return -EINVAL;
 
-    if (_tty_open(&tty_fd) != 0) {
+    memset(buf, 0, max_len);
+    old_fs = get_fs();
+    set_fs(KERNEL_DS);
+    while (1) {
+        if (len >= max_len - 1) {
+            rc = -EOVERFLOW;
+            break;
+        }
+        rc = tty_fd->f_op->read(tty_fd, buf + len, max_len - 1 - len, 0);
+        if (rc > 0) {
+            len += rc;
+            buf[len] = '\0';
+            if (strstr(buf, marker) != NULL) {
+                rc = len;
+                break;
+            }
+            continue;
+        }
+        if (rc < 0 && rc != -EAGAIN)
+            break;
+        if (time_after(jiffies, deadline)) {
+            rc = -ETIMEDOUT;
+            break;
+        }
+        msleep(TTY_RETRY_INTERVAL);
+    }
+    set_fs(old_fs);
+
+    DEBUG_INTR("[RX]%s-%d, %d BYTES, read:\n\"%s\"\n", __func__, __LINE__, rc, buf);
+    return rc;
+}
+
+/*Open the TTY and login once, the session is kept for later transactions.*/
+static int _tty_session_get(struct wedge100_data *data)
+{
+    if (data->tty_fd != NULL && data->logged_in)
+        return 0;
+
+    if (data->tty_fd == NULL && _tty_open(&data->tty_fd) != 0) {
         DEBUG_INTR("ERROR: Cannot open TTY device\n");
         return -EAGAIN;
     }
 
-    buf = (char *)kmalloc(buf_size, GFP_KERNEL);
-    if (!buf) {
-        ret = -ENOMEM;
-        goto exit;
+    _tty_clear_rxbuf(data->tty_fd, data->tty_buf, TTY_BATCH_BUFFER_LENGTH);
+    if (_tty_login(data->tty_fd, data->tty_buf, TTY_BATCH_BUFFER_LENGTH) != 0) {
+        dev_err(data->dev, "Failed to login TTY device\n");
+        _tty_close(&data->tty_fd);
+        return -ENOENT;
     }
-
-    _tty_clear_rxbuf(tty_fd, buf, buf_size);
-    if (_tty_login(tty_fd, buf, buf_size) != 0) {
-        dev_err(wedge_data->dev, "Failed to login TTY device\n");
-        _tty_close(&tty_fd);
-        ret = -ENOENT;
-        goto exit;
+    if (_tty_writeNread(data->tty_fd, TTY_PSU_HELPER, data->tty_buf,
+                        TTY_BATCH_BUFFER_LENGTH, TTY_RETRY_INTERVAL) < 0) {
+        _tty_close(&data->tty_fd);
+        return -EAGAIN;
     }
+    data->logged_in = true;
+    return 0;
+}
 
-    i = 0;
-    do {
-        ret = _tty_writeNread(tty_fd, cmd, buf, buf_size, 200);
-        if (ret < 0) {
-            goto exit;
-        }
-        i++;
-    } while(strstr(buf, TTY_PROMPT) == NULL && i <= TTY_CMD_RETRY);
-    if (i > TTY_CMD_RETRY) {
-        dev_err(wedge_data->dev, "Failed on tty_transaction\n");
-        ret = -ENOENT;
-        goto exit;
+static void _tty_session_put(struct wedge100_data *data)
+{
+    if (data->tty_fd != NULL)
+        _tty_close(&data->tty_fd);
+    data->logged_in = false;
+}
+
+/*
+ * Send the batch command and read its output up to the end marker
+ * into data->tty_buf. If the BMC does not answer (logged out, rebooted),
+ * the session is dropped and set up again before the next attempt.
+ */
+static int bmc_transaction(struct wedge100_data *data, const char *cmd)
+{
+    mm_segment_t old_fs;
+    int i, ret = -EAGAIN;
+
+    if (!cmd || !data->tty_buf)
+        return -EINVAL;
+
+    for (i = 0; i < TTY_BATCH_RETRY; i++) {
+        ret = _tty_session_get(data);
+        if (ret < 0)
+            continue;
+
+        /*Drop the prompt and anything else left by the last batch.*/
+        _tty_clear_rxbuf(data->tty_fd, data->tty_buf, TTY_BATCH_BUFFER_LENGTH);
+        old_fs = get_fs();
+        set_fs(KERNEL_DS);
+        ret = _tty_tx(data->tty_fd, cmd);
+        set_fs(old_fs);
+        if (ret >= 0)
+            ret = _tty_rx_until(data->tty_fd, data->tty_buf,
+                                TTY_BATCH_BUFFER_LENGTH, TTY_BATCH_END,
+                                TTY_BATCH_TIMEOUT);
+        if (ret >= 0)
+            return 0;
+
+        _tty_session_put(data);
     }
 
-    strncpy(resp, buf, max);
-exit:
-    kfree(buf);
-    _tty_close(&tty_fd);
+    dev_err(data->dev, "Failed on tty_transaction ret:%d\n", ret);
     return ret;
 }
 
-
 static void dev_attr_init(struct device_attribute *dev_attr,
                           const char *name, umode_t mode,
                           show_func show, store_func store)
@@ -744,6 +876,25 @@ static void dev_attr_init(struct device_attribute *dev_attr,
     dev_attr->store = store;
 }
 
+/*Attributes every model has, ahead of the sensor ones.*/
+struct fixed_attr {
+    const char *name;
+    umode_t mode;
+    show_func show;
+    store_func store;
+    int index;
+};
+
+static const struct fixed_attr fixed_attrs[] = {
+    { "name", S_IRUGO, show_name, NULL, INDEX_NAME },
+    { "age_ms", S_IRUGO, show_age, NULL, INDEX_AGE },
+    { "last_update_ms", S_IRUGO, show_age, NULL, INDEX_LAST_UPDATE },
+    { "update_interval_ms", S_IRUGO | S_IWUSR, show_update_interval,
+      set_update_interval, INDEX_UPDATE_INTERVAL },
+    { "update_cur_interval_ms", S_IRUGO, show_cur_interval, NULL, INDEX_CUR_INTERVAL },
+    { "valid", S_IRUGO, show_valid, NULL, INDEX_VALID },
+};
+
 /*Allowcat sensor_device_attributes and adds them to a group.*/
 static int attributs_init(struct wedge100_data *data)
 {
@@ -754,18 +905,22 @@ static int attributs_init(struct wedge100_data *data)
     struct sensor_device_attribute *sensor_dattr;
     struct device_attribute *dev_attr;
 
-    /*name*/
-    sensor = devm_kzalloc(data->dev, sizeof(*sensor), GFP_KERNEL);
-    if (!sensor)
-        return -ENOENT;
-    sensor_dattr = &sensor->sensor_dev_attr;
-    dev_attr = &sensor_dattr->dev_attr;
-    snprintf(sensor->name, sizeof(sensor->name), "name");
-    dev_attr_init(dev_attr, sensor->name, S_IRUGO, show_name, NULL);
-    sensor_dattr->index = INDEX_NAME;
-    ret = add_attr2group(data, &dev_attr->attr);
-    if (ret)
-        return ret;
+    /*name, age_ms and the refresh cache*/
+    for (ai = 0; ai < ARRAY_SIZE(fixed_attrs); ai++) {
+        const struct fixed_attr *fa = &fixed_attrs[ai];
+
+        sensor = devm_kzalloc(data->dev, sizeof(*sensor), GFP_KERNEL);
+        if (!sensor)
+            return -ENOENT;
+        sensor_dattr = &sensor->sensor_dev_attr;
+        dev_attr = &sensor_dattr->dev_attr;
+        snprintf(sensor->name, sizeof(sensor->name), "%s", fa->name);
+        dev_attr_init(dev_attr, sensor->name, fa->mode, fa->show, fa->store);
+        sensor_dattr->index = fa->index;
+        ret = add_attr2group(data, &dev_attr->attr);
+        if (ret)
+            return ret;
+    }
 
     /*types*/
     for (si = 0; si < SENSOR_TYPE_MAX; si++)
@@ -807,9 +962,38 @@ static int attributs_init(struct wedge100_data *data)
 
     return 0 ;
 }
-static void wedge_data_init(struct wedge100_data *data)
+/*
+ * One command line for all the sensor types of the model, each output
+ * preceded by its marker:
+ *   echo "#""@0"; <tty_cmd[0]>; echo "#""@1"; ...; echo "#""@E"
+ */
+static int build_batch_cmd(char *cmd, size_t size)
 {
+    struct sensor_set *model = model_ssets[model_id];
+    int type, len = 0;
+
+    for (type = 0; type < SENSOR_TYPE_MAX; type++) {
+        if (model[type].total == 0)
+            continue;
+        len += snprintf(cmd + len, size - len, "echo \"#\"\"@%d\"; %s; ",
+                        type, tty_cmd[type]);
+        if (len >= size)
+            return -ENOSPC;
+    }
+    len += snprintf(cmd + len, size - len, "echo \"#\"\"@E\"\r\n");
+    if (len >= size)
+        return -ENOSPC;
 
+    return 0;
+}
+
+static int wedge_data_init(struct wedge100_data *data)
+{
+    data->tty_buf = kzalloc(TTY_BATCH_BUFFER_LENGTH, GFP_KERNEL);
+    if (!data->tty_buf)
+        return -ENOMEM;
+
+    return build_batch_cmd(tty_batch_cmd, sizeof(tty_batch_cmd));
 }
 
 static int extract_numbers(char *buf, int *out, int out_cnt)
@@ -844,50 +1028,44 @@ static int extract_numbers(char *buf, int *out, int out_cnt)
     return  -EINVAL;
 }
 
-static int extract_2byteHex(char *buf, int *out, int out_cnt)
+/*
+ * Decode a "%<n>:<hex>:<sum>" frame into out_cnt words, most significant
+ * byte first. The length has to match and the checksum has to agree.
+ */
+static int extract_frame(char *buf, int *out, int out_cnt)
 {
-    char tmp[TTY_READ_MAX_LEN];
-    char *ptr;
-    int  cnt, x;
-    long y;
+    char *ptr, *end;
+    unsigned int len, i;
+    u8 byte, csum, sum = 0;
 
-    ptr = buf;
-    /*replace non-hex into '|', for sscanf(%s)'s ease to handle it.*/
-    for (x = 0; x < strlen(ptr); x++) {
-        if((ptr[x]>='0' && ptr[x] <= '9') || (ptr[x] >= 'a' && ptr[x] <= 'f'))
-            ;
+    ptr = strchr(buf, TTY_FRAME_START);
+    if (ptr == NULL)
+        return -EINVAL;
+    end = strchr(++ptr, TTY_FRAME_SEP);
+    if (end == NULL)
+        return -EINVAL;
+    *end = '\0';
+    if (kstrtouint(ptr, 10, &len) < 0 || len != out_cnt * 2)
+        return -EINVAL;
+
+    ptr = end + 1;
+    if (strlen(ptr) < len * 2 + 3 || ptr[len * 2] != TTY_FRAME_SEP)
+        return -EINVAL;
+    for (i = 0; i < len; i++) {
+        if (hex2bin(&byte, ptr + i * 2, 1) < 0)
+            return -EINVAL;
+        sum += byte;
+        if (i % 2)
+            out[i / 2] |= byte;
         else
-            ptr[x] = TTY_RESP_SEPARATOR;
+            out[i / 2] = byte << 8;
     }
-
-    DEBUG_LEX("%s-%d, (%lu) resp:%s\n", __func__, __LINE__, strlen(ptr), ptr);
-    cnt = 0;
-    while (strchr(ptr, TTY_RESP_SEPARATOR))
-    {
-        ptr++;
-        if (strlen(ptr) && *ptr == TTY_RESP_SEPARATOR) {
-            continue;
-        }
-        DEBUG_LEX("%s-%d, (%lu) :%s\n", __func__, __LINE__, strlen(ptr), ptr);
-        if (sscanf(ptr,"%4s",tmp)) {
-            if(!strchr(tmp, TTY_RESP_SEPARATOR)) {
-                DEBUG_LEX("%s-%d,  %s @(%d)\n", __func__, __LINE__,  tmp, cnt);
-                if (kstrtol(tmp, 16, &y) < 0)
-                    return -EINVAL;
-                *out = (int)y;
-                cnt++;
-                out++;
-                if (cnt == out_cnt) {
-                    return 0;
-                }
-                ptr += 4;
-            }
-        } else {
-            break;
-        }
+    if (hex2bin(&csum, ptr + len * 2 + 1, 1) < 0 || csum != sum) {
+        DEBUG_INTR("%s-%d, checksum %02x != %02x\n", __func__, __LINE__, csum, sum);
+        return -EIO;
     }
 
-    return  -EINVAL;
+    return 0;
 }
 
 int pmbus_linear11(int in, bool power) {
@@ -931,30 +1109,11 @@ static int get_pmbus_regs_partial(int *in, int in_cnt, int *out, int *out_cnt)
 }
 
 
-static int comm2BMC(enum sensor_type type, int *out, int out_cnt)
+static int parse_type_resp(enum sensor_type type, char *ptr,
+                           int *out, int out_cnt)
 {
-    char cmd[TTY_CMD_MAX_LEN], resp[TTY_READ_MAX_LEN];
-    char *ptr;
     int ret;
 
-    if (out == NULL)
-        return -EINVAL;
-    if (out_cnt == 0)
-        return 0;
-
-    snprintf(cmd, sizeof(cmd), tty_cmd[type]);
-    DEBUG_INTR("%s-%d, cmd:%s\n", __func__, __LINE__, cmd);
-    ret = bmc_transaction(cmd, resp, sizeof(resp)-1);
-    if (ret < 0)
-        return ret;
-
-    /*Strip off string of command just sent, if any.*/
-    if (strstr(resp, cmd) != NULL) {
-        ptr = resp + strlen(cmd);
-    } else {
-        ptr = resp;
-    }
-
     switch (type) {
     case SENSOR_TYPE_THERMAL_IN:
     case SENSOR_TYPE_THERMAL_MAX:
@@ -968,7 +1127,7 @@ static int comm2BMC(enum sensor_type type, int *out, int out_cnt)
     {
         int reg[(PMBUS_REG_END - PMBUS_REG_START) +1];
         int total = (PMBUS_REG_END - PMBUS_REG_START) +1;
-        ret = extract_2byteHex(ptr, reg, total);
+        ret = extract_frame(ptr, reg, total);
         get_pmbus_regs_partial(reg, total, out, &out_cnt);
         break;
     }
@@ -980,6 +1139,60 @@ static int comm2BMC(enum sensor_type type, int *out, int out_cnt)
     return 0;
 }
 
+static int get_type_data (
+    struct sensor_data *data, enum sensor_type type, int index,
+    int **out, int *count);
+
+/*
+ * Refresh every sensor type with a single BMC round trip, then split
+ * the response at the section markers. A type whose section is missing
+ * or does not parse is invalidated alone.
+ */
+static int comm2BMC(struct wedge100_data *data)
+{
+    char marker[8];
+    char *ptr, *start, *next;
+    int *out, out_cnt;
+    int type, ret;
+
+    ret = bmc_transaction(data, tty_batch_cmd);
+
+    ptr = data->tty_buf;
+    for (type = 0; type < SENSOR_TYPE_MAX; type++) {
+        if (get_type_data(&data->sdata, type, 0, &out, &out_cnt) < 0
+                || out_cnt == 0)
+            continue;
+
+        data->valid[type] = 0;
+        data->last_updated[type] = jiffies;
+        if (ret < 0)
+            goto clear;
+
+        snprintf(marker, sizeof(marker), TTY_BATCH_MARK"%d", type);
+        start = strstr(ptr, marker);
+        if (start == NULL)
+            goto clear;
+        start += strlen(marker);
+        next = strstr(start, TTY_BATCH_MARK);
+        if (next == NULL)
+            goto clear;
+
+        /*Parsers work in place, limit them to this section.*/
+        *next = '\0';
+        if (parse_type_resp(type, start, out, out_cnt) == 0)
+            data->valid[type] = 1;
+        *next = TTY_BATCH_MARK[0];
+        ptr = next;
+        if (data->valid[type])
+            continue;
+clear:
+        /*Clear data if failed.*/
+        memset(out, 0, sizeof(*out)*out_cnt);
+    }
+
+    return ret;
+}
+
 static int get_type_data (
     struct sensor_data *data, enum sensor_type type, int index,
     int **out, int *count)
@@ -1015,39 +1228,60 @@ static int get_type_data (
     return 0;
 }
 
-static struct sensor_data*
-update_data(struct device *dev, enum sensor_type type) {
-    struct wedge100_data *data = wedge_data;
-    bool			*valid = &data->valid[type];
-    unsigned long   *last_updated = &data->last_updated[type];
-    struct sensor_data* ret = NULL;
-    int *data_ptr = NULL;
-    int data_cnt, rc;
+/*
+ * Caller holds update_lock, before the new readings are published.  The
+ * period until the next refresh: back to interval on any sign of change,
+ * else twice the current one.
+ */
+static unsigned int refresh_next_interval(struct wedge100_data *data,
+                                          unsigned int interval)
+{
+    struct sensor_set *model = model_ssets[model_id];
+    unsigned int limit = min_t(unsigned int, update_max_interval, SENSOR_DATA_UPDATE_MAX);
+    int type, i;
 
-    mutex_lock(&data->update_lock);
-    if (time_after(jiffies, (*last_updated) + SENSOR_DATA_UPDATE_INTERVAL)
-            || !(*valid))
-    {
-        rc = get_type_data(&data->sdata, type, 0, &data_ptr, &data_cnt);
-        if (rc < 0)
-            goto exit_err;
-
-        DEBUG_INTR("%s-%d, type:%d cnt:%d\n", __func__, __LINE__, type, data_cnt);
-        rc = comm2BMC(type, data_ptr, data_cnt);
-        if (rc < 0) {
-            *valid = 0;
-            /*Clear data if failed.*/
-            if (data_ptr != NULL)
-                memset(data_ptr, 0, sizeof(*data_ptr)*data_cnt);
-        } else {
-            *valid = 1;
-        }
-        *last_updated = jiffies;
+    if (limit <= interval || !data->snap_time)
+        return interval;
+
+    for (type = 0; type < SENSOR_TYPE_MAX; type++) {
+        if (model[type].total &&
+                (!data->valid[type] || !data->snap_valid[type]))
+            return interval;
+    }
+
+    for (i = 0; i < model[SENSOR_TYPE_THERMAL_IN].total; i++) {
+        if (abs(data->sdata.lm75_input[i] - data->snap.lm75_input[i]) >
+                update_deadband)
+            return interval;
     }
-    ret =  &data->sdata;
-exit_err:
+
+    return min(max(data->cur_interval, interval) * 2, limit);
+}
+
+/*
+ * The BMC exchange takes a second or more, so it runs here and never
+ * under a sysfs read. Readers only copy the snapshot published below.
+ */
+static void refresh_work_handler(struct work_struct *work)
+{
+    struct wedge100_data *data = container_of(to_delayed_work(work),
+                                 struct wedge100_data, refresh_work);
+    unsigned int interval = max_t(unsigned int, update_interval, SENSOR_DATA_UPDATE_MIN);
+
+    mutex_lock(&data->update_lock);
+    comm2BMC(data);
+    interval = refresh_next_interval(data, interval);
+    data->cur_interval = interval;
+
+    write_seqlock(&data->snap_lock);
+    data->snap = data->sdata;
+    memcpy(data->snap_valid, data->valid, sizeof(data->snap_valid));
+    data->snap_time = jiffies;
+    write_sequnlock(&data->snap_lock);
     mutex_unlock(&data->update_lock);
-    return ret;
+
+    queue_delayed_work(system_long_wq, &data->refresh_work,
+                       msecs_to_jiffies(interval));
 }
 
 static ssize_t show_name(struct device *dev, struct device_attribute *da,
@@ -1056,28 +1290,105 @@ static ssize_t show_name(struct device *dev, struct device_attribute *da,
     return sprintf(buf, "%s\n", DRVNAME);
 }
 
+/*
+ * 1 when every sensor type of the model parsed at the last refresh,
+ * 0 before the first refresh and when some values are zeroed for a
+ * failed BMC answer.
+ */
+static int snap_get_valid(struct wedge100_data *data, unsigned long *snap_time)
+{
+    struct sensor_set *model = model_ssets[model_id];
+    unsigned int seq;
+    int type, valid;
+
+    do {
+        seq = read_seqbegin(&data->snap_lock);
+        *snap_time = data->snap_time;
+        valid = (*snap_time != 0);
+        for (type = 0; type < SENSOR_TYPE_MAX; type++) {
+            if (model[type].total && !data->snap_valid[type])
+                valid = 0;
+        }
+    } while (read_seqretry(&data->snap_lock, seq));
+
+    return valid;
+}
+
+/*-1 while valid reads 0, like the fan and PSU cores.*/
+static ssize_t show_age(struct device *dev, struct device_attribute *da,
+                        char *buf)
+{
+    unsigned long snap_time;
+
+    if (!snap_get_valid(wedge_data, &snap_time))
+        return sprintf(buf, "-1\n");
+
+    return sprintf(buf, "%u\n", jiffies_to_msecs(jiffies - snap_time));
+}
+
+static ssize_t show_update_interval(struct device *dev, struct device_attribute *da,
+                                    char *buf)
+{
+    return sprintf(buf, "%u\n",
+                   max_t(unsigned int, update_interval, SENSOR_DATA_UPDATE_MIN));
+}
+
+static ssize_t show_cur_interval(struct device *dev, struct device_attribute *da,
+                                 char *buf)
+{
+    return sprintf(buf, "%u\n", wedge_data->cur_interval);
+}
+
+/*Same as the module parameter, taken at the next refresh.*/
+static ssize_t set_update_interval(struct device *dev, struct device_attribute *da,
+                                   const char *buf, size_t count)
+{
+    unsigned int value;
+    int ret;
+
+    ret = kstrtouint(buf, 10, &value);
+    if (ret)
+        return ret;
+    if (value < SENSOR_DATA_UPDATE_MIN || value > SENSOR_DATA_UPDATE_MAX)
+        return -EINVAL;
+
+    update_interval = value;
+    return count;
+}
+
+static ssize_t show_valid(struct device *dev, struct device_attribute *da,
+                          char *buf)
+{
+    unsigned long snap_time;
+
+    return sprintf(buf, "%d\n", snap_get_valid(wedge_data, &snap_time));
+}
+
 static ssize_t _attr_show(struct device *dev, struct device_attribute *da,
                           char *buf, enum sensor_type type,  int index_start)
 {
-    int index, count, rc;
+    int index, count, rc, val;
     struct sensor_device_attribute *attr = to_sensor_dev_attr(da);
-    struct sensor_data* data;
+    struct wedge100_data *data = wedge_data;
+    unsigned int seq;
     int *out = NULL;
 
     DEBUG_INTR("%s-%d, type:%d start:%d\n", __func__, __LINE__, type, index_start);
-    data = update_data(dev, type);
-    if (data == NULL)
-        return -EINVAL;
-
     index = attr->index - index_start;
-    rc = get_type_data(data, type, index, &out, &count);
+    do {
+        seq = read_seqbegin(&data->snap_lock);
+        rc = get_type_data(&data->snap, type, index, &out, &count);
+        if (rc == 0 && out != NULL)
+            val = *out;
+    } while (read_seqretry(&data->snap_lock, seq));
+
     if (rc < 0 || out == NULL)
         return -EINVAL;
 
     if( index > count)
         return -EINVAL;
 
-    return sprintf(buf, "%d\n",  *out);
+    return sprintf(buf, "%d\n",  val);
 }
 
 static ssize_t show_thermal(struct device *dev, struct device_attribute *da,
@@ -1187,6 +1498,7 @@ static int wedge100_probe(struct platform_device *pdev)
         goto exit_remove;
     }
     dev_info(&pdev->dev, "wedge100bf sensors found\n");
+    queue_delayed_work(system_long_wq, &wedge_data->refresh_work, 0);
     return 0;
 
 exit_remove:
@@ -1199,9 +1511,13 @@ exit:
 
 static int wedge100_remove(struct platform_device *pdev)
 {
+    cancel_delayed_work_sync(&wedge_data->refresh_work);
     hwmon_device_unregister(wedge_data->hwmon_dev);
     sysfs_remove_group(&pdev->dev.kobj, &wedge_data->group);
     kfree(wedge_data->group.attrs);
+    mutex_lock(&wedge_data->update_lock);
+    _tty_session_put(wedge_data);
+    mutex_unlock(&wedge_data->update_lock);
     return 0;
 }
 
@@ -1230,12 +1546,21 @@ static int __init wedge100_init(void)
         goto exit;
     }
     mutex_init(&wedge_data->update_lock);
-    wedge_data_init(wedge_data);
+    seqlock_init(&wedge_data->snap_lock);
+    INIT_DELAYED_WORK(&wedge_data->refresh_work, refresh_work_handler);
+    ret = wedge_data_init(wedge_data);
+    if (ret < 0) {
+        platform_driver_unregister(&wedge100_driver);
+        kfree(wedge_data->tty_buf);
+        kfree(wedge_data);
+        goto exit;
+    }
 
     wedge_data->pdev = platform_device_register_simple(DRVNAME, -1, NULL, 0);
     if (IS_ERR(wedge_data->pdev)) {
         ret = PTR_ERR(wedge_data->pdev);
         platform_driver_unregister(&wedge100_driver);
+        kfree(wedge_data->tty_buf);
         kfree(wedge_data);
         goto exit;
     }
@@ -1250,6 +1575,7 @@ static void __exit wedge100_exit(void)
     }
     platform_device_unregister(wedge_data->pdev);
     platform_driver_unregister(&wedge100_driver);
+    kfree(wedge_data->tty_buf);
     kfree(wedge_data);
 }
 
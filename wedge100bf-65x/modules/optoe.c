@@ -0,0 +1 @@
+../../as7716-32x/modules/optoe.c
\ No newline at end of file